@@ -117,43 +117,58 @@ extern volatile int interrupts_isrFlagGlobal;
 
 #else /* not ZYBO_BOARD */
 
+// Host build: these are implemented by the simulated hardware layer in
+// platforms/host (see hostSim.h for how simulated time is advanced).
+
+#include "instance.h"
+
 #define INTERRUPT_CUMULATIVE_ISR_INTERVAL_TIMER_NUMBER 0
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-int interrupts_initAll(__attribute__((unused)) bool printFailedStatusFlag);
-
-// User can set the load value on the private timer.
-// Also updates ticks per heart beat so that the LD4 heart-beat toggle rate
-// remains constant.
-void interrupts_setPrivateTimerLoadValue(u32 loadValue);
-
-u32 interrupts_getPrivateTimerTicksPerSecond();
+int interrupts_initAll(bool printFailedStatusFlag);
 
 // Enable/disable ARM ints.
 int interrupts_enableArmInts();
 int interrupts_disableArmInts();
 
+// Enable/disable the global timer int output.
+int interrupts_enableTimerGlobalInts();
+int interrupts_disableTimerGlobalInts();
+
 // Starts/stops the interrupt timer.
 int interrupts_startArmPrivateTimer();
 int interrupts_stopArmPrivateTimer();
 
+u32 interrupts_getPrivateTimerCounterValue(void);
+void interrupts_setPrivateTimerLoadValue(u32 loadValue);
+void interrupts_setPrivateTimerPrescalerValue(u32 prescalerValue);
+
 // Keep track of total number of times interrupt_timerIsr is invoked.
 u32 interrupts_isrInvocationCount();
 
 // Returns the number of private timer ticks that occur in 1 second.
 u32 interrupts_getPrivateTimerTicksPerSecond();
 
-// These two functions are provided mainly to remain compatible
-// with code given to students.
-void interrupts_enableTimerGlobalInts();
-void interrupts_disableTimerGlobalInts();
+// Used to determine the input mode for the ADC.
+bool interrupts_getAdcInputMode();
 
+// Use this to read the latest ADC conversion.
+uint32_t interrupts_getAdcData();
+
+u32 interrupts_getTotalEocCount();
 void isr_function();
 
-extern volatile int interrupts_isrFlagGlobal;
+// Init/Enable/disable interrupts for the bluetooth radio (RDYN line).
+uint32_t interrupts_initBluetoothInterrupts();
+void interrupts_enableBluetoothInterrupts();
+void interrupts_disableBluetoothInterrupts();
+void interrupts_ackBluetoothInterrupts();
+
+// Each simulated gun has its own flag (see lasertag/instance.h).
+extern INSTANCE_LOCAL volatile int interrupts_isrFlagGlobal;
 
 #ifdef __cplusplus
 } // extern "C'
@@ -0,0 +1,159 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <string.h>
+
+#include "amp.h"
+
+#ifdef ZYBO_BOARD
+#include "xil_io.h"
+#include "xil_mmu.h"
+#include "xpseudo_asm.h"
+#include "xtime_l.h"
+
+// Top 64 KB of OCM. The FSBL maps OCM high; the last word is the CPU1 start
+// vector, so the shared region stays well below it.
+#define AMP_SHARED_ADDRESS 0xFFFF0000
+// Section attributes for shareable, non-cacheable normal memory (TEX=4,
+// C=B=0, S=1), as in Xilinx XAPP1079.
+#define AMP_OCM_ATTRIBUTES 0x14de2
+// CPU1 sleeps in the boot ROM until an event, then jumps to this address.
+#define CPU1_START_VECTOR 0xFFFFFFF0
+// Where the CPU1 image is linked (see lscript_cpu1.ld).
+#define CPU1_START_ADDRESS 0x10000000
+#else
+#include <sched.h>
+#include <time.h>
+
+#define NANOSECONDS_PER_SECOND 1000000000ull
+#endif
+
+#define AMP_MAGIC 0x414D5031 // "AMP1"
+
+#ifndef ZYBO_BOARD
+static amp_shared_t hostShared;
+#endif
+
+// Returns the region shared by the two cores.
+amp_shared_t *amp_getShared(void) {
+#ifdef ZYBO_BOARD
+  return (amp_shared_t *)AMP_SHARED_ADDRESS;
+#else
+  return &hostShared;
+#endif
+}
+
+// Called by CPU0 before it starts CPU1: makes the region uncached and empties
+// the rings.
+void amp_init(void) {
+  amp_shared_t *shared = amp_getShared();
+#ifdef ZYBO_BOARD
+  Xil_SetTlbAttributes(AMP_SHARED_ADDRESS, AMP_OCM_ATTRIBUTES);
+#endif
+  memset(shared, 0, sizeof(*shared));
+  shared->magic = AMP_MAGIC;
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+// Wake CPU1 and wait until it reports that it is running.
+void amp_startDetectorCore(void) {
+  amp_shared_t *shared = amp_getShared();
+#ifdef ZYBO_BOARD
+  Xil_Out32(CPU1_START_VECTOR, CPU1_START_ADDRESS);
+  dmb();
+  sev(); // CPU1 leaves wfe in the boot ROM.
+#endif
+  while (__atomic_load_n(&shared->cpu1State, __ATOMIC_ACQUIRE) != AMP_CPU1_RUNNING) {
+#ifndef ZYBO_BOARD
+    sched_yield();
+#endif
+  }
+}
+
+// Add a message to a ring. Only one core may push to a given ring.
+bool amp_push(amp_ring_t *ring, amp_messageType_t type, uint16_t argument,
+              uint32_t value) {
+  uint32_t head = ring->head; // Only this core writes head.
+  uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  if (head - tail == AMP_RING_SIZE) {
+    ring->rejected++;
+    return false;
+  }
+  amp_message_t *slot = &ring->slots[head % AMP_RING_SIZE];
+  slot->type = type;
+  slot->argument = argument;
+  slot->value = value;
+  // The slot must be visible before the new head.
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+// Take the oldest message from a ring. Only one core may pop from a given
+// ring.
+bool amp_pop(amp_ring_t *ring, amp_message_t *message) {
+  uint32_t tail = ring->tail; // Only this core writes tail.
+  uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  if (head == tail)
+    return false;
+  *message = ring->slots[tail % AMP_RING_SIZE];
+  // The slot must be read before the producer may reuse it.
+  __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+// Returns the number of messages waiting in a ring.
+uint32_t amp_ringElements(const amp_ring_t *ring) {
+  return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) -
+         __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
+
+// CPU1 publishes its load. The sequence count is odd while the copy is being
+// written, so a reader that sees an odd or changed count tries again.
+void amp_publishStats(const amp_stats_t *stats) {
+  amp_shared_t *shared = amp_getShared();
+  uint32_t sequence = shared->statsSequence;
+  __atomic_store_n(&shared->statsSequence, sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  shared->stats = *stats;
+  __atomic_store_n(&shared->statsSequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+// CPU0 reads a consistent copy of the load published by CPU1.
+void amp_readStats(amp_stats_t *stats) {
+  amp_shared_t *shared = amp_getShared();
+  uint32_t before, after;
+  do {
+    before = __atomic_load_n(&shared->statsSequence, __ATOMIC_ACQUIRE);
+    *stats = shared->stats;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    after = __atomic_load_n(&shared->statsSequence, __ATOMIC_RELAXED);
+  } while ((before & 1) || before != after);
+}
+
+// A clock both cores read identically.
+uint64_t amp_getTime(void) {
+#ifdef ZYBO_BOARD
+  XTime time;
+  XTime_GetTime(&time); // The global timer, shared by both cores.
+  return time;
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec;
+#endif
+}
+
+// Rate of amp_getTime().
+uint64_t amp_getTimeTicksPerSecond(void) {
+#ifdef ZYBO_BOARD
+  return COUNTS_PER_SECOND;
+#else
+  return NANOSECONDS_PER_SECOND;
+#endif
+}
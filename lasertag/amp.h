@@ -0,0 +1,127 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef AMP_H_
+#define AMP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "filter.h"
+
+// Inter-core protocol for the asymmetric multiprocessing (AMP) build. CPU1
+// runs the ADC interrupt, the lockout and hit-LED timers and detector()
+// (see detectorCore.h); CPU0 runs the game, the histogram and sound, and
+// talks to the detector through remoteDetector.c, which provides the usual
+// detector_* functions.
+//
+// The cores share one amp_shared_t. On the board it lives in the top 64 KB of
+// on-chip memory (OCM), which both cores map as shareable and uncached, so no
+// cache maintenance is needed. On the host it is a global shared by the two
+// threads that play the cores.
+//
+// Messages flow through two single-producer single-consumer rings, one per
+// direction. Each index is written by one side only, on its own cache line,
+// and is published with a release store after the slot is written (a DMB on
+// the Cortex-A9), so neither side ever takes a lock or waits for the other.
+// A full ring rejects the message and counts it.
+
+#define AMP_RING_SIZE 256 // Messages per ring; a power of two.
+#define AMP_CACHE_LINE_BYTES 32 // Cortex-A9 L1 line.
+
+typedef enum {
+  // CPU0 to CPU1.
+  AMP_MESSAGE_RESET,            // detector_init(): clear hit counts and flags.
+  AMP_MESSAGE_SET_IGNORED,      // value: bit n set ignores frequency n.
+  AMP_MESSAGE_IGNORE_ALL_HITS,  // argument: true to ignore every hit.
+  AMP_MESSAGE_SET_FUDGE_FACTOR, // argument: fudge-factor index.
+  AMP_MESSAGE_STOP,             // Leave detectorCore_run().
+  // CPU1 to CPU0.
+  AMP_MESSAGE_HIT,              // argument: frequency, value: ADC tick of the hit.
+} amp_messageType_t;
+
+typedef struct {
+  uint16_t type;     // amp_messageType_t
+  uint16_t argument;
+  uint32_t value;
+} amp_message_t;
+
+typedef struct {
+  volatile uint32_t head; // Next slot to write. Written by the producer only.
+  uint8_t headPadding[AMP_CACHE_LINE_BYTES - sizeof(uint32_t)];
+  volatile uint32_t tail; // Next slot to read. Written by the consumer only.
+  uint8_t tailPadding[AMP_CACHE_LINE_BYTES - sizeof(uint32_t)];
+  volatile uint32_t rejected; // Pushes that found the ring full.
+  uint8_t rejectedPadding[AMP_CACHE_LINE_BYTES - sizeof(uint32_t)];
+  amp_message_t slots[AMP_RING_SIZE];
+} amp_ring_t;
+
+// Detector-core load and filter powers, published by CPU1 about every
+// AMP_STATS_INTERVAL_TICKS and just before each hit is sent. Times are in
+// amp_getTime() units.
+typedef struct {
+  uint64_t runTime;      // Since detectorCore_run() started.
+  uint64_t busyTime;     // Spent filtering, i.e. not waiting for samples.
+  uint32_t ticks;        // ADC samples taken by the CPU1 timer ISR.
+  uint32_t detectorInvocations;
+  uint32_t bufferHighWater; // Most samples waiting in the ADC buffer.
+  uint32_t hits;
+  uint32_t filterRuns;        // IIR filters run (detector_getFilterRunCounts())...
+  uint32_t filterRunsSkipped; // ...and skipped by the masked filter bank.
+  double powerValues[FILTER_FREQUENCY_COUNT]; // filter_getCurrentPowerValues().
+} amp_stats_t;
+
+#define AMP_STATS_INTERVAL_TICKS 10000 // 100 ms.
+
+#define AMP_CPU1_OFF 0
+#define AMP_CPU1_RUNNING 1
+#define AMP_CPU1_STOPPED 2
+
+typedef struct {
+  uint32_t magic;
+  volatile uint32_t cpu1State; // AMP_CPU1_*
+  amp_ring_t toDetector;       // CPU0 to CPU1.
+  amp_ring_t toGame;           // CPU1 to CPU0.
+  volatile uint32_t statsSequence; // Odd while CPU1 is updating stats.
+  amp_stats_t stats;
+} amp_shared_t;
+
+// Returns the region shared by the two cores.
+amp_shared_t *amp_getShared(void);
+
+// Called by CPU0 before it starts CPU1: makes the region uncached and empties
+// the rings.
+void amp_init(void);
+
+// Wake CPU1 and wait until it reports that it is running. On the host the
+// simulator starts the CPU1 thread itself and this only waits.
+void amp_startDetectorCore(void);
+
+// Add a message to a ring. Only one core may push to a given ring. Returns
+// false if the ring is full.
+bool amp_push(amp_ring_t *ring, amp_messageType_t type, uint16_t argument,
+              uint32_t value);
+
+// Take the oldest message from a ring. Only one core may pop from a given
+// ring. Returns false if the ring is empty.
+bool amp_pop(amp_ring_t *ring, amp_message_t *message);
+
+// Returns the number of messages waiting in a ring.
+uint32_t amp_ringElements(const amp_ring_t *ring);
+
+// CPU1 publishes its load. CPU0 reads a consistent copy with amp_readStats().
+void amp_publishStats(const amp_stats_t *stats);
+void amp_readStats(amp_stats_t *stats);
+
+// A clock both cores read identically: the Zynq global timer on the board,
+// CLOCK_MONOTONIC on the host.
+uint64_t amp_getTime(void);
+uint64_t amp_getTimeTicksPerSecond(void);
+
+#endif /* AMP_H_ */
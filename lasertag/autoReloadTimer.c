@@ -0,0 +1,74 @@
+#include "autoReloadTimer.h"
+#include "gameEngine.h"
+#include "instance.h"
+#include "sampleRate.h"
+#include "trigger.h"
+
+// The autoReloadTimer is started by the game engine when the clip runs dry.
+// When it expires it loads AUTO_RELOAD_SHOT_VALUE shots into the trigger
+// state machine and tells the game engine with GAME_EVENT_RELOAD_DONE.
+
+static INSTANCE_LOCAL volatile uint32_t ticks;
+static INSTANCE_LOCAL uint32_t expireValue = AUTO_RELOAD_EXPIRE_VALUE; // At the sample rate.
+
+// States for the controller state machine.
+enum autoReloadTimer_st_t {
+  waiting_st,  // Wait here until started
+  reloading_st // Count down the reload delay
+};
+static INSTANCE_LOCAL volatile enum autoReloadTimer_st_t currentState;
+
+// Need to init things.
+void autoReloadTimer_init() {
+  ticks = 0;
+  expireValue = sampleRate_ticks(AUTO_RELOAD_EXPIRE_VALUE);
+  currentState = waiting_st;
+}
+
+// Standard tick function.
+void autoReloadTimer_tick() {
+  // State updates
+  switch (currentState) {
+  case waiting_st:
+    break;
+  case reloading_st:
+    if (ticks >= expireValue) {
+      ticks = 0;
+      currentState = waiting_st;
+      trigger_setRemainingShotCount(AUTO_RELOAD_SHOT_VALUE);
+      gameEngine_postEvent(GAME_EVENT_RELOAD_DONE, 0);
+    }
+    break;
+  default:
+    // error
+    break;
+  }
+
+  // State actions
+  switch (currentState) {
+  case waiting_st:
+    break;
+  case reloading_st:
+    ticks++;
+    break;
+  default:
+    // error
+    break;
+  }
+}
+
+// Calling this starts the timer.
+void autoReloadTimer_start() {
+  ticks = 0;
+  currentState = reloading_st;
+}
+
+// Returns true if the timer is currently running.
+bool autoReloadTimer_running() {
+  return currentState == reloading_st;
+}
+
+// Disables the autoReloadTimer and re-initializes it.
+void autoReloadTimer_cancel() {
+  autoReloadTimer_init();
+}
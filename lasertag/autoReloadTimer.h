@@ -12,9 +12,9 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 
 #include <stdbool.h>
 
-// The auto-reload timer is always looking at the remaining shot-count from the
-// trigger state-machine. When it goes to 0, it starts a configurable delay and
-// after the delay expires, it sets the remaining shots to a specific value.
+// The auto-reload timer is started by the game engine when the clip runs dry.
+// After a configurable delay it sets the trigger state-machine's remaining
+// shots to a specific value and posts GAME_EVENT_RELOAD_DONE.
 
 #ifndef AUTO_RELOAD_EXPIRE_VALUE
 // Default, Defined in terms of 100 kHz ticks.
@@ -5,115 +5,236 @@
  *      Author: hutch
  */
 
-// DONT COMPILE AND LINK THIS INTO YOUR PROJECT.
-// IT IS ALREADY COMPILED INTO THE LASERTAG LIBRARY.
+// The bluetooth modem talks to the board through an AXI UART Lite with 16-byte
+// FIFOs. Characters move between the UART and two lock-free rings:
+//
+// - When the UART interrupt is wired to the GIC (BLUETOOTH_UART_INTR below),
+//   bluetooth_uartIsr() runs whenever the receive FIFO becomes non-empty or
+//   the transmit FIFO drains, and moves whole FIFOs at a time.
+// - Otherwise bluetooth_poll() does the same work from a timer ISR, as before.
+//
+// Each ring has one producer and one consumer (receive: ISR in, main loop out;
+// transmit: main loop in, ISR out), so neither side ever disables interrupts
+// to read or write it. Data are copied with memcpy() in at most two runs per
+// call, and the UART is read straight into the ring and written straight from
+// it.
 
-#include <Xuartlite.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "bluetooth.h"
+#include "instance.h"
+#include "interrupts.h"
+#include "utils.h"
 #include "xparameters.h"
+#include "xuartlite.h"
 
-static XUartLite bluetooth_uartInstance; // Handle to the bluetooth UART.
-static XUartLite_Config
-    bluetooth_uartConfig; // Handle to the bluetooth UART config.
+#ifdef ZYBO_BOARD
+#include "xscugic.h"
+// Present once the UART's interrupt output is connected to IRQ_F2P in the
+// hardware design.
+#ifdef XPAR_FABRIC_BLUETOOTH_UARTLITE_0_INTERRUPT_INTR
+#define BLUETOOTH_UART_INTR XPAR_FABRIC_BLUETOOTH_UARTLITE_0_INTERRUPT_INTR
+#endif
+#else
+#include "hostSim.h"
+#endif
 
-// This implements a dedicated buffer for storing values from the ADC
-// until they are read and processed by detector().
-// adcBuffer_t is similar to a queue.
-#define BLUETOOTH_QUEUE_SIZE 1000
+#define BLUETOOTH_QUEUE_SIZE 1024 // A power of two.
+#define BLUETOOTH_QUEUE_MASK (BLUETOOTH_QUEUE_SIZE - 1)
 #define BLUETOOTH_UART_FIFO_SIZE 16
+#define BLUETOOTH_LINE_SIZE 128
+#define BLUETOOTH_RESPONSE_WAIT_MS 200
+
+// Indices run freely and are masked on access, so the queue is empty when they
+// are equal and full when they differ by BLUETOOTH_QUEUE_SIZE. indexIn is only
+// written by the producer and indexOut only by the consumer.
 typedef struct {
-  uint16_t indexIn;                   // New values go here.
-  uint16_t indexOut;                  // Pull old values from here.
-  uint8_t data[BLUETOOTH_QUEUE_SIZE]; // Store values here.
-  uint16_t elementCount; // Number of values contained in adcBuffer_t.
-  uint16_t size;         // queue can hold this many elements.
+  volatile uint32_t indexIn;  // New values go here.
+  volatile uint32_t indexOut; // Pull old values from here.
+  uint8_t data[BLUETOOTH_QUEUE_SIZE];
 } bluetooth_queue_t;
 
-static bluetooth_queue_t
+static INSTANCE_LOCAL XUartLite bluetooth_uartInstance; // Handle to the bluetooth UART.
+static INSTANCE_LOCAL XUartLite_Config
+    bluetooth_uartConfig; // Handle to the bluetooth UART config.
+
+static INSTANCE_LOCAL bluetooth_queue_t
     bluetooth_receiveQueue; // characters read from the bluetooth UART go here.
-static bluetooth_queue_t
+static INSTANCE_LOCAL bluetooth_queue_t
     bluetooth_transmitQueue; // characters that need to be transmitted to the
                              // bluetooth UART go here.
 
+static INSTANCE_LOCAL bool interruptDriven;
+// True while the transmit FIFO holds bytes from the transmit queue, so a
+// transmit-empty interrupt is still to come.
+static INSTANCE_LOCAL volatile bool transmitting;
+static INSTANCE_LOCAL bluetooth_stats_t stats;
+
+#ifdef BLUETOOTH_UART_INTR
+static XScuGic bluetooth_gic; // Second handle onto the GIC set up by interrupts.c.
+#endif
+
+/*****************************************************************************
+***** Lock-free queue
+*****************************************************************************/
+
 // Init the q.
-void bluetooth_queueInit(bluetooth_queue_t *q, uint16_t size) {
+static void bluetooth_queueInit(bluetooth_queue_t *q) {
   q->indexIn = 0;
   q->indexOut = 0;
-  q->elementCount = 0;
-  q->size = size;
-}
-
-// Implemented as a fixed-size circular buffer.
-// indexIn always points to an empty location (by definition).
-// indexOut always points to the oldest element.
-// buffer is empty if indexIn == indexOut. Buffer is full if incremented indexIn
-// == indexOut
-void bluetooth_queuePush(bluetooth_queue_t *q, uint8_t data) {
-  if (q->elementCount <
-      q->size) // Increment the element count unless you are already full.
-    q->elementCount++;
-  q->data[q->indexIn] = data;              // write,
-  q->indexIn = (q->indexIn + 1) % q->size; // then increment.
-  if (q->indexIn ==
-      q->indexOut) { // If you are now pointing at the out pointer,
-    q->indexOut = (q->indexOut + 1) % q->size; // move the out pointer up.
-  }
 }
 
-// Removes a single item from the ADC buffer.
-// Does not signal an error if the ADC buffer is currently
-// empty. Simply returns a default value of 0 if the buffer is currently empty.
-uint8_t bluetooth_queuePop(bluetooth_queue_t *q) {
-  uint8_t returnValue = 0;
-  if (q->indexIn == q->indexOut) // Just return 0 if empty.
-    return 0;
-  else {
-    returnValue =
-        q->data[q->indexOut]; // Not empty, get the return value from buffer.
-    q->indexOut = (q->indexOut + 1) % q->size; // increment the out index.
-    q->elementCount--;                         // One less element.
+// Producer: returns the longest run of free space that does not wrap.
+static uint32_t bluetooth_queueFreeRun(bluetooth_queue_t *q, uint8_t **run) {
+  uint32_t in = q->indexIn;
+  uint32_t free =
+      BLUETOOTH_QUEUE_SIZE - (in - __atomic_load_n(&q->indexOut, __ATOMIC_ACQUIRE));
+  uint32_t toEnd = BLUETOOTH_QUEUE_SIZE - (in & BLUETOOTH_QUEUE_MASK);
+  *run = &q->data[in & BLUETOOTH_QUEUE_MASK];
+  return free < toEnd ? free : toEnd;
+}
+
+// Producer: publish count bytes written into the free run.
+static void bluetooth_queueCommit(bluetooth_queue_t *q, uint32_t count) {
+  __atomic_store_n(&q->indexIn, q->indexIn + count, __ATOMIC_RELEASE);
+}
+
+// Consumer: returns the longest run of waiting bytes that does not wrap.
+static uint32_t bluetooth_queueDataRun(bluetooth_queue_t *q, uint8_t **run) {
+  uint32_t out = q->indexOut;
+  uint32_t count = __atomic_load_n(&q->indexIn, __ATOMIC_ACQUIRE) - out;
+  uint32_t toEnd = BLUETOOTH_QUEUE_SIZE - (out & BLUETOOTH_QUEUE_MASK);
+  *run = &q->data[out & BLUETOOTH_QUEUE_MASK];
+  return count < toEnd ? count : toEnd;
+}
+
+// Consumer: release count bytes of the data run.
+static void bluetooth_queueConsume(bluetooth_queue_t *q, uint32_t count) {
+  __atomic_store_n(&q->indexOut, q->indexOut + count, __ATOMIC_RELEASE);
+}
+
+// Producer: copy in as much of data as fits. Returns the number of bytes taken.
+static uint16_t bluetooth_queueWrite(bluetooth_queue_t *q, const uint8_t *data,
+                                     uint16_t size) {
+  uint16_t written = 0;
+  for (int part = 0; part < 2 && written < size; part++) { // Before and after the wrap.
+    uint8_t *run;
+    uint32_t length = bluetooth_queueFreeRun(q, &run);
+    if (length > (uint32_t)(size - written))
+      length = size - written;
+    memcpy(run, data + written, length);
+    bluetooth_queueCommit(q, length);
+    written += length;
   }
-  return returnValue;
+  return written;
 }
 
-// Provides read access to all elements in the ADC buffer.
-// No error messages are provided. In cases of error, a 0 is returned.
-// index = 0 indexes the oldest data in the queue.
-uint32_t bluetooth_queueReadElementAt(bluetooth_queue_t *q, uint32_t index) {
-  // Just return 0 if there if the buffer is empty or not enough elements for
-  // the index.
-  if ((q->indexIn == q->indexOut) || (index + 1 > q->elementCount))
-    return 0;
-  // Otherwise, there are enough elements, just do modulo addressing.
-  return q->data[(q->indexOut + index) % q->size];
+// Consumer: copy out up to maxSize bytes. Returns the number of bytes read.
+static uint16_t bluetooth_queueRead(bluetooth_queue_t *q, uint8_t *data,
+                                    uint16_t maxSize) {
+  uint16_t read = 0;
+  for (int part = 0; part < 2 && read < maxSize; part++) {
+    uint8_t *run;
+    uint32_t length = bluetooth_queueDataRun(q, &run);
+    if (length > (uint32_t)(maxSize - read))
+      length = maxSize - read;
+    memcpy(data + read, run, length);
+    bluetooth_queueConsume(q, length);
+    read += length;
+  }
+  return read;
 }
 
-// Functional interface to access element count.
-uint16_t bluetooth_queueElementCount(bluetooth_queue_t *q) {
-  return q->elementCount;
+/*****************************************************************************
+***** UART service
+*****************************************************************************/
+
+// Empty the receive FIFO into the receive queue. Bytes that find the queue
+// full are read anyway, so the FIFO cannot overrun, and counted as dropped.
+static void bluetooth_serviceReceive() {
+  for (;;) {
+    uint8_t *run;
+    uint32_t length = bluetooth_queueFreeRun(&bluetooth_receiveQueue, &run);
+    if (length == 0) {
+      uint8_t discard[BLUETOOTH_UART_FIFO_SIZE];
+      stats.receiveDropped +=
+          XUartLite_Recv(&bluetooth_uartInstance, discard, BLUETOOTH_UART_FIFO_SIZE);
+      return;
+    }
+    if (length > BLUETOOTH_UART_FIFO_SIZE)
+      length = BLUETOOTH_UART_FIFO_SIZE;
+    uint32_t received = XUartLite_Recv(&bluetooth_uartInstance, run, length);
+    bluetooth_queueCommit(&bluetooth_receiveQueue, received);
+    stats.bytesReceived += received;
+    if (received < length)
+      return; // FIFO is empty.
+  }
 }
 
-// Check if the queue is empty.
-bool bluetooth_queueEmpty(bluetooth_queue_t *q) {
-  return (q->indexIn == q->indexOut);
+// Fill the transmit FIFO from the transmit queue.
+static void bluetooth_serviceTransmit() {
+  for (;;) {
+    uint8_t *run;
+    uint32_t length = bluetooth_queueDataRun(&bluetooth_transmitQueue, &run);
+    if (length == 0)
+      break;
+    if (length > BLUETOOTH_UART_FIFO_SIZE)
+      length = BLUETOOTH_UART_FIFO_SIZE;
+    uint32_t sent = XUartLite_Send(&bluetooth_uartInstance, run, length);
+    bluetooth_queueConsume(&bluetooth_transmitQueue, sent);
+    stats.bytesSent += sent;
+    if (sent < length)
+      break; // FIFO is full.
+  }
+  transmitting = XUartLite_IsSending(&bluetooth_uartInstance);
 }
 
-// Check if the queue is full.
-bool bluetooth_queueFull(bluetooth_queue_t *q) {
-  return !(q->elementCount < q->size);
+// Services both directions of the UART. Connected to the UART interrupt, and
+// called by bluetooth_poll() when the interrupt is not available.
+void bluetooth_uartIsr(void *callBackRef) {
+  (void)callBackRef;
+  stats.serviceCalls++;
+  bluetooth_serviceReceive();
+  bluetooth_serviceTransmit();
 }
 
-uint16_t bluetooth_queueSize(bluetooth_queue_t *q) { return q->size; }
+/*****************************************************************************
+***** Public interface
+*****************************************************************************/
+
+// Connect bluetooth_uartIsr() to the UART interrupt. Returns false if the
+// interrupt is not wired.
+static bool bluetooth_connectInterrupt() {
+#ifdef BLUETOOTH_UART_INTR
+  // The GIC belongs to interrupts.c, which has already initialized it; this
+  // handle shares its handler table and only adds an entry.
+  XScuGic_Config *config = XScuGic_LookupConfig(XPAR_SCUGIC_SINGLE_DEVICE_ID);
+  bluetooth_gic.Config = config;
+  bluetooth_gic.IsReady = XIL_COMPONENT_IS_READY;
+  if (XScuGic_Connect(&bluetooth_gic, BLUETOOTH_UART_INTR,
+                      (Xil_ExceptionHandler)bluetooth_uartIsr, NULL) != XST_SUCCESS)
+    return false;
+  XScuGic_Enable(&bluetooth_gic, BLUETOOTH_UART_INTR);
+  XUartLite_EnableInterrupt(&bluetooth_uartInstance);
+  return true;
+#elif defined(ZYBO_BOARD)
+  return false;
+#else
+  hostSim_uartConnectIsr(bluetooth_uartIsr, NULL);
+  XUartLite_EnableInterrupt(&bluetooth_uartInstance);
+  return true;
+#endif
+}
 
 // Used to initialize any bluetooth data structures.
-// Must be called before accessing any of the bluetooth_ routines.
+// Must be called before accessing any of the bluetooth_ routines. On the board
+// interrupts_initAll() must have run first.
 int bluetooth_init() {
-  bluetooth_queueInit(&bluetooth_receiveQueue,
-                      BLUETOOTH_QUEUE_SIZE); // init the receive q.
-  bluetooth_queueInit(&bluetooth_transmitQueue,
-                      BLUETOOTH_QUEUE_SIZE); // init the transmit q.
+  bluetooth_queueInit(&bluetooth_receiveQueue);  // init the receive q.
+  bluetooth_queueInit(&bluetooth_transmitQueue); // init the transmit q.
+  memset(&stats, 0, sizeof(stats));
+  transmitting = false;
   // Init the bluetooth UART.
   int status =
       XUartLite_CfgInitialize(&bluetooth_uartInstance, &bluetooth_uartConfig,
@@ -122,52 +243,46 @@ int bluetooth_init() {
     printf("bluetooth_init(): Unable to initialize bluetooth UART\n.");
     return BLUETOOTH_INIT_STATUS_FAIL;
   }
+  interruptDriven = bluetooth_connectInterrupt();
   return BLUETOOTH_INIT_STATUS_OK;
 }
 
-// Writes data to the bluetooth modem via the bluetooth_UART.
-// Returns the number of characters written.
-// Nonblocking.
-// Can be data or commands. Switch on bluetooth modem board determines whether
-// is interpreted as data or commands.
-uint16_t bluetooth_uartWrite(uint8_t *data, uint16_t size) {
-  return XUartLite_Send(&bluetooth_uartInstance, data, size);
+// Leave the UART interrupt off and rely on bluetooth_poll().
+void bluetooth_usePolling() {
+  XUartLite_DisableInterrupt(&bluetooth_uartInstance);
+#ifdef BLUETOOTH_UART_INTR
+  if (interruptDriven)
+    XScuGic_Disable(&bluetooth_gic, BLUETOOTH_UART_INTR);
+#elif !defined(ZYBO_BOARD)
+  hostSim_uartConnectIsr(NULL, NULL);
+#endif
+  interruptDriven = false;
 }
 
-// Reads data from the bluetooth modem via the bluetooth_UART.
-// Returns the number of characters read.
-// Nonblocking.
-uint16_t bluetooth_uartRead(uint8_t *data, uint16_t maxSize) {
-  return XUartLite_Recv(&bluetooth_uartInstance, data, maxSize);
-}
+// True if the UART interrupt services the queues.
+bool bluetooth_isInterruptDriven() { return interruptDriven; }
 
 // Reads characters from the bluetooth buffer. Characters are placed in the
 // bluetooth_receiveQueue by reading the bluetooth UART and pushing them into
 // the queue. Will only read upto maxSize characters. Returns the number of
 // characters read.
 uint16_t bluetooth_receiveQueueRead(uint8_t *data, uint16_t maxSize) {
-  uint16_t bytesRead = 0;
-  // Read the characters unless the receive queue empties.
-  for (uint16_t i = 0;
-       i < maxSize && !bluetooth_queueEmpty(&bluetooth_receiveQueue); i++) {
-    data[i] = bluetooth_queuePop(&bluetooth_receiveQueue);
-    bytesRead++;
-  }
-  return bytesRead; // Let the caller know how many bytes were read.
+  return bluetooth_queueRead(&bluetooth_receiveQueue, data, maxSize);
 }
 
 // Writes characters to the bluetooth transmit queue. The characters from the
 // buffer need to be written from the queue to the bluetooth UART. Returns the
 // number of characters written.
 uint16_t bluetooth_transmitQueueWrite(uint8_t *data, uint16_t size) {
-  uint16_t bytesWritten = 0;
-  // Write the characters unless the transmit queue fills up.
-  for (uint16_t i = 0;
-       i < size && !bluetooth_queueFull(&bluetooth_transmitQueue); i++) {
-    bluetooth_queuePush(&bluetooth_transmitQueue, data[i]);
-    bytesWritten++;
+  uint16_t written = bluetooth_queueWrite(&bluetooth_transmitQueue, data, size);
+  // An idle transmitter raises no interrupt, so start it here. The ISR is the
+  // queue's other consumer, hence the brief mask.
+  if (interruptDriven && written && !transmitting) {
+    interrupts_disableArmInts();
+    bluetooth_serviceTransmit();
+    interrupts_enableArmInts();
   }
-  return bytesWritten; // Let the caller know how many bytes were written.
+  return written;
 }
 
 // Polls the bluetooth for data.
@@ -175,53 +290,32 @@ uint16_t bluetooth_transmitQueueWrite(uint8_t *data, uint16_t size) {
 // Data in the transmit queue are sent to the bluetooth UART.
 // bluetooth UART only operates at 9600 BAUD, so don't call this more than about
 // every 5 ms or so. Presumed that this will be called in a timer ISR.
-void bluetooth_poll() {
-  // Read characters from the bluetooth UART and copy to the receive queue.
-  uint8_t readData[BLUETOOTH_UART_FIFO_SIZE];
-  // How much room is in the receive queue?
-  uint16_t receiveQueueSpace =
-      bluetooth_queueSize(&bluetooth_receiveQueue) -
-      bluetooth_queueElementCount(&bluetooth_receiveQueue);
-  // Requested number of bytes will be either all the chars in the UART FIFO, or
-  // the available space in the recieve queue.
-  uint16_t requestedReadCount = receiveQueueSpace > BLUETOOTH_UART_FIFO_SIZE
-                                    ? BLUETOOTH_UART_FIFO_SIZE
-                                    : receiveQueueSpace;
-  // Transfer whatever you read to the receive queue.
-  uint16_t bytesRead = bluetooth_uartRead(readData, requestedReadCount);
-  //    if (bytesRead != 0)
-  //        printf("received %d bytes.\n", bytesRead);
-  for (uint16_t i = 0; i < bytesRead; i++) {
-    bluetooth_queuePush(&bluetooth_receiveQueue, readData[i]);
-  }
-  // Read chars from the transmit queue and send them to the bluetooth UART.
-  // Transmit characters one at a time so you won't have to put anything back
-  // into the transmit queue.
-  bool transmitOk =
-      true; // This will be set to false if unable to transmit a byte.
-  uint16_t bytesToTransmit =
-      bluetooth_queueElementCount(&bluetooth_transmitQueue);
-  // Loop will write bytes to the bluetooth UART until the UART is full or all
-  // characters are transmitted.
-  for (uint16_t i = 0; i < bytesToTransmit && transmitOk; i++) {
-    uint8_t transmitData[1]; // Only transmit one byte at a time.
-    transmitData[0] = bluetooth_queueReadElementAt(
-        &bluetooth_transmitQueue, i); // Read the byte to be transmitted.
-    uint8_t bytesWritten =
-        bluetooth_uartWrite(transmitData, 1); // Ask for it to be written.
-    if (bytesWritten == 1) { // Successful if one byte was written.
-      transmitOk = true;
-      bluetooth_queuePop(
-          &bluetooth_transmitQueue); // Successfully written so pop the data off
-                                     // the queue.
-    } else {                         // Not successful, so terminate.
-      transmitOk = false;
-    }
-  }
-}
+void bluetooth_poll() { bluetooth_uartIsr(NULL); }
+
+// Copy of the transfer counters.
+void bluetooth_getStats(bluetooth_stats_t *statsOut) { *statsOut = stats; }
 
 // Starts an interactive loop that queries the user for input, transmits that
 // input to the bluetooth UART and then prints the result. Useful for
 // configuring the bluetooth modem when in command mode. Terminates if the user
 // types a single "." on a line of input.
-// void bluetooth_interactiveLoop() {}
+void bluetooth_interactiveLoop() {
+  char line[BLUETOOTH_LINE_SIZE];
+  printf("Enter commands for the bluetooth modem, a single \".\" to quit.\n");
+  while (fgets(line, sizeof(line), stdin)) {
+    if (strcmp(line, ".\n") == 0 || strcmp(line, ".\r\n") == 0 || strcmp(line, ".") == 0)
+      return;
+    uint16_t length = strlen(line), written = 0;
+    while (written < length) {
+      written += bluetooth_transmitQueueWrite((uint8_t *)line + written, length - written);
+      if (written < length)
+        utils_msDelay(1);
+    }
+    utils_msDelay(BLUETOOTH_RESPONSE_WAIT_MS);
+    uint8_t response[BLUETOOTH_LINE_SIZE];
+    uint16_t count;
+    while ((count = bluetooth_receiveQueueRead(response, sizeof(response))))
+      fwrite(response, 1, count, stdout);
+    fflush(stdout);
+  }
+}
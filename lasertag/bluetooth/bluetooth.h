@@ -14,10 +14,28 @@
 #define BLUETOOTH_INIT_STATUS_FAIL 0
 #define BLUETOOTH_INIT_STATUS_OK 1
 
+// Transfer counters since bluetooth_init().
+typedef struct {
+  uint32_t bytesReceived;  // Moved from the UART into the receive queue.
+  uint32_t bytesSent;      // Moved from the transmit queue into the UART.
+  uint32_t receiveDropped; // Read from the UART with the receive queue full.
+  uint32_t serviceCalls;   // Calls to bluetooth_uartIsr(), interrupt or poll.
+} bluetooth_stats_t;
+
 // Used to initialize any bluetooth data structures.
-// Must be called before accessing any of the bluetooth_ routines.
+// Must be called before accessing any of the bluetooth_ routines. On the board
+// interrupts_initAll() must have run first. If the UART interrupt is wired,
+// the queues are serviced from it from here on; otherwise bluetooth_poll()
+// must be called from a timer ISR.
 int bluetooth_init();
 
+// Leave the UART interrupt off and rely on bluetooth_poll(), as without the
+// interrupt. For comparing the two.
+void bluetooth_usePolling();
+
+// True if the UART interrupt services the queues.
+bool bluetooth_isInterruptDriven();
+
 // Reads characters from the bluetooth buffer. Characters are placed in the
 // bluetooth_receiveQueue by reading the bluetooth UART and pushing them into
 // the queue. Will only read upto maxSize characters. Returns the number of
@@ -26,7 +44,8 @@ uint16_t bluetooth_receiveQueueRead(uint8_t *data, uint16_t maxSize);
 
 // Writes characters to the bluetooth transmit queue. The characters from the
 // buffer need to be written from the queue to the bluetooth UART. Returns the
-// number of characters written.
+// number of characters written. Call from the main loop, not from an ISR: it
+// briefly masks interrupts to start an idle transmitter.
 uint16_t bluetooth_transmitQueueWrite(uint8_t *data, uint16_t size);
 
 // Polls the bluetooth for data.
@@ -36,6 +55,13 @@ uint16_t bluetooth_transmitQueueWrite(uint8_t *data, uint16_t size);
 // every 5 ms or so. Presumed that this will be called in a timer ISR.
 void bluetooth_poll();
 
+// Services both directions of the UART: receive FIFO into the receive queue,
+// transmit queue into the transmit FIFO. The UART interrupt handler.
+void bluetooth_uartIsr(void *callBackRef);
+
+// Copy of the transfer counters.
+void bluetooth_getStats(bluetooth_stats_t *stats);
+
 // Starts an interactive loop that queries the user for input, transmits that
 // input to the bluetooth UART and then prints the result. Useful for
 // configuring the bluetooth modem when in command mode. Terminates if the user
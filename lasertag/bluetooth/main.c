@@ -10,6 +10,7 @@
 
 #define BUFSIZE 1000
 #define TEXT_SIZE 2
+#define BLUETOOTH_ECHO_BATCH_SIZE 64
 
 // Quick hack for non-blocking IO read.
 // bool peek() { return XUartPs_IsReceiveData(XPAR_XUARTPS_0_BASEADDR); }
@@ -48,33 +49,32 @@ int main() {
   bluetooth_init();
   interrupts_enableArmInts();
   // Implement a simple echo that reads incoming characters, converts them to
-  // upper-case, and transmits them back out.
-  uint8_t incomingData[1];
-  uint8_t outgoingData[1];
+  // upper-case, and transmits them back out. The queues are lock-free, so
+  // there is no need to disable interrupts around them.
+  uint8_t data[BLUETOOTH_ECHO_BATCH_SIZE];
   while (1) {
-    interrupts_disableArmInts();
-    uint16_t bytesRead = bluetooth_receiveQueueRead(incomingData, 1);
-    if (bytesRead == 1) {
-      outgoingData[0] = toupper(incomingData[0]);
-      char c = outgoingData[0];
-      display_printChar(c);
-      bluetooth_transmitQueueWrite(outgoingData, 1);
+    uint16_t bytesRead = bluetooth_receiveQueueRead(data, BLUETOOTH_ECHO_BATCH_SIZE);
+    for (uint16_t i = 0; i < bytesRead; i++) {
+      data[i] = toupper(data[i]);
+      display_printChar(data[i]);
     }
-    interrupts_enableArmInts();
+    for (uint16_t written = 0; written < bytesRead;)
+      written += bluetooth_transmitQueueWrite(data + written, bytesRead - written);
   }
 }
 
 static uint16_t tickCount = 0;
 #define BLUETOOTH_SERVICE_INTERVAL 5
 
+// Only needed when the UART interrupt is not wired.
 void isr_function() {
-  //    printf("#\n");
+  if (bluetooth_isInterruptDriven())
+    return;
   tickCount++;
-  if (tickCount > BLUETOOTH_SERVICE_INTERVAL) {
+  if (tickCount >= BLUETOOTH_SERVICE_INTERVAL) {
     bluetooth_poll();
     tickCount = 0;
   }
-  bluetooth_poll();
 }
 
 //#define TEXT_SIZE 1
@@ -1,19 +1,24 @@
 #include "buffer.h"
+#include "instance.h"
  
 // This implements a dedicated circular buffer for storing values
 // from the ADC until they are read and processed by the detector.
 // The function of the buffer is similar to a queue or FIFO.
  
 #define BUFFER_SIZE 32768
+// The ring holds the history behind the elements as well, and its first
+// BUFFER_HISTORY slots are mirrored past its end: the history is then
+// contiguous wherever the ring wraps.
+#define BUFFER_RING (BUFFER_SIZE + BUFFER_HISTORY)
  
 typedef struct {
     uint32_t indexIn; // Points to the next open slot.
     uint32_t indexOut; // Points to the next element to be removed.
     uint32_t elementCount; // Number of elements in the buffer.
-    buffer_data_t data[BUFFER_SIZE]; // Values are stored here.
+    buffer_data_t data[BUFFER_RING + BUFFER_HISTORY]; // Values are stored here.
 } buffer_t;
  
-volatile static buffer_t buf;
+static INSTANCE_LOCAL volatile buffer_t buf;
  
  
 // Initialize the buffer to empty.
@@ -26,6 +31,9 @@ void buffer_init(void)
 	buf.indexOut = 0;
 	// Keep track of the number of elements currently in queue.
 	buf.elementCount = 0;
+	// The history behind the first element is the ADC at rest.
+	for (uint32_t i = BUFFER_RING - BUFFER_HISTORY; i < BUFFER_RING; i++)
+		buf.data[i] = BUFFER_REST_VALUE;
 }
  
 // Add a value to the buffer. Overwrite the oldest value if full.
@@ -35,7 +43,9 @@ void buffer_pushover(buffer_data_t value)
 		buffer_pop();
 
     buf.data[buf.indexIn] = value;
-    buf.indexIn = (buf.indexIn + 1) % buffer_size();
+    if (buf.indexIn < BUFFER_HISTORY)
+        buf.data[BUFFER_RING + buf.indexIn] = value;
+    buf.indexIn = (buf.indexIn + 1) % BUFFER_RING;
     buf.elementCount++;
 }
  
@@ -48,7 +58,7 @@ buffer_data_t buffer_pop(void)
     } else {
         buffer_data_t value = buf.data[buf.indexOut];
 
-        buf.indexOut = (buf.indexOut + 1) % buffer_size();
+        buf.indexOut = (buf.indexOut + 1) % BUFFER_RING;
         buf.elementCount--;
 
         return value;
@@ -65,4 +75,35 @@ uint32_t buffer_elements(void)
 uint32_t buffer_size(void)
 {
     return BUFFER_SIZE;
-}
\ No newline at end of file
+}
+
+// Remove count values, at most buffer_elements(), without reading them.
+void buffer_advance(uint32_t count)
+{
+    if (count > buf.elementCount)
+        count = buf.elementCount;
+    buf.indexOut = (buf.indexOut + count) % BUFFER_RING;
+    buf.elementCount -= count;
+}
+
+// Return the last count values removed, oldest first, count at most
+// BUFFER_HISTORY.
+const buffer_data_t *buffer_history(uint32_t count)
+{
+    // Past the end of the ring the mirror carries on from its first slots.
+    // Removed values are not written again until the ring comes around, so
+    // they can be read without the volatile qualifier.
+    uint32_t start = (buf.indexOut + BUFFER_RING - count) % BUFFER_RING;
+    return (const buffer_data_t *)&buf.data[start];
+}
+
+// Make values, oldest first, the last count values removed.
+void buffer_setHistory(const buffer_data_t values[], uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t slot = (buf.indexOut + BUFFER_RING - count + i) % BUFFER_RING;
+        buf.data[slot] = values[i];
+        if (slot < BUFFER_HISTORY)
+            buf.data[BUFFER_RING + slot] = values[i];
+    }
+}
@@ -34,4 +34,24 @@ uint32_t buffer_elements(void);
 // Return the capacity of the buffer in elements.
 uint32_t buffer_size(void);
 
+// The values can also be read in place. The last BUFFER_HISTORY values
+// removed stay in the storage, and the storage is laid out so that they are
+// always contiguous: a decimating filter can read its window straight from
+// the buffer and consume inputs with buffer_advance(), copying nothing. After
+// buffer_init() the history holds BUFFER_REST_VALUE.
+#define BUFFER_HISTORY 128
+#define BUFFER_REST_VALUE 2048 // Mid-scale of the 12-bit ADC.
+
+// Remove count values, at most buffer_elements(), without reading them.
+void buffer_advance(uint32_t count);
+
+// Return the last count values removed, oldest first, count at most
+// BUFFER_HISTORY. They stay put until they are count + buffer_size() values
+// old.
+const buffer_data_t *buffer_history(uint32_t count);
+
+// Make values, oldest first, the last count values removed, as when
+// restoring a filter's inputs. count is at most BUFFER_HISTORY.
+void buffer_setHistory(const buffer_data_t values[], uint32_t count);
+
 #endif /* BUFFER_H_ */
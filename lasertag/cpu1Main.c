@@ -0,0 +1,96 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Entry point of the CPU1 image in the AMP build (see amp.h). CPU0 wakes this
+// core with amp_startDetectorCore() once it has set up the shared region.
+// CPU1 owns the XADC and its own private timer; the interrupt distributor was
+// set up by CPU0 and is left alone (the CPU1 BSP is built with USE_AMP=1).
+
+#include <stdio.h>
+
+#include "amp.h"
+#include "detectorCore.h"
+#include "interrupts.h"
+#include "sampleRate.h"
+#include "xil_exception.h"
+#include "xparameters.h"
+#include "xpseudo_asm.h"
+#include "xscugic.h"
+#include "xscutimer.h"
+#include "xsysmon.h"
+
+#define XADC_CLOCK_DIVIDER 4 // 100 MHz bus clock divided by 4.
+
+static XScuGic interruptController;
+static XScuTimer timerInstance;
+static XSysMon xSysMonInst;
+
+// Sample the ADC and hand it to the detector core, at the sample rate.
+static void timerIsr(void *callBackRef) {
+  detectorCore_tick(XSysMon_GetAdcData(&xSysMonInst, SELECTED_XADC_CHANNEL) >> 4);
+  XScuTimer_ClearInterruptStatus(&timerInstance);
+}
+
+// Single-channel conversion of the detector input, as interrupts_initAll()
+// does on the single-core build.
+static int initAdc(void) {
+  XSysMon_Config *config = XSysMon_LookupConfig(XPAR_AXI_XADC_0_DEVICE_ID);
+  if (XSysMon_CfgInitialize(&xSysMonInst, config, config->BaseAddress) != XST_SUCCESS)
+    return XST_FAILURE;
+  XSysMon_SetAdcClkDivisor(&xSysMonInst, XADC_CLOCK_DIVIDER);
+  XSysMon_SetSequencerMode(&xSysMonInst, XSM_SEQ_MODE_SINGCHAN);
+  if (XSysMon_SetSingleChParams(&xSysMonInst, XADC_AUX_CHANNEL_14, FALSE, FALSE,
+                                FALSE) != XST_SUCCESS)
+    return XST_FAILURE;
+  XSysMon_SetAlarmEnables(&xSysMonInst, 0x0);
+  return XST_SUCCESS;
+}
+
+// Connect CPU1's private timer to its CPU interface and start it.
+static int initTimer(void) {
+  XScuGic_Config *gicConfig = XScuGic_LookupConfig(XPAR_SCUGIC_SINGLE_DEVICE_ID);
+  if (XScuGic_CfgInitialize(&interruptController, gicConfig,
+                            gicConfig->CpuBaseAddress) != XST_SUCCESS)
+    return XST_FAILURE;
+  Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT,
+                               (Xil_ExceptionHandler)XScuGic_InterruptHandler,
+                               &interruptController);
+
+  XScuTimer_Config *timerConfig = XScuTimer_LookupConfig(XPAR_XSCUTIMER_0_DEVICE_ID);
+  if (XScuTimer_CfgInitialize(&timerInstance, timerConfig, timerConfig->BaseAddr) !=
+      XST_SUCCESS)
+    return XST_FAILURE;
+  if (XScuGic_Connect(&interruptController, XPAR_SCUTIMER_INTR,
+                      (Xil_ExceptionHandler)timerIsr, &timerInstance) != XST_SUCCESS)
+    return XST_FAILURE;
+  XScuGic_Enable(&interruptController, XPAR_SCUTIMER_INTR);
+  XScuTimer_EnableAutoReload(&timerInstance);
+  XScuTimer_SetPrescaler(&timerInstance, 0);
+  XScuTimer_LoadTimer(&timerInstance, sampleRate_getTimerLoadValue()); // As on CPU0.
+  XScuTimer_EnableInterrupt(&timerInstance);
+  XScuTimer_Start(&timerInstance);
+  return XST_SUCCESS;
+}
+
+int main() {
+  sampleRate_set(LASERTAG_SAMPLE_RATE_HZ); // As main() on CPU0.
+  detectorCore_init();
+  if (initAdc() != XST_SUCCESS || initTimer() != XST_SUCCESS) {
+    // CPU0 waits for AMP_CPU1_RUNNING forever, which is the best signal there
+    // is: the game cannot work without the detector.
+    while (1)
+      wfe();
+  }
+  Xil_ExceptionEnable();
+  detectorCore_run();
+  XScuTimer_Stop(&timerInstance);
+  while (1)
+    wfe();
+  return 0;
+}
@@ -0,0 +1,166 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "crosstalk.h"
+#include "filter.h"
+#include "instance.h"
+#include "sampleRate.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// The square waves of filterTest.c: the first half of each period low.
+#define SQUARE_WAVE_LOW -1.0
+#define SQUARE_WAVE_HIGH 1.0
+// Power windows per square wave; all but the last let the filters settle.
+#define MEASURE_WINDOWS 2
+#define MIN_PIVOT 1e-9
+
+static INSTANCE_LOCAL double leakage[FILTER_FREQUENCY_COUNT][FILTER_FREQUENCY_COUNT];
+// The inverse of leakage by columns: inverse[j] multiplies the power of
+// channel j. Rows past FILTER_FREQUENCY_COUNT are zero.
+static INSTANCE_LOCAL float inverse[FILTER_FREQUENCY_COUNT][CROSSTALK_STRIDE];
+static INSTANCE_LOCAL uint32_t measuredHz; // 0 until measured.
+
+// Run player's square wave through the filters and fill in column player of
+// leakage.
+static void measurePlayer(uint16_t player) {
+    uint32_t period = sampleRate_ticks(filter_frequencyTickTable[player]);
+    uint32_t inputs = MEASURE_WINDOWS * FILTER_INPUT_PULSE_WIDTH * filter_getDecimationValue();
+    uint16_t decimation = filter_getDecimationValue();
+    filter_reset();
+    for (uint32_t n = 0; n < inputs; n++) {
+        filter_addNewInput(n % period < period / 2 ? SQUARE_WAVE_LOW : SQUARE_WAVE_HIGH);
+        if ((n + 1) % decimation)
+            continue;
+        filter_firFilter();
+        for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+            filter_iirFilter(i);
+    }
+    double powers[FILTER_FREQUENCY_COUNT];
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+        powers[i] = filter_computePower(i, true, false);
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+        leakage[i][player] = powers[i] / powers[player];
+}
+
+// Gauss-Jordan elimination with partial pivoting. Returns false if leakage
+// is too close to singular.
+static bool invert(void) {
+    double a[FILTER_FREQUENCY_COUNT][2 * FILTER_FREQUENCY_COUNT];
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        for (uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; j++) {
+            a[i][j] = leakage[i][j];
+            a[i][FILTER_FREQUENCY_COUNT + j] = i == j;
+        }
+    }
+    for (uint16_t column = 0; column < FILTER_FREQUENCY_COUNT; column++) {
+        uint16_t pivot = column;
+        for (uint16_t i = column + 1; i < FILTER_FREQUENCY_COUNT; i++) {
+            if (fabs(a[i][column]) > fabs(a[pivot][column]))
+                pivot = i;
+        }
+        if (!(fabs(a[pivot][column]) > MIN_PIVOT))
+            return false;
+        for (uint16_t j = 0; j < 2 * FILTER_FREQUENCY_COUNT; j++) {
+            double swap = a[column][j];
+            a[column][j] = a[pivot][j];
+            a[pivot][j] = swap;
+        }
+        double scale = 1 / a[column][column];
+        for (uint16_t j = 0; j < 2 * FILTER_FREQUENCY_COUNT; j++)
+            a[column][j] *= scale;
+        for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+            double factor = a[i][column];
+            if (i == column || factor == 0)
+                continue;
+            for (uint16_t j = 0; j < 2 * FILTER_FREQUENCY_COUNT; j++)
+                a[i][j] -= factor * a[column][j];
+        }
+    }
+    memset(inverse, 0, sizeof(inverse));
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        for (uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; j++)
+            inverse[j][i] = a[i][FILTER_FREQUENCY_COUNT + j];
+    }
+    return true;
+}
+
+// Measure L at the sample rate and invert it, then reset the filters,
+// keeping the channel mask.
+bool crosstalk_measure(void) {
+    uint16_t mask = filter_getChannelMask();
+    for (uint16_t player = 0; player < FILTER_FREQUENCY_COUNT; player++)
+        measurePlayer(player);
+    filter_reset();
+    filter_setChannelMask(mask);
+    measuredHz = invert() ? sampleRate_getHz() : 0;
+    return measuredHz;
+}
+
+// Returns true once crosstalk_measure() has succeeded at the sample rate.
+bool crosstalk_isMeasured(void) {
+    return measuredHz == sampleRate_getHz();
+}
+
+// Returns the power on filterNumber of player's square wave, relative to
+// the power on player's own filter.
+double crosstalk_getLeakage(uint16_t filterNumber, uint16_t player) {
+    return leakage[filterNumber][player];
+}
+
+// Returns the channels outside mask that leak into one in it above
+// CROSSTALK_SOURCE_LEAKAGE.
+uint16_t crosstalk_getSources(uint16_t mask) {
+    uint16_t sources = 0;
+    for (uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; j++) {
+        if (mask & (1 << j))
+            continue;
+        for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+            if (mask & (1 << i) && leakage[i][j] > CROSSTALK_SOURCE_LEAKAGE)
+                sources |= 1 << j;
+        }
+    }
+    return sources;
+}
+
+// Replace the powers of the channels in mask with each player's own power,
+// leakage removed; the other channels read as zero.
+void crosstalk_compensate(double powerValues[], uint16_t mask) {
+    float compensated[CROSSTALK_STRIDE];
+#if defined(__ARM_NEON)
+    float32x4_t sums[CROSSTALK_STRIDE / CROSSTALK_LANES];
+    for (uint16_t r = 0; r < CROSSTALK_STRIDE / CROSSTALK_LANES; r++)
+        sums[r] = vdupq_n_f32(0);
+    for (uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; j++) {
+        if (!(mask & (1 << j)))
+            continue;
+        float32x4_t power = vdupq_n_f32(powerValues[j]);
+        for (uint16_t r = 0; r < CROSSTALK_STRIDE / CROSSTALK_LANES; r++)
+            sums[r] = vmlaq_f32(sums[r], vld1q_f32(&inverse[j][r * CROSSTALK_LANES]), power);
+    }
+    for (uint16_t r = 0; r < CROSSTALK_STRIDE / CROSSTALK_LANES; r++)
+        vst1q_f32(&compensated[r * CROSSTALK_LANES], sums[r]);
+#else
+    memset(compensated, 0, sizeof(compensated));
+    for (uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; j++) {
+        if (!(mask & (1 << j)))
+            continue;
+        float power = powerValues[j];
+        for (uint16_t r = 0; r < CROSSTALK_STRIDE; r++)
+            compensated[r] += inverse[j][r] * power;
+    }
+#endif
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+        powerValues[i] = mask & (1 << i) ? compensated[i] : 0.0;
+}
@@ -0,0 +1,64 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef CROSSTALK_H_
+#define CROSSTALK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Crosstalk compensation for the powers of the IIR filter bank. A player's
+// square wave does not only raise the power of its own filter: the filters'
+// skirts pass some of it to their neighbours, and the odd harmonics the FIR
+// filter lets through alias back into the band at the decimated rate (five
+// times 1471 Hz lands at 2645 Hz, 13 Hz from player 4's 2632 Hz). The powers
+// are then close to L s, where s holds the power of each player on its own
+// filter and L[i][j] is the power on filter i of a square wave at player j's
+// frequency, relative to filter j's. Multiplying the powers by the inverse
+// of L takes the leakage back out.
+//
+// L is measured with the square waves filterTest.c uses, through the filters
+// of filter.h at the sample rate, and inverted once. The compensation is a
+// 10 x 10 matrix-vector product in single precision, run once per decision
+// rather than per sample; on the board it is four columns of NEON
+// multiply-accumulates per row of three vectors, the rows padded to twelve.
+// Without NEON (the host) plain C does the same operations in the same order.
+
+#define CROSSTALK_LANES 4
+#define CROSSTALK_STRIDE 12 // FILTER_FREQUENCY_COUNT padded to the lanes.
+
+// Measure L at the sample rate (sampleRate.h) and invert it. This runs the
+// filters of filter.h over each player's square wave, several hundred
+// milliseconds of input in all, then resets them with filter_reset(),
+// keeping the channel mask. Returns false, leaving the compensation off, if L
+// cannot be inverted.
+bool crosstalk_measure(void);
+
+// Returns true once crosstalk_measure() has succeeded at the sample rate.
+bool crosstalk_isMeasured(void);
+
+// Returns L[filterNumber][player]: the power on filterNumber of player's
+// square wave, relative to the power on player's own filter.
+double crosstalk_getLeakage(uint16_t filterNumber, uint16_t player);
+
+// Channels whose leakage into another one is above this must be run for the
+// compensation to take it out: a shot from close by is up to 80 dB above the
+// noise in its own filter, and the hit threshold is 20 to 30 dB above it.
+#define CROSSTALK_SOURCE_LEAKAGE 1e-7 // -70 dB.
+
+// Returns the channels outside mask that leak into a channel in mask above
+// CROSSTALK_SOURCE_LEAKAGE.
+uint16_t crosstalk_getSources(uint16_t mask);
+
+// Replace the powers of the channels in mask with the power of each player
+// on its own filter, leakage removed; the other channels read as zero. The
+// leakage from channels outside the mask is not known and not removed.
+void crosstalk_compensate(double powerValues[], uint16_t mask);
+
+#endif /* CROSSTALK_H_ */
@@ -1,14 +1,17 @@
 #include "detector.h"
+#include "instance.h"
 #include "buffer.h"
+#include "crosstalk.h"
 #include "interrupts.h"
 #include "filter.h"
 #include "lockoutTimer.h"
 #include "hitLedTimer.h"
+#include "shotCode.h"
+#include "shotSlot.h"
 #include <stdio.h>
+#include <string.h>
 
 #define FUDGE_FACTOR_DEFAULT_INDEX 2
-#define ADC_MAX_VALUE 4095.0
-#define ADC_SCALAR 2.0
 #define MEDIAN_POWER_SCALAR 2
 #define DEFAULT_PLAYER_HIT 2
 
@@ -44,22 +47,98 @@
 #define FILTER_NUMBER_9_SECOND_VALUE 40
 #define FILTER_NUMBER_10_SECOND_VALUE 38
 
+// With coded shots a candidate hit is only a reason to decode, and the code
+// check rejects what is not a shot, so the power test can be this much more
+// sensitive. That wins back the range lost to the carrier being off for part
+// of a coded burst.
+#define CODED_SHOT_FUDGE_DIVISOR 10
+
+// When only a few frequencies can hit us, only those filters are run, plus
+// this many ignored ones as noise references for the threshold.
+#define NOISE_REFERENCE_COUNT 3
+
 #define NUM_FUDGE_FACTORS 3
 #define FUDGE_FACTOR_1 10
 #define FUDGE_FACTOR_2 100
 #define FUDGE_FACTOR_3 1000
 
 static uint32_t fudgeFactors[NUM_FUDGE_FACTORS] = {FUDGE_FACTOR_1, FUDGE_FACTOR_2, FUDGE_FACTOR_3};
-static uint8_t fudgeFactorIndex = FUDGE_FACTOR_DEFAULT_INDEX;
-
-static bool detector_hitDetectedFlag = false;
-static bool detector_ignoreAllHitsFlag = false;
+static INSTANCE_LOCAL uint8_t fudgeFactorIndex = FUDGE_FACTOR_DEFAULT_INDEX;
+
+static INSTANCE_LOCAL bool detector_hitDetectedFlag = false;
+static INSTANCE_LOCAL bool detector_ignoreAllHitsFlag = false;
+
+static INSTANCE_LOCAL uint32_t invocation_count;
+static INSTANCE_LOCAL uint32_t sample_cnt;
+static INSTANCE_LOCAL uint16_t decimation = FILTER_FIR_DECIMATION_FACTOR; // At the sample rate.
+static INSTANCE_LOCAL uint16_t frequencyNumberOfLastHit;
+static INSTANCE_LOCAL uint16_t detector_hitArray[FILTER_FREQUENCY_COUNT];
+static INSTANCE_LOCAL bool ignored_frequencyArray[FILTER_FREQUENCY_COUNT];
+static INSTANCE_LOCAL bool codedShotsOn = false;
+static INSTANCE_LOCAL bool crosstalkCompensationOn = false;
+static INSTANCE_LOCAL int16_t codeOfLastHit = SHOTCODE_NONE;
+
+// Time-division shots (shotSlot.h). slotPhase is the frame phase, in ADC
+// ticks, of the next sample taken from the ADC buffer.
+static INSTANCE_LOCAL uint16_t slotCount = 0;
+static INSTANCE_LOCAL uint32_t slotFrameTicks;
+static INSTANCE_LOCAL uint32_t slotPhase;
+static INSTANCE_LOCAL int16_t slotOfLastHit = SHOTSLOT_NONE;
+static INSTANCE_LOCAL int16_t slotOfCodedShot[FILTER_FREQUENCY_COUNT]; // Waiting to decode.
+static INSTANCE_LOCAL detector_hitCount_t slotHitArray[SHOTSLOT_MAX_COUNT][FILTER_FREQUENCY_COUNT];
+
+// The IIR filters run per decimated sample, and the noise references among
+// them; no references means all filters run and the median is taken over all.
+static INSTANCE_LOCAL bool channelMaskingOn = true;
+static INSTANCE_LOCAL uint16_t computedChannels[FILTER_FREQUENCY_COUNT];
+static INSTANCE_LOCAL uint16_t computedChannelCount = FILTER_FREQUENCY_COUNT;
+static INSTANCE_LOCAL uint16_t noiseReferences[NOISE_REFERENCE_COUNT];
+static INSTANCE_LOCAL uint16_t noiseReferenceCount = 0;
+static INSTANCE_LOCAL uint32_t filterRuns;
+static INSTANCE_LOCAL uint32_t filterRunsSkipped;
+
+// Pick the filters to run from the ignored frequencies: every frequency that
+// can hit us, and noise references spread over the ignored ones. Ignored
+// frequencies next to one that can hit us catch the skirt of its shots, so
+// they are not used as references. If that leaves too little to save, all
+// filters run. With crosstalk compensation, so do the ignored frequencies
+// that leak into the others, to be taken out.
+static void selectChannels(void) {
+    uint16_t mask = 0, activeCount = 0;
+    uint16_t candidates[FILTER_FREQUENCY_COUNT], candidateCount = 0;
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        if (!ignored_frequencyArray[i]) {
+            mask |= 1 << i;
+            activeCount++;
+        }
+    }
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        bool nextToActive = (i > 0 && !ignored_frequencyArray[i - 1]) ||
+                            (i + 1 < FILTER_FREQUENCY_COUNT && !ignored_frequencyArray[i + 1]);
+        if (ignored_frequencyArray[i] && !nextToActive)
+            candidates[candidateCount++] = i;
+    }
 
-static uint32_t invocation_count;
-static uint32_t sample_cnt;
-static uint16_t frequencyNumberOfLastHit;
-static uint16_t detector_hitArray[FILTER_FREQUENCY_COUNT];
-static bool ignored_frequencyArray[FILTER_FREQUENCY_COUNT];
+    noiseReferenceCount = 0;
+    if (!channelMaskingOn || activeCount + NOISE_REFERENCE_COUNT >= FILTER_FREQUENCY_COUNT ||
+        candidateCount < NOISE_REFERENCE_COUNT) {
+        mask = FILTER_ALL_CHANNELS;
+    } else {
+        for (uint16_t k = 0; k < NOISE_REFERENCE_COUNT; k++) {
+            uint16_t reference = candidates[k * (candidateCount - 1) / (NOISE_REFERENCE_COUNT - 1)];
+            noiseReferences[noiseReferenceCount++] = reference;
+            mask |= 1 << reference;
+        }
+        if (crosstalkCompensationOn)
+            mask |= crosstalk_getSources(mask);
+    }
+    filter_setChannelMask(mask);
+    computedChannelCount = 0;
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        if (mask & (1 << i))
+            computedChannels[computedChannelCount++] = i;
+    }
+}
 
 // Initialize the detector module.
 // By default, all frequencies are considered for hits.
@@ -82,7 +161,19 @@ void detector_init(void) {
 
     invocation_count = 0;
     sample_cnt = 0;
+    decimation = filter_getDecimationValue();
     frequencyNumberOfLastHit = 0;
+
+    codedShotsOn = false;
+    crosstalkCompensationOn = false;
+    codeOfLastHit = SHOTCODE_NONE;
+    shotCode_init();
+
+    detector_setSlots(0);
+
+    filterRuns = 0;
+    filterRunsSkipped = 0;
+    selectChannels();
 }
 
 // freqArray is indexed by frequency number. If an element is set to true,
@@ -92,6 +183,7 @@ void detector_setIgnoredFrequencies(bool freqArray[]) {
     for (int i = 0; i < FILTER_FREQUENCY_COUNT; ++i) {
         ignored_frequencyArray[i] = freqArray[i];
     }
+    selectChannels();
 }
 
 bool detector_detectHit(double powerValues[]) {
@@ -121,62 +213,132 @@ bool detector_detectHit(double powerValues[]) {
     double medianValue = powerValuesCopy[(FILTER_FREQUENCY_COUNT / MEDIAN_POWER_SCALAR - 1)];
 
     // if the highest power filter is above the median value * fudge factor, return true
-    return (powerValuesCopy[0] > (medianValue * fudgeFactors[fudgeFactorIndex]));
+    double fudgeFactor = fudgeFactors[fudgeFactorIndex];
+    if (codedShotsOn)
+        fudgeFactor /= CODED_SHOT_FUDGE_DIVISOR;
+    return (powerValuesCopy[0] > (medianValue * fudgeFactor));
+}
+
+// detector_detectHit() for a masked filter bank: the threshold comes from the
+// median of the noise references alone. Filters that are not run have no
+// power and cannot be the largest.
+static bool detectMaskedHit(double powerValues[]) {
+    double references[NOISE_REFERENCE_COUNT];
+    double maxPower = 0;
+    for (uint16_t i = 0; i < noiseReferenceCount; i++) {
+        // Insertion sort, largest first.
+        uint16_t j = i;
+        for (; j > 0 && references[j - 1] < powerValues[noiseReferences[i]]; j--)
+            references[j] = references[j - 1];
+        references[j] = powerValues[noiseReferences[i]];
+    }
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        if (powerValues[i] > maxPower)
+            maxPower = powerValues[i];
+    }
+    double medianValue = references[(noiseReferenceCount - 1) / 2];
+
+    double fudgeFactor = fudgeFactors[fudgeFactorIndex];
+    if (codedShotsOn)
+        fudgeFactor /= CODED_SHOT_FUDGE_DIVISOR;
+    return maxPower > medianValue * fudgeFactor;
+}
+
+// Count a hit by the shooter on frequency, with its code if coded shots are on
+// and the slot it was sent in if slots are.
+static void registerHit(uint8_t frequency, int16_t code, int16_t slot) {
+    lockoutTimer_start();
+    hitLedTimer_start();
+    detector_hitArray[frequency]++;
+    detector_hitDetectedFlag = true;
+    frequencyNumberOfLastHit = frequency;
+    codeOfLastHit = code;
+    slotOfLastHit = slot;
+    if (slot != SHOTSLOT_NONE)
+        slotHitArray[slot][frequency]++;
+}
+
+// Register the coded shots whose frames have just been decoded. A shot whose
+// code does not check out is not counted: it is more likely the skirt of a
+// shot on another frequency, or noise, than a player.
+static void registerDecodedHits(void) {
+    for (uint16_t frequency = 0; frequency < FILTER_FREQUENCY_COUNT; frequency++) {
+        int16_t code = shotCode_takeResult(frequency);
+        if (code >= 0 && !lockoutTimer_running() && !detector_ignoreAllHitsFlag)
+            registerHit(frequency, code, slotOfCodedShot[frequency]);
+    }
 }
 
 // Runs the entire detector: decimating FIR-filter, IIR-filters,
 // power-computation, hit-detection. If interruptsCurrentlyEnabled = true,
-// interrupts are running. If interruptsCurrentlyEnabled = false you can pop
+// interrupts are running. If interruptsCurrentlyEnabled = false you can take
 // values from the ADC buffer without disabling interrupts. If
 // interruptsCurrentlyEnabled = true, do the following:
 // 1. disable interrupts.
-// 2. pop the value from the ADC buffer.
+// 2. advance past the values taken from the ADC buffer.
 // 3. re-enable interrupts.
+// The FIR filter reads its inputs in place from the ADC buffer's history, so
+// the values are consumed up to each FIR output rather than popped one by one.
 // Ignore hits on frequencies specified with detector_setIgnoredFrequencies().
 // Assumption: draining the ADC buffer occurs faster than it can fill.
 void detector(bool interruptsCurrentlyEnabled) {
     invocation_count++;
-    uint64_t elementCount = buffer_elements();
+    uint32_t elementCount = buffer_elements();
 
-    // iterate through all new ADC values
-    for (int i = 0; i < elementCount; i++) {
+    // iterate through all new ADC values, up to one FIR output at a time
+    while (elementCount) {
+        uint32_t count = decimation - sample_cnt;
+        if (count > elementCount)
+            count = elementCount;
+        elementCount -= count;
 
-        uint32_t rawAdcValue;
-        // if interrupts are enabled, we need to temporarily disable them to pop from the buffer
+        // if interrupts are enabled, we need to temporarily disable them to advance the buffer
         if (interruptsCurrentlyEnabled) {
             interrupts_disableArmInts();
-            rawAdcValue = buffer_pop();
+            buffer_advance(count);
             interrupts_enableArmInts();
         } else {
-            rawAdcValue = buffer_pop();
+            buffer_advance(count);
         }
 
-        // Scaling the ADC value to a double between -1.0 and 1.0
-        double scaledAdcValue = ((double)rawAdcValue / ADC_MAX_VALUE) * ADC_SCALAR - 1.0;
+        // Keep time in the slot frame, one ADC tick per sample.
+        if (slotCount)
+            slotPhase = (slotPhase + count) % slotFrameTicks;
 
-        filter_addNewInput(scaledAdcValue);
+        sample_cnt += count; // Count samples since last filter run
 
-        sample_cnt++; // Count samples since last filter run
- 
         // Run filters and hit detection if decimation factor reached
-        if (sample_cnt >= FILTER_FIR_DECIMATION_FACTOR) {
+        if (sample_cnt >= decimation) {
             sample_cnt = 0; // Reset the sample count.
-            filter_firFilter(); // Runs the FIR filter, output goes in the y-queue.
-            // Run all the IIR filters and compute power in each of the output queues.
-            for (uint16_t filterNumber = 0; filterNumber < FILTER_FREQUENCY_COUNT; filterNumber++) {
-                filter_iirFilter(filterNumber); // Run each of the IIR filters.
+            // Runs the FIR filter on the inputs in the ADC buffer, output goes in the y-queue.
+            filter_firFilterAdc(buffer_history(filter_getFirCoefficientCount()));
+            // Run the IIR filters in use and compute power in each of their output queues.
+            for (uint16_t k = 0; k < computedChannelCount; k++) {
+                uint16_t filterNumber = computedChannels[k];
+                double y = filter_iirFilter(filterNumber); // Run each of the IIR filters.
+                // Coded shots are only sliced on channels that can hit us.
+                if (codedShotsOn && !ignored_frequencyArray[filterNumber])
+                    shotCode_addSample(filterNumber, y);
                 // Compute the power for each of the filters, at lowest computational cost.
                 // 1st false means do not compute from scratch.
                 // 2nd false means no debug prints.
                 filter_computePower(filterNumber, false, false);
             }
+            filterRuns += computedChannelCount;
+            filterRunsSkipped += FILTER_FREQUENCY_COUNT - computedChannelCount;
+            if (codedShotsOn && shotCode_endSample())
+                registerDecodedHits();
             // can't be hit by other players if we are locked out
             if (!lockoutTimer_running()) {
                 double powerValues[FILTER_FREQUENCY_COUNT];
                 filter_getCurrentPowerValues(powerValues);
+                if (crosstalkCompensationOn)
+                    crosstalk_compensate(powerValues, filter_getChannelMask());
 
                 // determine if this is a valid player hit and record it as such if it is
-                if ((detector_detectHit(powerValues)) && (!detector_ignoreAllHitsFlag)) {
+                bool hit = noiseReferenceCount ? detectMaskedHit(powerValues)
+                                               : detector_detectHit(powerValues);
+                if (hit && (!detector_ignoreAllHitsFlag)) {
                     uint8_t player_hit = DEFAULT_PLAYER_HIT;
                     // find highest power player
                     for (uint8_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
@@ -184,13 +346,18 @@ void detector(bool interruptsCurrentlyEnabled) {
                             player_hit = i;
                     }
 
-                    // if this is a valid player to be hit by, then register the hit
+                    // if this is a valid player to be hit by, then register the hit,
+                    // or with coded shots wait for the rest of the frame
+                    // The slot is binned here, where the shot is seen, even
+                    // when the hit waits for its code.
                     if (!ignored_frequencyArray[player_hit]) {
-                        lockoutTimer_start();
-                        hitLedTimer_start();
-                        detector_hitArray[player_hit]++;
-                        detector_hitDetectedFlag = true;
-                        frequencyNumberOfLastHit = player_hit;
+                        int16_t slot = shotSlot_ofDetection(slotPhase, slotCount);
+                        if (codedShotsOn) {
+                            shotCode_expectFrame(player_hit);
+                            slotOfCodedShot[player_hit] = slot;
+                        } else {
+                            registerHit(player_hit, SHOTCODE_NONE, slot);
+                        }
                     }
                 }
             }
@@ -235,6 +402,113 @@ void detector_setFudgeFactorIndex(uint32_t factorIdx) {
     fudgeFactorIndex = factorIdx;
 }
 
+// Turn coded shots on or off.
+void detector_setCodedShots(bool on) {
+    codedShotsOn = on;
+}
+
+// Turn crosstalk compensation on or off, measuring the leakage first if it
+// has not been measured at the sample rate. Returns whether it is on.
+bool detector_setCrosstalkCompensation(bool on) {
+    crosstalkCompensationOn = on && (crosstalk_isMeasured() || crosstalk_measure());
+    selectChannels();
+    return crosstalkCompensationOn;
+}
+
+// Returns the shooter ID of the last hit.
+int16_t detector_getCodeOfLastHit(void) {
+    return codeOfLastHit;
+}
+
+// Time-division shots: bin hits by slot in a frame of count slots, or not at
+// all for a count of 0.
+void detector_setSlots(uint16_t count) {
+    slotCount = count < SHOTSLOT_MAX_COUNT ? count : SHOTSLOT_MAX_COUNT;
+    slotFrameTicks = shotSlot_frameTicks(slotCount);
+    slotPhase = 0;
+    slotOfLastHit = SHOTSLOT_NONE;
+    for (uint16_t frequency = 0; frequency < FILTER_FREQUENCY_COUNT; frequency++)
+        slotOfCodedShot[frequency] = SHOTSLOT_NONE;
+    for (uint16_t slot = 0; slot < SHOTSLOT_MAX_COUNT; slot++)
+        for (uint16_t frequency = 0; frequency < FILTER_FREQUENCY_COUNT; frequency++)
+            slotHitArray[slot][frequency] = 0;
+}
+
+// The shared epoch is now. The samples still in the ADC buffer came before it,
+// so slot 0 starts with the first sample after them.
+void detector_syncSlots(void) {
+    if (!slotCount)
+        return;
+    uint32_t backlog = buffer_elements() % slotFrameTicks;
+    slotPhase = backlog ? slotFrameTicks - backlog : 0;
+}
+
+// Returns the slot the last hit was sent in.
+int16_t detector_getSlotOfLastHit(void) {
+    return slotOfLastHit;
+}
+
+// Copy the hit counts of slot, by frequency, into hitArray.
+void detector_getSlotHitCounts(uint16_t slot, detector_hitCount_t hitArray[]) {
+    for (int i = 0; i < FILTER_FREQUENCY_COUNT; ++i) {
+        hitArray[i] = slot < SHOTSLOT_MAX_COUNT ? slotHitArray[slot][i] : 0;
+    }
+}
+
+// Turn the masked filter bank on or off.
+void detector_setChannelMasking(bool on) {
+    channelMaskingOn = on;
+    selectChannels();
+}
+
+// Returns how many IIR filter runs the detector has made and skipped.
+void detector_getFilterRunCounts(uint32_t *runs, uint32_t *skipped) {
+    *runs = filterRuns;
+    *skipped = filterRunsSkipped;
+}
+
+// The header of a detector snapshot, ahead of the filter snapshot.
+typedef struct {
+    uint32_t magic;
+    uint16_t sampleCount; // Inputs since the last FIR output.
+    uint16_t reserved;
+} detectorStateHeader_t;
+
+// Write a snapshot of the detector into blob, which has room for size bytes.
+// Returns its length, or 0 if it does not fit or the filters cannot be saved.
+uint32_t detector_saveState(uint8_t blob[], uint32_t size) {
+    if (size < DETECTOR_STATE_HEADER_SIZE)
+        return 0;
+    // The FIR filter's inputs are in the ADC buffer: save them in its place.
+    filter_setAdcInputs(buffer_history(filter_getFirCoefficientCount()));
+    uint32_t filterSize = filter_saveState(blob + DETECTOR_STATE_HEADER_SIZE,
+                                           size - DETECTOR_STATE_HEADER_SIZE);
+    if (!filterSize)
+        return 0;
+    detectorStateHeader_t header = {DETECTOR_STATE_MAGIC, sample_cnt, 0};
+    memcpy(blob, &header, sizeof(header));
+    return DETECTOR_STATE_HEADER_SIZE + filterSize;
+}
+
+// Restore a snapshot written by detector_saveState(). Returns false, changing
+// nothing, if blob is not a whole snapshot or lacks a filter that now runs.
+bool detector_restoreState(const uint8_t blob[], uint32_t size) {
+    detectorStateHeader_t header;
+    if (size < DETECTOR_STATE_HEADER_SIZE)
+        return false;
+    memcpy(&header, blob, sizeof(header));
+    if (header.magic != DETECTOR_STATE_MAGIC ||
+        header.sampleCount >= decimation ||
+        !filter_restoreState(blob + DETECTOR_STATE_HEADER_SIZE,
+                             size - DETECTOR_STATE_HEADER_SIZE))
+        return false;
+    buffer_data_t inputs[BUFFER_HISTORY];
+    filter_getAdcInputs(inputs);
+    buffer_setHistory(inputs, filter_getFirCoefficientCount());
+    sample_cnt = header.sampleCount;
+    return true;
+}
+
 // Returns the detector invocation count.
 // The count is incremented each time detector is called.
 // Used for run-time statistics.
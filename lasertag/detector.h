@@ -14,6 +14,8 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "filter.h"
+
 typedef uint16_t detector_hitCount_t;
 
 // Initialize the detector module.
@@ -38,6 +40,11 @@ void detector_setIgnoredFrequencies(bool freqArray[]);
 // Assumption: draining the ADC buffer occurs faster than it can fill.
 void detector(bool interruptsCurrentlyEnabled);
 
+// Returns true if the power values look like a hit: the largest is more than
+// the median times the current fudge factor. Lockout and ignored frequencies
+// are not considered here; detector() applies those.
+bool detector_detectHit(double powerValues[]);
+
 // Returns true if a hit was detected.
 bool detector_hitDetected(void);
 
@@ -61,6 +68,80 @@ void detector_getHitCounts(detector_hitCount_t hitArray[]);
 // The actual values for fudge-factors is stored in an array found in detector.c
 void detector_setFudgeFactorIndex(uint32_t factorIdx);
 
+// Coded shots (shotCode.h). When on, a shot found by the power detector is
+// only registered once its code has been decoded and checks out, about 200 ms
+// later, and detector_getCodeOfLastHit() then says who fired it. Plain bursts
+// are not hits. Since the code check rejects what is not a shot, the power
+// test of detector_detectHit() is made ten times more sensitive meanwhile.
+// Cleared by detector_init().
+void detector_setCodedShots(bool on);
+
+// Crosstalk compensation (crosstalk.h). When on, the powers are multiplied by
+// the inverse of the filters' leakage matrix before each decision, so a
+// strong shot on one frequency, the gun's own included, does not show up on
+// the others. Turning it on measures the matrix first if it has not been
+// measured at the sample rate: that takes the filters over several hundred
+// milliseconds of input and resets them, so turn it on before the game
+// starts. With the bank masked, it also runs the ignored frequencies that leak
+// into the others (crosstalk_getSources()). Returns whether it is on. Cleared
+// by detector_init().
+bool detector_setCrosstalkCompensation(bool on);
+
+// Returns the shooter ID of the last hit, or SHOTCODE_NONE if coded shots are
+// off.
+int16_t detector_getCodeOfLastHit(void);
+
+// Time-division shots (shotSlot.h). With a frame of count slots, each hit is
+// also binned by the slot it was sent in, so shooters sharing a frequency in
+// different slots can be told apart. A count of 0, the default, turns slots
+// off, and at most SHOTSLOT_MAX_COUNT are binned. Clears the slot hit counts;
+// cleared by detector_init().
+void detector_setSlots(uint16_t count);
+
+// The shared epoch is now: slot 0 starts with the next sample the ADC takes.
+// Call it when the beacon or sync burst arrives, like transmitter_syncSlots().
+void detector_syncSlots(void);
+
+// Returns the slot the last hit was sent in, or SHOTSLOT_NONE if slots are
+// off.
+int16_t detector_getSlotOfLastHit(void);
+
+// Get the hit counts, by frequency, of the shots sent in slot.
+void detector_getSlotHitCounts(uint16_t slot, detector_hitCount_t hitArray[]);
+
+// Masked filter bank. When six or fewer frequencies can hit us, detector()
+// only runs their IIR filters and three ignored ones, away from them, as noise
+// references: the hit threshold is then the median of the references times
+// the fudge factor. In a two-team game that is 4 filters of 10. On by default,
+// and kept across detector_init().
+void detector_setChannelMasking(bool on);
+
+// Returns how many IIR filter runs (with their power computations) detector()
+// has made since detector_init(), and how many the masked filter bank saved.
+// Used for run-time statistics.
+void detector_getFilterRunCounts(uint32_t *runs, uint32_t *skipped);
+
+// Warm start. A detector snapshot is the decimation phase followed by a
+// filter snapshot (filter.h): the delay lines and the power sums, which also
+// carry the noise estimate, as the hit threshold comes from the median power.
+// Restored after detector_init() and detector_setIgnoredFrequencies(), the
+// power values are settled from the first sample, so the lockout that hides
+// bogus hits at startup is not needed. Hit counts, the lockout and coded-shot
+// decoding are not part of it.
+#define DETECTOR_STATE_MAGIC 0x3144544C // "LTD1" in memory.
+#define DETECTOR_STATE_HEADER_SIZE 8
+#define DETECTOR_STATE_MAX_SIZE (DETECTOR_STATE_HEADER_SIZE + FILTER_STATE_MAX_SIZE)
+
+// Write a snapshot of the detector into blob, which has room for size bytes.
+// Returns its length, or 0 if it does not fit or the filters cannot be saved.
+uint32_t detector_saveState(uint8_t blob[], uint32_t size);
+
+// Restore a snapshot written by detector_saveState(). Returns false, changing
+// nothing, if blob is not a whole snapshot or lacks one of the filters the
+// ignored frequencies now run (see filter_restoreState()); start the lockout
+// then, as for a cold start.
+bool detector_restoreState(const uint8_t blob[], uint32_t size);
+
 // Returns the detector invocation count.
 // The count is incremented each time detector is called.
 // Used for run-time statistics.
@@ -0,0 +1,124 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "amp.h"
+#include "buffer.h"
+#include "detector.h"
+#include "detectorCore.h"
+#include "filter.h"
+#include "instance.h"
+#include "lockoutTimer.h"
+#include "sampleRate.h"
+
+#define INTERRUPTS_CURRENTLY_ENABLED true
+
+static INSTANCE_LOCAL volatile uint32_t tickCount;
+static INSTANCE_LOCAL amp_stats_t stats;
+static INSTANCE_LOCAL uint64_t startTime;
+static INSTANCE_LOCAL uint32_t lastPublishTick;
+static INSTANCE_LOCAL uint32_t statsIntervalTicks = AMP_STATS_INTERVAL_TICKS; // At the sample rate.
+
+// Initialize the filters, detector, ADC buffer and lockout timer.
+void detectorCore_init(void) {
+  filter_init();
+  detector_init();
+  buffer_init();
+  lockoutTimer_init();
+  lockoutTimer_start(); // Ignore erroneous hits at startup.
+  tickCount = 0;
+  lastPublishTick = 0;
+  statsIntervalTicks = sampleRate_ticks(AMP_STATS_INTERVAL_TICKS);
+  stats = (amp_stats_t){0};
+  startTime = amp_getTime();
+}
+
+// Body of CPU1's timer ISR, called with the sample just converted.
+void detectorCore_tick(uint32_t adcValue) {
+  lockoutTimer_tick();
+  buffer_pushover(adcValue);
+  tickCount++;
+}
+
+// Apply one command from CPU0. Returns false for AMP_MESSAGE_STOP.
+static bool handleCommand(const amp_message_t *message) {
+  switch (message->type) {
+  case AMP_MESSAGE_RESET:
+    detector_init();
+    break;
+  case AMP_MESSAGE_SET_IGNORED: {
+    bool ignored[FILTER_FREQUENCY_COUNT];
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+      ignored[i] = message->value & (1 << i);
+    detector_setIgnoredFrequencies(ignored);
+    break;
+  }
+  case AMP_MESSAGE_IGNORE_ALL_HITS:
+    detector_ignoreAllHits(message->argument);
+    break;
+  case AMP_MESSAGE_SET_FUDGE_FACTOR:
+    detector_setFudgeFactorIndex(message->argument);
+    break;
+  case AMP_MESSAGE_STOP:
+    return false;
+  default:
+    break;
+  }
+  return true;
+}
+
+// Bring the load figures up to date and hand them to CPU0.
+static void publishStats(void) {
+  stats.runTime = amp_getTime() - startTime;
+  stats.ticks = tickCount;
+  stats.detectorInvocations = detector_getInvocationCount();
+  detector_getFilterRunCounts(&stats.filterRuns, &stats.filterRunsSkipped);
+  filter_getCurrentPowerValues(stats.powerValues);
+  amp_publishStats(&stats);
+}
+
+// One pass of the main loop: commands, detector() and hit reports.
+bool detectorCore_poll(bool interruptsCurrentlyEnabled) {
+  amp_shared_t *shared = amp_getShared();
+  amp_message_t message;
+  while (amp_pop(&shared->toDetector, &message))
+    if (!handleCommand(&message))
+      return false;
+
+  uint32_t waiting = buffer_elements();
+  if (waiting > stats.bufferHighWater)
+    stats.bufferHighWater = waiting;
+  if (waiting) {
+    uint64_t start = amp_getTime();
+    detector(interruptsCurrentlyEnabled);
+    if (detector_hitDetected()) {
+      stats.hits++;
+      publishStats(); // CPU0 finds the powers of the hit with it.
+      amp_push(&shared->toGame, AMP_MESSAGE_HIT,
+               detector_getFrequencyNumberOfLastHit(), tickCount);
+      detector_clearHit();
+    }
+    stats.busyTime += amp_getTime() - start;
+  }
+
+  if (tickCount - lastPublishTick >= statsIntervalTicks) {
+    lastPublishTick = tickCount;
+    publishStats();
+  }
+  return true;
+}
+
+// Report that CPU1 is running, then poll until CPU0 sends AMP_MESSAGE_STOP.
+void detectorCore_run(void) {
+  amp_shared_t *shared = amp_getShared();
+  __atomic_store_n(&shared->cpu1State, AMP_CPU1_RUNNING, __ATOMIC_RELEASE);
+  while (detectorCore_poll(INTERRUPTS_CURRENTLY_ENABLED))
+    ;
+  publishStats(); // Final numbers for CPU0's statistics screen.
+  __atomic_store_n(&shared->cpu1State, AMP_CPU1_STOPPED, __ATOMIC_RELEASE);
+}
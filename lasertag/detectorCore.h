@@ -0,0 +1,36 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef DETECTORCORE_H_
+#define DETECTORCORE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// CPU1 side of the AMP build (see amp.h). CPU1's own 100 kHz timer ISR puts
+// each ADC sample in the ADC buffer and ticks the lockout timer; its main loop
+// runs detector(), obeys the commands CPU0 sends and reports each hit and,
+// every 100 ms, its load. CPU0 lights the hit LED when the hit arrives.
+
+// Initialize the filters, detector, ADC buffer and lockout timer. The lockout
+// is started so the near-zero power at start-up cannot cause a hit.
+void detectorCore_init(void);
+
+// Body of CPU1's timer ISR, called with the sample just converted.
+void detectorCore_tick(uint32_t adcValue);
+
+// One pass of the main loop: handle commands, run detector() over the waiting
+// samples and report any hit. Returns false once CPU0 has sent
+// AMP_MESSAGE_STOP.
+bool detectorCore_poll(bool interruptsCurrentlyEnabled);
+
+// Report that CPU1 is running, then poll until CPU0 sends AMP_MESSAGE_STOP.
+void detectorCore_run(void);
+
+#endif /* DETECTORCORE_H_ */
@@ -1,58 +1,60 @@
 #include "filter.h"
+#include "filterCoefficients.h"
+#include "filterDesign.h"
+#include "filterFloat.h"
+#include "filterKernels.h"
+#include "instance.h"
 #include "queue.h"
+#include "sampleRate.h"
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
-#define FIR_COEFF_COUNT 81
-
-#define FILTER_FREQUENCY_COUNT 10
-
-#define IIR_B_COEFF_COUNT 11
-
-#define IIR_A_COEFF_COUNT 10
-
 #define X_QUEUE_SIZE FIR_COEFF_COUNT
 #define Y_QUEUE_SIZE IIR_B_COEFF_COUNT
 #define Z_QUEUE_SIZE (IIR_B_COEFF_COUNT - 1)
 #define OUTPUT_QUEUE_SIZE FILTER_INPUT_PULSE_WIDTH
 
 #define QUEUE_INIT_VALUE 0
-
-const static double fir_b_coeffs[FIR_COEFF_COUNT] = {
-    6.2534348595847538e-04, 6.5497758294040542e-04, 6.1992178501587701e-04, 5.0452526771031455e-04, 2.9091060249592421e-04, -3.2856141914564076e-05, -4.6270378618655110e-04, -9.6927546688259272e-04, -1.4924081755106418e-03, -1.9419900366783919e-03, -2.2067863671876870e-03, -2.1712756177317168e-03, -1.7387264211219384e-03, -8.5702012741646952e-04, 4.5755838533190820e-04, 2.1038619889547699e-03, 3.8916195777932861e-03, 5.5528025909850429e-03, 6.7697616171742822e-03, 7.2184438752610595e-03, 6.6220735304987509e-03, 4.8081553873736364e-03, 1.7600311340430473e-03, -2.3461497646870785e-03, -7.1270921927757249e-03, -1.2006185309970628e-02, -1.6257372605455990e-02, -1.9076605069723938e-02, -1.9674051143141542e-02, -1.7376505856439812e-02, -1.1726971420919888e-02, -2.5676376647722600e-03, 9.9063015042762728e-03, 2.5131461770900417e-02, 4.2204543223913080e-02, 5.9953325291499965e-02, 7.7043897907315209e-02, 9.2112551316003752e-02, 1.0390705353179479e-01, 1.1142031823958311e-01, 1.1400000000000000e-01, 1.1142031823958311e-01, 1.0390705353179479e-01, 9.2112551316003752e-02, 7.7043897907315209e-02, 5.9953325291499965e-02, 4.2204543223913080e-02, 2.5131461770900417e-02, 9.9063015042762728e-03, -2.5676376647722600e-03, -1.1726971420919888e-02, -1.7376505856439812e-02, -1.9674051143141542e-02, -1.9076605069723938e-02, -1.6257372605455990e-02, -1.2006185309970628e-02, -7.1270921927757249e-03, -2.3461497646870785e-03, 1.7600311340430473e-03, 4.8081553873736364e-03, 6.6220735304987509e-03, 7.2184438752610595e-03, 6.7697616171742822e-03, 5.5528025909850429e-03, 3.8916195777932861e-03, 2.1038619889547699e-03, 4.5755838533190820e-04, -8.5702012741646952e-04, -1.7387264211219384e-03, -2.1712756177317168e-03, -2.2067863671876870e-03, -1.9419900366783919e-03, -1.4924081755106418e-03, -9.6927546688259272e-04, -4.6270378618655110e-04, -3.2856141914564076e-05, 2.9091060249592421e-04, 5.0452526771031455e-04, 6.1992178501587701e-04, 6.5497758294040542e-04, 6.2534348595847538e-04
-};
-
-const static double iir_a_coeffs[FILTER_FREQUENCY_COUNT][IIR_A_COEFF_COUNT] = {
-    {-5.9637727070164059e+00, 1.9125339333078287e+01, -4.0341474540744301e+01, 6.1537466875369077e+01, -7.0019717951472558e+01, 6.0298814235239249e+01, -3.8733792862566574e+01, 1.7993533279581207e+01, -5.4979061224868158e+00, 9.0332828533800469e-01},
-    {-4.6377947119071408e+00, 1.3502215749461552e+01, -2.6155952405269698e+01, 3.8589668330738235e+01, -4.3038990303252490e+01, 3.7812927599536991e+01, -2.5113598088113683e+01, 1.2703182701888030e+01, -4.2755083391143280e+00, 9.0332828533799747e-01},
-    {-3.0591317915750937e+00, 8.6417489609637492e+00, -1.4278790253808838e+01, 2.1302268283304294e+01, -2.2193853972079211e+01, 2.0873499791105424e+01, -1.3709764520609379e+01, 8.1303553577931567e+00, -2.8201643879900473e+00, 9.0332828533799880e-01},
-    {-1.4071749185996751e+00, 5.6904141470697542e+00, -5.7374718273676306e+00, 1.1958028362868905e+01, -8.5435280598354630e+00, 1.1717345583835968e+01, -5.5088290876998647e+00, 5.3536787286077674e+00, -1.2972519209655595e+00, 9.0332828533800047e-01},
-    {8.2010906117760318e-01, 5.1673756579268604e+00, 3.2580350909220925e+00, 1.0392903763919193e+01, 4.8101776408669084e+00, 1.0183724507092508e+01, 3.1282000712126754e+00, 4.8615933365571991e+00, 7.5604535083144919e-01, 9.0332828533800047e-01},
-    {2.7080869856154530e+00, 7.8319071217995795e+00, 1.2201607990980769e+01, 1.8651500443681677e+01, 1.8758157568004620e+01, 1.8276088095999114e+01, 1.1715361303018966e+01, 7.3684394621254015e+00, 2.4965418284512091e+00, 9.0332828533801224e-01},
-    {4.9479835250075892e+00, 1.4691607003177602e+01, 2.9082414772101060e+01, 4.3179839108869331e+01, 4.8440791644688879e+01, 4.2310703962394342e+01, 2.7923434247706432e+01, 1.3822186510471010e+01, 4.5614664160654357e+00, 9.0332828533799958e-01},
-    {6.1701893352279864e+00, 2.0127225876810336e+01, 4.2974193398071691e+01, 6.5958045321253465e+01, 7.5230437667866624e+01, 6.4630411355739881e+01, 4.1261591079244141e+01, 1.8936128791950541e+01, 5.6881982915180327e+00, 9.0332828533799836e-01},
-    {7.4092912870072398e+00, 2.6857944460290135e+01, 6.1578787811202247e+01, 9.8258255839887340e+01, 1.1359460153696304e+02, 9.6280452143026153e+01, 5.9124742025776442e+01, 2.5268527576524235e+01, 6.8305064480743178e+00, 9.0332828533800158e-01},
-    {8.5743055776347692e+00, 3.4306584753117903e+01, 8.4035290411037124e+01, 1.3928510844056831e+02, 1.6305115418161643e+02, 1.3648147221895812e+02, 8.0686288623299902e+01, 3.2276361903872186e+01, 7.9045143816244918e+00, 9.0332828533799903e-01}};
-
-const static double iir_b_coeffs[FILTER_FREQUENCY_COUNT][IIR_B_COEFF_COUNT] = {
-    {9.0928661148176830e-10, 0.0, -4.5464330574088414e-09, 0.0, 9.0928661148176828e-09, 0.0, -9.0928661148176828e-09, 0.0, 4.5464330574088414e-09, 0.0, -9.0928661148176830e-10},
-    {9.0928661148203093e-10, 0.0, -4.5464330574101550e-09, 0.0, 9.0928661148203099e-09, 0.0, -9.0928661148203099e-09, 0.0, 4.5464330574101550e-09, 0.0, -9.0928661148203093e-10},
-    {9.0928661148196858e-10, 0.0, -4.5464330574098431e-09, 0.0, 9.0928661148196862e-09, 0.0, -9.0928661148196862e-09, 0.0, 4.5464330574098431e-09, 0.0, -9.0928661148196858e-10},
-    {9.0928661148203424e-10, 0.0, -4.5464330574101715e-09, 0.0, 9.0928661148203430e-09, 0.0, -9.0928661148203430e-09, 0.0, 4.5464330574101715e-09, 0.0, -9.0928661148203424e-10},
-    {9.0928661148203041e-10, 0.0, -4.5464330574101516e-09, 0.0, 9.0928661148203033e-09, 0.0, -9.0928661148203033e-09, 0.0, 4.5464330574101516e-09, 0.0, -9.0928661148203041e-10},
-    {9.0928661148164309e-10, 0.0, -4.5464330574082152e-09, 0.0, 9.0928661148164304e-09, 0.0, -9.0928661148164304e-09, 0.0, 4.5464330574082152e-09, 0.0, -9.0928661148164309e-10},
-    {9.0928661148193684e-10, 0.0, -4.5464330574096843e-09, 0.0, 9.0928661148193686e-09, 0.0, -9.0928661148193686e-09, 0.0, 4.5464330574096843e-09, 0.0, -9.0928661148193684e-10},
-    {9.0928661148192133e-10, 0.0, -4.5464330574096065e-09, 0.0, 9.0928661148192131e-09, 0.0, -9.0928661148192131e-09, 0.0, 4.5464330574096065e-09, 0.0, -9.0928661148192133e-10},
-    {9.0928661148181700e-10, 0.0, -4.5464330574090846e-09, 0.0, 9.0928661148181692e-09, 0.0, -9.0928661148181692e-09, 0.0, 4.5464330574090846e-09, 0.0, -9.0928661148181700e-10},
-    {9.0928661148189248e-10, 0.0, -4.5464330574094626e-09, 0.0, 9.0928661148189252e-09, 0.0, -9.0928661148189252e-09, 0.0, 4.5464330574094626e-09, 0.0, -9.0928661148189248e-10}};
-
-static queue_t xQueue;
-static queue_t yQueue;
-static queue_t zQueues[FILTER_FREQUENCY_COUNT];
-static queue_t outputQueues[FILTER_FREQUENCY_COUNT];
-
-static double currentPowerValue[FILTER_FREQUENCY_COUNT];
-static double oldest_value[FILTER_FREQUENCY_COUNT];
+#define IIR_ORDER (IIR_A_COEFF_COUNT / 2) // Of the Butterworth prototype.
+#define SAMPLE_RATE_UNIT_HZ 100 // Of the rate in a snapshot header.
+
+_Static_assert(X_QUEUE_SIZE + Y_QUEUE_SIZE == FILTER_STATE_SHARED_VALUES,
+               "filter.h describes another snapshot layout");
+_Static_assert(Z_QUEUE_SIZE + OUTPUT_QUEUE_SIZE + 2 == FILTER_STATE_CHANNEL_VALUES,
+               "filter.h describes another snapshot layout");
+
+// The header of a snapshot, ahead of the queue contents.
+typedef struct {
+    uint32_t magic;
+    uint16_t channelMask; // The channels saved, in order.
+    uint16_t sampleRate;  // In SAMPLE_RATE_UNIT_HZ.
+} stateHeader_t;
+
+static INSTANCE_LOCAL queue_t xQueue;
+static INSTANCE_LOCAL queue_t yQueue;
+static INSTANCE_LOCAL queue_t zQueues[FILTER_FREQUENCY_COUNT];
+static INSTANCE_LOCAL queue_t outputQueues[FILTER_FREQUENCY_COUNT];
+
+static INSTANCE_LOCAL double currentPowerValue[FILTER_FREQUENCY_COUNT];
+static INSTANCE_LOCAL double oldest_value[FILTER_FREQUENCY_COUNT];
+static INSTANCE_LOCAL uint16_t channelMask = FILTER_ALL_CHANNELS;
+
+// The coefficients for the sample rate, the tables of filterCoefficients.h
+// at 100 kHz, and the FIR decimation.
+static INSTANCE_LOCAL double firCoefficients[FIR_COEFF_COUNT];
+static INSTANCE_LOCAL double iirACoefficients[FILTER_FREQUENCY_COUNT][IIR_A_COEFF_COUNT];
+static INSTANCE_LOCAL double iirBCoefficients[FILTER_FREQUENCY_COUNT][IIR_B_COEFF_COUNT];
+static INSTANCE_LOCAL uint16_t decimation = FILTER_FIR_DECIMATION_FACTOR;
+// The FIR coefficients for raw ADC codes, oldest input first, with the
+// scaling folded in: the output is their dot product plus adcFirOffset.
+static INSTANCE_LOCAL double adcFirCoefficients[FIR_COEFF_COUNT];
+static INSTANCE_LOCAL double adcFirOffset;
+#ifdef LASERTAG_FLOAT_PIPELINE
+// filterFloat_iirFilters() runs the whole bank at once, on the first
+// filter_iirFilter() call after each FIR output.
+static INSTANCE_LOCAL bool iirFiltersRun;
+#endif
 
 /******************************************************************************
 ***** Helper functions
@@ -100,6 +102,93 @@ void initOutputQueues() {
     }
 }
 
+// Fill in the coefficients and decimation for the sample rate.
+static void setUpForSampleRate() {
+    uint32_t hz = sampleRate_getHz();
+    decimation = sampleRate_getDecimation();
+    if (hz == SAMPLE_RATE_REFERENCE_HZ) {
+        memcpy(firCoefficients, fir_b_coeffs, sizeof(firCoefficients));
+        memcpy(iirACoefficients, iir_a_coeffs, sizeof(iirACoefficients));
+        memcpy(iirBCoefficients, iir_b_coeffs, sizeof(iirBCoefficients));
+    } else {
+        filterDesign_firLowpass(FILTERDESIGN_FIR_CUTOFF / decimation, firCoefficients,
+                                FIR_COEFF_COUNT);
+        for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+            // The player's frequency as the transmitter makes it at this rate,
+            // rounded to the Hz as the tables were.
+            double centerHz = round((double)hz / sampleRate_ticks(filter_frequencyTickTable[i]));
+            filterDesign_iirBandpass(IIR_ORDER, centerHz, FILTERDESIGN_IIR_BANDWIDTH_HZ,
+                                     sampleRate_getDecimatedHz(), iirACoefficients[i],
+                                     iirBCoefficients[i]);
+        }
+    }
+    // sum b[i] (code * scalar / max - 1) = sum (b[i] scalar / max) code - sum b[i].
+    adcFirOffset = 0.0;
+    for (uint32_t i = 0; i < FIR_COEFF_COUNT; i++) {
+        adcFirCoefficients[FIR_COEFF_COUNT - 1 - i] =
+            firCoefficients[i] * FILTER_ADC_SCALAR / FILTER_ADC_MAX_VALUE;
+        adcFirOffset -= firCoefficients[i];
+    }
+}
+
+// Zero the IIR outputs and power of filter i.
+static void clearChannel(uint16_t i) {
+    for (uint32_t j = 0; j < Z_QUEUE_SIZE; j++) {
+        queue_overwritePush(&(zQueues[i]), QUEUE_INIT_VALUE);
+    }
+    for (uint32_t j = 0; j < OUTPUT_QUEUE_SIZE; j++) {
+        queue_overwritePush(&(outputQueues[i]), QUEUE_INIT_VALUE);
+    }
+    currentPowerValue[i] = 0.0;
+    oldest_value[i] = 0.0;
+#ifdef LASERTAG_FILTER_TEMPLATES
+    filterKernels_clearChannel(i);
+#endif
+}
+
+#if !defined(LASERTAG_FLOAT_PIPELINE) && !defined(LASERTAG_FILTER_TEMPLATES)
+// Returns how many channels are in mask.
+static uint16_t channelCount(uint16_t mask) {
+    uint16_t count = 0;
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        count += (mask >> i) & 1;
+    }
+    return count;
+}
+
+// Copy value into blob at offset. Returns the offset after it.
+static uint32_t saveValue(double value, uint8_t blob[], uint32_t offset) {
+    memcpy(blob + offset, &value, sizeof(value));
+    return offset + sizeof(value);
+}
+
+// Copy a value out of blob at offset. Returns the offset after it.
+static uint32_t restoreValue(double *value, const uint8_t blob[], uint32_t offset) {
+    memcpy(value, blob + offset, sizeof(*value));
+    return offset + sizeof(*value);
+}
+
+// Copy the contents of a full queue, oldest first, into blob at offset.
+// Returns the offset after them.
+static uint32_t saveQueue(queue_t *q, uint8_t blob[], uint32_t offset) {
+    for (uint32_t i = 0; i < queue_size(q); i++) {
+        offset = saveValue(queue_readElementAt(q, i), blob, offset);
+    }
+    return offset;
+}
+
+// Refill a full queue from blob at offset, oldest first. Returns the offset
+// after its contents.
+static uint32_t restoreQueue(queue_t *q, const uint8_t blob[], uint32_t offset) {
+    for (uint32_t i = 0; i < queue_size(q); i++) {
+        double value;
+        offset = restoreValue(&value, blob, offset);
+        queue_overwritePush(q, value);
+    }
+    return offset;
+}
+#endif
+
 // 1. First filter is a decimating FIR filter with a configurable number of taps
 // and decimation factor.
 // 2. The output from the decimating FIR filter is passed through a bank of 10
@@ -117,43 +206,143 @@ void filter_init()
   initYQueue();  // Call queue_init() on yQueue and fill it with zeros.
   initZQueues(); // Call queue_init() on all of the zQueues and fill each z queue with zeros.
   initOutputQueues();  // Call queue_init() on all of the outputQueues and fill each outputQueue with zeros.
+  setUpForSampleRate();
+  channelMask = FILTER_ALL_CHANNELS;
+#ifdef LASERTAG_FLOAT_PIPELINE
+  filterFloat_init();
+  iirFiltersRun = false;
+#elif defined(LASERTAG_FILTER_TEMPLATES)
+  filterKernels_init();
+#endif
+}
+
+// Zero every queue and power value, as filter_init() does, without
+// allocating the queues again.
+void filter_reset()
+{
+    for (uint32_t i = 0; i < X_QUEUE_SIZE; i++) {
+        queue_overwritePush(&xQueue, QUEUE_INIT_VALUE);
+    }
+    for (uint32_t i = 0; i < Y_QUEUE_SIZE; i++) {
+        queue_overwritePush(&yQueue, QUEUE_INIT_VALUE);
+    }
+    for (uint32_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        for (uint32_t j = 0; j < Z_QUEUE_SIZE; j++) {
+            queue_overwritePush(&(zQueues[i]), QUEUE_INIT_VALUE);
+        }
+        for (uint32_t j = 0; j < OUTPUT_QUEUE_SIZE; j++) {
+            queue_overwritePush(&(outputQueues[i]), QUEUE_INIT_VALUE);
+        }
+        currentPowerValue[i] = 0.0;
+        oldest_value[i] = 0.0;
+    }
+    setUpForSampleRate();
+    channelMask = FILTER_ALL_CHANNELS;
+#ifdef LASERTAG_FLOAT_PIPELINE
+    filterFloat_init();
+    iirFiltersRun = false;
+#elif defined(LASERTAG_FILTER_TEMPLATES)
+    filterKernels_init();
+#endif
 }
 
 // Use this to copy an input into the input queue of the FIR-filter (xQueue).
 void filter_addNewInput(double x)
 {
+#ifdef LASERTAG_FLOAT_PIPELINE
+    filterFloat_addNewInput(x);
+#elif defined(LASERTAG_FILTER_TEMPLATES)
+    filterKernels_addNewInput(x);
+#else
     queue_overwritePush(&xQueue, x);
+#endif
 }
 
 // Invokes the FIR-filter. Input is contents of xQueue.
 // Output is returned and is also pushed on to yQueue.
 double filter_firFilter()
 {
+#ifdef LASERTAG_FLOAT_PIPELINE
+    iirFiltersRun = false;
+    return filterFloat_firFilter();
+#elif defined(LASERTAG_FILTER_TEMPLATES)
+    return filterKernels_firFilter();
+#else
     double y = 0.0;
 
     // This for-loop performs the identical computation to that shown above.
     for (uint32_t i=0; i < FIR_COEFF_COUNT; i++) { // iteratively adds the (b * input) products.
-        y += queue_readElementAt(&xQueue, ((FIR_COEFF_COUNT - 1) - i)) * fir_b_coeffs[i];
+        y += queue_readElementAt(&xQueue, ((FIR_COEFF_COUNT - 1) - i)) * firCoefficients[i];
+    }
+
+    queue_overwritePush(&yQueue, y);
+
+    return y;
+#endif
+}
+
+// Invokes the FIR-filter on the last FIR_COEFF_COUNT raw ADC codes, oldest
+// first, read in place. Output is returned and is also pushed on to yQueue.
+double filter_firFilterAdc(const uint32_t codes[])
+{
+#if defined(LASERTAG_FLOAT_PIPELINE) || defined(LASERTAG_FILTER_TEMPLATES)
+    // Those filters keep their own inputs: give them the new ones.
+    for (uint32_t i = FIR_COEFF_COUNT - decimation; i < FIR_COEFF_COUNT; i++) {
+        filter_addNewInput(codes[i] / FILTER_ADC_MAX_VALUE * FILTER_ADC_SCALAR - 1.0);
+    }
+    return filter_firFilter();
+#else
+    double y = adcFirOffset;
+    for (uint32_t i = 0; i < FIR_COEFF_COUNT; i++) {
+        y += codes[i] * adcFirCoefficients[i];
     }
 
     queue_overwritePush(&yQueue, y);
 
     return y;
+#endif
+}
+
+// Put the scaled codes, oldest first, into xQueue.
+void filter_setAdcInputs(const uint32_t codes[])
+{
+    for (uint32_t i = 0; i < X_QUEUE_SIZE; i++) {
+        queue_overwritePush(&xQueue, codes[i] / FILTER_ADC_MAX_VALUE * FILTER_ADC_SCALAR - 1.0);
+    }
+}
+
+// Read xQueue back as codes, oldest first.
+void filter_getAdcInputs(uint32_t codes[])
+{
+    for (uint32_t i = 0; i < X_QUEUE_SIZE; i++) {
+        double code = (queue_readElementAt(&xQueue, i) + 1.0) / FILTER_ADC_SCALAR *
+                      FILTER_ADC_MAX_VALUE;
+        codes[i] = (uint32_t)lround(code);
+    }
 }
 
 // Use this to invoke a single iir filter. Input comes from yQueue.
 // Output is returned and is also pushed onto zQueue[filterNumber].
 double filter_iirFilter(uint16_t filterNumber)
 {
+#ifdef LASERTAG_FLOAT_PIPELINE
+    if (!iirFiltersRun) {
+        filterFloat_iirFilters();
+        iirFiltersRun = true;
+    }
+    return filterFloat_getIirOutput(filterNumber);
+#elif defined(LASERTAG_FILTER_TEMPLATES)
+    return filterKernels_iirFilter(filterNumber);
+#else
     double y = 0.0;
     double z = 0.0;
 
     for (uint32_t i = 0; i < Y_QUEUE_SIZE; i++) {
-        y += queue_readElementAt(&yQueue, (Y_QUEUE_SIZE - i - 1)) * iir_b_coeffs[filterNumber][i];
+        y += queue_readElementAt(&yQueue, (Y_QUEUE_SIZE - i - 1)) * iirBCoefficients[filterNumber][i];
     }
 
     for (uint32_t i = 0; i < Z_QUEUE_SIZE; i++) {
-        z += queue_readElementAt(&(zQueues[filterNumber]), (Z_QUEUE_SIZE - i - 1)) * iir_a_coeffs[filterNumber][i];
+        z += queue_readElementAt(&(zQueues[filterNumber]), (Z_QUEUE_SIZE - i - 1)) * iirACoefficients[filterNumber][i];
     }
 
     z = y - z;
@@ -162,6 +351,7 @@ double filter_iirFilter(uint16_t filterNumber)
     queue_overwritePush(&(zQueues[filterNumber]), z);
 
     return z;
+#endif
 }
 
 
@@ -181,6 +371,14 @@ double filter_iirFilter(uint16_t filterNumber)
 double filter_computePower(uint16_t filterNumber, bool forceComputeFromScratch,
                            bool debugPrint)
 {
+#ifdef LASERTAG_FLOAT_PIPELINE
+    currentPowerValue[filterNumber] = forceComputeFromScratch
+        ? filterFloat_computePowerFromScratch(filterNumber)
+        : filterFloat_getPower(filterNumber);
+#elif defined(LASERTAG_FILTER_TEMPLATES)
+    currentPowerValue[filterNumber] =
+        filterKernels_computePower(filterNumber, forceComputeFromScratch);
+#else
     if (forceComputeFromScratch) {
         double power = 0;
 
@@ -196,10 +394,35 @@ double filter_computePower(uint16_t filterNumber, bool forceComputeFromScratch,
     }
 
     oldest_value[filterNumber] = queue_readElementAt(&outputQueues[filterNumber], 0); // Store the oldest output value for next loop
+#endif
 
     return currentPowerValue[filterNumber];
 }
 
+// Sets which IIR filters are run, as a channel mask.
+void filter_setChannelMask(uint16_t mask)
+{
+    mask &= FILTER_ALL_CHANNELS;
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        uint16_t bit = 1 << i;
+        if ((mask & bit) == (channelMask & bit))
+            continue;
+        // Dropped filters read as silent, and so do returning ones until
+        // they have run again: both start from a clean slate.
+        clearChannel(i);
+    }
+    channelMask = mask;
+#ifdef LASERTAG_FLOAT_PIPELINE
+    filterFloat_setChannelMask(mask);
+#endif
+}
+
+// Returns the channel mask.
+uint16_t filter_getChannelMask()
+{
+    return channelMask;
+}
+
 // Returns the last-computed output power value for the IIR filter
 // [filterNumber].
 double filter_getCurrentPowerValue(uint16_t filterNumber)
@@ -258,6 +481,80 @@ void filter_getNormalizedPowerValues(double normalizedArray[],
     }
 }
 
+// Write a snapshot of the filters into blob, which has room for size bytes.
+// Returns its length, or 0 if it does not fit. The float and template builds
+// keep their state elsewhere and always return 0.
+uint32_t filter_saveState(uint8_t blob[], uint32_t size)
+{
+#if defined(LASERTAG_FLOAT_PIPELINE) || defined(LASERTAG_FILTER_TEMPLATES)
+    (void)blob;
+    (void)size;
+    return 0;
+#else
+    uint32_t length = FILTER_STATE_SIZE(channelCount(channelMask));
+    if (size < length) {
+        return 0;
+    }
+    stateHeader_t header = {FILTER_STATE_MAGIC, channelMask,
+                            sampleRate_getHz() / SAMPLE_RATE_UNIT_HZ};
+    memcpy(blob, &header, sizeof(header));
+    uint32_t offset = saveQueue(&xQueue, blob, FILTER_STATE_HEADER_SIZE);
+    offset = saveQueue(&yQueue, blob, offset);
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        if (!(channelMask & (1 << i))) {
+            continue;
+        }
+        offset = saveQueue(&zQueues[i], blob, offset);
+        offset = saveQueue(&outputQueues[i], blob, offset);
+        offset = saveValue(currentPowerValue[i], blob, offset);
+        offset = saveValue(oldest_value[i], blob, offset);
+    }
+    return offset;
+#endif
+}
+
+// Restore a snapshot written by filter_saveState(). The channel mask stays
+// as it is, and channels the snapshot has outside it are skipped. Returns
+// false, changing nothing, if blob is not a whole snapshot taken at the
+// sample rate or lacks a channel in the mask: that channel would start from
+// silence with the others settled.
+bool filter_restoreState(const uint8_t blob[], uint32_t size)
+{
+#if defined(LASERTAG_FLOAT_PIPELINE) || defined(LASERTAG_FILTER_TEMPLATES)
+    (void)blob;
+    (void)size;
+    return false;
+#else
+    stateHeader_t header;
+    if (size < FILTER_STATE_HEADER_SIZE) {
+        return false;
+    }
+    memcpy(&header, blob, sizeof(header));
+    if (header.magic != FILTER_STATE_MAGIC || (header.channelMask & ~FILTER_ALL_CHANNELS) ||
+        header.sampleRate != sampleRate_getHz() / SAMPLE_RATE_UNIT_HZ ||
+        size < FILTER_STATE_SIZE(channelCount(header.channelMask)) ||
+        (channelMask & ~header.channelMask)) {
+        return false;
+    }
+    uint32_t offset = restoreQueue(&xQueue, blob, FILTER_STATE_HEADER_SIZE);
+    offset = restoreQueue(&yQueue, blob, offset);
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        uint16_t bit = 1 << i;
+        if (!(header.channelMask & bit)) {
+            continue;
+        }
+        if (!(channelMask & bit)) {
+            offset += FILTER_STATE_CHANNEL_VALUES * sizeof(double);
+            continue;
+        }
+        offset = restoreQueue(&zQueues[i], blob, offset);
+        offset = restoreQueue(&outputQueues[i], blob, offset);
+        offset = restoreValue(&currentPowerValue[i], blob, offset);
+        offset = restoreValue(&oldest_value[i], blob, offset);
+    }
+    return true;
+#endif
+}
 
 /******************************************************************************
 ***** Verification-Assisting Functions
@@ -268,7 +565,7 @@ void filter_getNormalizedPowerValues(double normalizedArray[],
 // Returns the array of FIR coefficients.
 const double *filter_getFirCoefficientArray()
 {
-    return fir_b_coeffs;
+    return firCoefficients;
 }
 
 // Returns the number of FIR coefficients.
@@ -280,7 +577,7 @@ uint32_t filter_getFirCoefficientCount()
 // Returns the array of a coefficients for a particular filter number.
 const double *filter_getIirACoefficientArray(uint16_t filterNumber)
 {
-    return iir_a_coeffs[filterNumber];
+    return iirACoefficients[filterNumber];
 }
 
 // Returns the number of A coefficients.
@@ -292,7 +589,7 @@ uint32_t filter_getIirACoefficientCount()
 // Returns the array of b coefficients for a particular filter number.
 const double *filter_getIirBCoefficientArray(uint16_t filterNumber)
 {
-    return iir_b_coeffs[filterNumber];
+    return iirBCoefficients[filterNumber];
 }
 
 // Returns the number of B coefficients.
@@ -307,10 +604,10 @@ uint32_t filter_getYQueueSize()
     return Y_QUEUE_SIZE;
 }
 
-// Returns the decimation value.
+// Returns the decimation value for the sample rate.
 uint16_t filter_getDecimationValue()
 {
-    return FILTER_FIR_DECIMATION_FACTOR;
+    return decimation;
 }
 
 // Returns the address of xQueue.
@@ -14,6 +14,8 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 
 #include "queue.h"
 
+// The sample rate and decimation at the reference rate. sampleRate.h can
+// set another rate; filter_getDecimationValue() then has the decimation.
 #define FILTER_SAMPLE_FREQUENCY_IN_KHZ 100
 #define FILTER_FREQUENCY_COUNT 10
 #define FILTER_FIR_DECIMATION_FACTOR                                           \
@@ -24,10 +26,14 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 // These are the tick counts that are used to generate the user frequencies.
 // Not used in filter.h but are used to TEST the filter code.
 // Placed here for general access as they are essentially constant throughout
-// the code. The transmitter will also use these.
+// the code. The transmitter will also use these. They are 100 kHz ticks:
+// sampleRate_ticks() converts them to the sample rate.
 static const uint16_t filter_frequencyTickTable[FILTER_FREQUENCY_COUNT] = {
     68, 58, 50, 44, 38, 34, 30, 28, 26, 24};
 
+// Channel masks name a set of IIR filters, bit n for filter n.
+#define FILTER_ALL_CHANNELS ((1 << FILTER_FREQUENCY_COUNT) - 1)
+
 // Filtering routines for the laser-tag project.
 // Filtering is performed by a two-stage filter, as described below.
 
@@ -35,6 +41,14 @@ static const uint16_t filter_frequencyTickTable[FILTER_FREQUENCY_COUNT] = {
 // and decimation factor.
 // 2. The output from the decimating FIR filter is passed through a bank of 10
 // IIR filters. The characteristics of the IIR filter are fixed.
+// filter_init() takes the coefficients from filterCoefficients.h at 100 kHz
+// and designs them for any other sample rate (filterDesign.h).
+//
+// Built with LASERTAG_FLOAT_PIPELINE, the filtering runs in single precision
+// (filterFloat.h) behind this same interface. The queues below are then left
+// unused, so filterTest only applies to the double build.
+// LASERTAG_FILTER_TEMPLATES does the same with the compile-time specialized
+// C++ kernels of filterKernels.hpp, which compute exactly what filter.c does.
 
 /******************************************************************************
 ***** Main Filter Functions
@@ -43,6 +57,11 @@ static const uint16_t filter_frequencyTickTable[FILTER_FREQUENCY_COUNT] = {
 // Must call this prior to using any filter functions.
 void filter_init();
 
+// Zero every queue and power value, as filter_init() does, without
+// allocating the queues again. Used to reuse one filter instance for
+// independent runs.
+void filter_reset();
+
 // Use this to copy an input into the input queue of the FIR-filter (xQueue).
 void filter_addNewInput(double x);
 
@@ -50,6 +69,26 @@ void filter_addNewInput(double x);
 // Output is returned and is also pushed on to yQueue.
 double filter_firFilter();
 
+// The ADC scaling the detector applies: raw / FILTER_ADC_MAX_VALUE *
+// FILTER_ADC_SCALAR - 1, from -1 to 1.
+#define FILTER_ADC_MAX_VALUE 4095.0
+#define FILTER_ADC_SCALAR 2.0
+
+// Invokes the FIR-filter on raw ADC values read in place, for a caller that
+// keeps the inputs itself (buffer_history()): codes holds the last
+// FIR_COEFF_COUNT inputs, oldest first, and this is called once every
+// filter_getDecimationValue() inputs. The scaling is folded into the
+// coefficients and xQueue is left alone. Output is returned and is also
+// pushed on to yQueue. The float and template builds feed the new inputs to
+// their own filters.
+double filter_firFilterAdc(const uint32_t codes[]);
+
+// For snapshots of such a caller's filters: put the scaled codes, oldest
+// first, into xQueue, ahead of filter_saveState(), or read xQueue back as
+// codes after filter_restoreState().
+void filter_setAdcInputs(const uint32_t codes[]);
+void filter_getAdcInputs(uint32_t codes[]);
+
 // Use this to invoke a single iir filter. Input comes from yQueue.
 // Output is returned and is also pushed onto zQueue[filterNumber].
 double filter_iirFilter(uint16_t filterNumber);
@@ -70,6 +109,15 @@ double filter_iirFilter(uint16_t filterNumber);
 double filter_computePower(uint16_t filterNumber, bool forceComputeFromScratch,
                            bool debugPrint);
 
+// Sets which IIR filters are run, as a channel mask; filter_init() sets
+// FILTER_ALL_CHANNELS. Filters left out are not run, and their power reads
+// as zero. Filters brought back start again from silence, so their power only
+// means something again a pulse width later.
+void filter_setChannelMask(uint16_t mask);
+
+// Returns the channel mask.
+uint16_t filter_getChannelMask();
+
 // Returns the last-computed output power value for the IIR filter
 // [filterNumber].
 double filter_getCurrentPowerValue(uint16_t filterNumber);
@@ -95,6 +143,41 @@ void filter_getCurrentPowerValues(double powerValues[]);
 void filter_getNormalizedPowerValues(double normalizedArray[],
                                      uint16_t *indexOfMaxValue);
 
+/******************************************************************************
+***** State Snapshots
+******************************************************************************/
+
+// A snapshot is a byte blob holding everything the filters remember: a
+// header (magic, channel mask and sample rate), the FIR and IIR input queues (81 + 11
+// values), then for each channel in the mask its 10 IIR outputs, its power
+// window, its power and the oldest value of its last power update. Restored,
+// the filters carry on bit for bit as if they had never stopped, so a new
+// round or a replay resumed mid-capture needs no settling time. Channels
+// outside the mask are left out, so a two-team game's snapshot is 65 KB
+// rather than 162 KB. Snapshots are only meaningful to the same build of
+// filter.c.
+#define FILTER_STATE_MAGIC 0x3146544C // "LTF1" in memory.
+#define FILTER_STATE_HEADER_SIZE 8
+#define FILTER_STATE_SHARED_VALUES 92
+#define FILTER_STATE_CHANNEL_VALUES (10 + FILTER_INPUT_PULSE_WIDTH + 2)
+#define FILTER_STATE_SIZE(channelCount)                                        \
+  (FILTER_STATE_HEADER_SIZE +                                                  \
+   sizeof(double) * (FILTER_STATE_SHARED_VALUES +                              \
+                     (channelCount) * FILTER_STATE_CHANNEL_VALUES))
+#define FILTER_STATE_MAX_SIZE FILTER_STATE_SIZE(FILTER_FREQUENCY_COUNT)
+
+// Write a snapshot of the filters into blob, which has room for size bytes.
+// Returns its length, or 0 if it does not fit. The float and template builds
+// keep their state elsewhere and always return 0.
+uint32_t filter_saveState(uint8_t blob[], uint32_t size);
+
+// Restore a snapshot written by filter_saveState(). The channel mask stays
+// as it is, and channels the snapshot has outside it are skipped. Returns
+// false, changing nothing, if blob is not a whole snapshot taken at the
+// sample rate or lacks a channel in the mask: that channel would start from
+// silence with the others settled.
+bool filter_restoreState(const uint8_t blob[], uint32_t size);
+
 /******************************************************************************
 ***** Verification-Assisting Functions
 ***** External test functions access the internal data structures of filter.c
@@ -122,7 +205,7 @@ uint32_t filter_getIirBCoefficientCount();
 // Returns the size of the yQueue.
 uint32_t filter_getYQueueSize();
 
-// Returns the decimation value.
+// Returns the decimation value for the sample rate.
 uint16_t filter_getDecimationValue();
 
 // Returns the address of xQueue.
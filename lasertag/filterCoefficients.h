@@ -0,0 +1,58 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef FILTERCOEFFICIENTS_H_
+#define FILTERCOEFFICIENTS_H_
+
+#include "filter.h"
+
+// Coefficients of the filters in filter.c, shared with the C++ kernels of
+// filterKernels.hpp. In C++ the tables are constexpr, so the kernels can
+// build them into the code.
+#ifdef __cplusplus
+#define FILTER_COEFFICIENT_TABLE static constexpr double
+#else
+#define FILTER_COEFFICIENT_TABLE static const double
+#endif
+
+#define FIR_COEFF_COUNT 81
+
+#define IIR_B_COEFF_COUNT 11
+
+#define IIR_A_COEFF_COUNT 10
+
+FILTER_COEFFICIENT_TABLE fir_b_coeffs[FIR_COEFF_COUNT] = {
+    6.2534348595847538e-04, 6.5497758294040542e-04, 6.1992178501587701e-04, 5.0452526771031455e-04, 2.9091060249592421e-04, -3.2856141914564076e-05, -4.6270378618655110e-04, -9.6927546688259272e-04, -1.4924081755106418e-03, -1.9419900366783919e-03, -2.2067863671876870e-03, -2.1712756177317168e-03, -1.7387264211219384e-03, -8.5702012741646952e-04, 4.5755838533190820e-04, 2.1038619889547699e-03, 3.8916195777932861e-03, 5.5528025909850429e-03, 6.7697616171742822e-03, 7.2184438752610595e-03, 6.6220735304987509e-03, 4.8081553873736364e-03, 1.7600311340430473e-03, -2.3461497646870785e-03, -7.1270921927757249e-03, -1.2006185309970628e-02, -1.6257372605455990e-02, -1.9076605069723938e-02, -1.9674051143141542e-02, -1.7376505856439812e-02, -1.1726971420919888e-02, -2.5676376647722600e-03, 9.9063015042762728e-03, 2.5131461770900417e-02, 4.2204543223913080e-02, 5.9953325291499965e-02, 7.7043897907315209e-02, 9.2112551316003752e-02, 1.0390705353179479e-01, 1.1142031823958311e-01, 1.1400000000000000e-01, 1.1142031823958311e-01, 1.0390705353179479e-01, 9.2112551316003752e-02, 7.7043897907315209e-02, 5.9953325291499965e-02, 4.2204543223913080e-02, 2.5131461770900417e-02, 9.9063015042762728e-03, -2.5676376647722600e-03, -1.1726971420919888e-02, -1.7376505856439812e-02, -1.9674051143141542e-02, -1.9076605069723938e-02, -1.6257372605455990e-02, -1.2006185309970628e-02, -7.1270921927757249e-03, -2.3461497646870785e-03, 1.7600311340430473e-03, 4.8081553873736364e-03, 6.6220735304987509e-03, 7.2184438752610595e-03, 6.7697616171742822e-03, 5.5528025909850429e-03, 3.8916195777932861e-03, 2.1038619889547699e-03, 4.5755838533190820e-04, -8.5702012741646952e-04, -1.7387264211219384e-03, -2.1712756177317168e-03, -2.2067863671876870e-03, -1.9419900366783919e-03, -1.4924081755106418e-03, -9.6927546688259272e-04, -4.6270378618655110e-04, -3.2856141914564076e-05, 2.9091060249592421e-04, 5.0452526771031455e-04, 6.1992178501587701e-04, 6.5497758294040542e-04, 6.2534348595847538e-04
+};
+
+FILTER_COEFFICIENT_TABLE iir_a_coeffs[FILTER_FREQUENCY_COUNT][IIR_A_COEFF_COUNT] = {
+    {-5.9637727070164059e+00, 1.9125339333078287e+01, -4.0341474540744301e+01, 6.1537466875369077e+01, -7.0019717951472558e+01, 6.0298814235239249e+01, -3.8733792862566574e+01, 1.7993533279581207e+01, -5.4979061224868158e+00, 9.0332828533800469e-01},
+    {-4.6377947119071408e+00, 1.3502215749461552e+01, -2.6155952405269698e+01, 3.8589668330738235e+01, -4.3038990303252490e+01, 3.7812927599536991e+01, -2.5113598088113683e+01, 1.2703182701888030e+01, -4.2755083391143280e+00, 9.0332828533799747e-01},
+    {-3.0591317915750937e+00, 8.6417489609637492e+00, -1.4278790253808838e+01, 2.1302268283304294e+01, -2.2193853972079211e+01, 2.0873499791105424e+01, -1.3709764520609379e+01, 8.1303553577931567e+00, -2.8201643879900473e+00, 9.0332828533799880e-01},
+    {-1.4071749185996751e+00, 5.6904141470697542e+00, -5.7374718273676306e+00, 1.1958028362868905e+01, -8.5435280598354630e+00, 1.1717345583835968e+01, -5.5088290876998647e+00, 5.3536787286077674e+00, -1.2972519209655595e+00, 9.0332828533800047e-01},
+    {8.2010906117760318e-01, 5.1673756579268604e+00, 3.2580350909220925e+00, 1.0392903763919193e+01, 4.8101776408669084e+00, 1.0183724507092508e+01, 3.1282000712126754e+00, 4.8615933365571991e+00, 7.5604535083144919e-01, 9.0332828533800047e-01},
+    {2.7080869856154530e+00, 7.8319071217995795e+00, 1.2201607990980769e+01, 1.8651500443681677e+01, 1.8758157568004620e+01, 1.8276088095999114e+01, 1.1715361303018966e+01, 7.3684394621254015e+00, 2.4965418284512091e+00, 9.0332828533801224e-01},
+    {4.9479835250075892e+00, 1.4691607003177602e+01, 2.9082414772101060e+01, 4.3179839108869331e+01, 4.8440791644688879e+01, 4.2310703962394342e+01, 2.7923434247706432e+01, 1.3822186510471010e+01, 4.5614664160654357e+00, 9.0332828533799958e-01},
+    {6.1701893352279864e+00, 2.0127225876810336e+01, 4.2974193398071691e+01, 6.5958045321253465e+01, 7.5230437667866624e+01, 6.4630411355739881e+01, 4.1261591079244141e+01, 1.8936128791950541e+01, 5.6881982915180327e+00, 9.0332828533799836e-01},
+    {7.4092912870072398e+00, 2.6857944460290135e+01, 6.1578787811202247e+01, 9.8258255839887340e+01, 1.1359460153696304e+02, 9.6280452143026153e+01, 5.9124742025776442e+01, 2.5268527576524235e+01, 6.8305064480743178e+00, 9.0332828533800158e-01},
+    {8.5743055776347692e+00, 3.4306584753117903e+01, 8.4035290411037124e+01, 1.3928510844056831e+02, 1.6305115418161643e+02, 1.3648147221895812e+02, 8.0686288623299902e+01, 3.2276361903872186e+01, 7.9045143816244918e+00, 9.0332828533799903e-01}};
+
+FILTER_COEFFICIENT_TABLE iir_b_coeffs[FILTER_FREQUENCY_COUNT][IIR_B_COEFF_COUNT] = {
+    {9.0928661148176830e-10, 0.0, -4.5464330574088414e-09, 0.0, 9.0928661148176828e-09, 0.0, -9.0928661148176828e-09, 0.0, 4.5464330574088414e-09, 0.0, -9.0928661148176830e-10},
+    {9.0928661148203093e-10, 0.0, -4.5464330574101550e-09, 0.0, 9.0928661148203099e-09, 0.0, -9.0928661148203099e-09, 0.0, 4.5464330574101550e-09, 0.0, -9.0928661148203093e-10},
+    {9.0928661148196858e-10, 0.0, -4.5464330574098431e-09, 0.0, 9.0928661148196862e-09, 0.0, -9.0928661148196862e-09, 0.0, 4.5464330574098431e-09, 0.0, -9.0928661148196858e-10},
+    {9.0928661148203424e-10, 0.0, -4.5464330574101715e-09, 0.0, 9.0928661148203430e-09, 0.0, -9.0928661148203430e-09, 0.0, 4.5464330574101715e-09, 0.0, -9.0928661148203424e-10},
+    {9.0928661148203041e-10, 0.0, -4.5464330574101516e-09, 0.0, 9.0928661148203033e-09, 0.0, -9.0928661148203033e-09, 0.0, 4.5464330574101516e-09, 0.0, -9.0928661148203041e-10},
+    {9.0928661148164309e-10, 0.0, -4.5464330574082152e-09, 0.0, 9.0928661148164304e-09, 0.0, -9.0928661148164304e-09, 0.0, 4.5464330574082152e-09, 0.0, -9.0928661148164309e-10},
+    {9.0928661148193684e-10, 0.0, -4.5464330574096843e-09, 0.0, 9.0928661148193686e-09, 0.0, -9.0928661148193686e-09, 0.0, 4.5464330574096843e-09, 0.0, -9.0928661148193684e-10},
+    {9.0928661148192133e-10, 0.0, -4.5464330574096065e-09, 0.0, 9.0928661148192131e-09, 0.0, -9.0928661148192131e-09, 0.0, 4.5464330574096065e-09, 0.0, -9.0928661148192133e-10},
+    {9.0928661148181700e-10, 0.0, -4.5464330574090846e-09, 0.0, 9.0928661148181692e-09, 0.0, -9.0928661148181692e-09, 0.0, 4.5464330574090846e-09, 0.0, -9.0928661148181700e-10},
+    {9.0928661148189248e-10, 0.0, -4.5464330574094626e-09, 0.0, 9.0928661148189252e-09, 0.0, -9.0928661148189252e-09, 0.0, 4.5464330574094626e-09, 0.0, -9.0928661148189248e-10}};
+
+#endif /* FILTERCOEFFICIENTS_H_ */
@@ -0,0 +1,116 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <complex.h>
+#include <math.h>
+
+#include "filterDesign.h"
+
+#define MAX_ORDER 8
+
+// Write taps coefficients of a windowed-sinc lowpass into b, b[0] the
+// newest input's. cutoff is in cycles per sample.
+void filterDesign_firLowpass(double cutoff, double b[], uint32_t taps) {
+  double middle = (taps - 1) / 2.0;
+  for (uint32_t i = 0; i < taps; i++) {
+    double t = i - middle;
+    double sinc = t == 0 ? 2 * cutoff : sin(2 * M_PI * cutoff * t) / (M_PI * t);
+    double window = 0.54 - 0.46 * cos(2 * M_PI * i / (taps - 1));
+    b[i] = sinc * window;
+  }
+}
+
+// Frequency f at sampleHz warped onto the analog axis, in rad/s.
+static double prewarp(double f, double sampleHz) {
+  return 2 * sampleHz * tan(M_PI * f / sampleHz);
+}
+
+// The 2 * order poles of the Butterworth bandpass, into z, and the gain of
+// its numerator, b[0].
+static double bandpassPoles(uint16_t order, double centerHz, double bandwidthHz,
+                            double sampleHz, double complex z[]) {
+  double low = prewarp(centerHz - bandwidthHz / 2, sampleHz);
+  double high = prewarp(centerHz + bandwidthHz / 2, sampleHz);
+  double width = high - low;
+  double centerSquared = low * high;
+  double k = 2 * sampleHz; // The bilinear transform: s = k (z - 1) / (z + 1).
+
+  // Each lowpass prototype pole p becomes the two bandpass poles that solve
+  // s^2 - p width s + centerSquared = 0, then z = (k + s) / (k - s). The
+  // gain of width^order s^order over the poles is carried through the
+  // transform.
+  double complex gain = 1;
+  uint16_t poles = 0;
+  for (uint16_t i = 0; i < order && i < MAX_ORDER; i++) {
+    double complex p = cexp(I * M_PI * (2 * i + order + 1) / (2.0 * order));
+    double complex root = csqrt(p * p * width * width - 4 * centerSquared);
+    double complex s[2] = {(p * width + root) / 2, (p * width - root) / 2};
+    gain *= k * width;
+    for (uint16_t j = 0; j < 2; j++) {
+      z[poles++] = (k + s[j]) / (k - s[j]);
+      gain /= k - s[j];
+    }
+  }
+  return creal(gain);
+}
+
+// Write the coefficients of a Butterworth bandpass of 2 * order poles,
+// centerHz +- bandwidthHz / 2 at sampleHz: 2 * order + 1 numerator
+// coefficients into b and the 2 * order denominator coefficients after the
+// leading 1 into a, in the layout of filterCoefficients.h.
+void filterDesign_iirBandpass(uint16_t order, double centerHz, double bandwidthHz,
+                              double sampleHz, double a[], double b[]) {
+  double complex z[2 * MAX_ORDER];
+  double g = bandpassPoles(order, centerHz, bandwidthHz, sampleHz, z);
+  if (order > MAX_ORDER)
+    order = MAX_ORDER;
+
+  // The denominator is built up one pole at a time.
+  double complex denominator[2 * MAX_ORDER + 1] = {1};
+  for (uint16_t i = 0; i < 2 * order; i++)
+    for (uint16_t n = i + 1; n > 0; n--)
+      denominator[n] -= z[i] * denominator[n - 1];
+  for (uint16_t n = 0; n < 2 * order; n++)
+    a[n] = creal(denominator[n + 1]);
+
+  // (1 - z^-2)^order: binomial coefficients on the even powers.
+  double coefficient = 1;
+  for (uint16_t n = 0; n <= order; n++) {
+    b[2 * n] = (n % 2 ? -1 : 1) * coefficient * g;
+    if (n < order)
+      b[2 * n + 1] = 0;
+    coefficient = coefficient * (order - n) / (n + 1);
+  }
+}
+
+// The same bandpass as order second-order sections, one per pair of
+// complex-conjugate poles p: {a1, a2} = {-2 Re(p), |p|^2} of each into
+// sections, the poles furthest from the unit circle first. Each section's
+// numerator is (1 - z^-2); returns b[0], the gain of all of them together.
+double filterDesign_iirBandpassSections(uint16_t order, double centerHz, double bandwidthHz,
+                                        double sampleHz, double sections[][2]) {
+  double complex z[2 * MAX_ORDER];
+  double g = bandpassPoles(order, centerHz, bandwidthHz, sampleHz, z);
+  if (order > MAX_ORDER)
+    order = MAX_ORDER;
+  uint16_t count = 0;
+  for (uint16_t i = 0; i < 2 * order && count < order; i++) {
+    if (cimag(z[i]) <= 0)
+      continue;
+    double a2 = creal(z[i] * conj(z[i]));
+    uint16_t n = count++;
+    for (; n > 0 && sections[n - 1][1] > a2; n--) { // Insertion sort on |p|^2.
+      sections[n][0] = sections[n - 1][0];
+      sections[n][1] = sections[n - 1][1];
+    }
+    sections[n][0] = -2 * creal(z[i]);
+    sections[n][1] = a2;
+  }
+  return g;
+}
@@ -0,0 +1,48 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef FILTERDESIGN_H_
+#define FILTERDESIGN_H_
+
+#include <stdint.h>
+
+// Designs the filters of filter.c for any sample rate, as the tables in
+// filterCoefficients.h were designed for 100 kHz; at 100 kHz the designs
+// match those tables to within 1e-14. filter_init() uses them at any other
+// rate (sampleRate.h).
+// - The FIR filter is a Hamming-windowed sinc lowpass. Its cutoff is
+//   FILTERDESIGN_FIR_CUTOFF of the decimated rate, 5.7 kHz at 100 kHz: just
+//   past the decimated Nyquist frequency, well above the highest player.
+// - Each IIR filter is a Butterworth bandpass, FILTERDESIGN_IIR_BANDWIDTH_HZ
+//   wide around the player's frequency, designed at the decimated rate by
+//   the bilinear transform with both band edges prewarped. Its zeros are at
+//   DC and Nyquist, (1 - z^-2)^order, and its gain is 1 at the center.
+
+#define FILTERDESIGN_FIR_CUTOFF 0.57
+#define FILTERDESIGN_IIR_BANDWIDTH_HZ 50.0
+
+// Write taps coefficients of a windowed-sinc lowpass into b, b[0] the
+// newest input's. cutoff is in cycles per sample.
+void filterDesign_firLowpass(double cutoff, double b[], uint32_t taps);
+
+// Write the coefficients of a Butterworth bandpass of 2 * order poles,
+// centerHz +- bandwidthHz / 2 at sampleHz: 2 * order + 1 numerator
+// coefficients into b and the 2 * order denominator coefficients after the
+// leading 1 into a, in the layout of filterCoefficients.h.
+void filterDesign_iirBandpass(uint16_t order, double centerHz, double bandwidthHz,
+                              double sampleHz, double a[], double b[]);
+
+// The same bandpass as order second-order sections, one per pair of
+// complex-conjugate poles p: {a1, a2} = {-2 Re(p), |p|^2} of each into
+// sections, the poles furthest from the unit circle first. Each section's
+// numerator is (1 - z^-2); returns b[0], the gain of all of them together.
+double filterDesign_iirBandpassSections(uint16_t order, double centerHz, double bandwidthHz,
+                                        double sampleHz, double sections[][2]);
+
+#endif /* FILTERDESIGN_H_ */
@@ -0,0 +1,264 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "filter.h"
+#include "filterCoefficients.h"
+#include "filterFloat.h"
+#include "instance.h"
+
+#define FIR_PADDED_TAP_COUNT                                                   \
+  ((FIR_COEFF_COUNT + FILTERFLOAT_LANES - 1) / FILTERFLOAT_LANES * FILTERFLOAT_LANES)
+#define SECTION_COUNT 5 // Second-order sections per IIR filter.
+#define CHANNEL_SLOTS                                                          \
+  ((FILTER_FREQUENCY_COUNT + FILTERFLOAT_LANES - 1) / FILTERFLOAT_LANES * FILTERFLOAT_LANES)
+#define LANE_MASK ((1 << FILTERFLOAT_LANES) - 1)
+#define POWER_WINDOW FILTER_INPUT_PULSE_WIDTH
+#define POWER_DROP_RECOMPUTE 4
+#define VECTOR_ALIGNED __attribute__((aligned(16)))
+
+// {a1, a2} of the sections of each IIR filter: the pairs of
+// complex-conjugate poles p of its a polynomial, as a1 = -2 Re(p) and
+// a2 = |p|^2, the poles furthest from the unit circle first. Multiplied out
+// they give iir_a_coeffs to 1e-16.
+static const double sections[FILTER_FREQUENCY_COUNT][SECTION_COUNT][2] = {
+    {{-1.1863680818247795e+00, 9.6906745969488584e-01}, {-1.1751239421490003e+00, 9.7473019887757961e-01}, {-1.2044435361437180e+00, 9.7507577732839368e-01}, {-1.1751208011242633e+00, 9.9023180520726128e-01}, {-1.2227163457746451e+00, 9.9044858959438598e-01}},
+    {{-9.2259238436202584e-01, 9.6906744072340889e-01}, {-9.0908059642002303e-01, 9.7478162594833928e-01}, {-9.4141678028512210e-01, 9.7502434950287309e-01}, {-9.0604810240075317e-01, 9.9026403111184969e-01}, {-9.5865684843921672e-01, 9.9041636207616934e-01}},
+    {{-6.0855036074436875e-01, 9.6906742154597014e-01}, {-5.9293577454660107e-01, 9.7482863340202597e-01}, {-6.2766922161464134e-01, 9.7497734902823763e-01}, {-5.8669556658491473e-01, 9.9029352608769750e-01}, {-6.4328086808456786e-01, 9.9038686636491580e-01}},
+    {{-2.7992805679424515e-01, 9.6906742182083372e-01}, {-2.6267822955319126e-01, 9.7487012318277488e-01}, {-2.9878980833192464e-01, 9.7493585462634558e-01}, {-2.5345490878521237e-01, 9.9031956966292123e-01}, {-3.1232391513510160e-01, 9.9036082079761156e-01}},
+    {{1.6314356763931834e-01, 9.6906741684255959e-01}, {1.4543809985544481e-01, 9.7488396497550267e-01}, {1.8178847219167221e-01, 9.7492201637508280e-01}, {1.3523718742024071e-01, 9.9032825599277319e-01}, {1.9450173407092711e-01, 9.9035213492381957e-01}},
+    {{5.3871733676984168e-01, 9.6906742539416280e-01}, {5.2270991098225394e-01, 9.7483790011399141e-01}, {5.5782689267170293e-01, 9.7496807784510719e-01}, {5.1580591210294102e-01, 9.9029934613449855e-01}, {5.7302693308871333e-01, 9.9038104506624314e-01}},
+    {{9.8429798184854889e-01, 9.6906744724736726e-01}, {9.7127092311944618e-01, 9.7477090830240920e-01}, {1.0029929355360319e+00, 9.7503506444935684e-01}, {9.6891634241525237e-01, 9.9025731217456536e-01}, {1.0205053420883099e+00, 9.9042308099751086e-01}},
+    {{1.2274303156170983e+00, 9.6906744226197972e-01}, {1.2165897825405942e+00, 9.7472055311977801e-01}, {1.2453387363251098e+00, 9.7508544129942021e-01}, {1.2170923342300648e+00, 9.9022572631907491e-01}, {1.2637381665151191e+00, 9.9045467273872501e-01}},
+    {{1.4739238018404173e+00, 9.6906741479361347e-01}, {1.4658797668316557e+00, 9.7464462689366671e-01}, {1.4904550217226575e+00, 9.7516142726966870e-01}, {1.4696759559479939e+00, 9.9017813546497013e-01}, {1.5093567406645154e+00, 9.9050227915625866e-01}},
+    {{1.7056797427921542e+00, 9.6906870833101844e-01}, {1.7011318617292344e+00, 9.7450618686405188e-01}, {1.7200473129080034e+00, 9.7529878889188049e-01}, {1.7086461077676629e+00, 9.9009106520766788e-01}, {1.7388005524377141e+00, 9.9058925316953172e-01}}};
+
+// FIR taps, oldest input first, and the delay line: the input pushed last is
+// at firNewest and at firNewest + FIR_PADDED_TAP_COUNT, so the inputs of
+// one output are always contiguous, starting at firNewest + 1.
+static INSTANCE_LOCAL float firTaps[FIR_PADDED_TAP_COUNT] VECTOR_ALIGNED;
+static INSTANCE_LOCAL float firDelay[2 * FIR_PADDED_TAP_COUNT] VECTOR_ALIGNED;
+static INSTANCE_LOCAL uint16_t firNewest;
+static INSTANCE_LOCAL float firOutput;
+
+// IIR bank, lane-major. sectionGain is zero for the channels not run, which
+// keeps them silent wherever their lanes get computed anyway. Stage s is
+// the input of section s, stage SECTION_COUNT the output of the filter;
+// stage1 holds its last value and stage2 the one before.
+static INSTANCE_LOCAL float sectionGain[CHANNEL_SLOTS] VECTOR_ALIGNED;
+static INSTANCE_LOCAL float gainOf[CHANNEL_SLOTS];
+static INSTANCE_LOCAL float sectionA1[SECTION_COUNT][CHANNEL_SLOTS] VECTOR_ALIGNED;
+static INSTANCE_LOCAL float sectionA2[SECTION_COUNT][CHANNEL_SLOTS] VECTOR_ALIGNED;
+static INSTANCE_LOCAL float stage1[SECTION_COUNT + 1][CHANNEL_SLOTS] VECTOR_ALIGNED;
+static INSTANCE_LOCAL float stage2[SECTION_COUNT + 1][CHANNEL_SLOTS] VECTOR_ALIGNED;
+
+// The last POWER_WINDOW outputs of every filter, oldest at historyNext, and
+// their power. A running sum keeps the rounding error of the largest value
+// it has held, so once a power has fallen to 1/POWER_DROP_RECOMPUTE of its
+// highest since it was last recomputed, it is recomputed from the window.
+static INSTANCE_LOCAL float history[POWER_WINDOW][CHANNEL_SLOTS] VECTOR_ALIGNED;
+static INSTANCE_LOCAL uint16_t historyNext;
+static INSTANCE_LOCAL float power[CHANNEL_SLOTS] VECTOR_ALIGNED;
+static INSTANCE_LOCAL float powerPeak[CHANNEL_SLOTS] VECTOR_ALIGNED;
+static INSTANCE_LOCAL uint16_t channelMask;
+
+// Clear the state of one channel, from its first section on, and its power.
+static void clearChannel(uint16_t channel) {
+  for (uint16_t s = 1; s <= SECTION_COUNT; s++) {
+    stage1[s][channel] = 0;
+    stage2[s][channel] = 0;
+  }
+  for (uint16_t i = 0; i < POWER_WINDOW; i++)
+    history[i][channel] = 0;
+  power[channel] = 0;
+  powerPeak[channel] = 0;
+}
+
+// Recompute the power of count channels from first on from their window.
+static void recomputePower(uint16_t first, uint16_t count) {
+  float sum[CHANNEL_SLOTS] = {0};
+  for (uint16_t i = 0; i < POWER_WINDOW; i++)
+    for (uint16_t j = first; j < first + count; j++)
+      sum[j] += history[i][j] * history[i][j];
+  for (uint16_t j = first; j < first + count; j++) {
+    power[j] = sum[j];
+    powerPeak[j] = sum[j];
+  }
+}
+
+// Zero all filter state and power, and run every channel.
+void filterFloat_init(void) {
+  memset(firTaps, 0, sizeof(firTaps));
+  for (uint16_t i = 0; i < FIR_COEFF_COUNT; i++)
+    firTaps[FIR_PADDED_TAP_COUNT - 1 - i] = fir_b_coeffs[i];
+  memset(firDelay, 0, sizeof(firDelay));
+  firNewest = 0;
+  firOutput = 0;
+
+  // Padding lanes keep zero coefficients and stay silent.
+  memset(gainOf, 0, sizeof(gainOf));
+  memset(sectionA1, 0, sizeof(sectionA1));
+  memset(sectionA2, 0, sizeof(sectionA2));
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    // b is b[0] (1 - z^-2)^5; each section takes the fifth root of b[0].
+    gainOf[f] = pow(iir_b_coeffs[f][0], 1.0 / SECTION_COUNT);
+    for (uint16_t s = 0; s < SECTION_COUNT; s++) {
+      sectionA1[s][f] = sections[f][s][0];
+      sectionA2[s][f] = sections[f][s][1];
+    }
+  }
+  memcpy(sectionGain, gainOf, sizeof(sectionGain));
+  memset(stage1, 0, sizeof(stage1));
+  memset(stage2, 0, sizeof(stage2));
+  memset(history, 0, sizeof(history));
+  memset(power, 0, sizeof(power));
+  memset(powerPeak, 0, sizeof(powerPeak));
+  historyNext = 0;
+  channelMask = FILTER_ALL_CHANNELS;
+}
+
+// Sets which IIR filters are run, as a channel mask.
+void filterFloat_setChannelMask(uint16_t mask) {
+  mask &= FILTER_ALL_CHANNELS;
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    uint16_t bit = 1 << i;
+    if ((mask & bit) != (channelMask & bit))
+      clearChannel(i);
+    sectionGain[i] = mask & bit ? gainOf[i] : 0;
+  }
+  channelMask = mask;
+}
+
+// Push an input into the FIR delay line.
+void filterFloat_addNewInput(float x) {
+  firNewest = firNewest + 1 == FIR_PADDED_TAP_COUNT ? 0 : firNewest + 1;
+  firDelay[firNewest] = x;
+  firDelay[firNewest + FIR_PADDED_TAP_COUNT] = x;
+}
+
+#if defined(__ARM_NEON)
+
+// Dot product of the taps with the delay line.
+static float firDot(const float *inputs) {
+  float32x4_t sum = vdupq_n_f32(0);
+  for (uint16_t i = 0; i < FIR_PADDED_TAP_COUNT; i += FILTERFLOAT_LANES)
+    sum = vmlaq_f32(sum, vld1q_f32(&firTaps[i]), vld1q_f32(&inputs[i]));
+  float32x2_t half = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+  return vget_lane_f32(vpadd_f32(half, half), 0);
+}
+
+// Run the four channels from first on through their sections, and update
+// their power with the new output.
+static void runLanes(uint16_t first) {
+  float32x4_t gain = vld1q_f32(&sectionGain[first]);
+  float32x4_t x = vdupq_n_f32(firOutput);
+  for (uint16_t s = 0; s < SECTION_COUNT; s++) {
+    float32x4_t y = vmulq_f32(gain, vsubq_f32(x, vld1q_f32(&stage2[s][first])));
+    y = vmlsq_f32(y, vld1q_f32(&sectionA1[s][first]), vld1q_f32(&stage1[s + 1][first]));
+    y = vmlsq_f32(y, vld1q_f32(&sectionA2[s][first]), vld1q_f32(&stage2[s + 1][first]));
+    vst1q_f32(&stage2[s][first], vld1q_f32(&stage1[s][first]));
+    vst1q_f32(&stage1[s][first], x);
+    x = y;
+  }
+  vst1q_f32(&stage2[SECTION_COUNT][first], vld1q_f32(&stage1[SECTION_COUNT][first]));
+  vst1q_f32(&stage1[SECTION_COUNT][first], x);
+  float32x4_t oldest = vld1q_f32(&history[historyNext][first]);
+  float32x4_t sum = vmlaq_f32(vld1q_f32(&power[first]), x, x);
+  sum = vmlsq_f32(sum, oldest, oldest);
+  vst1q_f32(&power[first], sum);
+  vst1q_f32(&powerPeak[first], vmaxq_f32(vld1q_f32(&powerPeak[first]), sum));
+  vst1q_f32(&history[historyNext][first], x);
+}
+
+#else
+
+// Dot product of the taps with the delay line.
+static float firDot(const float *inputs) {
+  float sum[FILTERFLOAT_LANES] = {0};
+  for (uint16_t i = 0; i < FIR_PADDED_TAP_COUNT; i += FILTERFLOAT_LANES)
+    for (uint16_t j = 0; j < FILTERFLOAT_LANES; j++)
+      sum[j] += firTaps[i + j] * inputs[i + j];
+  return (sum[0] + sum[2]) + (sum[1] + sum[3]);
+}
+
+// Run the four channels from first on through their sections, and update
+// their power with the new output.
+static void runLanes(uint16_t first) {
+  float x[FILTERFLOAT_LANES];
+  for (uint16_t j = 0; j < FILTERFLOAT_LANES; j++)
+    x[j] = firOutput;
+  for (uint16_t s = 0; s < SECTION_COUNT; s++) {
+    for (uint16_t j = first; j < first + FILTERFLOAT_LANES; j++) {
+      float y = sectionGain[j] * (x[j - first] - stage2[s][j]);
+      y = y - sectionA1[s][j] * stage1[s + 1][j];
+      y = y - sectionA2[s][j] * stage2[s + 1][j];
+      stage2[s][j] = stage1[s][j];
+      stage1[s][j] = x[j - first];
+      x[j - first] = y;
+    }
+  }
+  for (uint16_t j = first; j < first + FILTERFLOAT_LANES; j++) {
+    float y = x[j - first], oldest = history[historyNext][j];
+    stage2[SECTION_COUNT][j] = stage1[SECTION_COUNT][j];
+    stage1[SECTION_COUNT][j] = y;
+    power[j] = (power[j] + y * y) - oldest * oldest;
+    powerPeak[j] = power[j] > powerPeak[j] ? power[j] : powerPeak[j];
+    history[historyNext][j] = y;
+  }
+}
+
+#endif
+
+// Runs the FIR filter on the delay line and returns its output.
+float filterFloat_firFilter(void) {
+  firOutput = firDot(&firDelay[firNewest + 1]);
+  return firOutput;
+}
+
+// Runs every IIR filter in the channel mask on the last FIR output.
+void filterFloat_iirFilters(void) {
+  for (uint16_t first = 0; first < CHANNEL_SLOTS; first += FILTERFLOAT_LANES) {
+    if (!((channelMask >> first) & LANE_MASK))
+      continue;
+    runLanes(first);
+    for (uint16_t j = first; j < first + FILTERFLOAT_LANES; j++) {
+      if (power[j] * POWER_DROP_RECOMPUTE < powerPeak[j]) {
+        recomputePower(first, FILTERFLOAT_LANES);
+        break;
+      }
+    }
+  }
+  if (++historyNext < POWER_WINDOW)
+    return;
+  // The window is all new: start the sums over from it.
+  historyNext = 0;
+  recomputePower(0, CHANNEL_SLOTS);
+}
+
+// Returns the last output of IIR filter filterNumber.
+float filterFloat_getIirOutput(uint16_t filterNumber) {
+  return stage1[SECTION_COUNT][filterNumber];
+}
+
+// Returns the power over the last outputs of IIR filter filterNumber.
+float filterFloat_getPower(uint16_t filterNumber) {
+  return power[filterNumber];
+}
+
+// Recomputes that power from the stored outputs and returns it.
+float filterFloat_computePowerFromScratch(uint16_t filterNumber) {
+  recomputePower(filterNumber, 1);
+  return power[filterNumber];
+}
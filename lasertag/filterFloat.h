@@ -0,0 +1,71 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef FILTERFLOAT_H_
+#define FILTERFLOAT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The filter chain of filter.h in single precision. Built with
+// LASERTAG_FLOAT_PIPELINE, filter.c hands all of its filtering to these
+// functions and only converts at its double interface, so the detector and
+// everything above it are unchanged. The host build always has both chains;
+// host/floatAudit.c runs them side by side.
+//
+// Everything kept per channel is stored lane-major, FILTERFLOAT_LANES
+// channels side by side, so one NEON register holds the same value of four
+// channels and the IIR bank and the power sums run four channels per
+// instruction. The ten channels are padded to twelve. The FIR delay line is
+// stored twice over so the newest taps are always contiguous, and the taps
+// are padded with zeros to a multiple of four. Without NEON (the host) plain
+// C does the same operations in the same order.
+//
+// Two stages are restructured, as float cannot run them as filter.c does:
+// - Each 10th-order IIR filter runs as a cascade of five second-order
+//   sections, one per conjugate pair of poles, each with a pair of the
+//   (1 - z^-2) zeros and a fifth of the gain. In direct form the a
+//   coefficients reach 163 while the poles sit within 0.016 of the unit
+//   circle; rounded to float they put the poles elsewhere.
+// - The running power sum keeps the rounding error of the largest power it
+//   has held, which after a shot can be many times the power left. It is
+//   recomputed from its window whenever it has fallen to a quarter of its
+//   peak, and every time the window has been replaced.
+
+#define FILTERFLOAT_LANES 4
+
+// Zero all filter state and power, and run every channel.
+void filterFloat_init(void);
+
+// Sets which IIR filters are run, as a channel mask. Filters left out read
+// as silent, and filters brought back start again from silence.
+void filterFloat_setChannelMask(uint16_t mask);
+
+// Push an input into the FIR delay line.
+void filterFloat_addNewInput(float x);
+
+// Runs the FIR filter on the delay line and returns its output, which is
+// the input of the next filterFloat_iirFilters().
+float filterFloat_firFilter(void);
+
+// Runs every IIR filter in the channel mask on the last FIR output, four
+// channels at a time, and brings their power up to date.
+void filterFloat_iirFilters(void);
+
+// Returns the last output of IIR filter filterNumber.
+float filterFloat_getIirOutput(uint16_t filterNumber);
+
+// Returns the power over the last FILTER_INPUT_PULSE_WIDTH outputs of IIR
+// filter filterNumber.
+float filterFloat_getPower(uint16_t filterNumber);
+
+// Recomputes that power from the stored outputs and returns it.
+float filterFloat_computePowerFromScratch(uint16_t filterNumber);
+
+#endif /* FILTERFLOAT_H_ */
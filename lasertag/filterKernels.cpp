@@ -0,0 +1,63 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "filterKernels.h"
+#include "filterCoefficients.h"
+#include "filterKernels.hpp"
+#include "instance.h"
+
+namespace {
+
+using fir_t = filterKernels::FirDecimator<FIR_COEFF_COUNT, FILTER_FIR_DECIMATION_FACTOR,
+                                          double, fir_b_coeffs>;
+using iir_t = filterKernels::IirBank<IIR_A_COEFF_COUNT, FILTER_FREQUENCY_COUNT, double,
+                                     iir_a_coeffs, iir_b_coeffs>;
+using power_t =
+    filterKernels::PowerWindow<FILTER_INPUT_PULSE_WIDTH, FILTER_FREQUENCY_COUNT, double>;
+
+INSTANCE_LOCAL fir_t fir;
+INSTANCE_LOCAL iir_t iir;
+INSTANCE_LOCAL power_t power;
+
+} // namespace
+
+// Zero all filter state and power.
+void filterKernels_init(void) {
+  fir.clear();
+  iir.clear();
+  power.clear();
+}
+
+// Zero the state and power of IIR filter filterNumber.
+void filterKernels_clearChannel(uint16_t filterNumber) {
+  iir.clear(filterNumber);
+  power.clear(filterNumber);
+}
+
+// Push an input into the FIR delay line.
+void filterKernels_addNewInput(double x) { fir.push(x); }
+
+// Runs the FIR filter and returns its output.
+double filterKernels_firFilter(void) {
+  double y = fir.output();
+  iir.push(y);
+  return y;
+}
+
+// Runs IIR filter filterNumber and returns its output.
+double filterKernels_iirFilter(uint16_t filterNumber) {
+  double z = iir.run(filterNumber);
+  power.push(filterNumber, z);
+  return z;
+}
+
+// Returns the power of the last outputs of IIR filter filterNumber.
+double filterKernels_computePower(uint16_t filterNumber, bool forceComputeFromScratch) {
+  return power.update(filterNumber, forceComputeFromScratch);
+}
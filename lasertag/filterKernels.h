@@ -0,0 +1,51 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef FILTERKERNELS_H_
+#define FILTERKERNELS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The filter chain of filter.h on the compile-time specialized C++ kernels
+// of filterKernels.hpp, instantiated in filterKernels.cpp for 81 FIR taps,
+// decimation by 10 and ten 10th-order IIR filters. Built with
+// LASERTAG_FILTER_TEMPLATES, filter.c hands all of its filtering to these
+// functions. The host build always has both; host/filterKernelBench.c runs
+// them side by side. The functions are those of filter.h.
+
+// Zero all filter state and power.
+void filterKernels_init(void);
+
+// Zero the state and power of IIR filter filterNumber.
+void filterKernels_clearChannel(uint16_t filterNumber);
+
+// Push an input into the FIR delay line.
+void filterKernels_addNewInput(double x);
+
+// Runs the FIR filter and returns its output, which is also the next input
+// of the IIR filters.
+double filterKernels_firFilter(void);
+
+// Runs IIR filter filterNumber and returns its output.
+double filterKernels_iirFilter(uint16_t filterNumber);
+
+// Returns the power of the last FILTER_INPUT_PULSE_WIDTH outputs of IIR
+// filter filterNumber, incrementally or from scratch.
+double filterKernels_computePower(uint16_t filterNumber, bool forceComputeFromScratch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FILTERKERNELS_H_ */
@@ -0,0 +1,204 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef FILTERKERNELS_HPP_
+#define FILTERKERNELS_HPP_
+
+#include <cstddef>
+#include <utility>
+
+// Header-only C++ kernels of the filter chain in filter.c, specialized at
+// compile time. Sizes are template arguments and the coefficients constexpr
+// tables (filterCoefficients.h), so every sum is written out term by term
+// with its coefficient built in, terms with a zero coefficient are left out
+// and nothing is allocated. Delay lines are stored twice over, so the
+// window of one output is contiguous and every tap sits at a constant
+// offset from one moving index.
+//
+// The sums add up in the same order as filter.c, so for the same input the
+// results are the same to the last bit. filterKernels.cpp instantiates the
+// kernels for the gun and exports them to C (filterKernels.h).
+
+namespace filterKernels {
+
+// The last Length values pushed, window()[0] the oldest.
+template <std::size_t Length, typename T> class DelayLine {
+public:
+  void push(T x) {
+    newest = newest + 1 == Length ? 0 : newest + 1;
+    values[newest] = x;
+    values[newest + Length] = x;
+  }
+
+  const T *window() const { return &values[newest + 1]; }
+
+  void clear() {
+    for (std::size_t i = 0; i < 2 * Length; i++)
+      values[i] = 0;
+  }
+
+private:
+  T values[2 * Length] = {};
+  std::size_t newest = 0;
+};
+
+// FIR filter of Taps taps that keeps only every Decimation-th output.
+// B[0] weighs the newest input.
+template <std::size_t Taps, std::size_t Decimation, typename T, const double (&B)[Taps]>
+class FirDecimator {
+public:
+  // Push an input. Returns true when an output is due, every Decimation
+  // inputs.
+  bool push(T x) {
+    inputs.push(x);
+    if (++pending < Decimation)
+      return false;
+    pending = 0;
+    return true;
+  }
+
+  // Returns the output for the inputs pushed so far.
+  T output() const {
+    T y = 0;
+    sum(y, inputs.window(), std::make_index_sequence<Taps>());
+    return y;
+  }
+
+  void clear() {
+    inputs.clear();
+    pending = 0;
+  }
+
+private:
+  template <std::size_t I> static void term(T &y, const T *x) {
+    if constexpr (B[I] != 0)
+      y += x[Taps - 1 - I] * static_cast<T>(B[I]);
+  }
+
+  template <std::size_t... I> static void sum(T &y, const T *x, std::index_sequence<I...>) {
+    (term<I>(y, x), ...);
+  }
+
+  DelayLine<Taps, T> inputs;
+  std::size_t pending = 0;
+};
+
+// Channels IIR filters of order Order on the same input. Filter n has the
+// numerator B[n] and the denominator 1 + A[n][0] z^-1 + ... ; B[n][0] and
+// A[n][0] weigh the newest input and output.
+template <std::size_t Order, std::size_t Channels, typename T,
+          const double (&A)[Channels][Order], const double (&B)[Channels][Order + 1]>
+class IirBank {
+public:
+  // Push the next input of all the filters.
+  void push(T x) { inputs.push(x); }
+
+  // Runs filter n on the inputs pushed so far and returns its output.
+  T run(std::size_t n) { return runFilter(n, std::make_index_sequence<Channels>()); }
+
+  // Forget the outputs of filter n, or of all the filters and the inputs.
+  void clear(std::size_t n) { outputs[n].clear(); }
+  void clear() {
+    inputs.clear();
+    for (std::size_t n = 0; n < Channels; n++)
+      outputs[n].clear();
+  }
+
+private:
+  template <std::size_t N, std::size_t I> static void feedForward(T &y, const T *x) {
+    if constexpr (B[N][I] != 0)
+      y += x[Order - I] * static_cast<T>(B[N][I]);
+  }
+
+  template <std::size_t N, std::size_t I> static void feedBack(T &z, const T *y) {
+    if constexpr (A[N][I] != 0)
+      z += y[Order - 1 - I] * static_cast<T>(A[N][I]);
+  }
+
+  template <std::size_t N, std::size_t... I>
+  static void feedForwardSum(T &y, const T *x, std::index_sequence<I...>) {
+    (feedForward<N, I>(y, x), ...);
+  }
+
+  template <std::size_t N, std::size_t... I>
+  static void feedBackSum(T &z, const T *y, std::index_sequence<I...>) {
+    (feedBack<N, I>(z, y), ...);
+  }
+
+  template <std::size_t N> T runFilter() {
+    T y = 0, z = 0;
+    feedForwardSum<N>(y, inputs.window(), std::make_index_sequence<Order + 1>());
+    feedBackSum<N>(z, outputs[N].window(), std::make_index_sequence<Order>());
+    z = y - z;
+    outputs[N].push(z);
+    return z;
+  }
+
+  // Picks runFilter<n>().
+  template <std::size_t... N> T runFilter(std::size_t n, std::index_sequence<N...>) {
+    T z = 0;
+    ((n == N && (z = runFilter<N>(), true)) || ...);
+    return z;
+  }
+
+  DelayLine<Order + 1, T> inputs;
+  DelayLine<Order, T> outputs[Channels];
+};
+
+// Power of Channels signals over their last Length values. update() brings
+// it up to date one value at a time, as filter_computePower() does.
+template <std::size_t Length, std::size_t Channels, typename T> class PowerWindow {
+public:
+  // Push the next value of signal n.
+  void push(std::size_t n, T x) {
+    values[n][next[n]] = x;
+    next[n] = next[n] + 1 == Length ? 0 : next[n] + 1;
+  }
+
+  // Returns the power of signal n: from every value in the window if
+  // fromScratch, otherwise from the last power and the values that came and
+  // went since.
+  T update(std::size_t n, bool fromScratch) {
+    T newest = values[n][next[n] ? next[n] - 1 : Length - 1];
+    if (fromScratch) {
+      T sum = 0;
+      for (std::size_t i = 0; i < Length; i++) {
+        T x = values[n][(next[n] + i) % Length];
+        sum += x * x;
+      }
+      power[n] = sum;
+    } else {
+      power[n] = power[n] - oldest[n] * oldest[n] + newest * newest;
+    }
+    oldest[n] = values[n][next[n]];
+    return power[n];
+  }
+
+  // Forget signal n, or all of them.
+  void clear(std::size_t n) {
+    for (std::size_t i = 0; i < Length; i++)
+      values[n][i] = 0;
+    power[n] = 0;
+    oldest[n] = 0;
+  }
+  void clear() {
+    for (std::size_t n = 0; n < Channels; n++)
+      clear(n);
+  }
+
+private:
+  T values[Channels][Length] = {};
+  std::size_t next[Channels] = {}; // Where the next value goes: the oldest.
+  T power[Channels] = {};
+  T oldest[Channels] = {}; // The oldest value at the last update.
+};
+
+} // namespace filterKernels
+
+#endif /* FILTERKERNELS_HPP_ */
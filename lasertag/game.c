@@ -15,21 +15,32 @@ The code in runningModes.c can be an example for implementing the game here.
 
 #include "detector.h"
 #include "filter.h"
+#include "gameEngine.h"
 #include "hitLedTimer.h"
 #include "interrupts.h"
-#include "intervalTimer.h"
-#include "invincibilityTimer.h"
 #include "runningModes.h"
 #include "sound/sound.h"
 #include "switches.h"
-#include "trigger.h"
 #include "transmitter.h"
 #include "lockoutTimer.h"
 #include "histogram.h"
 
-#define STARTING_LIVES 3
-#define STARTING_BULLETS 10
-#define HITS_PER_LIFE 5
+#ifdef LASERTAG_TELEMETRY
+#include "bluetooth/bluetooth.h"
+#include "telemetry.h"
+#endif
+
+#ifdef LASERTAG_JOURNAL
+#include "buffer.h"
+#include "journal.h"
+#include "utils.h"
+#ifdef LASERTAG_JOURNAL_UART
+#include "bluetooth/bluetooth.h"
+#else
+#include "journalSd.h"
+#endif
+#endif
+
 #define TEAM_A_FREQUENCY 5
 #define TEAM_B_FREQUENCY 8
 
@@ -40,18 +51,57 @@ The code in runningModes.c can be an example for implementing the game here.
 #define INTERRUPTS_CURRENTLY_ENABLED true
 #define INTERRUPTS_CURRENTLY_DISABLE false
 
-#define ISR_CUMULATIVE_TIMER INTERVAL_TIMER_TIMER_0 // Used by the ISR.
-#define RELOAD_TRIGGER_TIMER \
-  INTERVAL_TIMER_TIMER_1 // Used to compute total run-time.
-#define RELOAD_TRIGGER_LENGTH_S 3
+#ifdef LASERTAG_JOURNAL
+#define JOURNAL_CLOSE_TIMEOUT_MS 20000 // For a UART to drain the ring.
+
+static uint16_t journaledLives, journaledBullets;
+
+#ifdef LASERTAG_JOURNAL_UART
+// journal_writer_t for the Bluetooth UART: takes what its queue has room for.
+static uint32_t journalBluetoothWrite(const uint8_t *data, uint32_t size) {
+  return bluetooth_transmitQueueWrite((uint8_t *)data, size > UINT16_MAX ? UINT16_MAX : size);
+}
+#endif
+
+// Start the journal on the SD card, or the Bluetooth UART, with the game.
+static void journalGameStart(bool teamB) {
+#ifdef LASERTAG_JOURNAL_UART
+  bluetooth_init();
+  journal_start(journalBluetoothWrite, 0);
+#else
+  journalSd_start(); // Without a card the game runs unjournaled.
+#endif
+  journaledLives = gameEngine_getLives();
+  journaledBullets = gameEngine_getBullets();
+  journal_record(JOURNAL_EVENT_GAME_START, transmitter_getFrequencyNumber(), 0, teamB);
+}
 
-volatile static uint8_t bulletsLeft = STARTING_BULLETS;
+// Journal what the events just run through the engine did to the clip and
+// lives. Costs two comparisons when they changed nothing.
+static void journalGameChanges(void) {
+  uint16_t frequency = transmitter_getFrequencyNumber();
+  uint16_t bullets = gameEngine_getBullets(), lives = gameEngine_getLives();
+  if (bullets != journaledBullets) {
+    if (bullets > journaledBullets)
+      journal_record(JOURNAL_EVENT_RELOAD, frequency, 0, bullets);
+    else
+      for (uint16_t b = journaledBullets; b > bullets; b--)
+        journal_record(JOURNAL_EVENT_SHOT, frequency, 0, b - 1);
+    journaledBullets = bullets;
+  }
+  if (lives != journaledLives) {
+    journal_record(lives ? JOURNAL_EVENT_LIFE_LOST : JOURNAL_EVENT_OUT, frequency, 0, lives);
+    journaledLives = lives;
+  }
+}
 
-// Reload the gun by resetting number of bullets in the gun and playing a reload sound
-void reload() {
-  bulletsLeft = STARTING_BULLETS;
-  // TODO: Play a reload sound
+// Close the game in the journal and write everything out.
+static void journalGameEnd(uint32_t hitsTaken) {
+  journal_record(JOURNAL_EVENT_GAME_END, 0, 0, hitsTaken);
+  for (uint32_t ms = 0; !journal_flush() && ms < JOURNAL_CLOSE_TIMEOUT_MS; ms++)
+    utils_msDelay(1);
 }
+#endif
 
 // This game supports two teams, Team-A and Team-B.
 // Each team operates on its own configurable frequency.
@@ -62,20 +112,16 @@ void reload() {
 // that takes a short time to reload a new clip.
 // The clips are automatically loaded.
 // Runs until BTN3 is pressed.
+// The rules live in gameEngine.c; this loop only feeds it hits and runs the
+// events the ISR has queued, and otherwise stays in the detector.
 void game_twoTeamTag(void) {
-  uint16_t hitCount = 0;
   runningModes_initAll();
+  gameEngine_init();
   sound_setVolume(sound_mediumHighVolume_e);
   sound_setSound(sound_gameStart_e);
   sound_startSound();
 
-  // Configuration...
-
-  uint8_t livesLeft = STARTING_LIVES;
-  bool gameOver = false;
-
-  bool reloadTriggerTimerRunning = false;
-
+  // Only the other team's frequency can hit us.
   bool ignoredFrequencies[FILTER_FREQUENCY_COUNT];
   for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
     ignoredFrequencies[i] = true;
@@ -85,61 +131,83 @@ void game_twoTeamTag(void) {
   if (switchSetting) { // Team B
     transmitter_setFrequencyNumber(TEAM_B_FREQUENCY);
     ignoredFrequencies[TEAM_A_FREQUENCY] = false;
-    ignoredFrequencies[TEAM_B_FREQUENCY] = false; // TODO remove
     printf("B\n");
   } else { // Team A
     transmitter_setFrequencyNumber(TEAM_A_FREQUENCY);
     ignoredFrequencies[TEAM_B_FREQUENCY] = false;
-    ignoredFrequencies[TEAM_A_FREQUENCY] = false; // TODO remove
     printf("A\n");
   }
   detector_setIgnoredFrequencies(ignoredFrequencies);
 
-  trigger_enable();                          // Makes the state machine responsive to the trigger.
-  interrupts_enableTimerGlobalInts();        // Allow timer interrupts.
-  interrupts_startArmPrivateTimer();         // Start the private ARM timer running.
-  interrupts_enableArmInts();                // ARM will now see interrupts after this.
-  lockoutTimer_start();                      // Ignore erroneous hits at startup (when all power
-                                             // values are essentially 0).
-  intervalTimer_reset(RELOAD_TRIGGER_TIMER); // Used to measure main-loop execution time.
-
-  // Implement game loop...
-  while (!gameOver) { // Run until you detect BTN3 pressed.
+#ifdef LASERTAG_TELEMETRY
+  bluetooth_init();
+  telemetry_init(bluetooth_transmitQueueWrite, TELEMETRY_DEFAULT_BYTES_PER_SECOND);
+#endif
+#ifdef LASERTAG_JOURNAL
+  journalGameStart(switchSetting);
+#endif
+
+  gameEngine_start();                 // Enables the trigger.
+  interrupts_enableTimerGlobalInts(); // Allow timer interrupts.
+  interrupts_startArmPrivateTimer();  // Start the private ARM timer running.
+  interrupts_enableArmInts();         // ARM will now see interrupts after this.
+#ifndef LASERTAG_AMP // CPU1 runs the lockout with the filters.
+  lockoutTimer_start();               // Ignore erroneous hits at startup (when all power
+                                      // values are essentially 0).
+#endif
+
+  while (!gameEngine_quitRequested()) { // Run until you detect BTN3 pressed.
 
     // Run filters, compute power, run hit-detection.
     detector(INTERRUPTS_CURRENTLY_ENABLED); // Interrupts are currently enabled.
 
-    // If there is a hit detected, handle it
-    if (detector_hitDetected()) { // Hit detected
-      hitCount++;                 // increment the hit count.
-      detector_clearHit();        // Clear the hit.
+    // Hand a hit to the game engine and plot it.
+    if (detector_hitDetected()) {
+      uint16_t hitFrequency = detector_getFrequencyNumberOfLastHit();
+      gameEngine_dispatch(GAME_EVENT_HIT, hitFrequency);
+      detector_clearHit();
       detector_hitCount_t
           hitCounts[DETECTOR_HIT_ARRAY_SIZE]; // Store the hit-counts here.
       detector_getHitCounts(hitCounts);       // Get the current hit counts.
       histogram_plotUserHits(hitCounts);      // Plot the hit counts on the TFT.
+#ifdef LASERTAG_TELEMETRY
+      telemetry_sendHit(interrupts_isrInvocationCount(), hitFrequency,
+                        hitCounts[hitFrequency]);
+#endif
+#ifdef LASERTAG_JOURNAL
+      float power = filter_getCurrentPowerValue(hitFrequency);
+      journal_record(JOURNAL_EVENT_HIT, hitFrequency, power, hitCounts[hitFrequency]);
+      journalGameChanges();
+#endif
     }
 
-    // If the trigger is pressed, start a timer
-    if (trigger_isPressed()) {
-      if (!reloadTriggerTimerRunning) {
-        intervalTimer_start(RELOAD_TRIGGER_TIMER);
-        reloadTriggerTimerRunning = true;
-      }
-    } else if (reloadTriggerTimerRunning) {
-      // if the trigger isn't pressed but the trigger timer is still running, stop and reset the timer.
-      intervalTimer_stop(RELOAD_TRIGGER_TIMER);
-      reloadTriggerTimerRunning = false;
-      intervalTimer_reset(RELOAD_TRIGGER_TIMER);
-    }
-
-    // if the trigger has been pulled for 3 or more seconds, stop & reset the timer and manually reload.
-    if (intervalTimer_getTotalDurationInSeconds(RELOAD_TRIGGER_TIMER) >= RELOAD_TRIGGER_LENGTH_S) {
-      reload();
-    }
+#ifdef LASERTAG_TELEMETRY
+    // Queues and sends without waiting, so the detector never stalls on it.
+    telemetry_sendSnapshots(interrupts_isrInvocationCount());
+    telemetry_poll(interrupts_isrInvocationCount());
+#endif
+
+    // Shots, reloads, respawns and BTN3, queued by the ISR. Costs one
+    // comparison when there are none.
+    gameEngine_processEvents();
+
+#ifdef LASERTAG_JOURNAL
+    // Batches go to the card only while the ADC buffer is nearly empty.
+    journalGameChanges();
+    journal_poll(interrupts_isrInvocationCount(), buffer_elements());
+#endif
   }
 
   // End game loop...
   interrupts_disableArmInts();           // Done with game loop, disable the interrupts.
   hitLedTimer_turnLedOff();              // Save power :-)
   runningModes_printRunTimeStatistics(); // Print the run-time statistics.
+#ifdef LASERTAG_JOURNAL
+  detector_hitCount_t hitCounts[DETECTOR_HIT_ARRAY_SIZE];
+  detector_getHitCounts(hitCounts);
+  uint32_t hitsTaken = 0;
+  for (uint16_t i = 0; i < DETECTOR_HIT_ARRAY_SIZE; i++)
+    hitsTaken += hitCounts[i];
+  journalGameEnd(hitsTaken);
+#endif
 }
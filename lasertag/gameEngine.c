@@ -0,0 +1,239 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "autoReloadTimer.h"
+#include "buttons.h"
+#include "detector.h"
+#include "gameEngine.h"
+#include "instance.h"
+#include "invincibilityTimer.h"
+#include "sampleRate.h"
+#include "sound/sound.h"
+#include "trigger.h"
+
+#define QUEUE_MASK (GAME_ENGINE_EVENT_QUEUE_SIZE - 1)
+
+typedef struct {
+  uint8_t event;
+  uint16_t argument;
+} queuedEvent_t;
+
+// An action runs when its event arrives in its state and returns the next
+// state of its table.
+typedef uint8_t (*action_t)(uint16_t argument);
+
+// Written by the ISR (head) and the main loop (tail) only. Each side
+// publishes its index with a release store and reads the other's with an
+// acquire load, so a slot is written before it is seen and read before it is
+// reused.
+static INSTANCE_LOCAL queuedEvent_t eventQueue[GAME_ENGINE_EVENT_QUEUE_SIZE];
+static INSTANCE_LOCAL uint32_t queueHead;
+static INSTANCE_LOCAL uint32_t queueTail;
+static INSTANCE_LOCAL volatile uint32_t droppedEvents;
+static INSTANCE_LOCAL uint32_t eventCount;
+
+static INSTANCE_LOCAL volatile bool running;
+static INSTANCE_LOCAL volatile bool quitRequested;
+static INSTANCE_LOCAL bool triggerWasPressed;
+static INSTANCE_LOCAL uint32_t triggerHeldTicks;
+static INSTANCE_LOCAL uint32_t buttonPollTicks;
+// GAME_ENGINE_RELOAD_HOLD_TICKS and GAME_ENGINE_BUTTON_POLL_TICKS at the
+// sample rate.
+static INSTANCE_LOCAL uint32_t reloadHoldTicks = GAME_ENGINE_RELOAD_HOLD_TICKS;
+static INSTANCE_LOCAL uint32_t buttonPollPeriod = GAME_ENGINE_BUTTON_POLL_TICKS;
+
+static INSTANCE_LOCAL gameEngine_lifeState_t lifeState;
+static INSTANCE_LOCAL gameEngine_clipState_t clipState;
+static INSTANCE_LOCAL uint16_t lives;
+static INSTANCE_LOCAL uint16_t hitsThisLife;
+static INSTANCE_LOCAL uint16_t bullets;
+
+/*****************************************************************************
+***** Actions
+*****************************************************************************/
+
+// A hit that counts. Every GAME_ENGINE_HITS_PER_LIFE hits cost a life.
+static uint8_t takeHit(uint16_t frequency) {
+  (void)frequency;
+  if (++hitsThisLife < GAME_ENGINE_HITS_PER_LIFE) {
+    sound_playSound(sound_hit_e);
+    return GAME_LIFE_ALIVE;
+  }
+  hitsThisLife = 0;
+  if (--lives == 0) {
+    trigger_disable(); // For good: only the referee restarts the gun.
+    sound_playSound(sound_gameOver_e);
+    return GAME_LIFE_OUT;
+  }
+  invincibilityTimer_start(GAME_ENGINE_INVINCIBILITY_SECONDS);
+  sound_playSound(sound_loseLife_e);
+  return GAME_LIFE_INVINCIBLE;
+}
+
+// Back in the game after losing a life.
+static uint8_t respawn(uint16_t argument) {
+  (void)argument;
+  return GAME_LIFE_ALIVE;
+}
+
+// The trigger fired a shot. An empty clip disables the trigger and starts the
+// automatic reload.
+static uint8_t fireShot(uint16_t argument) {
+  (void)argument;
+  if (bullets)
+    bullets--;
+  if (bullets)
+    return GAME_CLIP_LOADED;
+  trigger_disable();
+  autoReloadTimer_start();
+  sound_playSound(sound_gunClick_e);
+  return GAME_CLIP_RELOADING;
+}
+
+// A full clip, after the automatic reload or a long trigger hold.
+static uint8_t reloadClip(uint16_t argument) {
+  (void)argument;
+  bullets = GAME_ENGINE_STARTING_BULLETS;
+  if (lifeState != GAME_LIFE_OUT)
+    trigger_enable();
+  sound_playSound(sound_gunReload_e);
+  return GAME_CLIP_LOADED;
+}
+
+// Reloading by hand ends any automatic reload in progress.
+static uint8_t manualReload(uint16_t argument) {
+  autoReloadTimer_cancel();
+  return reloadClip(argument);
+}
+
+// Events missing from a row are ignored in that state, e.g. hits while
+// invincible or out. The detector is told to ignore those hits too, so they
+// are neither counted nor plotted and do not light the hit LED.
+static const action_t lifeTable[GAME_LIFE_STATE_COUNT][GAME_EVENT_COUNT] = {
+    [GAME_LIFE_ALIVE] = {[GAME_EVENT_HIT] = takeHit},
+    [GAME_LIFE_INVINCIBLE] = {[GAME_EVENT_INVINCIBILITY_OVER] = respawn},
+    [GAME_LIFE_OUT] = {0},
+};
+
+static const action_t clipTable[GAME_CLIP_STATE_COUNT][GAME_EVENT_COUNT] = {
+    [GAME_CLIP_LOADED] = {[GAME_EVENT_SHOT] = fireShot,
+                          [GAME_EVENT_TRIGGER_HELD] = manualReload},
+    [GAME_CLIP_RELOADING] = {[GAME_EVENT_RELOAD_DONE] = reloadClip,
+                             [GAME_EVENT_TRIGGER_HELD] = manualReload},
+};
+
+/*****************************************************************************
+***** Engine
+*****************************************************************************/
+
+// Full lives and clip, nothing queued.
+void gameEngine_init(void) {
+  running = false;
+  quitRequested = false;
+  queueHead = queueTail = 0;
+  droppedEvents = 0;
+  eventCount = 0;
+  triggerWasPressed = false;
+  triggerHeldTicks = 0;
+  buttonPollTicks = 0;
+  reloadHoldTicks = sampleRate_ticks(GAME_ENGINE_RELOAD_HOLD_TICKS);
+  buttonPollPeriod = sampleRate_ticks(GAME_ENGINE_BUTTON_POLL_TICKS);
+  lifeState = GAME_LIFE_ALIVE;
+  detector_ignoreAllHits(false);
+  clipState = GAME_CLIP_LOADED;
+  lives = GAME_ENGINE_STARTING_LIVES;
+  hitsThisLife = 0;
+  bullets = GAME_ENGINE_STARTING_BULLETS;
+  invincibilityTimer_init();
+  autoReloadTimer_init();
+}
+
+// Start watching the trigger and BTN3 and enable the trigger.
+void gameEngine_start(void) {
+  trigger_enable();
+  running = true;
+}
+
+// Called from the timer ISR: trigger presses, long holds and BTN3.
+void gameEngine_tick(void) {
+  if (!running)
+    return;
+  bool pressed = trigger_isPressed();
+  if (pressed && !triggerWasPressed)
+    gameEngine_postEvent(GAME_EVENT_SHOT, 0);
+  triggerWasPressed = pressed;
+  triggerHeldTicks = pressed ? triggerHeldTicks + 1 : 0;
+  if (triggerHeldTicks == reloadHoldTicks)
+    gameEngine_postEvent(GAME_EVENT_TRIGGER_HELD, 0);
+  if (++buttonPollTicks >= buttonPollPeriod) {
+    buttonPollTicks = 0;
+    if (buttons_read() & BUTTONS_BTN3_MASK)
+      gameEngine_postEvent(GAME_EVENT_QUIT, 0);
+  }
+}
+
+// Queue an event from the timer ISR.
+bool gameEngine_postEvent(gameEngine_event_t event, uint16_t argument) {
+  uint32_t head = queueHead; // Only the ISR writes head.
+  if (head - __atomic_load_n(&queueTail, __ATOMIC_ACQUIRE) == GAME_ENGINE_EVENT_QUEUE_SIZE) {
+    droppedEvents++;
+    return false;
+  }
+  eventQueue[head & QUEUE_MASK] = (queuedEvent_t){event, argument};
+  __atomic_store_n(&queueHead, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+// Run one event through both tables.
+void gameEngine_dispatch(gameEngine_event_t event, uint16_t argument) {
+  eventCount++;
+  if (event == GAME_EVENT_QUIT) {
+    running = false;
+    quitRequested = true;
+    return;
+  }
+  action_t lifeAction = lifeTable[lifeState][event];
+  if (lifeAction) {
+    gameEngine_lifeState_t before = lifeState;
+    lifeState = lifeAction(argument);
+    if (lifeState != before)
+      detector_ignoreAllHits(lifeState != GAME_LIFE_ALIVE);
+  }
+  action_t clipAction = clipTable[clipState][event];
+  if (clipAction)
+    clipState = clipAction(argument);
+}
+
+// Run every queued event through the rules.
+uint32_t gameEngine_processEvents(void) {
+  uint32_t handled = 0;
+  uint32_t tail = queueTail; // Only the main loop writes tail.
+  while (tail != __atomic_load_n(&queueHead, __ATOMIC_ACQUIRE)) {
+    queuedEvent_t queued = eventQueue[tail & QUEUE_MASK];
+    __atomic_store_n(&queueTail, ++tail, __ATOMIC_RELEASE);
+    gameEngine_dispatch(queued.event, queued.argument);
+    handled++;
+  }
+  return handled;
+}
+
+// True once BTN3 has been pressed.
+bool gameEngine_quitRequested(void) { return quitRequested; }
+
+gameEngine_lifeState_t gameEngine_getLifeState(void) { return lifeState; }
+
+gameEngine_clipState_t gameEngine_getClipState(void) { return clipState; }
+
+uint16_t gameEngine_getLives(void) { return lives; }
+
+uint16_t gameEngine_getBullets(void) { return bullets; }
+
+uint32_t gameEngine_getEventCount(void) { return eventCount; }
+
+uint32_t gameEngine_getDroppedEventCount(void) { return droppedEvents; }
@@ -0,0 +1,89 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef GAMEENGINE_H_
+#define GAMEENGINE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Event-driven rules for game_twoTeamTag(). Everything that changes the game
+// arrives as an event: hits from the main loop, and shots, trigger holds,
+// reload and invincibility expiry and BTN3 from the timer ISR, which queues
+// them. The rules are two small tables of actions indexed by state and event,
+// one for lives and one for the clip. With nothing queued,
+// gameEngine_processEvents() is a single comparison, so the main loop spends
+// its time in detector().
+
+#define GAME_ENGINE_STARTING_LIVES 3
+#define GAME_ENGINE_HITS_PER_LIFE 5
+#define GAME_ENGINE_STARTING_BULLETS 10
+#define GAME_ENGINE_INVINCIBILITY_SECONDS 5
+#define GAME_ENGINE_RELOAD_HOLD_TICKS 300000 // Hold the trigger 3 s to reload.
+#define GAME_ENGINE_BUTTON_POLL_TICKS 1000   // Look at BTN3 every 10 ms.
+#define GAME_ENGINE_EVENT_QUEUE_SIZE 16      // A power of two.
+
+typedef enum {
+  GAME_EVENT_HIT,                // argument: frequency of the shooter.
+  GAME_EVENT_SHOT,               // Debounced trigger press; the shot is out.
+  GAME_EVENT_TRIGGER_HELD,       // Trigger held for a manual reload.
+  GAME_EVENT_RELOAD_DONE,        // The auto-reload timer expired.
+  GAME_EVENT_INVINCIBILITY_OVER, // The invincibility timer expired.
+  GAME_EVENT_QUIT,               // BTN3.
+  GAME_EVENT_COUNT
+} gameEngine_event_t;
+
+typedef enum {
+  GAME_LIFE_ALIVE,
+  GAME_LIFE_INVINCIBLE, // Just lost a life; the detector ignores hits until respawn.
+  GAME_LIFE_OUT,        // No lives left: return to base. Hits are ignored.
+  GAME_LIFE_STATE_COUNT
+} gameEngine_lifeState_t;
+
+typedef enum {
+  GAME_CLIP_LOADED,
+  GAME_CLIP_RELOADING, // Empty; the trigger is disabled until the reload.
+  GAME_CLIP_STATE_COUNT
+} gameEngine_clipState_t;
+
+// Full lives and clip, nothing queued. The engine ignores the trigger and
+// buttons until gameEngine_start().
+void gameEngine_init(void);
+
+// Start watching the trigger and BTN3 and enable the trigger.
+void gameEngine_start(void);
+
+// Called from the timer ISR: turns trigger presses, long holds and BTN3 into
+// events.
+void gameEngine_tick(void);
+
+// Queue an event from the timer ISR, the only producer. Returns false, and
+// counts the loss, if the queue is full.
+bool gameEngine_postEvent(gameEngine_event_t event, uint16_t argument);
+
+// Run one event through the rules now. Used by the main loop for hits.
+void gameEngine_dispatch(gameEngine_event_t event, uint16_t argument);
+
+// Run every queued event through the rules. Returns how many there were.
+uint32_t gameEngine_processEvents(void);
+
+// True once BTN3 has been pressed.
+bool gameEngine_quitRequested(void);
+
+gameEngine_lifeState_t gameEngine_getLifeState(void);
+gameEngine_clipState_t gameEngine_getClipState(void);
+uint16_t gameEngine_getLives(void);
+uint16_t gameEngine_getBullets(void);
+
+// Returns how many events have been handled, and how many were lost because
+// the queue was full.
+uint32_t gameEngine_getEventCount(void);
+uint32_t gameEngine_getDroppedEventCount(void);
+
+#endif /* GAMEENGINE_H_ */
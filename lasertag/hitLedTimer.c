@@ -1,5 +1,7 @@
 #include "buttons.h"
 #include "hitLedTimer.h"
+#include "instance.h"
+#include "sampleRate.h"
 #include "include/leds.h"
 #include "include/mio.h"
 #include "utils.h"
@@ -11,21 +13,23 @@
 #define LED_1 1      // on the Zybo board, used for debugging
 #define BOUNCE_DELAY 5
 
-volatile static bool isEnabled;
-volatile static bool shouldStart;
-volatile static uint64_t ticks;
+static INSTANCE_LOCAL volatile bool isEnabled;
+static INSTANCE_LOCAL volatile bool shouldStart;
+static INSTANCE_LOCAL volatile uint64_t ticks;
+static INSTANCE_LOCAL uint32_t expireValue = HIT_LED_TIMER_EXPIRE_VALUE; // At the sample rate.
 
 // States for the controller state machine.
 enum hitLedTimer_st_t {
 	init_st,           // hit LED off
 	running_st         // hit LED on for 1/2 second
 };
-volatile static enum hitLedTimer_st_t currentState;
+static INSTANCE_LOCAL volatile enum hitLedTimer_st_t currentState;
 
 // Need to init things.
 void hitLedTimer_init() {
     isEnabled = false;
     ticks = 0;
+    expireValue = sampleRate_ticks(HIT_LED_TIMER_EXPIRE_VALUE);
     currentState = init_st;
     shouldStart = false;
     mio_setPinAsOutput(HIT_LED_TIMER_OUTPUT_PIN);
@@ -47,7 +51,7 @@ void hitLedTimer_tick() {
             }
             break;
         case running_st:
-            if (ticks >= HIT_LED_TIMER_EXPIRE_VALUE) {
+            if (ticks >= expireValue) {
                 ticks = 0;
                 shouldStart = false;
                 hitLedTimer_turnLedOff();
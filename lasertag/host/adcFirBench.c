@@ -0,0 +1,178 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// The decimating FIR filter read in place from the ADC buffer
+// (filter_firFilterAdc() on buffer_history(), consuming with buffer_advance())
+// against popping each sample, scaling it and copying it into xQueue for
+// filter_firFilter(), as the detector used to:
+// - agreement: both run side by side on random ADC samples, and every FIR
+//   output must agree to within rounding;
+// - speed: time per input sample of each to drain the ADC buffer, a
+//   detector call's worth of samples at a time, with the FIR filter alone and
+//   with the whole chain behind it.
+//
+//   adcFirBench [--seconds s] [--check]
+//
+// --check fails if any output differs by more than MAX_DIFFERENCE.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "buffer.h"
+#include "filter.h"
+
+#define SAMPLE_RATE (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000)
+#define TIMING_SAMPLES SAMPLE_RATE // One second of input, filtered over again.
+#define BLOCK_SAMPLES 1000         // Waiting per detector call: 10 ms.
+#define MAX_DIFFERENCE 1e-12
+
+typedef enum { POPPED, IN_PLACE } path_t;
+
+// What a timing run does per FIR output.
+typedef enum { FIR_ONLY, WHOLE_CHAIN } work_t;
+
+static const char *workNames[] = {"FIR", "FIR + 10 IIR + power"};
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static double unitRandom(uint64_t *state) {
+  *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+  return (*state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static buffer_data_t randomCode(uint64_t *random) {
+  return unitRandom(random) * (FILTER_ADC_MAX_VALUE + 1);
+}
+
+// Both start from the ADC at rest.
+static void startPaths(void) {
+  buffer_init();
+  filter_reset();
+  filter_setAdcInputs(buffer_history(filter_getFirCoefficientCount()));
+}
+
+// Run both over samples inputs; returns the largest difference between their
+// outputs. Popping a sample leaves it in the history, so one buffer serves
+// both.
+static double compare(uint32_t samples, uint32_t *outputs) {
+  uint64_t random = 1;
+  uint16_t decimation = filter_getDecimationValue();
+  uint32_t taps = filter_getFirCoefficientCount();
+  double largest = 0;
+  *outputs = 0;
+  startPaths();
+  for (uint32_t n = 0; n < samples; n++) {
+    buffer_pushover(randomCode(&random));
+    filter_addNewInput(buffer_pop() / FILTER_ADC_MAX_VALUE * FILTER_ADC_SCALAR - 1.0);
+    if ((n + 1) % decimation)
+      continue;
+    double difference = fabs(filter_firFilter() - filter_firFilterAdc(buffer_history(taps)));
+    largest = fmax(largest, difference);
+    (*outputs)++;
+  }
+  return largest;
+}
+
+// Seconds per input sample of one path draining the ADC buffer and doing
+// work, over passes through the inputs. Filling the buffer is not timed.
+static double measureSpeed(path_t path, work_t work, const buffer_data_t inputs[],
+                           uint32_t passes) {
+  uint16_t decimation = filter_getDecimationValue();
+  uint32_t taps = filter_getFirCoefficientCount();
+  double sink = 0, seconds = 0;
+  uint32_t phase = 0; // Inputs since the last FIR output.
+  startPaths();
+  for (uint32_t pass = 0; pass < passes; pass++) {
+    for (uint32_t block = 0; block < TIMING_SAMPLES; block += BLOCK_SAMPLES) {
+      for (uint32_t n = block; n < block + BLOCK_SAMPLES; n++)
+        buffer_pushover(inputs[n]);
+      double begin = now();
+      uint32_t elements = buffer_elements();
+      while (elements) {
+        uint32_t count = decimation - phase;
+        if (count > elements)
+          count = elements;
+        elements -= count;
+        if (path == POPPED) {
+          for (uint32_t i = 0; i < count; i++)
+            filter_addNewInput(buffer_pop() / FILTER_ADC_MAX_VALUE * FILTER_ADC_SCALAR -
+                               1.0);
+        } else {
+          buffer_advance(count);
+        }
+        phase += count;
+        if (phase < decimation)
+          continue;
+        phase = 0;
+        sink += path == POPPED ? filter_firFilter() : filter_firFilterAdc(buffer_history(taps));
+        if (work != WHOLE_CHAIN)
+          continue;
+        for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+          sink += filter_iirFilter(f);
+          sink += filter_computePower(f, false, false);
+        }
+      }
+      seconds += now() - begin;
+    }
+  }
+  if (sink == 0.5) // Keep the loops.
+    printf("\n");
+  return seconds / ((double)passes * TIMING_SAMPLES);
+}
+
+int main(int argc, char *argv[]) {
+  double seconds = 20;
+  bool check = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+      seconds = atof(argv[++i]);
+    else if (strcmp(argv[i], "--check") == 0)
+      check = true;
+    else {
+      printf("usage: %s [--seconds s] [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+  uint32_t samples = seconds * SAMPLE_RATE;
+  if (samples < TIMING_SAMPLES)
+    samples = TIMING_SAMPLES;
+
+  filter_init();
+  uint32_t outputs;
+  double largest = compare(samples, &outputs);
+  printf("%.1f s of input: %u FIR outputs, largest difference %.3g\n",
+         (double)samples / SAMPLE_RATE, outputs, largest);
+
+  static buffer_data_t inputs[TIMING_SAMPLES];
+  uint64_t random = 2;
+  for (uint32_t n = 0; n < TIMING_SAMPLES; n++)
+    inputs[n] = randomCode(&random);
+  uint32_t passes = samples / TIMING_SAMPLES;
+  printf("work per FIR output    popped + xQueue    in place  speedup  (ns per input sample)\n");
+  for (work_t work = FIR_ONLY; work <= WHOLE_CHAIN; work++) {
+    double popped = measureSpeed(POPPED, work, inputs, passes);
+    double inPlace = measureSpeed(IN_PLACE, work, inputs, passes);
+    printf("%-20s  %16.2f  %10.2f  %6.2fx\n", workNames[work], popped * 1e9, inPlace * 1e9,
+           popped / inPlace);
+  }
+  if (check && !(largest <= MAX_DIFFERENCE)) {
+    printf("adcFirBench: FAILED\n");
+    return 1;
+  }
+  return 0;
+}
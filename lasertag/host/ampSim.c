@@ -0,0 +1,292 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Host model of the dual-core (AMP) build described in amp.h. One thread plays
+// CPU1: it feeds synthetic ADC samples from the channel model through
+// detectorCore_tick() and runs detectorCore_poll(), exactly as cpu1Main.c does
+// on the board. The main thread plays CPU0: it ticks the trigger, transmitter,
+// hit-LED timer and sound (isr_function() as built with LASERTAG_AMP) and
+// collects hits through remoteDetector.c. The two share only the amp_shared_t
+// rings.
+//
+// --single runs the same shots through the single-core build instead: one
+// thread doing the whole isr_function() plus detector(). Both modes report the
+// work each core does per simulated second ("load", measured on this host, so
+// only the ratio between the modes carries over to the board) and check the
+// hits against the shots: every shot must be detected once, except those on
+// the ignored frequency. In AMP mode, the filter powers CPU0 reads when CPU1
+// has stopped must also be exactly CPU1's own.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "amp.h"
+#include "autoReloadTimer.h"
+#include "channel.h"
+#include "detector.h"
+#include "detectorCore.h"
+#include "filter.h"
+#include "gameEngine.h"
+#include "hitLedTimer.h"
+#include "hostSim.h"
+#include "invincibilityTimer.h"
+#include "isr.h"
+#include "lockoutTimer.h"
+#include "remoteDetector.h"
+#include "sound.h"
+#include "transmitter.h"
+#include "trigger.h"
+
+#define TICKS_PER_SECOND HOSTSIM_DEFAULT_TICKS_PER_SECOND
+#define TICKS_PER_MS (TICKS_PER_SECOND / 1000)
+#define MS_PER_SECOND 1000
+#define DEFAULT_SECONDS 10
+#define DEFAULT_IGNORED_FREQUENCY 4
+#define NANOSECONDS_PER_SECOND 1e9
+
+// Shots start after the lockout that follows start-up and are further apart
+// than the lockout, so each one should be detected exactly once.
+#define FIRST_SHOT_S 0.6
+#define SHOT_INTERVAL_S 0.6
+#define SHOT_DURATION_S 0.2
+#define SHOT_DISTANCE_M 5.0
+#define SHOT_FREQUENCY_STEP 3 // Frequencies 1, 4, 7, 0, 3, ...
+
+static uint32_t simMs = DEFAULT_SECONDS * MS_PER_SECOND;
+static uint16_t ignoredFrequency = DEFAULT_IGNORED_FREQUENCY;
+static bool realTime;
+static channel_config_t channelConfig;
+static uint32_t expectedHits[FILTER_FREQUENCY_COUNT];
+
+// Set by CPU1 once it has filtered the last simulated millisecond.
+static volatile uint32_t cpu1Done;
+static double cpu1TickSeconds; // Time in detectorCore_tick().
+static double cpu1PowerValues[FILTER_FREQUENCY_COUNT]; // CPU1's filters when it stopped.
+
+static INSTANCE_LOCAL channel_t channel;
+static INSTANCE_LOCAL uint16_t samples[TICKS_PER_MS];
+static INSTANCE_LOCAL uint32_t sampleIndex;
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / NANOSECONDS_PER_SECOND;
+}
+
+// ADC source for the single-core build: the next channel sample.
+static uint32_t nextSample(void) { return samples[sampleIndex++]; }
+
+// Shots every SHOT_INTERVAL_S, cycling through the frequencies.
+static void scheduleShots(void) {
+  channel_initConfig(&channelConfig);
+  uint16_t frequency = 1;
+  for (double start = FIRST_SHOT_S; start + SHOT_DURATION_S < simMs / (double)MS_PER_SECOND;
+       start += SHOT_INTERVAL_S) {
+    if (!channel_addShooter(&channelConfig, frequency, SHOT_DISTANCE_M, start,
+                            SHOT_DURATION_S))
+      break;
+    if (frequency != ignoredFrequency)
+      expectedHits[frequency]++;
+    frequency = (frequency + SHOT_FREQUENCY_STEP) % FILTER_FREQUENCY_COUNT;
+  }
+}
+
+// With --realtime, wait until simulated millisecond ms is due.
+static void pace(double start, uint32_t ms) {
+  if (!realTime)
+    return;
+  double due = start + (double)ms / MS_PER_SECOND;
+  while (now() < due)
+    ;
+}
+
+// CPU1: the timer ISR and main loop of cpu1Main.c, interleaved one simulated
+// millisecond at a time.
+static void *cpu1(void *arg) {
+  (void)arg;
+  channel_init(&channel, &channelConfig);
+  detectorCore_init();
+  __atomic_store_n(&amp_getShared()->cpu1State, AMP_CPU1_RUNNING, __ATOMIC_RELEASE);
+  double start = now();
+  for (uint32_t ms = 0; ms < simMs; ms++) {
+    pace(start, ms);
+    channel_generate(&channel, samples, TICKS_PER_MS);
+    double tickStart = now();
+    for (uint32_t i = 0; i < TICKS_PER_MS; i++)
+      detectorCore_tick(samples[i]);
+    cpu1TickSeconds += now() - tickStart;
+    detectorCore_poll(false);
+  }
+  __atomic_store_n(&cpu1Done, 1, __ATOMIC_RELEASE);
+  detectorCore_run(); // Until CPU0 sends AMP_MESSAGE_STOP.
+  filter_getCurrentPowerValues(cpu1PowerValues);
+  return NULL;
+}
+
+// CPU0's part of each timer tick in the AMP build.
+static void cpu0Tick(void) {
+  trigger_tick();
+  hitLedTimer_tick();
+  transmitter_tick();
+  sound_tick();
+  invincibilityTimer_tick();
+  autoReloadTimer_tick();
+  gameEngine_tick();
+}
+
+// Print one core's load: work per simulated second.
+static void printLoad(const char *name, double seconds) {
+  double simSeconds = (double)simMs / MS_PER_SECOND;
+  printf("  %-28s %8.3f s  %6.2f%% of real time\n", name, seconds,
+         seconds / simSeconds * 100);
+}
+
+// Compare the hit counts with the shots. Returns true if they match.
+static bool checkHits(const detector_hitCount_t hits[]) {
+  bool pass = true;
+  printf("hits by frequency (expected):");
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    printf(" %u(%u)", hits[f], expectedHits[f]);
+    pass &= hits[f] == expectedHits[f];
+  }
+  printf("%s\n", pass ? "" : "  MISMATCH");
+  return pass;
+}
+
+static bool runAmp(void) {
+  amp_init();
+  pthread_t cpu1Thread;
+  double start = now();
+  pthread_create(&cpu1Thread, NULL, cpu1, NULL);
+  amp_startDetectorCore();
+
+  isr_init();
+  remoteDetector_init();
+  bool ignored[FILTER_FREQUENCY_COUNT] = {false};
+  ignored[ignoredFrequency] = true;
+  remoteDetector_setIgnoredFrequencies(ignored);
+
+  double cpu0Seconds = 0;
+  for (uint32_t ms = 0; ms < simMs; ms++) {
+    pace(start, ms);
+    double tickStart = now();
+    for (uint32_t i = 0; i < TICKS_PER_MS; i++)
+      cpu0Tick();
+    remoteDetector_poll();
+    cpu0Seconds += now() - tickStart;
+  }
+  while (!__atomic_load_n(&cpu1Done, __ATOMIC_ACQUIRE))
+    remoteDetector_poll();
+  remoteDetector_poll();
+  amp_push(&amp_getShared()->toDetector, AMP_MESSAGE_STOP, 0, 0);
+  pthread_join(cpu1Thread, NULL);
+  double wall = now() - start;
+
+  amp_stats_t stats;
+  amp_readStats(&stats);
+  double detectorSeconds = (double)stats.busyTime / amp_getTimeTicksPerSecond();
+  printf("AMP: %.1f simulated s in %.2f s\n", simMs / (double)MS_PER_SECOND, wall);
+  printf("CPU0:\n");
+  printLoad("ISR and hit collection", cpu0Seconds);
+  printf("CPU1:\n");
+  printLoad("ISR (ADC, lockout)", cpu1TickSeconds);
+  printLoad("detector", detectorSeconds);
+  printLoad("total", cpu1TickSeconds + detectorSeconds);
+  printf("CPU1 ticks %u, detector invocations %u, ADC buffer high water %u\n",
+         stats.ticks, stats.detectorInvocations, stats.bufferHighWater);
+  printf("ring rejections: to CPU1 %u, to CPU0 %u\n",
+         amp_getShared()->toDetector.rejected, amp_getShared()->toGame.rejected);
+
+  // detectorCore_run() published CPU1's last powers as it stopped.
+  double powerValues[FILTER_FREQUENCY_COUNT];
+  remoteDetector_getPowerValues(powerValues);
+  bool powersMatch = memcmp(powerValues, cpu1PowerValues, sizeof(powerValues)) == 0;
+  printf("powers published to CPU0: %s\n", powersMatch ? "match CPU1's" : "MISMATCH");
+
+  detector_hitCount_t hits[FILTER_FREQUENCY_COUNT];
+  remoteDetector_getHitCounts(hits);
+  return checkHits(hits) && amp_getShared()->toGame.rejected == 0 && powersMatch;
+}
+
+static bool runSingle(void) {
+  channel_init(&channel, &channelConfig);
+  hostSim_setAdcSource(nextSample);
+  isr_init();
+  filter_init();
+  detector_init();
+  lockoutTimer_start(); // As detectorCore_init() does.
+  bool ignored[FILTER_FREQUENCY_COUNT] = {false};
+  ignored[ignoredFrequency] = true;
+  detector_setIgnoredFrequencies(ignored);
+
+  double isrSeconds = 0, detectorSeconds = 0;
+  double start = now();
+  for (uint32_t ms = 0; ms < simMs; ms++) {
+    pace(start, ms);
+    channel_generate(&channel, samples, TICKS_PER_MS);
+    sampleIndex = 0;
+    double tickStart = now();
+    for (uint32_t i = 0; i < TICKS_PER_MS; i++)
+      isr_function();
+    double detectorStart = now();
+    detector(false);
+    if (detector_hitDetected())
+      detector_clearHit();
+    isrSeconds += detectorStart - tickStart;
+    detectorSeconds += now() - detectorStart;
+  }
+  double wall = now() - start;
+
+  printf("single core: %.1f simulated s in %.2f s\n", simMs / (double)MS_PER_SECOND,
+         wall);
+  printf("CPU0:\n");
+  printLoad("ISR", isrSeconds);
+  printLoad("detector", detectorSeconds);
+  printLoad("total", isrSeconds + detectorSeconds);
+  printf("detector invocations %u\n", detector_getInvocationCount());
+
+  detector_hitCount_t hits[FILTER_FREQUENCY_COUNT];
+  detector_getHitCounts(hits);
+  return checkHits(hits);
+}
+
+static void printUsage(const char *program) {
+  printf("usage: %s [--seconds n] [--ignore frequency] [--single] [--realtime]\n",
+         program);
+}
+
+int main(int argc, char *argv[]) {
+  bool single = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--single") == 0) {
+      single = true;
+    } else if (strcmp(argv[i], "--realtime") == 0) {
+      realTime = true;
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      simMs = atof(argv[++i]) * MS_PER_SECOND;
+    } else if (strcmp(argv[i], "--ignore") == 0 && i + 1 < argc) {
+      ignoredFrequency = atoi(argv[++i]);
+    } else {
+      printUsage(argv[0]);
+      return 2;
+    }
+  }
+  if (!simMs || ignoredFrequency >= FILTER_FREQUENCY_COUNT) {
+    printUsage(argv[0]);
+    return 2;
+  }
+
+  hostSim_setConsoleEnabled(false);
+  scheduleShots();
+  bool pass = single ? runSingle() : runAmp();
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,535 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Arena simulator: many complete guns playing one game in one process.
+// Each gun runs the real filter, detector, transmitter, trigger and timer code
+// on its own thread (all module state is INSTANCE_LOCAL, see instance.h), with
+// a small two-team game on top: lives, clips, reloads and friendly-fire
+// rejection by frequency.
+//
+// Guns advance in lockstep one simulated millisecond at a time. During
+// millisecond m every gun records its transmitter output; during m + 1 every
+// receiver mixes the other guns' waveforms from m through the optical channel
+// matrix (path loss plus a beam term for the player being aimed at, and stray
+// light otherwise) into its ADC input. The result depends only on the seed,
+// never on thread scheduling, so runs with different worker counts must give
+// identical results; --scaling checks that and reports the speedup.
+//
+// With --slots, players sharing a frequency take turns (shotSlot.h): each gun
+// gets its own slot among the guns on its frequency, every gun syncs to a
+// common epoch, give or take --sync-error-ms, and hits are attributed to the
+// shooter by (frequency, slot). Without slots a hit names a single shooter
+// only when nobody else uses that frequency. Either way the attributable hits
+// per second are reported; --check fails if a hit is pinned on the wrong
+// shooter or, with slots, fewer than 90% of hits name their shooter.
+
+#include <math.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "detector.h"
+#include "filter.h"
+#include "hostSim.h"
+#include "interrupts.h"
+#include "isr.h"
+#include "shotSlot.h"
+#include "transmitter.h"
+#include "trigger.h"
+
+#define DEFAULT_PLAYERS 30
+#define DEFAULT_SIM_SECONDS 600
+#define DEFAULT_SEED 1
+#define MAX_PLAYERS 256
+#define TEAM_COUNT 2
+#define TICKS_PER_MS (HOSTSIM_DEFAULT_TICKS_PER_SECOND / 1000)
+#define MS_PER_SECOND 1000
+#define ADC_MAX_VALUE 4095
+#define TRIGGER_MIO_PIN 10 // Same pin as trigger.c.
+
+// Game rules, as in game.c.
+#define STARTING_LIVES 3
+#define HITS_PER_LIFE 5
+#define STARTING_BULLETS 10
+#define RELOAD_MS 3000
+#define TEAM_A_FREQUENCY 5 // Used by the "game" frequency plan.
+#define TEAM_B_FREQUENCY 8
+
+// Player behaviour.
+#define TRIGGER_HOLD_MS 100 // Longer than the 50 ms trigger debounce.
+#define MIN_SHOT_INTERVAL_MS 500
+#define SHOT_INTERVAL_SPREAD_MS 3000
+
+// Optical channel. Teams start at opposite ends of the field.
+#define FIELD_LENGTH_M 40.0
+#define FIELD_WIDTH_M 20.0
+#define TEAM_AREA_DEPTH_M 10.0
+#define BEAM_AMPLITUDE 1500.0 // ADC counts at the reference distance.
+#define REFERENCE_DISTANCE_M 5.0
+#define STRAY_LIGHT_FRACTION 0.02 // Of the beam, for players not aimed at.
+#define MIN_CHANNEL_GAIN 0.5      // Below this a path is left out of the mix.
+#define NOISE_AMPLITUDE 20
+
+// A hit counts as correctly attributed if a gun on the detected frequency
+// aimed at this player and transmitted within this window.
+#define ATTRIBUTION_WINDOW_MS 400
+
+// Time-division shots: the epoch every gun syncs to, give or take the error.
+#define SYNC_EPOCH_MS 200
+#define MAX_SYNC_ERROR_MS 150
+#define MIN_SHOOTER_ATTRIBUTED_FRACTION 0.9
+
+#define LCG_MULTIPLIER 1664525u
+#define LCG_INCREMENT 1013904223u
+
+typedef enum { PLAN_SPREAD, PLAN_GAME } frequencyPlan_t;
+
+typedef struct {
+  // Set up before the run and read-only afterwards.
+  uint16_t team;
+  uint16_t frequency;
+  uint16_t slot;
+  uint32_t syncMs; // When this gun sees the epoch.
+  double x, y;
+
+  // Written by the owning gun during millisecond m and read by every other
+  // gun during m + 1, hence double-buffered on the parity of m.
+  uint8_t txWave[2][TICKS_PER_MS];
+  bool transmitted[2];
+  int16_t aimTarget[2];
+
+  // Private to the owning gun's thread.
+  uint32_t lcgState;
+  uint16_t adc[TICKS_PER_MS];
+  int64_t litByFrequencyMs[FILTER_FREQUENCY_COUNT];
+  int64_t litByGunMs[MAX_PLAYERS];
+  int16_t currentTarget;
+  uint32_t nextShotMs;
+  uint32_t triggerReleaseMs;
+  uint32_t reloadDoneMs;
+  bool wasPressed;
+
+  // Results.
+  uint32_t shots;
+  uint32_t hitsTaken;
+  uint32_t hitsCorrect;
+  uint32_t hitsByShooter;    // Attributed to the gun that shot...
+  uint32_t hitsWrongShooter; // ...or to one that did not.
+  uint32_t hitsByFrequency[FILTER_FREQUENCY_COUNT];
+  uint8_t bullets;
+  uint8_t livesLeft;
+  uint32_t eliminatedMs;
+} gun_t;
+
+static gun_t guns[MAX_PLAYERS];
+static float beamGain[MAX_PLAYERS][MAX_PLAYERS]; // [receiver][transmitter]
+static float strayGain[MAX_PLAYERS][MAX_PLAYERS];
+static uint16_t playerCount = DEFAULT_PLAYERS;
+static uint32_t simMs = DEFAULT_SIM_SECONDS * MS_PER_SECOND;
+static uint32_t seed = DEFAULT_SEED;
+static frequencyPlan_t plan = PLAN_SPREAD;
+static bool slotsOn = false;
+static uint16_t slotCount; // The same for every gun, 0 with slots off.
+static uint32_t syncErrorMs = 0;
+// The gun each (frequency, slot) names, or -1 for nobody or more than one.
+static int16_t shooterOf[FILTER_FREQUENCY_COUNT][SHOTSLOT_MAX_COUNT];
+
+static pthread_barrier_t msBarrier;
+static sem_t workerSlots;
+
+// The gun owned by the calling thread, the parity of the current millisecond
+// and the tick within it.
+static INSTANCE_LOCAL gun_t *self;
+static INSTANCE_LOCAL uint32_t parity;
+static INSTANCE_LOCAL uint32_t tickInMs;
+
+// Next pseudo-random number from a gun's generator.
+static uint32_t nextRandom(uint32_t *state) {
+  *state = *state * LCG_MULTIPLIER + LCG_INCREMENT;
+  return *state >> 8;
+}
+
+// Deterministic placement, frequencies and channel matrix for a new game.
+static void setupArena(void) {
+  uint32_t state = seed;
+  for (uint16_t i = 0; i < playerCount; i++) {
+    gun_t *gun = &guns[i];
+    memset(gun, 0, sizeof(*gun));
+    gun->team = i % TEAM_COUNT;
+    if (plan == PLAN_GAME)
+      gun->frequency = gun->team ? TEAM_B_FREQUENCY : TEAM_A_FREQUENCY;
+    else // Each team gets half of the frequencies, round robin.
+      gun->frequency = gun->team * (FILTER_FREQUENCY_COUNT / TEAM_COUNT) +
+                       (i / TEAM_COUNT) % (FILTER_FREQUENCY_COUNT / TEAM_COUNT);
+    double depth = (nextRandom(&state) % 1000) / 1000.0 * TEAM_AREA_DEPTH_M;
+    gun->x = gun->team ? FIELD_LENGTH_M - depth : depth;
+    gun->y = (nextRandom(&state) % 1000) / 1000.0 * FIELD_WIDTH_M;
+    gun->lcgState = seed * (i + 1) + i;
+    gun->aimTarget[0] = gun->aimTarget[1] = gun->currentTarget = -1;
+    gun->bullets = STARTING_BULLETS;
+    gun->livesLeft = STARTING_LIVES;
+    gun->nextShotMs = MIN_SHOT_INTERVAL_MS +
+                      nextRandom(&gun->lcgState) % SHOT_INTERVAL_SPREAD_MS;
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+      gun->litByFrequencyMs[f] = -ATTRIBUTION_WINDOW_MS - 1;
+    for (uint16_t tx = 0; tx < MAX_PLAYERS; tx++)
+      gun->litByGunMs[tx] = -ATTRIBUTION_WINDOW_MS - 1;
+  }
+
+  // Slots are handed out in turn among the guns on each frequency, and the
+  // frame is long enough for the most crowded one.
+  uint16_t users[FILTER_FREQUENCY_COUNT] = {0};
+  for (uint16_t i = 0; i < playerCount; i++)
+    guns[i].slot = users[guns[i].frequency]++ % SHOTSLOT_MAX_COUNT;
+  slotCount = 0;
+  for (uint16_t f = 0; slotsOn && f < FILTER_FREQUENCY_COUNT; f++)
+    if (users[f] > slotCount)
+      slotCount = users[f] < SHOTSLOT_MAX_COUNT ? users[f] : SHOTSLOT_MAX_COUNT;
+  memset(shooterOf, 0xff, sizeof(shooterOf));
+  int16_t named[FILTER_FREQUENCY_COUNT][SHOTSLOT_MAX_COUNT] = {{0}};
+  for (uint16_t i = 0; i < playerCount; i++) {
+    uint16_t slot = slotsOn ? guns[i].slot : 0;
+    if (named[guns[i].frequency][slot]++ == 0)
+      shooterOf[guns[i].frequency][slot] = i;
+    else
+      shooterOf[guns[i].frequency][slot] = -1;
+    guns[i].syncMs = SYNC_EPOCH_MS;
+    if (slotsOn)
+      guns[i].syncMs += nextRandom(&state) % (2 * syncErrorMs + 1) - syncErrorMs;
+  }
+  for (uint16_t rx = 0; rx < playerCount; rx++) {
+    for (uint16_t tx = 0; tx < playerCount; tx++) {
+      double dx = guns[rx].x - guns[tx].x, dy = guns[rx].y - guns[tx].y;
+      double distance = fmax(sqrt(dx * dx + dy * dy), REFERENCE_DISTANCE_M);
+      double loss = REFERENCE_DISTANCE_M * REFERENCE_DISTANCE_M /
+                    (distance * distance);
+      beamGain[rx][tx] = rx == tx ? 0 : BEAM_AMPLITUDE * loss;
+      strayGain[rx][tx] = beamGain[rx][tx] * STRAY_LIGHT_FRACTION;
+    }
+  }
+}
+
+// Mix last millisecond's transmitters into this gun's ADC input.
+static void mixOpticalInput(uint16_t id, uint32_t ms) {
+  uint32_t previous = (ms + 1) & 1;
+  float light[TICKS_PER_MS] = {0};
+  for (uint16_t tx = 0; tx < playerCount; tx++) {
+    if (!guns[tx].transmitted[previous])
+      continue;
+    bool aimedAtMe = guns[tx].aimTarget[previous] == id;
+    float gain = aimedAtMe ? beamGain[id][tx] : strayGain[id][tx];
+    if (gain < MIN_CHANNEL_GAIN)
+      continue;
+    if (aimedAtMe && guns[tx].team != guns[id].team) {
+      self->litByFrequencyMs[guns[tx].frequency] = ms;
+      self->litByGunMs[tx] = ms;
+    }
+    const uint8_t *wave = guns[tx].txWave[previous];
+    for (uint32_t t = 0; t < TICKS_PER_MS; t++)
+      light[t] += gain * wave[t];
+  }
+  for (uint32_t t = 0; t < TICKS_PER_MS; t++) {
+    int32_t noise = (int32_t)(nextRandom(&self->lcgState) %
+                              (2 * NOISE_AMPLITUDE + 1)) - NOISE_AMPLITUDE;
+    int32_t value = HOSTSIM_ADC_IDLE_VALUE + (int32_t)light[t] + noise;
+    self->adc[t] = value < 0 ? 0 : value > ADC_MAX_VALUE ? ADC_MAX_VALUE : value;
+  }
+}
+
+// ADC source for the ISR: replay the mixed input and record our own output.
+static uint32_t arenaAdc(void) {
+  uint32_t t = tickInMs++;
+  uint8_t high = hostSim_getMioPin(TRANSMITTER_OUTPUT_PIN);
+  self->txWave[parity][t] = high;
+  self->transmitted[parity] |= high;
+  return self->adc[t];
+}
+
+// Decide what the player does with the trigger this millisecond.
+static void playerBehaviour(uint32_t ms) {
+  gun_t *gun = self;
+  if (ms == gun->triggerReleaseMs)
+    hostSim_setMioPin(TRIGGER_MIO_PIN, 0);
+  if (gun->reloadDoneMs && ms >= gun->reloadDoneMs) {
+    gun->reloadDoneMs = 0;
+    gun->bullets = STARTING_BULLETS;
+    trigger_enable();
+  }
+  if (ms < gun->nextShotMs || gun->livesLeft == 0 || gun->reloadDoneMs)
+    return;
+  // Aim at a random opponent and pull the trigger.
+  uint16_t opponents = 0;
+  for (uint16_t i = 0; i < playerCount; i++)
+    opponents += guns[i].team != gun->team;
+  if (opponents) {
+    uint16_t pick = nextRandom(&gun->lcgState) % opponents;
+    for (uint16_t i = 0; i < playerCount; i++)
+      if (guns[i].team != gun->team && pick-- == 0)
+        gun->currentTarget = i;
+  }
+  hostSim_setMioPin(TRIGGER_MIO_PIN, 1);
+  gun->triggerReleaseMs = ms + TRIGGER_HOLD_MS;
+  gun->nextShotMs = gun->triggerReleaseMs + MIN_SHOT_INTERVAL_MS +
+                    nextRandom(&gun->lcgState) % SHOT_INTERVAL_SPREAD_MS;
+}
+
+// Game rules applied after the detector has run.
+static void gameStep(uint32_t ms) {
+  gun_t *gun = self;
+  bool pressed = trigger_isPressed();
+  if (pressed && !gun->wasPressed && gun->livesLeft) { // A shot went out.
+    gun->shots++;
+    if (--gun->bullets == 0) { // Clip empty: automatic reload.
+      trigger_disable();
+      gun->reloadDoneMs = ms + RELOAD_MS;
+    }
+  }
+  gun->wasPressed = pressed;
+
+  if (!detector_hitDetected())
+    return;
+  detector_clearHit();
+  uint16_t frequency = detector_getFrequencyNumberOfLastHit();
+  gun->hitsTaken++;
+  gun->hitsByFrequency[frequency]++;
+  if (ms - gun->litByFrequencyMs[frequency] <= ATTRIBUTION_WINDOW_MS)
+    gun->hitsCorrect++;
+  int16_t slot = slotsOn ? detector_getSlotOfLastHit() : 0;
+  int16_t shooter = slot == SHOTSLOT_NONE ? -1 : shooterOf[frequency][slot];
+  if (shooter >= 0 && ms - gun->litByGunMs[shooter] <= ATTRIBUTION_WINDOW_MS)
+    gun->hitsByShooter++;
+  else if (shooter >= 0)
+    gun->hitsWrongShooter++;
+  if (gun->hitsTaken % HITS_PER_LIFE == 0 && --gun->livesLeft == 0) {
+    gun->eliminatedMs = ms; // Out of the game: return to base.
+    trigger_disable();
+    detector_ignoreAllHits(true);
+  }
+}
+
+// One gun for the whole game. All module state touched here is thread-local.
+static void *gunThread(void *arg) {
+  uint16_t id = (uint16_t)(uintptr_t)arg;
+  self = &guns[id];
+  hostSim_setConsoleEnabled(false);
+  hostSim_setAdcSource(arenaAdc);
+  filter_init();
+  detector_init();
+  isr_init();
+  interrupts_initAll(false);
+
+  bool ignoredFrequencies[FILTER_FREQUENCY_COUNT] = {false};
+  for (uint16_t i = 0; i < playerCount; i++) // No friendly fire.
+    if (guns[i].team == self->team)
+      ignoredFrequencies[guns[i].frequency] = true;
+  detector_setIgnoredFrequencies(ignoredFrequencies);
+  transmitter_setFrequencyNumber(self->frequency);
+  transmitter_setSlot(self->slot, slotCount);
+  detector_setSlots(slotCount);
+  trigger_enable();
+  interrupts_enableTimerGlobalInts();
+  interrupts_startArmPrivateTimer();
+  interrupts_enableArmInts();
+
+  for (uint32_t ms = 0; ms < simMs; ms++) {
+    sem_wait(&workerSlots);
+    parity = ms & 1;
+    tickInMs = 0;
+    self->transmitted[parity] = false;
+    self->aimTarget[parity] = self->currentTarget;
+    mixOpticalInput(id, ms);
+    if (slotsOn && ms == self->syncMs) {
+      transmitter_syncSlots();
+      detector_syncSlots();
+    }
+    playerBehaviour(ms);
+    hostSim_advanceTicks(TICKS_PER_MS);
+    detector(false); // Same thread as the ISR: nothing to protect.
+    gameStep(ms);
+    sem_post(&workerSlots);
+    pthread_barrier_wait(&msBarrier);
+  }
+  interrupts_disableArmInts();
+  return NULL;
+}
+
+// Run one game with the given number of concurrently running guns.
+// Returns the wall-clock time in seconds, or a negative value on failure.
+static double runGame(uint32_t workers) {
+  setupArena();
+  pthread_t threads[MAX_PLAYERS];
+  pthread_barrier_init(&msBarrier, NULL, playerCount);
+  sem_init(&workerSlots, 0, workers);
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (uint16_t i = 0; i < playerCount; i++) {
+    if (pthread_create(&threads[i], NULL, gunThread, (void *)(uintptr_t)i)) {
+      printf("arena: cannot create thread %u\n", i);
+      exit(1);
+    }
+  }
+  for (uint16_t i = 0; i < playerCount; i++)
+    pthread_join(threads[i], NULL);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  pthread_barrier_destroy(&msBarrier);
+  sem_destroy(&workerSlots);
+  return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// FNV-1a over every result, to compare runs with different worker counts.
+static uint32_t resultChecksum(void) {
+  uint32_t hash = 2166136261u;
+  for (uint16_t i = 0; i < playerCount; i++) {
+    uint32_t fields[] = {guns[i].shots,        guns[i].hitsTaken,   guns[i].hitsCorrect,
+                         guns[i].hitsByShooter, guns[i].livesLeft, guns[i].eliminatedMs};
+    for (uint32_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++)
+      hash = (hash ^ fields[f]) * 16777619u;
+  }
+  return hash;
+}
+
+// Print the results. Returns false if --check finds them wanting.
+static bool printResults(double wallSeconds, uint32_t workers) {
+  double simSeconds = (double)simMs / MS_PER_SECOND;
+  uint32_t totalShots = 0, totalHits = 0, totalCorrect = 0;
+  uint32_t totalByShooter = 0, totalWrongShooter = 0;
+  uint32_t teamAlive[TEAM_COUNT] = {0};
+  printf("player team freq slot   x(m)   y(m)  shots  hits correct shooter lives  out(s)\n");
+  for (uint16_t i = 0; i < playerCount; i++) {
+    gun_t *gun = &guns[i];
+    printf("%6u %4c %4u ", i, 'A' + gun->team, gun->frequency);
+    if (slotsOn)
+      printf("%4u", gun->slot);
+    else
+      printf("   -");
+    printf(" %6.1f %6.1f %6u %5u %7u %7u %5u", gun->x, gun->y, gun->shots,
+           gun->hitsTaken, gun->hitsCorrect, gun->hitsByShooter, gun->livesLeft);
+    if (gun->livesLeft)
+      printf("       -\n");
+    else
+      printf(" %7.1f\n", (double)gun->eliminatedMs / MS_PER_SECOND);
+    totalShots += gun->shots;
+    totalHits += gun->hitsTaken;
+    totalCorrect += gun->hitsCorrect;
+    totalByShooter += gun->hitsByShooter;
+    totalWrongShooter += gun->hitsWrongShooter;
+    teamAlive[gun->team] += gun->livesLeft > 0;
+  }
+  printf("\nhits by detected frequency:");
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    uint32_t count = 0;
+    for (uint16_t i = 0; i < playerCount; i++)
+      count += guns[i].hitsByFrequency[f];
+    printf(" %u", count);
+  }
+  printf("\nshots %u, hits %u, correctly attributed %.1f%%\n", totalShots,
+         totalHits, totalHits ? 100.0 * totalCorrect / totalHits : 0.0);
+  if (slotsOn)
+    printf("%u slots of %u ms, guns synced within +-%u ms\n", slotCount,
+           SHOTSLOT_TICKS / TICKS_PER_MS, syncErrorMs);
+  printf("attributed to the shooter: %u hits, %.2f per second, %u to the wrong one\n",
+         totalByShooter, totalByShooter / simSeconds, totalWrongShooter);
+  printf("players left: team A %u, team B %u\n", teamAlive[0], teamAlive[1]);
+  printf("%u guns x %.1f s simulated in %.2f s wall time with %u workers "
+         "(%.1fx real time, %.1f gun-seconds/s)\n",
+         playerCount, simSeconds, wallSeconds, workers, simSeconds / wallSeconds,
+         playerCount * simSeconds / wallSeconds);
+  printf("result checksum %08x\n", resultChecksum());
+  return totalWrongShooter == 0 &&
+         (!slotsOn || totalByShooter >= MIN_SHOOTER_ATTRIBUTED_FRACTION * totalHits);
+}
+
+// Run the same game with 1, 2, 4, ... workers up to the number of cores.
+// Every run must produce the same results.
+static bool runScaling(uint32_t maxWorkers) {
+  double baseline = 0;
+  uint32_t expected = 0;
+  bool consistent = true;
+  printf("workers  wall(s)  speedup  efficiency  checksum\n");
+  for (uint32_t workers = 1;; workers *= 2) {
+    if (workers > maxWorkers)
+      workers = maxWorkers;
+    double wall = runGame(workers);
+    uint32_t checksum = resultChecksum();
+    if (workers == 1) {
+      baseline = wall;
+      expected = checksum;
+    }
+    consistent = consistent && checksum == expected;
+    printf("%7u %8.2f %8.2f %10.0f%%  %08x%s\n", workers, wall,
+           baseline / wall, 100.0 * baseline / wall / workers, checksum,
+           checksum == expected ? "" : "  MISMATCH");
+    if (workers == maxWorkers)
+      break;
+  }
+  return consistent;
+}
+
+static void printUsage(const char *program) {
+  printf("usage: %s [--players n] [--seconds s] [--workers n] [--seed n]\n"
+         "          [--plan spread|game] [--slots] [--sync-error-ms n] [--scaling]\n"
+         "          [--check]\n",
+         program);
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t cores = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t workers = cores;
+  bool scaling = false, check = false;
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--players") == 0 && hasValue)
+      playerCount = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--seconds") == 0 && hasValue)
+      simMs = (uint32_t)(atof(argv[++i]) * MS_PER_SECOND);
+    else if (strcmp(argv[i], "--workers") == 0 && hasValue)
+      workers = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+      seed = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--plan") == 0 && hasValue) {
+      i++;
+      if (strcmp(argv[i], "spread") == 0)
+        plan = PLAN_SPREAD;
+      else if (strcmp(argv[i], "game") == 0)
+        plan = PLAN_GAME;
+      else {
+        printUsage(argv[0]);
+        return 2;
+      }
+    } else if (strcmp(argv[i], "--slots") == 0)
+      slotsOn = true;
+    else if (strcmp(argv[i], "--sync-error-ms") == 0 && hasValue)
+      syncErrorMs = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--scaling") == 0)
+      scaling = true;
+    else if (strcmp(argv[i], "--check") == 0)
+      check = true;
+    else {
+      printUsage(argv[0]);
+      return 2;
+    }
+  }
+  if (playerCount < TEAM_COUNT || playerCount > MAX_PLAYERS || workers < 1 ||
+      syncErrorMs > MAX_SYNC_ERROR_MS) {
+    printUsage(argv[0]);
+    return 2;
+  }
+  if (scaling)
+    return runScaling(cores) ? 0 : 1;
+  bool passed = printResults(runGame(workers), workers);
+  if (check && !passed)
+    printf("arena: FAILED\n");
+  return check && !passed ? 1 : 0;
+}
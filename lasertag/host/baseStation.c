@@ -0,0 +1,786 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Base station: collects the binary telemetry (telemetry.h) of every gun at an
+// event and keeps a live scoreboard and health view.
+//
+//   baseStation --device /dev/ttyUSB0 --device /dev/ttyUSB1 ... [--port 8080]
+//   baseStation --pty 4                    (prints the pseudo-terminals to feed)
+//   baseStation --replay a.bin b.bin ... --speed 10
+//   baseStation --load-test 60 --seconds 20 --speed 10 --check
+//
+// One thread serves every stream from a single epoll loop. Each stream has a
+// fixed read buffer; frames are COBS-decoded in place where they were read
+// (telemetry_parseFrame()) and their payload fields are read straight out of
+// it, so nothing is copied or allocated per frame and memory is fixed by
+// MAX_STREAMS. Per gun it keeps hits taken, the latest power snapshot, ADC
+// buffer level and high water, detector rate and telemetry losses, and it
+// raises an alert when a gun's ADC buffer nears overrun, when the gun reports
+// dropped telemetry, when frames arrive corrupt, and when a gun goes quiet.
+//
+// The scoreboard is printed every --interval seconds and served as plain text
+// to anything that connects to --port (e.g. curl localhost:8080).
+//
+// --replay plays recorded streams (telemetryDecode --record) into
+// pseudo-terminals at --speed times their recorded pace, from a separate
+// load-generator thread, while the base station reads them as it would serial
+// ports. --load-test does the same with synthetic recordings of n guns, some
+// of which run their ADC buffer close to overrun; with --check it fails
+// unless every frame and hit arrives and exactly those guns raise overrun
+// alerts.
+
+#define _GNU_SOURCE // posix_openpt(), cfmakeraw()
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "filter.h"
+#include "instance.h"
+#include "telemetry.h"
+
+#define MAX_STREAMS 256
+#define STREAM_BUFFER_SIZE 512 // Read size; frames never reach the end of it.
+#define STREAM_NAME_SIZE 48
+#define ALERT_LOG_SIZE 64
+#define ALERT_TEXT_SIZE 96
+#define SCOREBOARD_SIZE (MAX_STREAMS * 160 + ALERT_LOG_SIZE * (ALERT_TEXT_SIZE + 16) + 4096)
+#define DEFAULT_BAUD_RATE B9600
+#define DEFAULT_INTERVAL_S 1.0
+#define DEFAULT_SPEED 10.0
+#define DEFAULT_LOAD_TEST_SECONDS 20
+#define EPOLL_BATCH 64
+#define EPOLL_TIMEOUT_MS 50
+#define END_IDLE_S 0.3 // After the replay ends, quiet for this long means done.
+#define HTTP_RECEIVE_TIMEOUT_US 20000
+#define NANOSECONDS_PER_SECOND 1e9
+
+// Health thresholds.
+#define BUFFER_ALERT_FRACTION 0.9 // Of the ADC buffer: close to overrun.
+#define BUFFER_CLEAR_FRACTION 0.5
+#define STALE_S 3.0 // Wall time without a frame.
+
+// Synthetic guns for --load-test.
+#define SYNTH_TICKS_PER_MS (TELEMETRY_TICKS_PER_SECOND / 1000)
+#define SYNTH_HIT_ONE_IN_MS 1500     // Mean time between hits.
+#define SYNTH_OVERRUN_EVERY 7        // Every seventh gun nears overrun...
+#define SYNTH_OVERRUN_START_MS 4000  // ...for a while, starting here.
+#define SYNTH_OVERRUN_MS 2000
+#define SYNTH_ADC_BUFFER_SIZE 32768
+#define SYNTH_IDLE_ELEMENTS 40
+#define SYNTH_DRAIN_MS 20000
+#define LCG_MULTIPLIER 1664525u
+#define LCG_INCREMENT 1013904223u
+
+typedef struct {
+  char name[STREAM_NAME_SIZE];
+  int fd;
+  bool open;
+  uint8_t buffer[STREAM_BUFFER_SIZE];
+  uint32_t fill;    // Bytes of an unfinished frame at the start of buffer.
+  bool discarding;  // In a run too long to be a frame, up to the next zero.
+
+  uint64_t bytes;
+  uint32_t frames;
+  uint32_t badFrames;
+  uint32_t sequenceGaps;
+  bool haveSequence;
+  uint16_t lastSequence;
+  uint32_t lastTick;
+  uint32_t ticksPerSecond; // From HELLO; 0 until one arrives.
+
+  uint32_t hits; // Taken by this gun.
+  float power[FILTER_FREQUENCY_COUNT];
+  uint32_t bufferElements, bufferSize, bufferHighWater;
+  uint32_t detectorInvocations, profileTick;
+  double detectorRate; // Invocations per gun second, between PROFILE messages.
+  uint32_t telemetryDropped;
+
+  double lastFrameTime;
+  bool bufferAlarm, staleAlarm;
+  uint32_t overrunAlerts;
+} stream_t;
+
+typedef struct {
+  double time;
+  char text[ALERT_TEXT_SIZE];
+} alert_t;
+
+// A recording to replay and its frame boundaries.
+typedef struct {
+  uint8_t *data;
+  uint32_t size, capacity;
+  uint32_t *frameEnd;  // Offset just past each frame's delimiter.
+  uint32_t *frameTick;
+  uint32_t frameCount, frameCapacity;
+  int masterFd;
+  uint32_t nextFrame; // Next frame to write.
+  uint32_t written;   // Bytes written so far.
+  // What the synthetic gun sent.
+  uint32_t expectedFrames, expectedHits;
+  bool expectOverrun;
+} recording_t;
+
+static stream_t streams[MAX_STREAMS];
+static uint32_t streamCount;
+static alert_t alerts[ALERT_LOG_SIZE];
+static uint32_t alertCount; // Ever raised; the log keeps the last ALERT_LOG_SIZE.
+static uint32_t hitsByFrequency[FILTER_FREQUENCY_COUNT];
+static bool quiet;
+static double startTime;
+static volatile sig_atomic_t stopRequested;
+
+static recording_t recordings[MAX_STREAMS];
+static double speed = DEFAULT_SPEED;
+static volatile int replayDone;
+static uint32_t replayStalls; // Writes that found a pseudo-terminal full.
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / NANOSECONDS_PER_SECOND;
+}
+
+static double threadCpuSeconds(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+  return t.tv_sec + t.tv_nsec / NANOSECONDS_PER_SECOND;
+}
+
+static void onSignal(int signal) {
+  (void)signal;
+  stopRequested = 1;
+}
+
+/*****************************************************************************
+***** Alerts and per-gun state
+*****************************************************************************/
+
+static void raiseAlert(const stream_t *stream, const char *format, ...) {
+  alert_t *alert = &alerts[alertCount++ % ALERT_LOG_SIZE];
+  alert->time = now() - startTime;
+  int length = snprintf(alert->text, sizeof(alert->text), "%s: ", stream->name);
+  va_list args;
+  va_start(args, format);
+  vsnprintf(alert->text + length, sizeof(alert->text) - length, format, args);
+  va_end(args);
+  if (!quiet)
+    fprintf(stderr, "ALERT %7.2f s %s\n", alert->time, alert->text);
+}
+
+// Fold one good frame into its gun's state. The payload is read in place.
+static void applyFrame(stream_t *stream, const telemetry_frameView_t *frame) {
+  static const uint16_t minimumPayload[TELEMETRY_MESSAGE_TYPE_COUNT] = {
+      0, TELEMETRY_HELLO_PAYLOAD, TELEMETRY_HIT_PAYLOAD, sizeof(uint32_t),
+      TELEMETRY_BUFFER_PAYLOAD, TELEMETRY_PROFILE_PAYLOAD};
+  if (frame->type == 0 || frame->type >= TELEMETRY_MESSAGE_TYPE_COUNT ||
+      frame->payloadSize < minimumPayload[frame->type]) {
+    stream->badFrames++;
+    return;
+  }
+  const uint8_t *p = frame->payload;
+  if (frame->type == TELEMETRY_MESSAGE_HELLO)
+    stream->haveSequence = false; // The gun restarted.
+  if (stream->haveSequence)
+    stream->sequenceGaps += (uint16_t)(frame->sequence - stream->lastSequence - 1);
+  stream->haveSequence = true;
+  stream->lastSequence = frame->sequence;
+  stream->frames++;
+  stream->lastTick = telemetry_readU32(p, 0);
+
+  switch (frame->type) {
+  case TELEMETRY_MESSAGE_HELLO:
+    stream->ticksPerSecond = telemetry_readU32(p, 4);
+    break;
+  case TELEMETRY_MESSAGE_HIT:
+    stream->hits++;
+    if (p[4] < FILTER_FREQUENCY_COUNT)
+      hitsByFrequency[p[4]]++;
+    break;
+  case TELEMETRY_MESSAGE_POWER:
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT &&
+                         sizeof(uint32_t) + (f + 1) * sizeof(float) <= frame->payloadSize;
+         f++)
+      stream->power[f] = telemetry_readF32(p, sizeof(uint32_t) + f * sizeof(float));
+    break;
+  case TELEMETRY_MESSAGE_BUFFER: {
+    stream->bufferElements = telemetry_readU32(p, 4);
+    stream->bufferSize = telemetry_readU32(p, 8);
+    if (stream->bufferElements > stream->bufferHighWater)
+      stream->bufferHighWater = stream->bufferElements;
+    double fill = stream->bufferSize ? (double)stream->bufferElements / stream->bufferSize : 0;
+    if (!stream->bufferAlarm && fill >= BUFFER_ALERT_FRACTION) {
+      stream->bufferAlarm = true;
+      stream->overrunAlerts++;
+      raiseAlert(stream, "ADC buffer %.0f%% full, near overrun", fill * 100);
+    } else if (stream->bufferAlarm && fill < BUFFER_CLEAR_FRACTION) {
+      stream->bufferAlarm = false;
+    }
+    break;
+  }
+  case TELEMETRY_MESSAGE_PROFILE: {
+    uint32_t tick = stream->lastTick, invocations = telemetry_readU32(p, 8);
+    uint32_t ticksPerSecond =
+        stream->ticksPerSecond ? stream->ticksPerSecond : TELEMETRY_TICKS_PER_SECOND;
+    if (stream->profileTick && tick != stream->profileTick)
+      stream->detectorRate = (double)(invocations - stream->detectorInvocations) *
+                             ticksPerSecond / (tick - stream->profileTick);
+    stream->profileTick = tick;
+    stream->detectorInvocations = invocations;
+    uint32_t dropped = telemetry_readU32(p, 12);
+    if (dropped > stream->telemetryDropped)
+      raiseAlert(stream, "gun dropped %u telemetry frames", dropped - stream->telemetryDropped);
+    stream->telemetryDropped = dropped;
+    break;
+  }
+  }
+}
+
+// Split the bytes just read at their delimiters and decode each complete
+// frame where it lies. Whatever follows the last delimiter moves to the
+// front of the buffer to be completed by the next read.
+static void scanStream(stream_t *stream, uint32_t end, double time) {
+  uint32_t start = 0, position = stream->fill;
+  uint8_t *zero;
+  while ((zero = memchr(stream->buffer + position, 0, end - position))) {
+    uint32_t length = zero - (stream->buffer + start);
+    if (stream->discarding) {
+      stream->badFrames++;
+      stream->discarding = false;
+    } else if (length) {
+      telemetry_frameView_t frame;
+      if (telemetry_parseFrame(stream->buffer + start, length, &frame) == TELEMETRY_DECODE_OK) {
+        applyFrame(stream, &frame);
+        stream->lastFrameTime = time;
+        stream->staleAlarm = false;
+      } else if (stream->badFrames++ == 0) {
+        raiseAlert(stream, "corrupt frames on the link");
+      }
+    }
+    start = position = zero - stream->buffer + 1;
+  }
+  uint32_t remaining = end - start;
+  if (remaining > TELEMETRY_MAX_ENCODED_FRAME) {
+    stream->discarding = true;
+    remaining = 0;
+  }
+  memmove(stream->buffer, stream->buffer + start, remaining);
+  stream->fill = remaining;
+}
+
+// Read everything waiting on a stream. Returns the number of bytes read.
+static uint32_t ingest(stream_t *stream, double time) {
+  uint32_t total = 0;
+  for (;;) {
+    ssize_t count = read(stream->fd, stream->buffer + stream->fill,
+                         STREAM_BUFFER_SIZE - stream->fill);
+    if (count < 0 && (errno == EAGAIN || errno == EINTR))
+      return total;
+    if (count <= 0) { // End of the stream or the device went away.
+      stream->open = false;
+      close(stream->fd);
+      raiseAlert(stream, "stream closed");
+      return total;
+    }
+    stream->bytes += count;
+    total += count;
+    scanStream(stream, stream->fill + count, time);
+  }
+}
+
+static void checkStale(double time) {
+  for (uint32_t i = 0; i < streamCount; i++) {
+    stream_t *stream = &streams[i];
+    if (stream->open && stream->frames && !stream->staleAlarm &&
+        time - stream->lastFrameTime > STALE_S) {
+      stream->staleAlarm = true;
+      raiseAlert(stream, "no telemetry for %.0f s", STALE_S);
+    }
+  }
+}
+
+/*****************************************************************************
+***** Scoreboard
+*****************************************************************************/
+
+// Write the scoreboard and the recent alerts into text. Returns the length.
+static size_t formatScoreboard(char *text, size_t size) {
+  size_t length = 0;
+#define APPEND(...)                                                                 \
+  do {                                                                              \
+    if (length < size)                                                              \
+      length += snprintf(text + length, size - length, __VA_ARGS__);               \
+  } while (0)
+  APPEND("base station: %u guns, %.1f s\n", streamCount, now() - startTime);
+  APPEND("%-20s %6s %6s %5s %5s %8s %7s %6s %6s  %s\n", "gun", "frames", "bad", "gaps",
+         "hits", "det/s", "buffer", "peak", "drops", "status");
+  for (uint32_t i = 0; i < streamCount; i++) {
+    const stream_t *s = &streams[i];
+    double fill = s->bufferSize ? 100.0 * s->bufferElements / s->bufferSize : 0;
+    double peak = s->bufferSize ? 100.0 * s->bufferHighWater / s->bufferSize : 0;
+    APPEND("%-20s %6u %6u %5u %5u %8.0f %6.1f%% %5.1f%% %6u  %s%s%s\n", s->name, s->frames,
+           s->badFrames, s->sequenceGaps, s->hits, s->detectorRate, fill, peak,
+           s->telemetryDropped, s->open ? "" : "closed ", s->bufferAlarm ? "OVERRUN " : "",
+           s->staleAlarm ? "STALE" : "");
+  }
+  APPEND("hits scored by frequency:");
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+    APPEND(" %u:%u", f, hitsByFrequency[f]);
+  APPEND("\nalerts: %u\n", alertCount);
+  uint32_t first = alertCount > ALERT_LOG_SIZE ? alertCount - ALERT_LOG_SIZE : 0;
+  for (uint32_t a = first; a < alertCount; a++)
+    APPEND("  %7.2f s %s\n", alerts[a % ALERT_LOG_SIZE].time, alerts[a % ALERT_LOG_SIZE].text);
+#undef APPEND
+  return length < size ? length : size - 1;
+}
+
+static void printScoreboard(void) {
+  static char text[SCOREBOARD_SIZE];
+  fwrite(text, 1, formatScoreboard(text, sizeof(text)), stdout);
+  fflush(stdout);
+}
+
+// Answer one connection on the scoreboard port with the scoreboard as plain
+// text, whatever was asked.
+static void serveScoreboard(int listenFd) {
+  static char text[SCOREBOARD_SIZE];
+  int client = accept(listenFd, NULL, NULL);
+  if (client < 0)
+    return;
+  struct timeval timeout = {.tv_sec = 0, .tv_usec = HTTP_RECEIVE_TIMEOUT_US};
+  setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  char request[1024];
+  if (recv(client, request, sizeof(request), 0) < 0) // Usually an HTTP GET.
+    request[0] = 0;
+  size_t length = formatScoreboard(text, sizeof(text));
+  char header[128];
+  int headerLength = snprintf(header, sizeof(header),
+                              "HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\n"
+                              "Content-Length: %zu\r\n\r\n",
+                              length);
+  if (write(client, header, headerLength) == headerLength)
+    (void)!write(client, text, length);
+  shutdown(client, SHUT_WR);
+  close(client);
+}
+
+static int openListener(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = htons(port),
+                                .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+  if (fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+      listen(fd, 8) != 0)
+    return -1;
+  return fd;
+}
+
+/*****************************************************************************
+***** Streams
+*****************************************************************************/
+
+// Raw mode: no echo, no line editing, no translation of the binary stream.
+static bool makeRaw(int fd, speed_t baudRate) {
+  struct termios settings;
+  if (tcgetattr(fd, &settings) != 0)
+    return false;
+  cfmakeraw(&settings);
+  cfsetispeed(&settings, baudRate);
+  cfsetospeed(&settings, baudRate);
+  return tcsetattr(fd, TCSANOW, &settings) == 0;
+}
+
+static stream_t *addStream(int fd, const char *name) {
+  if (streamCount == MAX_STREAMS)
+    return NULL;
+  stream_t *stream = &streams[streamCount++];
+  memset(stream, 0, sizeof(*stream));
+  snprintf(stream->name, sizeof(stream->name), "%s", name);
+  stream->fd = fd;
+  stream->open = true;
+  stream->lastFrameTime = now();
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return stream;
+}
+
+static bool addDevice(const char *path) {
+  int fd = open(path, O_RDONLY | O_NOCTTY);
+  if (fd < 0 || (isatty(fd) && !makeRaw(fd, DEFAULT_BAUD_RATE))) {
+    printf("baseStation: cannot open %s: %s\n", path, strerror(errno));
+    return false;
+  }
+  return addStream(fd, strrchr(path, '/') ? strrchr(path, '/') + 1 : path) != NULL;
+}
+
+// A pseudo-terminal whose slave side is read as the gun's serial port. Returns
+// the master side, for the replay to write into, or -1.
+static int addPty(const char *name) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    return -1;
+  int slave = open(ptsname(master), O_RDONLY | O_NOCTTY);
+  if (slave < 0 || !makeRaw(slave, DEFAULT_BAUD_RATE) || !addStream(slave, name))
+    return -1;
+  return master;
+}
+
+// A pseudo-terminal for another program to write a gun's stream into: the
+// master side is read. Returns the path of the slave side, or NULL.
+static const char *addPtyForWriter(const char *name) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    return NULL;
+  // Held open so the master reads nothing, rather than failing, between
+  // writers.
+  int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  if (slave < 0 || !makeRaw(slave, DEFAULT_BAUD_RATE) || !addStream(master, name))
+    return NULL;
+  return ptsname(master);
+}
+
+/*****************************************************************************
+***** Recordings and replay
+*****************************************************************************/
+
+static void appendBytes(recording_t *recording, const uint8_t *data, uint32_t size) {
+  if (recording->size + size > recording->capacity) {
+    recording->capacity = (recording->size + size) * 2;
+    recording->data = realloc(recording->data, recording->capacity);
+  }
+  memcpy(recording->data + recording->size, data, size);
+  recording->size += size;
+}
+
+// Find each frame's end and tick, so the replay can keep the recorded pace.
+static void indexFrames(recording_t *recording) {
+  uint32_t start = 0, tick = 0;
+  for (uint32_t i = 0; i < recording->size; i++) {
+    if (recording->data[i])
+      continue;
+    telemetry_frame_t frame;
+    if (i > start &&
+        telemetry_decodeFrame(recording->data + start, i - start, &frame) == TELEMETRY_DECODE_OK &&
+        frame.payloadSize >= sizeof(uint32_t))
+      tick = telemetry_readU32(frame.payload, 0);
+    if (recording->frameCount == recording->frameCapacity) {
+      recording->frameCapacity = recording->frameCapacity ? recording->frameCapacity * 2 : 256;
+      recording->frameEnd =
+          realloc(recording->frameEnd, recording->frameCapacity * sizeof(uint32_t));
+      recording->frameTick =
+          realloc(recording->frameTick, recording->frameCapacity * sizeof(uint32_t));
+    }
+    recording->frameEnd[recording->frameCount] = i + 1;
+    recording->frameTick[recording->frameCount++] = tick;
+    start = i + 1;
+  }
+}
+
+static bool loadRecording(recording_t *recording, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    printf("baseStation: cannot open %s\n", path);
+    return false;
+  }
+  uint8_t chunk[4096];
+  size_t count;
+  while ((count = fread(chunk, 1, sizeof(chunk), file)))
+    appendBytes(recording, chunk, count);
+  fclose(file);
+  indexFrames(recording);
+  return true;
+}
+
+static INSTANCE_LOCAL recording_t *capturing;
+
+static uint16_t captureWrite(uint8_t *data, uint16_t size) {
+  appendBytes(capturing, data, size);
+  return size;
+}
+
+static uint32_t nextRandom(uint32_t *state) {
+  *state = *state * LCG_MULTIPLIER + LCG_INCREMENT;
+  return *state >> 8;
+}
+
+// What a gun's telemetry would have carried over seconds of play: hits at
+// random, and snapshots every 250 ms, sent at the default rate. Guns picked by
+// SYNTH_OVERRUN_EVERY fill their ADC buffer for a while.
+static void synthesizeRecording(recording_t *recording, uint32_t gun, uint32_t seconds) {
+  capturing = recording;
+  telemetry_init(captureWrite, TELEMETRY_DEFAULT_BYTES_PER_SECOND);
+  uint32_t state = gun * 7919 + 1;
+  uint32_t hitsByFrequencySent[FILTER_FREQUENCY_COUNT] = {0};
+  recording->expectOverrun = gun % SYNTH_OVERRUN_EVERY == SYNTH_OVERRUN_EVERY - 1;
+  uint32_t ms = 0;
+  for (; ms < seconds * 1000; ms++) {
+    uint32_t tick = ms * SYNTH_TICKS_PER_MS;
+    if (nextRandom(&state) % SYNTH_HIT_ONE_IN_MS == 0) {
+      uint16_t frequency = nextRandom(&state) % FILTER_FREQUENCY_COUNT;
+      telemetry_sendHit(tick, frequency, ++hitsByFrequencySent[frequency]);
+      recording->expectedHits++;
+    }
+    if (ms % (TELEMETRY_SNAPSHOT_INTERVAL_TICKS / SYNTH_TICKS_PER_MS) == 0 && ms) {
+      double power[FILTER_FREQUENCY_COUNT];
+      for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+        power[f] = (nextRandom(&state) % 1000) / 1e5;
+      bool overrun = recording->expectOverrun && ms >= SYNTH_OVERRUN_START_MS &&
+                     ms < SYNTH_OVERRUN_START_MS + SYNTH_OVERRUN_MS;
+      uint32_t elements = overrun ? SYNTH_ADC_BUFFER_SIZE - nextRandom(&state) % 1000
+                                  : nextRandom(&state) % SYNTH_IDLE_ELEMENTS;
+      telemetry_sendPower(tick, power);
+      telemetry_sendBuffer(tick, elements, SYNTH_ADC_BUFFER_SIZE);
+      telemetry_sendProfile(tick, tick, tick / SYNTH_TICKS_PER_MS);
+    }
+    telemetry_poll(tick);
+  }
+  for (uint32_t drain = 0; drain < SYNTH_DRAIN_MS; drain++, ms++)
+    telemetry_poll(ms * SYNTH_TICKS_PER_MS);
+  telemetry_stats_t stats;
+  telemetry_getStats(&stats);
+  recording->expectedFrames = stats.framesQueued;
+  if (stats.droppedByType[TELEMETRY_MESSAGE_HIT])
+    recording->expectedHits -= stats.droppedByType[TELEMETRY_MESSAGE_HIT];
+  indexFrames(recording);
+}
+
+// Load generator: writes every recording into its pseudo-terminal, each frame
+// once its recorded tick is due at the replay speed.
+static void *replay(void *arg) {
+  uint32_t count = *(uint32_t *)arg;
+  double start = now();
+  bool pending = true;
+  while (pending && !stopRequested) {
+    pending = false;
+    double due = (now() - start) * speed * TELEMETRY_TICKS_PER_SECOND;
+    for (uint32_t r = 0; r < count; r++) {
+      recording_t *recording = &recordings[r];
+      uint32_t tickBase = recording->frameCount ? recording->frameTick[0] : 0;
+      while (recording->nextFrame < recording->frameCount &&
+             recording->frameTick[recording->nextFrame] - tickBase <= due)
+        recording->nextFrame++;
+      uint32_t end = recording->nextFrame ? recording->frameEnd[recording->nextFrame - 1] : 0;
+      if (recording->written < end) {
+        ssize_t written = write(recording->masterFd, recording->data + recording->written,
+                                end - recording->written);
+        if (written > 0)
+          recording->written += written;
+        if (recording->written < end)
+          replayStalls++;
+      }
+      pending |= recording->written < recording->size;
+    }
+    usleep(1000);
+  }
+  __atomic_store_n(&replayDone, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+/*****************************************************************************
+***** Main loop
+*****************************************************************************/
+
+// Serve every stream and the scoreboard port until stopped, the --seconds
+// limit passes or, when replaying, the replay is done and the streams are
+// quiet. Returns the base station thread's CPU time.
+static double serve(int listenFd, double seconds, double interval, bool replaying) {
+  int epollFd = epoll_create1(0);
+  for (uint32_t i = 0; i < streamCount; i++) {
+    struct epoll_event event = {.events = EPOLLIN, .data.u32 = i};
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, streams[i].fd, &event);
+  }
+  if (listenFd >= 0) {
+    struct epoll_event event = {.events = EPOLLIN, .data.u32 = MAX_STREAMS};
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+  }
+  double cpuStart = threadCpuSeconds();
+  double nextPrint = now() + interval, lastData = now();
+  while (!stopRequested) {
+    struct epoll_event events[EPOLL_BATCH];
+    int ready = epoll_wait(epollFd, events, EPOLL_BATCH, EPOLL_TIMEOUT_MS);
+    double time = now();
+    for (int e = 0; e < ready; e++) {
+      if (events[e].data.u32 == MAX_STREAMS) {
+        serveScoreboard(listenFd);
+        continue;
+      }
+      stream_t *stream = &streams[events[e].data.u32];
+      if (stream->open && ingest(stream, time))
+        lastData = time;
+    }
+    checkStale(time);
+    if (interval > 0 && !quiet && time >= nextPrint) {
+      printScoreboard();
+      nextPrint = time + interval;
+    }
+    if (seconds > 0 && time - startTime >= seconds)
+      break;
+    if (replaying && __atomic_load_n(&replayDone, __ATOMIC_ACQUIRE) &&
+        time - lastData > END_IDLE_S)
+      break;
+  }
+  close(epollFd);
+  return threadCpuSeconds() - cpuStart;
+}
+
+// Every recorded frame and hit must have arrived intact, and exactly the
+// guns that neared overrun must have raised the alert.
+static bool checkLoadTest(uint32_t count) {
+  bool pass = true;
+  for (uint32_t i = 0; i < count; i++) {
+    const stream_t *s = &streams[i];
+    const recording_t *r = &recordings[i];
+    bool ok = s->frames == r->expectedFrames && s->badFrames == 0 && s->sequenceGaps == 0 &&
+              s->hits == r->expectedHits && (s->overrunAlerts > 0) == r->expectOverrun;
+    if (!ok)
+      printf("FAIL %s: frames %u/%u, bad %u, gaps %u, hits %u/%u, overrun alerts %u%s\n",
+             s->name, s->frames, r->expectedFrames, s->badFrames, s->sequenceGaps, s->hits,
+             r->expectedHits, s->overrunAlerts, r->expectOverrun ? " (expected)" : "");
+    pass &= ok;
+  }
+  return pass;
+}
+
+static void printUsage(const char *program) {
+  printf("usage: %s [--device path]... [--pty n] [--port n] [--interval s] [--seconds s]\n"
+         "       %s --replay file... [--speed x] [--port n] [--check]\n"
+         "       %s --load-test guns [--seconds s] [--speed x] [--check]\n"
+         "  common: [--quiet]\n",
+         program, program, program);
+}
+
+int main(int argc, char *argv[]) {
+  double seconds = 0, interval = DEFAULT_INTERVAL_S;
+  uint32_t ptyCount = 0, loadTestGuns = 0, replayCount = 0;
+  int port = -1;
+  bool check = false;
+  const char *replayPaths[MAX_STREAMS];
+  startTime = now();
+  for (int i = 1; i < argc; i++) {
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (strcmp(argv[i], "--quiet") == 0) {
+      quiet = true;
+    } else if (strcmp(argv[i], "--check") == 0) {
+      check = true;
+    } else if (strcmp(argv[i], "--replay") == 0) {
+      while (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0 && replayCount < MAX_STREAMS)
+        replayPaths[replayCount++] = argv[++i];
+    } else if (!value) {
+      printUsage(argv[0]);
+      return 2;
+    } else {
+      if (strcmp(argv[i], "--device") == 0) {
+        if (!addDevice(value))
+          return 1;
+      } else if (strcmp(argv[i], "--pty") == 0) {
+        ptyCount = atoi(value);
+      } else if (strcmp(argv[i], "--port") == 0) {
+        port = atoi(value);
+      } else if (strcmp(argv[i], "--interval") == 0) {
+        interval = atof(value);
+      } else if (strcmp(argv[i], "--seconds") == 0) {
+        seconds = atof(value);
+      } else if (strcmp(argv[i], "--speed") == 0) {
+        speed = atof(value);
+      } else if (strcmp(argv[i], "--load-test") == 0) {
+        loadTestGuns = atoi(value);
+      } else {
+        printUsage(argv[0]);
+        return 2;
+      }
+      i++;
+    }
+  }
+  uint32_t replaying = loadTestGuns ? loadTestGuns : replayCount;
+  if (speed <= 0 || streamCount + ptyCount + replaying > MAX_STREAMS ||
+      (!streamCount && !ptyCount && !replaying)) {
+    printUsage(argv[0]);
+    return 2;
+  }
+  signal(SIGINT, onSignal);
+  signal(SIGPIPE, SIG_IGN);
+
+  for (uint32_t i = 0; i < ptyCount; i++) {
+    char name[STREAM_NAME_SIZE];
+    snprintf(name, sizeof(name), "pty%u", i);
+    const char *path = addPtyForWriter(name);
+    if (!path) {
+      printf("baseStation: cannot open a pseudo-terminal\n");
+      return 1;
+    }
+    printf("%s: write telemetry to %s\n", name, path);
+    fflush(stdout);
+  }
+
+  // Recordings are prepared before the clock starts so the replay runs at
+  // pace from its first frame.
+  for (uint32_t r = 0; r < replaying; r++) {
+    char name[STREAM_NAME_SIZE];
+    if (loadTestGuns) {
+      snprintf(name, sizeof(name), "gun%02u", r);
+      synthesizeRecording(&recordings[r], r, seconds > 0 ? seconds : DEFAULT_LOAD_TEST_SECONDS);
+    } else {
+      const char *slash = strrchr(replayPaths[r], '/');
+      snprintf(name, sizeof(name), "%s", slash ? slash + 1 : replayPaths[r]);
+      if (!loadRecording(&recordings[r], replayPaths[r]))
+        return 1;
+    }
+    recordings[r].masterFd = addPty(name);
+    if (recordings[r].masterFd < 0) {
+      printf("baseStation: cannot open a pseudo-terminal\n");
+      return 1;
+    }
+    fcntl(recordings[r].masterFd, F_SETFL,
+          fcntl(recordings[r].masterFd, F_GETFL) | O_NONBLOCK);
+  }
+
+  int listenFd = -1;
+  if (port >= 0 && (listenFd = openListener(port)) < 0) {
+    printf("baseStation: cannot listen on port %d\n", port);
+    return 1;
+  }
+
+  pthread_t replayThread;
+  startTime = now();
+  if (replaying)
+    pthread_create(&replayThread, NULL, replay, &replaying);
+  double cpuSeconds = serve(listenFd, replaying ? 0 : seconds, interval, replaying);
+  double wall = now() - startTime;
+  if (replaying)
+    pthread_join(replayThread, NULL);
+
+  printScoreboard();
+  uint64_t bytes = 0, frames = 0;
+  for (uint32_t i = 0; i < streamCount; i++) {
+    bytes += streams[i].bytes;
+    frames += streams[i].frames;
+  }
+  printf("%u streams, %lu frames, %lu bytes in %.2f s: %.0f frames/s\n", streamCount,
+         (unsigned long)frames, (unsigned long)bytes, wall, frames / wall);
+  printf("base station thread: %.3f s CPU, %.1f%% of one core, %.0f ns/frame\n", cpuSeconds,
+         cpuSeconds / wall * 100, frames ? cpuSeconds * NANOSECONDS_PER_SECOND / frames : 0);
+  printf("fixed state: %zu bytes for up to %u streams\n", sizeof(streams) + sizeof(alerts),
+         MAX_STREAMS);
+  if (replaying)
+    printf("replay at %.0fx: %u writes found a pseudo-terminal full\n", speed, replayStalls);
+  if (check && loadTestGuns && !checkLoadTest(loadTestGuns))
+    return 1;
+  return 0;
+}
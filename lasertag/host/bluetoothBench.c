@@ -0,0 +1,213 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Throughput and cost of the Bluetooth driver (bluetooth/bluetooth.c) on the
+// simulated UART Lite. The peer streams lower-case text at the full line rate
+// and the main loop echoes it back in upper case in batches, as the
+// bluetoothTest program does. Each line rate runs twice:
+//
+//   interrupt  bluetooth_uartIsr() connected to the UART interrupt.
+//   poll       bluetooth_poll() every 5 ms from the timer, as without it.
+//
+// For each run the peer checks every echoed byte, and the report gives the
+// echo throughput as a share of the line rate, bytes lost to receive-FIFO
+// overruns and to a full receive queue, driver calls per byte and host time in
+// the driver per byte. --check fails unless the interrupt runs are lossless at
+// every rate and the 9600 baud polled run is too.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bluetooth.h"
+#include "hostSim.h"
+#include "interrupts.h"
+
+#define TICKS_PER_SECOND HOSTSIM_DEFAULT_TICKS_PER_SECOND
+#define TICKS_PER_MS (TICKS_PER_SECOND / 1000)
+#define MS_PER_SECOND 1000
+#define DEFAULT_SECONDS 2
+#define POLL_INTERVAL_TICKS (5 * TICKS_PER_MS)
+#define DRAIN_MS 100 // After the peer stops, time for the last echoes.
+#define ECHO_BATCH_SIZE 256
+// The peer keeps a little over a millisecond of bytes queued so the line never
+// idles, and little enough that all of it is echoed during the drain.
+#define PEER_BACKLOG_MS 2
+#define LOSSLESS_THROUGHPUT 0.95 // Echo share of the line rate that counts as full speed.
+#define NANOSECONDS_PER_SECOND 1e9
+
+static const uint32_t baudRates[] = {9600, 115200, 460800, 921600};
+#define BAUD_RATE_COUNT (sizeof(baudRates) / sizeof(baudRates[0]))
+
+typedef struct {
+  uint32_t sent;        // By the peer.
+  uint32_t echoed;      // Received back by the peer while it was sending.
+  uint32_t echoedTotal; // Including the drain.
+  uint32_t mismatches;  // Echoed bytes that were not the expected ones.
+  uint32_t overruns;
+  uint32_t dropped;
+  uint32_t serviceCalls;
+  double driverSeconds;
+} result_t;
+
+static uint32_t simMs = DEFAULT_SECONDS * MS_PER_SECOND;
+static double driverSeconds;
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / NANOSECONDS_PER_SECOND;
+}
+
+// Byte n of the peer's stream.
+static uint8_t streamByte(uint32_t n) { return 'a' + n % 26; }
+
+// The UART interrupt, timed.
+static void timedIsr(void *callBackRef) {
+  double start = now();
+  bluetooth_uartIsr(callBackRef);
+  driverSeconds += now() - start;
+}
+
+// The legacy timer ISR: poll every POLL_INTERVAL_TICKS, timed.
+static void pollTick(void) {
+  if (hostSim_getTickCount() % POLL_INTERVAL_TICKS)
+    return;
+  double start = now();
+  bluetooth_poll();
+  driverSeconds += now() - start;
+}
+
+// One millisecond of the main loop: echo what has arrived in upper case.
+// Bytes the transmit queue cannot take yet wait in pending.
+static void echo(uint8_t pending[], uint16_t *pendingCount) {
+  double start = now();
+  if (*pendingCount == 0) {
+    *pendingCount = bluetooth_receiveQueueRead(pending, ECHO_BATCH_SIZE);
+    for (uint16_t i = 0; i < *pendingCount; i++)
+      pending[i] -= 'a' - 'A';
+  }
+  uint16_t written = bluetooth_transmitQueueWrite(pending, *pendingCount);
+  memmove(pending, pending + written, *pendingCount - written);
+  *pendingCount -= written;
+  driverSeconds += now() - start;
+}
+
+// The peer checks what comes back.
+static void collectEchoes(result_t *result, bool sending) {
+  uint8_t data[ECHO_BATCH_SIZE];
+  uint32_t count;
+  while ((count = hostSim_uartPeerReceive(data, sizeof(data)))) {
+    for (uint32_t i = 0; i < count; i++)
+      result->mismatches += data[i] != streamByte(result->echoedTotal + i) - ('a' - 'A');
+    result->echoedTotal += count;
+    if (sending)
+      result->echoed += count;
+  }
+}
+
+static void run(uint32_t baudRate, bool polled, result_t *result) {
+  memset(result, 0, sizeof(*result));
+  hostSim_uartSetBaudRate(baudRate);
+  interrupts_disableArmInts();
+  bluetooth_init();
+  if (polled) {
+    bluetooth_usePolling();
+    hostSim_setTickHook(pollTick);
+  } else {
+    hostSim_uartConnectIsr(timedIsr, NULL);
+    hostSim_setTickHook(NULL);
+  }
+  interrupts_enableArmInts();
+  driverSeconds = 0;
+
+  uint32_t backlog = baudRate / 10 * PEER_BACKLOG_MS / MS_PER_SECOND + 1;
+  uint8_t pending[ECHO_BATCH_SIZE];
+  uint16_t pendingCount = 0;
+  for (uint32_t ms = 0; ms < simMs + DRAIN_MS; ms++) {
+    bool sending = ms < simMs;
+    while (sending && hostSim_uartPeerPending() < backlog) {
+      uint8_t byte = streamByte(result->sent);
+      result->sent += hostSim_uartPeerSend(&byte, 1);
+    }
+    hostSim_advanceTicks(TICKS_PER_MS);
+    echo(pending, &pendingCount);
+    collectEchoes(result, sending);
+  }
+
+  bluetooth_stats_t stats;
+  bluetooth_getStats(&stats);
+  result->overruns = hostSim_uartGetOverrunCount();
+  result->dropped = stats.receiveDropped;
+  result->serviceCalls = stats.serviceCalls;
+  result->driverSeconds = driverSeconds;
+  hostSim_setTickHook(NULL);
+  interrupts_disableArmInts();
+}
+
+// All sent bytes came back, in order.
+static bool lossless(const result_t *result) {
+  return result->echoedTotal == result->sent && result->mismatches == 0;
+}
+
+static void report(uint32_t baudRate, bool polled, const result_t *result) {
+  double lineBytesPerSecond = baudRate / 10.0;
+  double throughput = result->echoed / ((double)simMs / MS_PER_SECOND);
+  uint32_t bytes = result->echoedTotal ? result->echoedTotal : 1;
+  printf("%7u %-9s %9.0f %6.1f%% %8u %8u %8u %8.3f %8.0f%s\n", baudRate,
+         polled ? "poll" : "interrupt", throughput,
+         throughput / lineBytesPerSecond * 100, result->overruns, result->dropped,
+         result->mismatches, (double)result->serviceCalls / bytes,
+         result->driverSeconds * NANOSECONDS_PER_SECOND / bytes,
+         lossless(result) ? "" : "  LOSSY");
+}
+
+static void printUsage(const char *program) {
+  printf("usage: %s [--seconds n] [--check]\n", program);
+}
+
+int main(int argc, char *argv[]) {
+  bool check = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--check") == 0) {
+      check = true;
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      simMs = atof(argv[++i]) * MS_PER_SECOND;
+    } else {
+      printUsage(argv[0]);
+      return 2;
+    }
+  }
+  if (!simMs) {
+    printUsage(argv[0]);
+    return 2;
+  }
+
+  hostSim_setConsoleEnabled(false);
+  printf("echo over %.1f simulated s per run\n", (double)simMs / MS_PER_SECOND);
+  printf("%7s %-9s %9s %7s %8s %8s %8s %8s %8s\n", "baud", "driver", "bytes/s",
+         "line", "overrun", "dropped", "wrong", "calls/B", "ns/B");
+  bool pass = true;
+  for (uint32_t b = 0; b < BAUD_RATE_COUNT; b++) {
+    for (int polled = 0; polled < 2; polled++) {
+      result_t result;
+      run(baudRates[b], polled, &result);
+      report(baudRates[b], polled, &result);
+      double share = result.echoed / ((double)simMs / MS_PER_SECOND) / (baudRates[b] / 10.0);
+      if (!polled || b == 0)
+        pass &= lossless(&result) && share >= LOSSLESS_THROUGHPUT;
+    }
+  }
+  if (check && !pass) {
+    printf("FAIL: echo is not lossless at full line rate\n");
+    return 1;
+  }
+  return 0;
+}
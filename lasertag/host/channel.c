@@ -0,0 +1,215 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "channel.h"
+#include "filter.h"
+#include "sampleRate.h"
+#include "shotCode.h"
+
+#define DEFAULT_REFERENCE_DISTANCE_M 5.0
+#define DEFAULT_REFERENCE_AMPLITUDE 1000.0
+#define DEFAULT_MAINS_HZ 60.0
+#define DEFAULT_NOISE_SIGMA 4.0
+#define DEFAULT_SEED 1
+
+#define PHASE_FRACTION_BITS 32 // Flicker phase is a 32-bit fraction of a period.
+#define FLICKER_TABLE_SHIFT (PHASE_FRACTION_BITS - 10)
+#define NOISE_TABLE_SHIFT (64 - 10)
+#define INVERSE_CDF_ITERATIONS 60
+#define INVERSE_CDF_LIMIT 10.0
+
+// splitmix64 finalizer: a good 64-bit hash of the sample index, so the noise
+// for any sample can be computed on its own.
+static inline uint64_t mix64(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+// Standard normal quantile by bisection. Only used to build the table.
+static double inverseNormalCdf(double p) {
+  double low = -INVERSE_CDF_LIMIT, high = INVERSE_CDF_LIMIT;
+  for (int i = 0; i < INVERSE_CDF_ITERATIONS; i++) {
+    double mid = (low + high) / 2;
+    if (0.5 * erfc(-mid / sqrt(2.0)) < p)
+      low = mid;
+    else
+      high = mid;
+  }
+  return (low + high) / 2;
+}
+
+// Fill in a configuration for a quiet indoor range: mid-scale offset, a
+// little noise, no flicker, no sunlight and no shooters.
+void channel_initConfig(channel_config_t *config) {
+  memset(config, 0, sizeof(*config));
+  config->sampleRateHz = CHANNEL_DEFAULT_SAMPLE_RATE;
+  config->referenceDistanceM = DEFAULT_REFERENCE_DISTANCE_M;
+  config->referenceAmplitude = DEFAULT_REFERENCE_AMPLITUDE;
+  config->mainsHz = DEFAULT_MAINS_HZ;
+  config->noiseSigma = DEFAULT_NOISE_SIGMA;
+  config->adcBits = CHANNEL_DEFAULT_ADC_BITS;
+  config->adcOffset = 1 << (CHANNEL_DEFAULT_ADC_BITS - 1);
+  config->seed = DEFAULT_SEED;
+}
+
+// Add a shooter to the configuration. Returns false if the table is full.
+bool channel_addShooter(channel_config_t *config, uint16_t frequencyNumber,
+                        double distanceM, double startS, double durationS) {
+  if (config->shooterCount == CHANNEL_MAX_SHOOTERS ||
+      frequencyNumber >= FILTER_FREQUENCY_COUNT)
+    return false;
+  channel_shooter_t *shooter = &config->shooters[config->shooterCount++];
+  shooter->frequencyNumber = frequencyNumber;
+  shooter->distanceM = distanceM;
+  shooter->startS = startS;
+  shooter->durationS = durationS;
+  shooter->code = SHOTCODE_NONE;
+  return true;
+}
+
+// Add a shooter that sends the coded burst for id.
+bool channel_addCodedShooter(channel_config_t *config, uint16_t frequencyNumber,
+                             double distanceM, double startS, int16_t id) {
+  double durationS = (double)SHOTCODE_FRAME_CHIPS * SHOTCODE_TICKS_PER_CHIP /
+                     SAMPLE_RATE_REFERENCE_HZ;
+  if (!channel_addShooter(config, frequencyNumber, distanceM, startS, durationS))
+    return false;
+  config->shooters[config->shooterCount - 1].code = id;
+  return true;
+}
+
+// Returns the amplitude, in ADC counts, of a shot from the given distance.
+double channel_pathLoss(const channel_config_t *config, double distanceM) {
+  double ratio = config->referenceDistanceM / distanceM;
+  return config->referenceAmplitude * ratio * ratio;
+}
+
+// Start a channel at sample 0 with a copy of the configuration.
+void channel_init(channel_t *channel, const channel_config_t *config) {
+  channel->config = *config;
+  channel->sampleIndex = 0;
+  channel->clippedSamples = 0;
+  // A rectified sine repeats twice per mains cycle; the table holds one mains
+  // cycle so the phase step is simply mains / rate.
+  channel->flickerStep = (uint64_t)ldexp(config->mainsHz / config->sampleRateHz,
+                                         PHASE_FRACTION_BITS);
+  for (uint32_t i = 0; i < CHANNEL_FLICKER_TABLE_SIZE; i++)
+    channel->flickerTable[i] =
+        config->flickerAmplitude *
+        fabs(sin(2 * M_PI * (i + 0.5) / CHANNEL_FLICKER_TABLE_SIZE));
+  for (uint32_t i = 0; i < CHANNEL_NOISE_TABLE_SIZE; i++)
+    channel->noiseTable[i] =
+        config->noiseSigma *
+        inverseNormalCdf((i + 0.5) / CHANNEL_NOISE_TABLE_SIZE);
+  channel_setShooters(channel, config->shooters, config->shooterCount);
+}
+
+// Replace the shooters of an initialized channel. The noise and flicker tables
+// are kept.
+bool channel_setShooters(channel_t *channel, const channel_shooter_t shooters[],
+                         uint16_t count) {
+  channel_config_t *config = &channel->config;
+  if (count > CHANNEL_MAX_SHOOTERS)
+    return false;
+  memmove(config->shooters, shooters, count * sizeof(shooters[0]));
+  config->shooterCount = count;
+  for (uint16_t s = 0; s < count; s++) {
+    const channel_shooter_t *shooter = &config->shooters[s];
+    channel->shotStart[s] = (uint64_t)llround(shooter->startS * config->sampleRateHz);
+    channel->shotEnd[s] = channel->shotStart[s] +
+                          (uint64_t)llround(shooter->durationS * config->sampleRateHz);
+    channel->shotAmplitude[s] = channel_pathLoss(config, shooter->distanceM);
+  }
+  return true;
+}
+
+// Light for one block: ambient, noise and every shooter that overlaps it.
+static void generateBlock(const channel_t *channel, uint64_t first,
+                          float light[], uint32_t count) {
+  const channel_config_t *config = &channel->config;
+  float dc = config->adcOffset + config->sunlight;
+  uint64_t seed = mix64(config->seed);
+  for (uint32_t i = 0; i < count; i++) {
+    uint64_t n = first + i;
+    uint32_t phase = (uint32_t)(n * channel->flickerStep);
+    light[i] = dc + channel->noiseTable[mix64(seed + n) >> NOISE_TABLE_SHIFT] +
+               channel->flickerTable[phase >> FLICKER_TABLE_SHIFT];
+  }
+  uint64_t last = first + count;
+  for (uint16_t s = 0; s < config->shooterCount; s++) {
+    uint64_t start = channel->shotStart[s], end = channel->shotEnd[s];
+    if (end <= first || start >= last)
+      continue;
+    uint64_t from = start > first ? start : first;
+    uint64_t to = end < last ? end : last;
+    uint16_t period = sampleRate_ticksAt(
+        config->sampleRateHz, filter_frequencyTickTable[config->shooters[s].frequencyNumber]);
+    uint16_t halfPeriod = period / 2;
+    uint16_t position = (from - start) % period;
+    float amplitude = channel->shotAmplitude[s];
+    int16_t code = config->shooters[s].code;
+    if (code == SHOTCODE_NONE) {
+      for (uint64_t n = from; n < to; n++) {
+        if (position < halfPeriod)
+          light[n - first] += amplitude;
+        if (++position == period)
+          position = 0;
+      }
+      continue;
+    }
+    // Coded: the carrier is keyed a chip at a time, as the transmitter does.
+    // shotCode_carrierOn() counts ticks at the gun's rate.
+    uint8_t frame = shotCode_encode(code);
+    uint32_t gunHz = sampleRate_getHz();
+    for (uint64_t n = from; n < to; n++) {
+      uint64_t tick = n - start;
+      if (gunHz != config->sampleRateHz)
+        tick = tick * gunHz / config->sampleRateHz;
+      if (position < halfPeriod && shotCode_carrierOn(frame, tick))
+        light[n - first] += amplitude;
+      if (++position == period)
+        position = 0;
+    }
+  }
+}
+
+// Produce the next count ADC samples.
+void channel_generate(channel_t *channel, uint16_t samples[], uint32_t count) {
+  float light[CHANNEL_BLOCK_SIZE];
+  int32_t maxCode = (1 << channel->config.adcBits) - 1;
+  while (count) {
+    uint32_t blockSize = count < CHANNEL_BLOCK_SIZE ? count : CHANNEL_BLOCK_SIZE;
+    generateBlock(channel, channel->sampleIndex, light, blockSize);
+    uint32_t clipped = 0;
+    for (uint32_t i = 0; i < blockSize; i++) {
+      int32_t code = (int32_t)(light[i] + 0.5f); // Negatives clip anyway.
+      clipped += (code <= 0) | (code >= maxCode);
+      code = code < 0 ? 0 : code;
+      samples[i] = code > maxCode ? maxCode : code;
+    }
+    channel->clippedSamples += clipped;
+    channel->sampleIndex += blockSize;
+    samples += blockSize;
+    count -= blockSize;
+  }
+}
+
+// Move to any sample index without generating the samples in between.
+void channel_seek(channel_t *channel, uint64_t sampleIndex) {
+  channel->sampleIndex = sampleIndex;
+}
+
+// Returns how many samples hit either ADC rail so far.
+uint64_t channel_getClippedSampleCount(const channel_t *channel) {
+  return channel->clippedSamples;
+}
@@ -0,0 +1,108 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef CHANNEL_H_
+#define CHANNEL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Optical channel model that produces realistic ADC sample streams for host
+// tests, benchmarks and captures. The light on the sensor is the sum of
+// - any number of shooters, each a square wave at a user frequency whose
+//   amplitude falls off with the square of the distance,
+// - fluorescent flicker: a rectified mains sine, i.e. 100 Hz or 120 Hz,
+// - sunlight, a constant offset,
+// - Gaussian noise,
+// and is then quantized by an ADC with the given number of bits, clipping at
+// both rails. Samples are generated a block at a time with straight-line loops
+// the compiler can vectorize.
+//
+// A channel is an object like queue_t: several can be used at once, e.g. one
+// per simulated gun or per replay thread. The noise and flicker are computed
+// from the sample index, so the same configuration and seed always produce the
+// same sample at a given index, however the stream was split into calls.
+
+#define CHANNEL_MAX_SHOOTERS 32
+#define CHANNEL_DEFAULT_SAMPLE_RATE 100000
+#define CHANNEL_DEFAULT_ADC_BITS 12
+#define CHANNEL_BLOCK_SIZE 256
+#define CHANNEL_NOISE_TABLE_SIZE 1024   // Inverse normal CDF, pre-scaled.
+#define CHANNEL_FLICKER_TABLE_SIZE 1024 // One mains period of |sin|.
+
+typedef struct {
+  uint16_t frequencyNumber; // Index into filter_frequencyTickTable.
+  double distanceM;         // Distance from the shooter to the sensor.
+  double startS;            // When the shot starts.
+  double durationS;         // Length of the shot (200 ms for a normal shot).
+  int16_t code;             // Shooter ID keyed onto the burst, or SHOTCODE_NONE.
+} channel_shooter_t;
+
+typedef struct {
+  uint32_t sampleRateHz;
+  double referenceDistanceM; // A shot from this distance has...
+  double referenceAmplitude; // ...this peak amplitude, in ADC counts.
+  double mainsHz;            // 50 or 60; the flicker is at twice this.
+  double flickerAmplitude;   // Peak flicker, in ADC counts.
+  double sunlight;           // DC from ambient light, in ADC counts.
+  double noiseSigma;         // Standard deviation of the noise, in ADC counts.
+  double adcOffset;          // ADC reading with no light on the sensor.
+  uint16_t adcBits;
+  uint64_t seed;
+  uint16_t shooterCount;
+  channel_shooter_t shooters[CHANNEL_MAX_SHOOTERS];
+} channel_config_t;
+
+typedef struct {
+  channel_config_t config;
+  uint64_t sampleIndex;  // Index of the next sample to be generated.
+  uint64_t flickerStep;  // 32-bit fixed-point mains phase per sample.
+  float noiseTable[CHANNEL_NOISE_TABLE_SIZE];
+  float flickerTable[CHANNEL_FLICKER_TABLE_SIZE];
+  uint64_t shotStart[CHANNEL_MAX_SHOOTERS]; // Shot windows in samples.
+  uint64_t shotEnd[CHANNEL_MAX_SHOOTERS];
+  float shotAmplitude[CHANNEL_MAX_SHOOTERS];
+  uint64_t clippedSamples;
+} channel_t;
+
+// Fill in a configuration for a quiet indoor range: mid-scale offset, a
+// little noise, no flicker, no sunlight and no shooters.
+void channel_initConfig(channel_config_t *config);
+
+// Add a shooter to the configuration. Returns false if the table is full.
+bool channel_addShooter(channel_config_t *config, uint16_t frequencyNumber,
+                        double distanceM, double startS, double durationS);
+
+// Add a shooter that sends the coded burst for id (shotCode.h), one sample
+// per transmitter tick. Returns false if the table is full.
+bool channel_addCodedShooter(channel_config_t *config, uint16_t frequencyNumber,
+                             double distanceM, double startS, int16_t id);
+
+// Start a channel at sample 0 with a copy of the configuration.
+void channel_init(channel_t *channel, const channel_config_t *config);
+
+// Replace the shooters of an initialized channel, e.g. to script a long
+// capture a section at a time. Cheaper than channel_init(): the noise and
+// flicker tables are kept.
+bool channel_setShooters(channel_t *channel, const channel_shooter_t shooters[],
+                         uint16_t count);
+
+// Produce the next count ADC samples.
+void channel_generate(channel_t *channel, uint16_t samples[], uint32_t count);
+
+// Move to any sample index without generating the samples in between.
+void channel_seek(channel_t *channel, uint64_t sampleIndex);
+
+// Returns how many samples hit either ADC rail so far.
+uint64_t channel_getClippedSampleCount(const channel_t *channel);
+
+// Returns the amplitude, in ADC counts, of a shot from the given distance.
+double channel_pathLoss(const channel_config_t *config, double distanceM);
+
+#endif /* CHANNEL_H_ */
@@ -0,0 +1,111 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Writes a synthetic capture produced by the channel model: raw 16-bit
+// little-endian ADC samples at 100 kHz, the same format as range captures.
+// Without --out it only measures how fast samples can be generated.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "channel.h"
+
+#define DEFAULT_SECONDS 60
+#define CHUNK_SAMPLES (64 * 1024)
+
+static void printUsage(const char *program) {
+  printf("usage: %s [--seconds s] [--out file] [--seed n]\n"
+         "          [--shot freq:distance_m:start_s:duration_s]...\n"
+         "          [--flicker amplitude] [--mains 50|60] [--sun dc]\n"
+         "          [--noise sigma] [--bits n] [--amplitude counts_at_5m]\n",
+         program);
+}
+
+int main(int argc, char *argv[]) {
+  channel_config_t config;
+  channel_initConfig(&config);
+  double seconds = DEFAULT_SECONDS;
+  const char *outPath = NULL;
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    const char *value = hasValue ? argv[i + 1] : NULL;
+    unsigned frequency;
+    double distance, start, duration;
+    if (!hasValue) {
+      printUsage(argv[0]);
+      return 2;
+    }
+    if (strcmp(argv[i], "--seconds") == 0)
+      seconds = atof(value);
+    else if (strcmp(argv[i], "--out") == 0)
+      outPath = value;
+    else if (strcmp(argv[i], "--seed") == 0)
+      config.seed = strtoull(value, NULL, 0);
+    else if (strcmp(argv[i], "--flicker") == 0)
+      config.flickerAmplitude = atof(value);
+    else if (strcmp(argv[i], "--mains") == 0)
+      config.mainsHz = atof(value);
+    else if (strcmp(argv[i], "--sun") == 0)
+      config.sunlight = atof(value);
+    else if (strcmp(argv[i], "--noise") == 0)
+      config.noiseSigma = atof(value);
+    else if (strcmp(argv[i], "--bits") == 0)
+      config.adcBits = atoi(value);
+    else if (strcmp(argv[i], "--amplitude") == 0)
+      config.referenceAmplitude = atof(value);
+    else if (strcmp(argv[i], "--shot") == 0 &&
+             sscanf(value, "%u:%lf:%lf:%lf", &frequency, &distance, &start,
+                    &duration) == 4 &&
+             channel_addShooter(&config, frequency, distance, start, duration))
+      ;
+    else {
+      printUsage(argv[0]);
+      return 2;
+    }
+    i++;
+  }
+
+  FILE *out = NULL;
+  if (outPath && !(out = fopen(outPath, "wb"))) {
+    printf("channelGen: cannot open %s\n", outPath);
+    return 1;
+  }
+  channel_t channel;
+  channel_init(&channel, &config);
+  static uint16_t samples[CHUNK_SAMPLES];
+  uint64_t total = (uint64_t)(seconds * config.sampleRateHz);
+  double generateSeconds = 0;
+  for (uint64_t done = 0; done < total;) {
+    uint32_t count = total - done < CHUNK_SAMPLES ? total - done : CHUNK_SAMPLES;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    channel_generate(&channel, samples, count);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    generateSeconds +=
+        (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    // Samples are written in host order, which is little-endian on every
+    // machine this runs on (and on the Zynq).
+    if (out && fwrite(samples, sizeof(samples[0]), count, out) != count) {
+      printf("channelGen: write to %s failed\n", outPath);
+      return 1;
+    }
+    done += count;
+  }
+  if (out)
+    fclose(out);
+  printf("%.1f s of ADC data (%llu samples, %llu clipped) generated in %.3f s: "
+         "%.1f M samples/s, %.0fx real time\n",
+         seconds, (unsigned long long)total,
+         (unsigned long long)channel_getClippedSampleCount(&channel),
+         generateSeconds, total / generateSeconds / 1e6,
+         seconds / generateSeconds);
+  return 0;
+}
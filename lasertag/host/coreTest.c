@@ -0,0 +1,770 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Host tests for the lasertag core. Run with the name of a test as the only
+// argument; the exit status is non-zero if the test fails. Each test is
+// registered with CTest in CMakeLists.txt.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "channel.h"
+#include "detector.h"
+#include "autoReloadTimer.h"
+#include "buttons.h"
+#include "display.h"
+#include "filter.h"
+#include "filterCoefficients.h"
+#include "filterDesign.h"
+#include "gameEngine.h"
+#include "hostSim.h"
+#include "interrupts.h"
+#include "isr.h"
+#include "journal.h"
+#include "sampleRate.h"
+#include "queueTest.h"
+#include "scope.h"
+#include "shotCode.h"
+#include "shotSlot.h"
+#include "telemetry.h"
+#include "transmitter.h"
+#include "trigger.h"
+
+// ADC reading while the transmitter LED is lit. The receiver sees an offset
+// square wave, like a real shot at moderate range.
+#define LOOPBACK_ADC_HIGH_VALUE 3000
+#define LOOPBACK_SETTLE_MS 300 // Long enough to flush the 200 ms power window.
+#define LOOPBACK_RUN_MS 500
+#define LOOPBACK_TICKS_PER_DETECTOR_CALL 100
+
+#define INTERRUPTS_CURRENTLY_ENABLED true
+
+// Feed the transmitter output straight back into the ADC.
+static uint32_t loopbackAdcSource(void) {
+  return hostSim_getMioPin(TRANSMITTER_OUTPUT_PIN) ? LOOPBACK_ADC_HIGH_VALUE
+                                                   : HOSTSIM_ADC_IDLE_VALUE;
+}
+
+// Run the ISR and detector together for ms milliseconds of simulated time.
+static void runDetectorFor(uint32_t ms) {
+  uint32_t ticks = ms * (sampleRate_getHz() / 1000);
+  for (uint32_t i = 0; i < ticks; i += LOOPBACK_TICKS_PER_DETECTOR_CALL) {
+    hostSim_advanceTicks(LOOPBACK_TICKS_PER_DETECTOR_CALL);
+    detector(INTERRUPTS_CURRENTLY_ENABLED);
+  }
+}
+
+// Transmit continuously on each frequency in turn with the transmitter looped
+// back into the ADC. The detector must attribute the hits to that frequency.
+static bool loopbackTest(void) {
+  bool passed = true;
+  filter_init();
+  isr_init();
+  interrupts_initAll(false);
+  hostSim_setAdcSource(loopbackAdcSource);
+  interrupts_enableTimerGlobalInts();
+  interrupts_startArmPrivateTimer();
+  interrupts_enableArmInts();
+
+  transmitter_setContinuousMode(true);
+  transmitter_run();
+  for (uint16_t frequency = 0; frequency < FILTER_FREQUENCY_COUNT; frequency++) {
+    transmitter_setFrequencyNumber(frequency);
+    runDetectorFor(LOOPBACK_SETTLE_MS);
+    detector_init();
+    runDetectorFor(LOOPBACK_RUN_MS);
+
+    detector_hitCount_t hitCounts[FILTER_FREQUENCY_COUNT];
+    detector_getHitCounts(hitCounts);
+    bool ok = detector_hitDetected() &&
+              detector_getFrequencyNumberOfLastHit() == frequency;
+    printf("frequency %d: %d hits, last hit on %d %s\n", frequency,
+           hitCounts[frequency], detector_getFrequencyNumberOfLastHit(),
+           ok ? "ok" : "FAILED");
+    passed = passed && ok;
+  }
+  interrupts_disableArmInts();
+  return passed;
+}
+
+#define CHANNEL_TEST_SAMPLES 100000
+#define CHANNEL_TEST_SPLIT 777 // Deliberately not a multiple of the block size.
+#define CHANNEL_TEST_SEEK 12345
+#define CHANNEL_TEST_SIGMA 20.0
+#define CHANNEL_TEST_SIGMA_TOLERANCE 0.5
+#define CHANNEL_TEST_FREQUENCY 3
+#define CHANNEL_TEST_SHOT_START_S 0.4
+#define CHANNEL_TEST_SHOT_LENGTH_S 0.2
+#define CHANNEL_TEST_SHOT_DISTANCE_M 15.0
+#define CHANNEL_TEST_RUN_MS 1000
+
+static channel_t testChannel;
+
+// Feed the ISR from the channel model.
+static uint32_t channelAdcSource(void) {
+  uint16_t sample;
+  channel_generate(&testChannel, &sample, 1);
+  return sample;
+}
+
+// The channel model must be repeatable however the stream is split, produce
+// noise with the configured spread, and deliver a shot through flicker,
+// sunlight and noise that the detector attributes to the right frequency.
+static bool channelTest(void) {
+  static uint16_t whole[CHANNEL_TEST_SAMPLES], pieces[CHANNEL_TEST_SAMPLES];
+  channel_config_t config;
+  channel_initConfig(&config);
+  config.noiseSigma = CHANNEL_TEST_SIGMA;
+  channel_t channel;
+  channel_init(&channel, &config);
+  channel_generate(&channel, whole, CHANNEL_TEST_SAMPLES);
+  channel_init(&channel, &config);
+  for (uint32_t i = 0; i < CHANNEL_TEST_SAMPLES; i += CHANNEL_TEST_SPLIT) {
+    uint32_t n = CHANNEL_TEST_SAMPLES - i < CHANNEL_TEST_SPLIT
+                     ? CHANNEL_TEST_SAMPLES - i
+                     : CHANNEL_TEST_SPLIT;
+    channel_generate(&channel, pieces + i, n);
+  }
+  uint16_t sought;
+  channel_seek(&channel, CHANNEL_TEST_SEEK);
+  channel_generate(&channel, &sought, 1);
+  bool repeatable =
+      memcmp(whole, pieces, sizeof(whole)) == 0 && sought == whole[CHANNEL_TEST_SEEK];
+
+  double sum = 0, sumSquares = 0;
+  for (uint32_t i = 0; i < CHANNEL_TEST_SAMPLES; i++) {
+    sum += whole[i];
+    sumSquares += (double)whole[i] * whole[i];
+  }
+  double mean = sum / CHANNEL_TEST_SAMPLES;
+  double sigma = sqrt(sumSquares / CHANNEL_TEST_SAMPLES - mean * mean);
+  bool noiseOk = fabs(mean - config.adcOffset) < CHANNEL_TEST_SIGMA_TOLERANCE &&
+                 fabs(sigma - CHANNEL_TEST_SIGMA) < CHANNEL_TEST_SIGMA_TOLERANCE;
+  printf("channel: repeatable %s, mean %.2f, sigma %.2f\n",
+         repeatable ? "yes" : "NO", mean, sigma);
+
+  channel_initConfig(&config);
+  config.flickerAmplitude = 100;
+  config.mainsHz = 60;
+  config.sunlight = 400;
+  config.noiseSigma = 10;
+  channel_addShooter(&config, CHANNEL_TEST_FREQUENCY, CHANNEL_TEST_SHOT_DISTANCE_M,
+                     CHANNEL_TEST_SHOT_START_S, CHANNEL_TEST_SHOT_LENGTH_S);
+  channel_init(&testChannel, &config);
+  filter_init();
+  isr_init();
+  detector_init();
+  interrupts_initAll(false);
+  hostSim_setAdcSource(channelAdcSource);
+  interrupts_enableTimerGlobalInts();
+  interrupts_startArmPrivateTimer();
+  interrupts_enableArmInts();
+  runDetectorFor(CHANNEL_TEST_RUN_MS);
+  interrupts_disableArmInts();
+  hostSim_setAdcSource(NULL);
+  detector_hitCount_t hitCounts[FILTER_FREQUENCY_COUNT];
+  detector_getHitCounts(hitCounts);
+  bool hitOk = hitCounts[CHANNEL_TEST_FREQUENCY] == 1 &&
+               detector_getFrequencyNumberOfLastHit() == CHANNEL_TEST_FREQUENCY;
+  printf("channel: %d hits on frequency %d, last hit on %d\n",
+         hitCounts[CHANNEL_TEST_FREQUENCY], CHANNEL_TEST_FREQUENCY,
+         detector_getFrequencyNumberOfLastHit());
+  return repeatable && noiseOk && hitOk;
+}
+
+#define GAME_TEST_TICKS_PER_MS (HOSTSIM_DEFAULT_TICKS_PER_SECOND / 1000)
+#define GAME_TEST_PRESS_MS 100 // Longer than the 50 ms trigger debounce.
+#define GAME_TEST_RELOAD_MS 3100
+#define GAME_TEST_INVINCIBLE_MS 5100
+#define GAME_TEST_FREQUENCY 8
+
+// Run the ISR for ms milliseconds, handling queued events every millisecond
+// as the game loop would.
+static void runGameFor(uint32_t ms) {
+  for (uint32_t i = 0; i < ms; i++) {
+    hostSim_advanceTicks(GAME_TEST_TICKS_PER_MS);
+    gameEngine_processEvents();
+  }
+}
+
+// Press and release BTN0, which the trigger treats like the gun trigger.
+static void pullTrigger(void) {
+  hostSim_setButtons(BUTTONS_BTN0_MASK);
+  runGameFor(GAME_TEST_PRESS_MS);
+  hostSim_setButtons(0);
+  runGameFor(GAME_TEST_PRESS_MS);
+}
+
+// Drive the game engine through a clip, a lost life, respawn and BTN3. The
+// last shot of the clip disables the trigger while it is down; once it is
+// let go, only the auto-reload may refill the clip, which it marks by
+// loading the trigger's shot count. A player knocked out with the trigger
+// down must not reload by holding it either.
+static bool gameTest(void) {
+  isr_init();
+  gameEngine_init();
+  interrupts_initAll(false);
+  interrupts_enableTimerGlobalInts();
+  interrupts_startArmPrivateTimer();
+  interrupts_enableArmInts();
+  gameEngine_start();
+
+  trigger_setRemainingShotCount(0);
+  for (uint16_t i = 0; i < GAME_ENGINE_STARTING_BULLETS; i++)
+    pullTrigger();
+  bool emptied = gameEngine_getBullets() == 0 &&
+                 gameEngine_getClipState() == GAME_CLIP_RELOADING && !trigger_isPressed();
+  pullTrigger(); // Disabled while reloading: not a shot.
+  runGameFor(GAME_TEST_RELOAD_MS);
+  bool reloaded = gameEngine_getBullets() == GAME_ENGINE_STARTING_BULLETS &&
+                  gameEngine_getClipState() == GAME_CLIP_LOADED &&
+                  trigger_getRemainingShotCount() == AUTO_RELOAD_SHOT_VALUE;
+  printf("game: clip emptied %s, reloaded by the timer %s\n", emptied ? "yes" : "NO",
+         reloaded ? "yes" : "NO");
+
+  for (uint16_t i = 0; i < GAME_ENGINE_HITS_PER_LIFE; i++)
+    gameEngine_dispatch(GAME_EVENT_HIT, GAME_TEST_FREQUENCY);
+  gameEngine_dispatch(GAME_EVENT_HIT, GAME_TEST_FREQUENCY); // Ignored.
+  bool lostLife = gameEngine_getLives() == GAME_ENGINE_STARTING_LIVES - 1 &&
+                  gameEngine_getLifeState() == GAME_LIFE_INVINCIBLE;
+  runGameFor(GAME_TEST_INVINCIBLE_MS);
+  bool respawned = gameEngine_getLifeState() == GAME_LIFE_ALIVE;
+  printf("game: lost a life %s, respawned %s\n", lostLife ? "yes" : "NO",
+         respawned ? "yes" : "NO");
+
+  for (uint16_t life = 2; life < GAME_ENGINE_STARTING_LIVES; life++) {
+    for (uint16_t i = 0; i < GAME_ENGINE_HITS_PER_LIFE; i++)
+      gameEngine_dispatch(GAME_EVENT_HIT, GAME_TEST_FREQUENCY);
+    runGameFor(GAME_TEST_INVINCIBLE_MS);
+  }
+  pullTrigger();
+  hostSim_setButtons(BUTTONS_BTN0_MASK); // Down as the last life goes.
+  runGameFor(GAME_TEST_PRESS_MS);
+  uint16_t bulletsLeft = gameEngine_getBullets();
+  for (uint16_t i = 0; i < GAME_ENGINE_HITS_PER_LIFE; i++)
+    gameEngine_dispatch(GAME_EVENT_HIT, GAME_TEST_FREQUENCY);
+  hostSim_setButtons(0);
+  runGameFor(GAME_TEST_RELOAD_MS);
+  bool outHeld = gameEngine_getLifeState() == GAME_LIFE_OUT &&
+                 gameEngine_getBullets() == bulletsLeft;
+  printf("game: out with %u bullets, no reload %s\n", bulletsLeft, outHeld ? "yes" : "NO");
+
+  hostSim_setButtons(BUTTONS_BTN3_MASK);
+  runGameFor(GAME_TEST_PRESS_MS);
+  hostSim_setButtons(0);
+  interrupts_disableArmInts();
+  printf("game: %u events, %u dropped, quit %s\n", gameEngine_getEventCount(),
+         gameEngine_getDroppedEventCount(), gameEngine_quitRequested() ? "yes" : "NO");
+  return emptied && reloaded && lostLife && respawned && outHeld && gameEngine_quitRequested() &&
+         gameEngine_getDroppedEventCount() == 0;
+}
+
+#define FRAMING_CRC_CHECK_VALUE 0x29B1 // CRC-16/CCITT-FALSE of "123456789".
+#define FRAMING_LONG_RUN 600 // Spans several 254-byte COBS blocks.
+
+// COBS must round-trip runs of zeros and runs longer than one block, and a
+// frame must be rejected once any bit of it is flipped.
+static bool framingTest(void) {
+  bool crcOk = telemetry_crc16((const uint8_t *)"123456789", 9) == FRAMING_CRC_CHECK_VALUE;
+
+  static uint8_t data[FRAMING_LONG_RUN], encoded[2 * FRAMING_LONG_RUN], decoded[2 * FRAMING_LONG_RUN];
+  const uint32_t sizes[] = {0, 1, 253, 254, 255, 508, FRAMING_LONG_RUN};
+  bool cobsOk = true;
+  for (int pattern = 0; pattern < 3; pattern++) {
+    for (uint32_t i = 0; i < FRAMING_LONG_RUN; i++)
+      data[i] = pattern == 0 ? 0 : pattern == 1 ? 1 + i % 255 : (i % 7 ? i : 0);
+    for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      uint32_t length = telemetry_cobsEncode(data, sizes[s], encoded);
+      bool noZeros = memchr(encoded, 0, length) == NULL;
+      int32_t decodedLength = telemetry_cobsDecode(encoded, length, decoded);
+      cobsOk &= noZeros && decodedLength == (int32_t)sizes[s] &&
+                memcmp(decoded, data, sizes[s]) == 0;
+    }
+  }
+
+  // A HIT frame must decode, and no single-bit corruption of it may.
+  telemetry_frame_t frame;
+  uint8_t hit[TELEMETRY_MAX_ENCODED_FRAME];
+  uint8_t raw[TELEMETRY_MAX_FRAME] = {TELEMETRY_VERSION, TELEMETRY_MESSAGE_HIT, 7, 0,
+                                      1, 2, 3, 4, 5, 6, 0, 0, 0};
+  uint16_t rawSize = TELEMETRY_HEADER_BYTES + TELEMETRY_HIT_PAYLOAD;
+  uint16_t crc = telemetry_crc16(raw, rawSize);
+  raw[rawSize++] = crc;
+  raw[rawSize++] = crc >> 8;
+  uint32_t length = telemetry_cobsEncode(raw, rawSize, hit);
+  bool frameOk = telemetry_decodeFrame(hit, length, &frame) == TELEMETRY_DECODE_OK &&
+                 frame.type == TELEMETRY_MESSAGE_HIT && frame.sequence == 7 &&
+                 frame.payloadSize == TELEMETRY_HIT_PAYLOAD;
+  uint32_t undetected = 0;
+  for (uint32_t bit = 0; bit < rawSize * 8; bit++) {
+    raw[bit / 8] ^= 1 << bit % 8;
+    length = telemetry_cobsEncode(raw, rawSize, hit);
+    undetected += telemetry_decodeFrame(hit, length, &frame) == TELEMETRY_DECODE_OK;
+    raw[bit / 8] ^= 1 << bit % 8;
+  }
+  printf("framing: CRC %s, COBS %s, frame %s, %u undetected bit flips\n", crcOk ? "ok" : "WRONG",
+         cobsOk ? "ok" : "WRONG", frameOk ? "ok" : "WRONG", undetected);
+  return crcOk && cobsOk && frameOk && undetected == 0;
+}
+
+#define JOURNAL_SINK_SIZE (64 * JOURNAL_BLOCK_SIZE)
+#define JOURNAL_SINK_CHUNK 100 // Like a UART queue: takes a little at a time.
+
+static uint8_t journalSink[JOURNAL_SINK_SIZE];
+static uint32_t journalSinkSize;
+static bool journalSinkOpen;
+
+static uint32_t journalSinkWrite(const uint8_t *data, uint32_t size) {
+  if (!journalSinkOpen)
+    return 0;
+  if (size > JOURNAL_SINK_CHUNK)
+    size = JOURNAL_SINK_CHUNK;
+  if (size > JOURNAL_SINK_SIZE - journalSinkSize)
+    size = JOURNAL_SINK_SIZE - journalSinkSize;
+  memcpy(journalSink + journalSinkSize, data, size);
+  journalSinkSize += size;
+  return size;
+}
+
+// Nothing is written until a batch is ready and the detector is idle, or a
+// record gets old; a writer that stalls costs new records, never old ones;
+// and everything written reads back in order.
+static bool journalTest(void) {
+  journalSinkSize = 0;
+  journalSinkOpen = true;
+  journal_start(journalSinkWrite, 3);
+  uint32_t value = 0;
+  journal_record(JOURNAL_EVENT_GAME_START, 5, 0, value++);
+  uint32_t tick = interrupts_isrInvocationCount();
+  journal_poll(tick, 0);
+  bool batched = journalSinkSize == 0;
+  while (value < JOURNAL_BATCH_BLOCKS * JOURNAL_RECORDS_PER_BLOCK + 1)
+    journal_record(JOURNAL_EVENT_HIT, 8, 0.5f, value++);
+  journal_poll(tick, JOURNAL_IDLE_BACKLOG);
+  batched &= journalSinkSize == 0; // Busy.
+  for (int i = 0; i < JOURNAL_BATCH_BLOCKS * JOURNAL_BLOCK_SIZE / JOURNAL_SINK_CHUNK + 1; i++)
+    journal_poll(tick, 0);
+  batched &= journalSinkSize == JOURNAL_BATCH_BLOCKS * JOURNAL_BLOCK_SIZE;
+  uint32_t beforeStale = journalSinkSize;
+  journal_poll(tick + JOURNAL_MAX_DELAY_TICKS, 0);
+  bool stale = journalSinkSize > beforeStale;
+  while (!journal_flush())
+    ;
+
+  journalSinkOpen = false;
+  journal_stats_t stats;
+  for (int i = 0; i < (JOURNAL_RING_BLOCKS + 1) * JOURNAL_RECORDS_PER_BLOCK; i++)
+    journal_record(JOURNAL_EVENT_SHOT, 5, 0, value++);
+  journal_getStats(&stats);
+  bool dropped = stats.dropped > 0;
+  journalSinkOpen = true;
+  while (!journal_flush())
+    ;
+  journal_getStats(&stats);
+
+  uint32_t records = 0, expectedValue = 0, badBlocks = 0, outOfOrder = 0;
+  for (uint32_t offset = 0; offset < journalSinkSize; offset += JOURNAL_BLOCK_SIZE) {
+    journal_blockHeader_t header;
+    if (!journal_parseBlock(journalSink + offset, &header) || header.session != 3 ||
+        header.sequence != offset / JOURNAL_BLOCK_SIZE) {
+      badBlocks++;
+      continue;
+    }
+    for (uint16_t i = 0; i < header.recordCount; i++, records++) {
+      journal_record_t record;
+      journal_readRecord(journalSink + offset, i, &record);
+      outOfOrder += record.value != expectedValue++;
+    }
+  }
+  bool complete = records == stats.records && records == value - stats.dropped &&
+                  journalSinkSize % JOURNAL_BLOCK_SIZE == 0;
+  printf("journal: batching %s, age flush %s, %u dropped while stalled, %u records read back, "
+         "%u bad blocks, %u out of order\n",
+         batched ? "ok" : "WRONG", stale ? "ok" : "WRONG", stats.dropped, records, badBlocks,
+         outOfOrder);
+  return batched && stale && dropped && complete && badBlocks == 0 && outOfOrder == 0;
+}
+
+#define SHOT_CODE_TEST_SHOTS 6
+#define SHOT_CODE_TEST_RUN_MS 800 // Frame, decode and the 500 ms lockout.
+
+// Coded bursts from the transmitter, looped back, must be registered with the
+// ID they carry whatever the frequency; a plain burst is no hit at all.
+static bool shotCodeTest(void) {
+  static const int16_t ids[SHOT_CODE_TEST_SHOTS] = {
+      SHOTCODE_ID(0, 0), SHOTCODE_ID(0, 21), SHOTCODE_ID(1, 10),
+      SHOTCODE_ID(1, 31), SHOTCODE_ID(0, 7), SHOTCODE_NONE};
+  bool passed = true;
+  filter_init();
+  isr_init();
+  interrupts_initAll(false);
+  hostSim_setAdcSource(loopbackAdcSource);
+  interrupts_enableTimerGlobalInts();
+  interrupts_startArmPrivateTimer();
+  interrupts_enableArmInts();
+  transmitter_setContinuousMode(false);
+  for (uint16_t shot = 0; shot < SHOT_CODE_TEST_SHOTS; shot++) {
+    uint16_t frequency = (shot * 3) % FILTER_FREQUENCY_COUNT;
+    detector_init();
+    detector_setCodedShots(true);
+    transmitter_setFrequencyNumber(frequency);
+    transmitter_setCode(ids[shot]);
+    transmitter_run();
+    runDetectorFor(SHOT_CODE_TEST_RUN_MS);
+
+    detector_hitCount_t hitCounts[FILTER_FREQUENCY_COUNT];
+    detector_getHitCounts(hitCounts);
+    bool ok = ids[shot] == SHOTCODE_NONE
+                  ? !detector_hitDetected()
+                  : hitCounts[frequency] == 1 &&
+                        detector_getFrequencyNumberOfLastHit() == frequency &&
+                        detector_getCodeOfLastHit() == ids[shot];
+    printf("shotCode: sent %d on frequency %d, %d hits, decoded %d %s\n", ids[shot],
+           frequency, hitCounts[frequency], detector_getCodeOfLastHit(), ok ? "ok" : "FAILED");
+    passed = passed && ok;
+  }
+  transmitter_setCode(SHOTCODE_NONE);
+  interrupts_disableArmInts();
+  hostSim_setAdcSource(NULL);
+  return passed;
+}
+
+#define CHANNEL_MASK_TEST_ENEMY 8 // The other team's frequency, as in game.c.
+#define CHANNEL_MASK_TEST_FRIEND 5
+#define CHANNEL_MASK_TEST_RUN_MS 5000
+
+// A two-team game ignores all but the other team's frequency, so the masked
+// filter bank runs 4 filters of 10. It must register the same enemy shots as
+// the full bank through flicker and sunlight, while teammates fire close by.
+static bool channelMaskTest(void) {
+  static const double enemyDistances[] = {10, 20, 25, 30};
+  channel_config_t config;
+  channel_initConfig(&config);
+  config.flickerAmplitude = 100;
+  config.sunlight = 400;
+  config.noiseSigma = 10;
+  for (uint16_t i = 0; i < sizeof(enemyDistances) / sizeof(enemyDistances[0]); i++) {
+    channel_addShooter(&config, CHANNEL_MASK_TEST_ENEMY, enemyDistances[i], 0.5 + i, 0.2);
+    channel_addShooter(&config, CHANNEL_MASK_TEST_FRIEND, 3.0, 1.0 + i, 0.2);
+  }
+  bool ignored[FILTER_FREQUENCY_COUNT];
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+    ignored[i] = i != CHANNEL_MASK_TEST_ENEMY;
+
+  detector_hitCount_t hitCounts[2][FILTER_FREQUENCY_COUNT];
+  uint32_t runs[2], skipped[2];
+  for (uint16_t masked = 0; masked < 2; masked++) {
+    channel_init(&testChannel, &config);
+    filter_init();
+    filter_reset(); // Power values too: both runs must start alike.
+    isr_init();
+    detector_init();
+    detector_setChannelMasking(masked);
+    detector_setIgnoredFrequencies(ignored);
+    interrupts_initAll(false);
+    hostSim_setAdcSource(channelAdcSource);
+    interrupts_enableTimerGlobalInts();
+    interrupts_startArmPrivateTimer();
+    interrupts_enableArmInts();
+    runDetectorFor(CHANNEL_MASK_TEST_RUN_MS);
+    interrupts_disableArmInts();
+    hostSim_setAdcSource(NULL);
+    detector_getHitCounts(hitCounts[masked]);
+    detector_getFilterRunCounts(&runs[masked], &skipped[masked]);
+    printf("channelMask: masking %s, %d enemy hits, %u filter runs, %u skipped\n",
+           masked ? "on" : "off", hitCounts[masked][CHANNEL_MASK_TEST_ENEMY], runs[masked],
+           skipped[masked]);
+  }
+  detector_setChannelMasking(true);
+  bool sameHits = memcmp(hitCounts[0], hitCounts[1], sizeof(hitCounts[0])) == 0;
+  bool allHit = hitCounts[1][CHANNEL_MASK_TEST_ENEMY] ==
+                sizeof(enemyDistances) / sizeof(enemyDistances[0]);
+  bool saved = skipped[1] == runs[1] / 4 * 6 && skipped[0] == 0;
+  return sameHits && allHit && saved;
+}
+
+#define SNAPSHOT_TEST_ENEMY 8
+#define SNAPSHOT_TEST_OTHER_TEAM 5 // The enemy once the team switch flips.
+#define SNAPSHOT_TEST_SAVE_MS 1000
+#define SNAPSHOT_TEST_RUN_MS 1000
+#define SNAPSHOT_TEST_SHOT_START_S 1.1 // Soon after the snapshot.
+
+// A detector restored from a snapshot into freshly initialized modules must
+// carry on exactly as the one that was saved: the same hits and the same
+// power values to the last bit. Masked channels are left out of the
+// snapshot, and a damaged or cut-short snapshot is refused, as is one that
+// lacks a filter the detector runs after the ignored frequencies change.
+static bool snapshotTest(void) {
+  static uint8_t state[DETECTOR_STATE_MAX_SIZE];
+  uint32_t stateSize = 0;
+  channel_config_t config;
+  channel_initConfig(&config);
+  config.flickerAmplitude = 100;
+  config.sunlight = 400;
+  config.noiseSigma = 10;
+  channel_addShooter(&config, SNAPSHOT_TEST_ENEMY, 20.0, SNAPSHOT_TEST_SHOT_START_S, 0.2);
+  bool ignored[FILTER_FREQUENCY_COUNT];
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+    ignored[i] = i != SNAPSHOT_TEST_ENEMY;
+
+  detector_hitCount_t hitCounts[2][FILTER_FREQUENCY_COUNT];
+  double powers[2][FILTER_FREQUENCY_COUNT];
+  bool restored = false;
+  for (uint16_t resumed = 0; resumed < 2; resumed++) {
+    channel_init(&testChannel, &config);
+    filter_init();
+    filter_reset();
+    isr_init();
+    detector_init();
+    detector_setIgnoredFrequencies(ignored);
+    interrupts_initAll(false);
+    hostSim_setAdcSource(channelAdcSource);
+    interrupts_enableTimerGlobalInts();
+    interrupts_startArmPrivateTimer();
+    interrupts_enableArmInts();
+    if (resumed) {
+      channel_seek(&testChannel,
+                   (uint64_t)SNAPSHOT_TEST_SAVE_MS * (HOSTSIM_DEFAULT_TICKS_PER_SECOND / 1000));
+      restored = detector_restoreState(state, stateSize);
+    } else {
+      runDetectorFor(SNAPSHOT_TEST_SAVE_MS);
+      stateSize = detector_saveState(state, sizeof(state));
+      detector_init(); // Only the hits after the snapshot are compared.
+      detector_setIgnoredFrequencies(ignored);
+    }
+    runDetectorFor(SNAPSHOT_TEST_RUN_MS);
+    interrupts_disableArmInts();
+    hostSim_setAdcSource(NULL);
+    detector_getHitCounts(hitCounts[resumed]);
+    filter_getCurrentPowerValues(powers[resumed]);
+  }
+  bool same = memcmp(hitCounts[0], hitCounts[1], sizeof(hitCounts[0])) == 0 &&
+              memcmp(powers[0], powers[1], sizeof(powers[0])) == 0;
+  bool hit = hitCounts[1][SNAPSHOT_TEST_ENEMY] == 1;
+  // Four channels: the enemy and three noise references.
+  bool compact = stateSize == DETECTOR_STATE_HEADER_SIZE + FILTER_STATE_SIZE(4);
+  state[0] ^= 1;
+  bool refused = !detector_restoreState(state, stateSize);
+  state[0] ^= 1;
+  refused = refused && !detector_restoreState(state, stateSize - 1);
+  ignored[SNAPSHOT_TEST_ENEMY] = true;
+  ignored[SNAPSHOT_TEST_OTHER_TEAM] = false;
+  detector_setIgnoredFrequencies(ignored);
+  refused = refused && !detector_restoreState(state, stateSize);
+  printf("snapshot: %u bytes, restored %s, %d enemy hits, hits and powers %s, "
+         "damaged snapshots %s\n",
+         stateSize, restored ? "yes" : "NO", hitCounts[1][SNAPSHOT_TEST_ENEMY],
+         same ? "identical" : "DIFFER", refused ? "refused" : "ACCEPTED");
+  return restored && same && hit && compact && refused;
+}
+
+#define SLOT_TEST_SLOTS 4
+#define SLOT_TEST_FREQUENCY 5
+#define SLOT_TEST_TICK_TOLERANCE 2
+#define SLOT_TEST_LISTEN_MS 400 // After the slot starts; within the lockout.
+
+static uint32_t slotTestTicks;
+static int64_t slotTestFirstHighTick;
+
+// Loopback that also notes when the burst started.
+static uint32_t slotTestAdcSource(void) {
+  if (slotTestFirstHighTick < 0 && hostSim_getMioPin(TRANSMITTER_OUTPUT_PIN))
+    slotTestFirstHighTick = slotTestTicks;
+  slotTestTicks++;
+  return loopbackAdcSource();
+}
+
+// A shot run just after the epoch must wait for the transmitter's own slot,
+// and the detector, synced at the same moment, must bin the hit in that slot.
+static bool slotTest(void) {
+  static const uint16_t slots[] = {2, 0, 3, 1};
+  bool passed = true;
+  filter_init();
+  isr_init();
+  interrupts_initAll(false);
+  hostSim_setAdcSource(slotTestAdcSource);
+  interrupts_enableTimerGlobalInts();
+  interrupts_startArmPrivateTimer();
+  interrupts_enableArmInts();
+  transmitter_setContinuousMode(false);
+  transmitter_setFrequencyNumber(SLOT_TEST_FREQUENCY);
+  for (uint16_t i = 0; i < sizeof(slots) / sizeof(slots[0]); i++) {
+    detector_init();
+    runDetectorFor(LOOPBACK_SETTLE_MS);
+    detector_setSlots(SLOT_TEST_SLOTS);
+    transmitter_setSlot(slots[i], SLOT_TEST_SLOTS);
+    transmitter_syncSlots();
+    detector_syncSlots();
+    slotTestTicks = 0;
+    slotTestFirstHighTick = -1;
+    transmitter_run();
+    runDetectorFor(slots[i] * SHOTSLOT_TICKS / (HOSTSIM_DEFAULT_TICKS_PER_SECOND / 1000) +
+                   SLOT_TEST_LISTEN_MS);
+
+    detector_hitCount_t hitCounts[FILTER_FREQUENCY_COUNT];
+    detector_getSlotHitCounts(slots[i], hitCounts);
+    int64_t late = slotTestFirstHighTick - (int64_t)slots[i] * SHOTSLOT_TICKS;
+    bool ok = slotTestFirstHighTick >= 0 && late >= 0 && late <= SLOT_TEST_TICK_TOLERANCE &&
+              detector_getSlotOfLastHit() == slots[i] && hitCounts[SLOT_TEST_FREQUENCY] == 1;
+    printf("slots: slot %d, burst at tick %lld, hit binned in slot %d %s\n", slots[i],
+           (long long)slotTestFirstHighTick, detector_getSlotOfLastHit(), ok ? "ok" : "FAILED");
+    passed = passed && ok;
+  }
+  transmitter_setSlot(0, 0);
+  interrupts_disableArmInts();
+  hostSim_setAdcSource(NULL);
+  return passed;
+}
+
+#define SCOPE_TEST_PERIOD 40 // Samples per period of the test square wave.
+#define SCOPE_TEST_LOW 1000
+#define SCOPE_TEST_HIGH 3000
+#define SCOPE_TEST_FLAT 2048
+#define SCOPE_TEST_PHASE 7 // The wave starts this far into a high half.
+#define SCOPE_TEST_MAX_SAMPLES 1000000
+
+static uint32_t scopeTestPixels;
+
+static void scopeTestCountPixels(uint32_t pixels) { scopeTestPixels += pixels; }
+
+// Square wave sample n, or a flat line.
+static uint16_t scopeTestSample(uint32_t n, bool flat) {
+  if (flat)
+    return SCOPE_TEST_FLAT;
+  return (n + SCOPE_TEST_PHASE) % SCOPE_TEST_PERIOD < SCOPE_TEST_PERIOD / 2 ? SCOPE_TEST_HIGH
+                                                                             : SCOPE_TEST_LOW;
+}
+
+// Feed samples from *n on until a sweep is complete, then draw it. Returns
+// the pixels drawn, and the sample the sweep started on in *start.
+static uint32_t scopeTestSweep(uint32_t *n, bool flat, uint32_t *start) {
+  uint32_t sweepSamples = (uint32_t)scope_getSamplesPerColumn() * DISPLAY_WIDTH;
+  uint32_t first = *n;
+  while (!scope_addSample(scopeTestSample((*n)++, flat)) && *n - first < SCOPE_TEST_MAX_SAMPLES)
+    ;
+  *start = *n - sweepSamples;
+  scopeTestPixels = 0;
+  scope_update();
+  return scopeTestPixels;
+}
+
+// The scope reduces each column to the min and max of its samples, starts
+// each sweep on a rising edge, and redraws nothing for an identical sweep. A
+// flat line still sweeps, by timing out.
+static bool scopeTest(void) {
+  static const uint16_t samplesPerColumn[] = {1, 8, 50};
+  bool passed = true;
+  hostSim_setDisplayHook(scopeTestCountPixels);
+  for (uint16_t i = 0; i < sizeof(samplesPerColumn) / sizeof(samplesPerColumn[0]); i++) {
+    uint16_t count = samplesPerColumn[i];
+    scope_init(count);
+    uint32_t n = 0, start, triggered;
+    scopeTestSweep(&n, false, &start);
+    bool onEdge = scopeTestSample(start, false) == SCOPE_TEST_HIGH &&
+                  scopeTestSample(start - 1, false) == SCOPE_TEST_LOW;
+    bool envelopeOk = true;
+    for (uint16_t x = 0; x < DISPLAY_WIDTH; x++) {
+      uint16_t min, max, expectedMin = SCOPE_TEST_HIGH, expectedMax = SCOPE_TEST_LOW;
+      for (uint32_t k = start + x * count; k < start + (x + 1) * count; k++) {
+        uint16_t sample = scopeTestSample(k, false);
+        expectedMin = sample < expectedMin ? sample : expectedMin;
+        expectedMax = sample > expectedMax ? sample : expectedMax;
+      }
+      scope_getColumn(x, &min, &max);
+      envelopeOk = envelopeOk && min == expectedMin && max == expectedMax;
+    }
+    uint32_t repeatPixels = scopeTestSweep(&n, false, &start);
+    scopeTestSweep(&n, true, &start);
+    uint32_t sweeps = scope_getSweepCount(&triggered);
+    bool ok = onEdge && envelopeOk && repeatPixels == 0 && sweeps == 3 && triggered == 2;
+    printf("scope: %u samples per column: %s on the edge, envelope %s, %u pixels redrawn "
+           "for the same sweep, %u of %u sweeps triggered %s\n",
+           count, onEdge ? "starts" : "does not start", envelopeOk ? "ok" : "wrong", repeatPixels,
+           triggered, sweeps, ok ? "ok" : "FAILED");
+    passed = passed && ok;
+  }
+  hostSim_setDisplayHook(NULL);
+  return passed;
+}
+
+#define SAMPLE_RATE_TEST_TOLERANCE 1e-12
+
+// At 100 kHz the filter designs must reproduce the coefficient tables, and
+// at the lowest and highest rates the transmitter looped back into the ADC
+// must still be detected on each frequency, with the filters designed for
+// the rate and every tick constant converted to it.
+static bool sampleRateTest(void) {
+  double fir[FIR_COEFF_COUNT], a[IIR_A_COEFF_COUNT], b[IIR_B_COEFF_COUNT];
+  double worst = 0;
+  filterDesign_firLowpass(FILTERDESIGN_FIR_CUTOFF / FILTER_FIR_DECIMATION_FACTOR, fir,
+                          FIR_COEFF_COUNT);
+  for (uint16_t i = 0; i < FIR_COEFF_COUNT; i++)
+    worst = fmax(worst, fabs(fir[i] - fir_b_coeffs[i]));
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    filterDesign_iirBandpass(IIR_A_COEFF_COUNT / 2,
+                             round((double)SAMPLE_RATE_REFERENCE_HZ / filter_frequencyTickTable[f]),
+                             FILTERDESIGN_IIR_BANDWIDTH_HZ, SAMPLE_RATE_DECIMATED_HZ, a, b);
+    for (uint16_t i = 0; i < IIR_A_COEFF_COUNT; i++)
+      worst = fmax(worst, fabs(a[i] - iir_a_coeffs[f][i]));
+    for (uint16_t i = 0; i < IIR_B_COEFF_COUNT; i++)
+      worst = fmax(worst, fabs(b[i] - iir_b_coeffs[f][i]));
+  }
+  printf("designs at 100 kHz: worst coefficient error %.2g\n", worst);
+  bool passed = worst < SAMPLE_RATE_TEST_TOLERANCE;
+
+  passed = passed && !sampleRate_set(SAMPLE_RATE_MIN_HZ - 1) &&
+           !sampleRate_set(SAMPLE_RATE_MAX_HZ + 1);
+  static const uint32_t rates[] = {SAMPLE_RATE_MIN_HZ, SAMPLE_RATE_MAX_HZ};
+  for (uint16_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+    sampleRate_set(rates[r]);
+    filter_init();
+    filter_reset(); // filter_init() leaves the power sums of the last rate.
+    printf("%u Hz, decimation %u:\n", rates[r], sampleRate_getDecimation());
+    passed = loopbackTest() && passed;
+  }
+  sampleRate_set(SAMPLE_RATE_REFERENCE_HZ);
+  return passed;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    printf("usage: %s queue|loopback|channel|game|framing|journal|shotCode|slots|channelMask|scope|sampleRate\n", argv[0]);
+    return 2;
+  }
+  bool passed = false;
+  if (strcmp(argv[1], "queue") == 0)
+    passed = queue_runTest();
+  else if (strcmp(argv[1], "loopback") == 0)
+    passed = loopbackTest();
+  else if (strcmp(argv[1], "channel") == 0)
+    passed = channelTest();
+  else if (strcmp(argv[1], "game") == 0)
+    passed = gameTest();
+  else if (strcmp(argv[1], "framing") == 0)
+    passed = framingTest();
+  else if (strcmp(argv[1], "journal") == 0)
+    passed = journalTest();
+  else if (strcmp(argv[1], "shotCode") == 0)
+    passed = shotCodeTest();
+  else if (strcmp(argv[1], "slots") == 0)
+    passed = slotTest();
+  else if (strcmp(argv[1], "channelMask") == 0)
+    passed = channelMaskTest();
+  else if (strcmp(argv[1], "snapshot") == 0)
+    passed = snapshotTest();
+  else if (strcmp(argv[1], "scope") == 0)
+    passed = scopeTest();
+  else if (strcmp(argv[1], "sampleRate") == 0)
+    passed = sampleRateTest();
+  else
+    printf("unknown test: %s\n", argv[1]);
+  return passed ? 0 : 1;
+}
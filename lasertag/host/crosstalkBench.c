@@ -0,0 +1,364 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Crosstalk compensation (crosstalk.h) on and off, through the ISR and the
+// real detector, with the shots from the channel model, in a game where only
+// a few players can hit the gun and the rest of the bank is masked off:
+// - the leakage matrix, in dB: how far each player's square wave shows up on
+//   the other filters;
+// - the leakage left on a quiet range: each player's shot from
+//   RESIDUAL_DISTANCE_M through the filter chain alone, the worst power on
+//   another filter relative to its own before and after compensation;
+// - the gun's own shots, on a frequency it ignores, from close by: any hit is
+//   put down to another player;
+// - enemy shots, one at a time from a random distance: each is detected on
+//   the enemy's frequency, put down to another player, or missed;
+// - the cost: host time per compensation and per simulated second, with a
+//   decision every decimated sample.
+//
+//   crosstalkBench [--shots n] [--own f] [--enemies f,f,...] [--own-distance m]
+//                  [--min-distance m] [--max-distance m] [--seed n] [--check]
+//
+// The default game is the gun on 0 against players 1, 3, 4 and 5: the masked
+// bank then runs 4 but not 0, whose fifth harmonic aliases onto 4.
+//
+// --check fails unless compensation takes at least MIN_REDUCTION_DB off the
+// worst leakage, puts no more shots down to the wrong player than without and
+// detects at least as many enemy shots.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "channel.h"
+#include "crosstalk.h"
+#include "detector.h"
+#include "filter.h"
+#include "hostSim.h"
+#include "interrupts.h"
+#include "isr.h"
+#include "sampleRate.h"
+
+#define SHOT_SPACING_S 1.0 // One shot a second, well clear of the lockout.
+#define SHOT_OFFSET_S 0.1
+#define SHOT_JITTER_S 0.3
+#define SHOT_DURATION_S 0.2
+#define DETECTOR_CALLS_PER_SECOND 1000
+#define MAX_TICKS_PER_CALL 200
+#define TIMING_CALLS 1000000
+#define RESIDUAL_DISTANCE_M 2.0
+#define RESIDUAL_WINDOWS 2 // Power windows per shot; the first lets the filters settle.
+#define MIN_REDUCTION_DB 20.0
+
+typedef struct {
+  uint32_t shots, seed;
+  uint16_t own;
+  uint16_t enemies[FILTER_FREQUENCY_COUNT], enemyCount;
+  double ownDistanceM; // The gun's own shot, reflected back from close by.
+  double minDistanceM, maxDistanceM;
+  bool check;
+} options_t;
+
+typedef struct {
+  uint32_t ownWrong;    // Hits during the gun's own shots.
+  uint32_t detected;    // Enemy shots registered on the enemy's frequency.
+  uint32_t enemyWrong;  // Enemy shots registered on another one.
+  double seconds;       // Host time in the ISR and detector.
+} result_t;
+
+static uint16_t samples[MAX_TICKS_PER_CALL];
+static uint32_t nextSample;
+
+static uint32_t samplesAdcSource(void) { return samples[nextSample++]; }
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static double unitRandom(uint64_t *state) {
+  *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+  return (*state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// The frequency a hit was registered on, or -1 for none.
+static int16_t newHit(const detector_hitCount_t before[]) {
+  detector_hitCount_t after[FILTER_FREQUENCY_COUNT];
+  detector_getHitCounts(after);
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+    if (after[i] != before[i])
+      return i;
+  return -1;
+}
+
+// Run the gun's own shots or the enemies', with compensation on or off.
+static void runShots(const options_t *options, bool compensated, bool enemies,
+                     result_t *result) {
+  uint32_t hz = sampleRate_getHz();
+  channel_config_t config;
+  channel_initConfig(&config);
+  config.flickerAmplitude = 100;
+  config.sunlight = 400;
+  config.noiseSigma = 10;
+  config.seed = options->seed;
+  channel_t channel;
+  channel_init(&channel, &config);
+  filter_init();
+  filter_reset();
+  isr_init();
+  detector_init();
+  bool ignored[FILTER_FREQUENCY_COUNT];
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+    ignored[i] = true;
+  for (uint16_t k = 0; k < options->enemyCount; k++)
+    ignored[options->enemies[k]] = false;
+  detector_setIgnoredFrequencies(ignored);
+  detector_setCrosstalkCompensation(compensated);
+  interrupts_initAll(false);
+  interrupts_setPrivateTimerLoadValue(sampleRate_getTimerLoadValue());
+  hostSim_setAdcSource(samplesAdcSource);
+  interrupts_enableTimerGlobalInts();
+  interrupts_startArmPrivateTimer();
+  interrupts_enableArmInts();
+
+  uint64_t random = options->seed;
+  uint32_t ticksPerCall = hz / DETECTOR_CALLS_PER_SECOND;
+  uint32_t ticksPerShot = SHOT_SPACING_S * hz;
+  for (uint32_t shot = 0; shot < options->shots; shot++) {
+    uint16_t enemy = options->enemies[(uint16_t)(unitRandom(&random) * options->enemyCount)];
+    double distance = options->minDistanceM +
+                      unitRandom(&random) * (options->maxDistanceM - options->minDistanceM);
+    double start = shot * SHOT_SPACING_S + SHOT_OFFSET_S + unitRandom(&random) * SHOT_JITTER_S;
+    channel_config_t shooters = config;
+    shooters.shooterCount = 0;
+    if (enemies)
+      channel_addShooter(&shooters, enemy, distance, start, SHOT_DURATION_S);
+    else
+      channel_addShooter(&shooters, options->own, options->ownDistanceM, start, SHOT_DURATION_S);
+    channel_setShooters(&channel, shooters.shooters, shooters.shooterCount);
+
+    detector_hitCount_t before[FILTER_FREQUENCY_COUNT];
+    detector_getHitCounts(before);
+    for (uint32_t tick = 0; tick < ticksPerShot; tick += ticksPerCall) {
+      channel_generate(&channel, samples, ticksPerCall);
+      nextSample = 0;
+      double begin = now();
+      hostSim_advanceTicks(ticksPerCall);
+      detector(true);
+      result->seconds += now() - begin;
+    }
+    int16_t hit = newHit(before);
+    if (hit < 0)
+      continue;
+    if (!enemies)
+      result->ownWrong++;
+    else if (hit == enemy)
+      result->detected++;
+    else
+      result->enemyWrong++;
+  }
+  interrupts_disableArmInts();
+  hostSim_setAdcSource(NULL);
+}
+
+// The worst power on another filter relative to the shooter's own, over each
+// player's shot on a quiet range, before and after compensation.
+static void measureResidual(double *before, double *after) {
+  uint16_t decimation = filter_getDecimationValue();
+  uint32_t inputs = RESIDUAL_WINDOWS * FILTER_INPUT_PULSE_WIDTH * decimation;
+  channel_config_t config;
+  channel_initConfig(&config);
+  config.sampleRateHz = sampleRate_getHz();
+  *before = *after = 0;
+  for (uint16_t player = 0; player < FILTER_FREQUENCY_COUNT; player++) {
+    config.shooterCount = 0;
+    channel_addShooter(&config, player, RESIDUAL_DISTANCE_M, 0, (double)inputs / config.sampleRateHz);
+    channel_t channel;
+    channel_init(&channel, &config);
+    filter_reset();
+    for (uint32_t n = 0; n < inputs; n += decimation) {
+      channel_generate(&channel, samples, decimation);
+      for (uint16_t i = 0; i < decimation; i++)
+        filter_addNewInput(samples[i] / FILTER_ADC_MAX_VALUE * FILTER_ADC_SCALAR - 1.0);
+      filter_firFilter();
+      for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+        filter_iirFilter(f);
+    }
+    double powers[FILTER_FREQUENCY_COUNT];
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+      powers[f] = filter_computePower(f, true, false);
+    double own = powers[player];
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+      *before = f == player ? *before : fmax(*before, powers[f] / own);
+    crosstalk_compensate(powers, FILTER_ALL_CHANNELS);
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+      *after = f == player ? *after : fmax(*after, fabs(powers[f]) / powers[player]);
+  }
+  filter_reset();
+}
+
+// Host seconds per crosstalk_compensate() call.
+static double measureCompensation(void) {
+  double powers[FILTER_FREQUENCY_COUNT], sink = 0;
+  uint64_t random = 3;
+  double begin = now();
+  for (uint32_t call = 0; call < TIMING_CALLS; call++) {
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+      powers[i] = unitRandom(&random);
+    crosstalk_compensate(powers, FILTER_ALL_CHANNELS);
+    sink += powers[call % FILTER_FREQUENCY_COUNT];
+  }
+  double seconds = now() - begin;
+  // The random powers alone, to take back out.
+  begin = now();
+  for (uint32_t call = 0; call < TIMING_CALLS; call++) {
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+      powers[i] = unitRandom(&random);
+    sink += powers[call % FILTER_FREQUENCY_COUNT];
+  }
+  seconds -= now() - begin;
+  if (sink == 0.5) // Keep the loops.
+    printf("\n");
+  return seconds / TIMING_CALLS;
+}
+
+static void printLeakage(void) {
+  printf("leakage in dB, filter (row) for each player's square wave (column):\n     ");
+  for (uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; j++)
+    printf(" %6u", j);
+  printf("\n");
+  double worst = 0;
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    printf("%4u ", i);
+    for (uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; j++) {
+      double leakage = crosstalk_getLeakage(i, j);
+      if (i == j)
+        printf(" %6s", "0");
+      else
+        printf(" %6.1f", 10 * log10(leakage));
+      if (i != j)
+        worst = fmax(worst, leakage);
+    }
+    printf("\n");
+  }
+  printf("worst leakage %.1f dB\n", 10 * log10(worst));
+}
+
+static void printUsage(const char *program) {
+  printf("usage: %s [--shots n] [--own f] [--enemies f,f,...] [--own-distance m]\n"
+         "          [--min-distance m] [--max-distance m] [--seed n] [--check]\n",
+         program);
+}
+
+// Parse a comma-separated list of frequencies; false if one is out of range.
+static bool parseEnemies(const char *list, options_t *options) {
+  options->enemyCount = 0;
+  for (char *end; *list && options->enemyCount < FILTER_FREQUENCY_COUNT; list = end) {
+    unsigned long frequency = strtoul(list, &end, 0);
+    if (end == list || frequency >= FILTER_FREQUENCY_COUNT)
+      return false;
+    options->enemies[options->enemyCount++] = frequency;
+    if (*end == ',')
+      end++;
+  }
+  return options->enemyCount && !*list;
+}
+
+int main(int argc, char *argv[]) {
+  options_t options = {200, 1, 0, {1, 3, 4, 5}, 4, 0.3, 2.0, 20.0, false};
+  bool enemiesOk = true;
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--shots") == 0 && hasValue)
+      options.shots = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--own") == 0 && hasValue)
+      options.own = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--enemies") == 0 && hasValue)
+      enemiesOk = parseEnemies(argv[++i], &options);
+    else if (strcmp(argv[i], "--own-distance") == 0 && hasValue)
+      options.ownDistanceM = strtod(argv[++i], NULL);
+    else if (strcmp(argv[i], "--min-distance") == 0 && hasValue)
+      options.minDistanceM = strtod(argv[++i], NULL);
+    else if (strcmp(argv[i], "--max-distance") == 0 && hasValue)
+      options.maxDistanceM = strtod(argv[++i], NULL);
+    else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+      options.seed = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--check") == 0)
+      options.check = true;
+    else {
+      printUsage(argv[0]);
+      return 2;
+    }
+  }
+  bool ownIsEnemy = false;
+  for (uint16_t k = 0; k < options.enemyCount; k++)
+    ownIsEnemy |= options.enemies[k] == options.own;
+  if (!options.shots || options.ownDistanceM <= 0 || !enemiesOk ||
+      options.own >= FILTER_FREQUENCY_COUNT || ownIsEnemy) {
+    printUsage(argv[0]);
+    return 2;
+  }
+
+  filter_init();
+  double begin = now();
+  if (!crosstalk_measure()) {
+    printf("crosstalkBench: the leakage matrix cannot be inverted\n");
+    return 1;
+  }
+  printf("measured in %.0f ms of host time\n", (now() - begin) * 1000);
+  printLeakage();
+  double residualBefore, residualAfter;
+  measureResidual(&residualBefore, &residualAfter);
+  printf("shots from %.0f m on a quiet range, worst leakage: %.1f dB uncompensated, %.1f dB "
+         "compensated\n",
+         RESIDUAL_DISTANCE_M, 10 * log10(residualBefore), 10 * log10(residualAfter));
+
+  printf("\n%u own shots on %u from %.1f m, then %u from enemies on", options.shots,
+         options.own, options.ownDistanceM, options.shots);
+  for (uint16_t k = 0; k < options.enemyCount; k++)
+    printf("%s%u", k ? "," : " ", options.enemies[k]);
+  printf(" from %.0f-%.0f m\n", options.minDistanceM, options.maxDistanceM);
+  printf("%-13s %-16s %15s %14s %12s %14s\n", "compensation", "filters run",
+         "own shots: hits", "enemy detected", "wrong player", "host ms per s");
+  result_t results[2];
+  for (uint16_t compensated = 0; compensated < 2; compensated++) {
+    result_t *result = &results[compensated];
+    memset(result, 0, sizeof(*result));
+    runShots(&options, compensated, false, result);
+    runShots(&options, compensated, true, result);
+    char channels[2 * FILTER_FREQUENCY_COUNT + 1] = "";
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+      if (filter_getChannelMask() & (1 << i))
+        sprintf(channels + strlen(channels), "%s%u", *channels ? "," : "", i);
+    }
+    printf("%-13s %-16s %15u %13.1f%% %12u %14.2f\n", compensated ? "on" : "off", channels,
+           result->ownWrong,
+           100.0 * result->detected / options.shots, result->enemyWrong,
+           result->seconds / (2 * options.shots * SHOT_SPACING_S) * 1000);
+  }
+
+  double perCall = measureCompensation();
+  double decisionsPerSecond = sampleRate_getDecimatedHz();
+  printf("compensation: %.1f ns of host time per decision, %.2f ms per second at %.0f "
+         "decisions a second\n",
+         perCall * 1e9, perCall * decisionsPerSecond * 1000, decisionsPerSecond);
+
+  if (!options.check)
+    return 0;
+  const result_t *off = &results[0], *on = &results[1];
+  bool pass = 10 * log10(residualBefore / residualAfter) >= MIN_REDUCTION_DB &&
+              on->ownWrong + on->enemyWrong <= off->ownWrong + off->enemyWrong &&
+              on->detected >= off->detected;
+  if (!pass)
+    printf("crosstalkBench: FAILED\n");
+  return pass ? 0 : 1;
+}
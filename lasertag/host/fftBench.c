@@ -0,0 +1,226 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// The spectrum analyzer's FFT kernel (support/fft.h) at every frame length
+// it supports:
+// - accuracy: fft_powerSpectrum() on noisy frames with a tone, against a
+//   direct DFT in double precision with the same mean removal and window,
+//   and the tone's bin against its expected power;
+// - speed: time per power spectrum, and fft_transform() against a plain
+//   radix-2 FFT of the same size for what the radix-4 passes save.
+// It runs whichever butterflies fft.c was built with: plain C on an x86
+// host, NEON where the compiler has it.
+//
+//   fftBench [--spectra n] [--check]
+//
+// --check fails if any bin is off by more than MAX_ERROR of the peak or a
+// noise-free tone's power by more than MAX_TONE_ERROR.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fft.h"
+
+#define SAMPLE_RATE_HZ 100000
+#define TWO_PI 6.283185307179586
+#define ADC_IDLE_VALUE 2048
+#define NOISE_AMPLITUDE 200
+#define TONE_AMPLITUDE 1000
+#define MAX_ERROR 1e-4
+#define MAX_TONE_ERROR 0.01
+#define SPECTRUM_FRAMES_PER_SECOND 20 // As spectrum.h draws them.
+
+static float frame[FFT_MAX_POINT_COUNT];
+static float power[FFT_MAX_POINT_COUNT / 2];
+static float re[FFT_MAX_POINT_COUNT / 2], im[FFT_MAX_POINT_COUNT / 2];
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static double unitRandom(uint64_t *state) {
+  *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+  return (*state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// ADC-like frame: idle level, uniform noise of +/- noise and a tone at bin
+// toneBin.
+static void fillFrame(uint16_t n, uint16_t toneBin, double noise, uint64_t *random) {
+  for (uint16_t i = 0; i < n; i++)
+    frame[i] = ADC_IDLE_VALUE + (unitRandom(random) * 2 - 1) * noise +
+               TONE_AMPLITUDE * cos(TWO_PI * toneBin * i / n);
+}
+
+// What fft_powerSpectrum() computes, by a direct DFT in double precision.
+static void referenceSpectrum(uint16_t n, double reference[]) {
+  double mean = 0, windowSum = 0;
+  for (uint16_t i = 0; i < n; i++) {
+    mean += frame[i];
+    windowSum += 0.5 - 0.5 * cos(TWO_PI * i / n);
+  }
+  mean /= n;
+  for (uint16_t k = 0; k < n / 2; k++) {
+    double xr = 0, xi = 0;
+    for (uint16_t i = 0; i < n; i++) {
+      double x = (frame[i] - mean) * (1 - cos(TWO_PI * i / n)) / windowSum;
+      xr += x * cos(TWO_PI * k * i / n);
+      xi -= x * sin(TWO_PI * k * i / n);
+    }
+    reference[k] = xr * xr + xi * xi;
+  }
+}
+
+// Textbook iterative radix-2 FFT of m complex values, for comparison, with
+// W_m^j in wr[j] and wi[j].
+static void radix2Transform(float xr[], float xi[], uint16_t m, const float wr[],
+                            const float wi[]) {
+  for (uint16_t i = 1, j = 0; i < m; i++) {
+    uint16_t bit = m >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j |= bit;
+    if (i < j) {
+      float swap = xr[i];
+      xr[i] = xr[j];
+      xr[j] = swap;
+      swap = xi[i];
+      xi[i] = xi[j];
+      xi[j] = swap;
+    }
+  }
+  for (uint16_t length = 2; length <= m; length *= 2) {
+    for (uint16_t j = 0; j < length / 2; j++) {
+      float cr = wr[j * (m / length)], ci = wi[j * (m / length)];
+      for (uint16_t g = j; g < m; g += length) {
+        uint16_t h = g + length / 2;
+        float tr = xr[h] * cr - xi[h] * ci, ti = xr[h] * ci + xi[h] * cr;
+        xr[h] = xr[g] - tr;
+        xi[h] = xi[g] - ti;
+        xr[g] += tr;
+        xi[g] += ti;
+      }
+    }
+  }
+}
+
+// Returns the worst bin error of fft_powerSpectrum() relative to the peak,
+// and the tone's relative power error in *toneError.
+static double checkAccuracy(uint16_t n, double *toneError) {
+  static double reference[FFT_MAX_POINT_COUNT / 2];
+  uint64_t random = n;
+  uint16_t toneBin = n / 16; // 6.25 kHz, a bin center at every length.
+  double expected = (double)TONE_AMPLITUDE * TONE_AMPLITUDE;
+  fillFrame(n, toneBin, 0, &random);
+  fft_powerSpectrum(frame, power);
+  *toneError = fabs(power[toneBin] - expected) / expected;
+
+  fillFrame(n, toneBin, NOISE_AMPLITUDE, &random);
+  fft_powerSpectrum(frame, power);
+  referenceSpectrum(n, reference);
+  double peak = 0, worst = 0;
+  for (uint16_t k = 0; k < n / 2; k++)
+    if (reference[k] > peak)
+      peak = reference[k];
+  for (uint16_t k = 0; k < n / 2; k++)
+    if (fabs(power[k] - reference[k]) / peak > worst)
+      worst = fabs(power[k] - reference[k]) / peak;
+  return worst;
+}
+
+// Seconds per call of fft_powerSpectrum(), fft_transform() and the radix-2
+// transform, over spectra calls each.
+static void measureSpeed(uint16_t n, uint32_t spectra, double seconds[3]) {
+  static float wr[FFT_MAX_POINT_COUNT / 4], wi[FFT_MAX_POINT_COUNT / 4];
+  for (uint16_t j = 0; j < n / 4; j++) {
+    wr[j] = cos(TWO_PI * j / (n / 2));
+    wi[j] = -sin(TWO_PI * j / (n / 2));
+  }
+  uint64_t random = 1;
+  fillFrame(n, n / 16, NOISE_AMPLITUDE, &random);
+  double sink = 0;
+  double begin = now();
+  for (uint32_t s = 0; s < spectra; s++) {
+    fft_powerSpectrum(frame, power);
+    sink += power[s % (n / 2)];
+  }
+  seconds[0] = (now() - begin) / spectra;
+  for (uint16_t pass = 1; pass < 3; pass++) {
+    begin = now();
+    for (uint32_t s = 0; s < spectra; s++) {
+      memcpy(re, frame, sizeof(float) * n / 2);
+      memcpy(im, frame + n / 2, sizeof(float) * n / 2);
+      if (pass == 1)
+        fft_transform(re, im);
+      else
+        radix2Transform(re, im, n / 2, wr, wi);
+      sink += re[s % (n / 2)];
+    }
+    seconds[pass] = (now() - begin) / spectra;
+  }
+  if (sink == 0.5) // Keep the loops.
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t spectra = 20000;
+  bool check = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--spectra") == 0 && i + 1 < argc)
+      spectra = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--check") == 0)
+      check = true;
+    else {
+      printf("usage: %s [--spectra n] [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (!spectra)
+    spectra = 1;
+
+  bool pass = true;
+  double largestSeconds = 0;
+#if defined(__ARM_NEON)
+  printf("NEON butterflies\n");
+#else
+  printf("plain C butterflies\n");
+#endif
+  printf("points  bin Hz  worst bin error  tone error  us/spectrum  ns/point  "
+         "transform vs radix-2\n");
+  for (uint16_t n = FFT_MIN_POINT_COUNT; n <= FFT_MAX_POINT_COUNT; n *= 2) {
+    if (!fft_init(n)) {
+      printf("fftBench: fft_init(%u) failed\n", n);
+      return 1;
+    }
+    double toneError;
+    double error = checkAccuracy(n, &toneError);
+    double seconds[3];
+    measureSpeed(n, spectra, seconds);
+    printf("%6u  %6.1f  %15.2e  %9.2e%%  %11.2f  %8.2f  %.2f us vs %.2f us (%.0f%% less)\n", n,
+           (double)SAMPLE_RATE_HZ / n, error, toneError * 100, seconds[0] * 1e6,
+           seconds[0] * 1e9 / n, seconds[1] * 1e6, seconds[2] * 1e6,
+           (1 - seconds[1] / seconds[2]) * 100);
+    pass = pass && error <= MAX_ERROR && toneError <= MAX_TONE_ERROR;
+    largestSeconds = seconds[0];
+  }
+  printf("%d spectra per second of %d points take %.3f%% of this host's core\n",
+         SPECTRUM_FRAMES_PER_SECOND, FFT_MAX_POINT_COUNT,
+         largestSeconds * SPECTRUM_FRAMES_PER_SECOND * 100);
+  if (check && !pass) {
+    printf("fftBench: FAILED\n");
+    return 1;
+  }
+  return 0;
+}
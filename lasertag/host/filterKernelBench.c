@@ -0,0 +1,162 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// The C++ filter kernels (filterKernels.hpp, through filterKernels.h)
+// against the queue-based C filters of filter.c:
+// - agreement: both run side by side on random ADC samples, and every FIR
+//   output, IIR output and power must come out the same to the last bit;
+// - speed: time per input sample of each, with all ten filters run, and of
+//   the FIR filter and one IIR filter alone.
+//
+//   filterKernelBench [--seconds s] [--check]
+//
+// --check fails on any output that differs.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "filter.h"
+#include "filterKernels.h"
+
+#define SAMPLE_RATE (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000)
+#define ADC_MAX_VALUE 4095
+#define TIMING_SAMPLES SAMPLE_RATE // One second of input, filtered over again.
+
+typedef enum { C_FILTERS, KERNELS } path_t;
+
+// What a timing run does per FIR output.
+typedef enum { WHOLE_CHAIN, FIR_ONLY, ONE_IIR } work_t;
+
+static const char *workNames[] = {"FIR + 10 IIR + power", "FIR", "FIR + one IIR"};
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static double unitRandom(uint64_t *state) {
+  *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+  return (*state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// A random ADC sample, scaled as the detector scales it.
+static double randomInput(uint64_t *random) {
+  double raw = (uint32_t)(unitRandom(random) * (ADC_MAX_VALUE + 1));
+  return raw / ADC_MAX_VALUE * 2 - 1;
+}
+
+// Run both over samples inputs; returns the number of outputs that differ.
+static uint32_t compare(uint32_t samples, uint32_t *outputs) {
+  uint64_t random = 1;
+  uint32_t differing = 0;
+  *outputs = 0;
+  filter_reset();
+  filterKernels_init();
+  for (uint32_t n = 0; n < samples; n++) {
+    double x = randomInput(&random);
+    filter_addNewInput(x);
+    filterKernels_addNewInput(x);
+    if ((n + 1) % FILTER_FIR_DECIMATION_FACTOR)
+      continue;
+    differing += filter_firFilter() != filterKernels_firFilter();
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+      differing += filter_iirFilter(f) != filterKernels_iirFilter(f);
+      // From scratch now and then, as the first computation is.
+      bool fromScratch = n % (100 * FILTER_FIR_DECIMATION_FACTOR) == f;
+      differing += filter_computePower(f, fromScratch, false) !=
+                   filterKernels_computePower(f, fromScratch);
+    }
+    *outputs += 1 + 2 * FILTER_FREQUENCY_COUNT;
+  }
+  return differing;
+}
+
+// Seconds per input sample of one path doing work, over passes through the
+// inputs.
+static double measureSpeed(path_t path, work_t work, const double inputs[],
+                           uint32_t passes) {
+  double sink = 0;
+  filter_reset();
+  filterKernels_init();
+  double begin = now();
+  for (uint32_t pass = 0; pass < passes; pass++) {
+    for (uint32_t n = 0; n < TIMING_SAMPLES; n++) {
+      if (path == KERNELS)
+        filterKernels_addNewInput(inputs[n]);
+      else
+        filter_addNewInput(inputs[n]);
+      if ((n + 1) % FILTER_FIR_DECIMATION_FACTOR)
+        continue;
+      sink += path == KERNELS ? filterKernels_firFilter() : filter_firFilter();
+      uint16_t filters = work == WHOLE_CHAIN ? FILTER_FREQUENCY_COUNT : work == ONE_IIR;
+      for (uint16_t f = 0; f < filters; f++) {
+        if (path == KERNELS) {
+          sink += filterKernels_iirFilter(f);
+          if (work == WHOLE_CHAIN)
+            sink += filterKernels_computePower(f, false);
+        } else {
+          sink += filter_iirFilter(f);
+          if (work == WHOLE_CHAIN)
+            sink += filter_computePower(f, false, false);
+        }
+      }
+    }
+  }
+  double seconds = (now() - begin) / ((double)passes * TIMING_SAMPLES);
+  if (sink == 0.5) // Keep the loops.
+    printf("\n");
+  return seconds;
+}
+
+int main(int argc, char *argv[]) {
+  double seconds = 20;
+  bool check = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+      seconds = atof(argv[++i]);
+    else if (strcmp(argv[i], "--check") == 0)
+      check = true;
+    else {
+      printf("usage: %s [--seconds s] [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+  uint32_t samples = seconds * SAMPLE_RATE;
+  if (samples < TIMING_SAMPLES)
+    samples = TIMING_SAMPLES;
+
+  filter_init();
+  uint32_t outputs;
+  uint32_t differing = compare(samples, &outputs);
+  printf("%.1f s of input: %u of %u outputs differ\n", (double)samples / SAMPLE_RATE,
+         differing, outputs);
+
+  static double inputs[TIMING_SAMPLES];
+  uint64_t random = 2;
+  for (uint32_t n = 0; n < TIMING_SAMPLES; n++)
+    inputs[n] = randomInput(&random);
+  uint32_t passes = samples / TIMING_SAMPLES;
+  printf("work per FIR output    C filters    C++ kernels  speedup  (ns per input sample)\n");
+  for (work_t work = WHOLE_CHAIN; work <= ONE_IIR; work++) {
+    double c = measureSpeed(C_FILTERS, work, inputs, passes);
+    double kernels = measureSpeed(KERNELS, work, inputs, passes);
+    printf("%-20s  %10.2f  %13.2f  %6.2fx\n", workNames[work], c * 1e9, kernels * 1e9,
+           c / kernels);
+  }
+  if (check && differing) {
+    printf("filterKernelBench: FAILED\n");
+    return 1;
+  }
+  return 0;
+}
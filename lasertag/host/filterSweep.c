@@ -0,0 +1,247 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Frequency-response sweep of the FIR filter and the IIR filter bank, the
+// host counterpart of filterTest_runSquareWaveFirPowerTest() and
+// filterTest_runSquareWaveIirPowerTest(). Each point of the frequency grid
+// pushes a tone through a freshly reset filter instance and measures the power
+// at the FIR output and at every IIR output; the points are shared out between
+// threads, each with its own filter instance. The result is written as CSV:
+//
+//   frequency_hz,fir_db,iir0_db,...,iir9_db
+//
+// Gains are in dB relative to the power of the input. The ten player
+// frequencies are always part of the grid, and --check fails unless each
+// player's IIR filter is the one that passes that player's frequency best.
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "filter.h"
+
+#define SAMPLE_RATE (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000.0)
+#define DEFAULT_POINTS 400
+#define DEFAULT_MIN_HZ 500.0
+#define DEFAULT_MAX_HZ 50000.0
+#define DEFAULT_SETTLE_SAMPLES 20000 // Ignored while the filters fill up.
+#define DEFAULT_MEASURE_SAMPLES 20000 // Same length as filterTest's pulse.
+#define MAX_THREADS 256
+
+typedef struct {
+  double frequencyHz;
+  double firPower;
+  double iirPower[FILTER_FREQUENCY_COUNT];
+} point_t;
+
+static point_t *points;
+static uint32_t pointCount;
+static uint32_t nextPoint;
+static pthread_mutex_t pointLock = PTHREAD_MUTEX_INITIALIZER;
+static bool sineWave;
+static uint32_t settleSamples = DEFAULT_SETTLE_SAMPLES;
+static uint32_t measureSamples = DEFAULT_MEASURE_SAMPLES;
+
+// Filter a tone at the point's frequency and record the mean output powers,
+// normalized by the mean input power.
+static void measurePoint(point_t *point) {
+  filter_reset();
+  double phaseStep = point->frequencyHz / SAMPLE_RATE;
+  double inputPower = 0;
+  uint32_t outputs = 0;
+  for (uint32_t n = 0; n < settleSamples + measureSamples; n++) {
+    double phase = fmod(n * phaseStep, 1.0);
+    double x = sineWave ? sin(2 * M_PI * phase) : (phase < 0.5 ? 1.0 : -1.0);
+    filter_addNewInput(x);
+    bool measuring = n >= settleSamples;
+    if (measuring)
+      inputPower += x * x;
+    if ((n + 1) % FILTER_FIR_DECIMATION_FACTOR)
+      continue;
+    double y = filter_firFilter();
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+      double z = filter_iirFilter(f);
+      if (measuring)
+        point->iirPower[f] += z * z;
+    }
+    if (measuring) {
+      point->firPower += y * y;
+      outputs++;
+    }
+  }
+  inputPower /= measureSamples;
+  point->firPower /= outputs * inputPower;
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+    point->iirPower[f] /= outputs * inputPower;
+}
+
+static void *worker(void *arg) {
+  (void)arg;
+  filter_init();
+  for (;;) {
+    pthread_mutex_lock(&pointLock);
+    uint32_t index = nextPoint++;
+    pthread_mutex_unlock(&pointLock);
+    if (index >= pointCount)
+      return NULL;
+    measurePoint(&points[index]);
+  }
+}
+
+static int compareFrequency(const void *a, const void *b) {
+  double fa = ((const point_t *)a)->frequencyHz, fb = ((const point_t *)b)->frequencyHz;
+  return (fa > fb) - (fa < fb);
+}
+
+// Build a grid of gridPoints frequencies from minHz to maxHz, spaced evenly on
+// a log scale unless linear, plus the player frequencies, sorted.
+static void buildGrid(uint32_t gridPoints, double minHz, double maxHz, bool linear) {
+  pointCount = gridPoints + FILTER_FREQUENCY_COUNT;
+  points = calloc(pointCount, sizeof(point_t));
+  for (uint32_t i = 0; i < gridPoints; i++) {
+    double t = gridPoints > 1 ? (double)i / (gridPoints - 1) : 0;
+    points[i].frequencyHz = linear ? minHz + t * (maxHz - minHz) : minHz * pow(maxHz / minHz, t);
+  }
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+    points[gridPoints + f].frequencyHz = SAMPLE_RATE / filter_frequencyTickTable[f];
+  qsort(points, pointCount, sizeof(point_t), compareFrequency);
+}
+
+static double decibels(double power) {
+  return power > 0 ? 10 * log10(power) : -INFINITY;
+}
+
+static void writeCsv(FILE *out) {
+  fprintf(out, "frequency_hz,fir_db");
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+    fprintf(out, ",iir%u_db", f);
+  fprintf(out, "\n");
+  for (uint32_t i = 0; i < pointCount; i++) {
+    fprintf(out, "%.3f,%.3f", points[i].frequencyHz, decibels(points[i].firPower));
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+      fprintf(out, ",%.3f", decibels(points[i].iirPower[f]));
+    fprintf(out, "\n");
+  }
+}
+
+// At each player frequency, the player's own IIR filter must have the largest
+// output. Prints the separation to the runner-up for every player.
+static bool checkPlayers(FILE *report) {
+  bool pass = true;
+  for (uint16_t player = 0; player < FILTER_FREQUENCY_COUNT; player++) {
+    double frequency = SAMPLE_RATE / filter_frequencyTickTable[player];
+    const point_t *point = NULL;
+    for (uint32_t i = 0; i < pointCount && !point; i++)
+      if (points[i].frequencyHz == frequency)
+        point = &points[i];
+    uint16_t best = 0, runnerUp = player ? 0 : 1;
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+      if (point->iirPower[f] > point->iirPower[best])
+        best = f;
+      if (f != player && point->iirPower[f] > point->iirPower[runnerUp])
+        runnerUp = f;
+    }
+    fprintf(report, "player %u (%7.1f Hz): iir%u %6.1f dB, next best iir%u %6.1f dB%s\n",
+            player, frequency, player, decibels(point->iirPower[player]), runnerUp,
+            decibels(point->iirPower[runnerUp]), best == player ? "" : "  FAIL");
+    pass &= best == player;
+  }
+  return pass;
+}
+
+static void printUsage(const char *program) {
+  printf("usage: %s [--out file.csv] [--points n] [--min-hz f] [--max-hz f]\n"
+         "          [--linear] [--sine] [--settle samples] [--samples n]\n"
+         "          [--threads n] [--check]\n",
+         program);
+}
+
+int main(int argc, char *argv[]) {
+  const char *outPath = NULL;
+  uint32_t gridPoints = DEFAULT_POINTS;
+  double minHz = DEFAULT_MIN_HZ, maxHz = DEFAULT_MAX_HZ;
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t threads = cores > 0 ? cores : 1;
+  bool linear = false, check = false;
+  for (int i = 1; i < argc; i++) {
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (strcmp(argv[i], "--linear") == 0) {
+      linear = true;
+      continue;
+    } else if (strcmp(argv[i], "--sine") == 0) {
+      sineWave = true;
+      continue;
+    } else if (strcmp(argv[i], "--check") == 0) {
+      check = true;
+      continue;
+    }
+    if (!value) {
+      printUsage(argv[0]);
+      return 2;
+    }
+    if (strcmp(argv[i], "--out") == 0)
+      outPath = value;
+    else if (strcmp(argv[i], "--points") == 0)
+      gridPoints = atoi(value);
+    else if (strcmp(argv[i], "--min-hz") == 0)
+      minHz = atof(value);
+    else if (strcmp(argv[i], "--max-hz") == 0)
+      maxHz = atof(value);
+    else if (strcmp(argv[i], "--settle") == 0)
+      settleSamples = atoi(value);
+    else if (strcmp(argv[i], "--samples") == 0)
+      measureSamples = atoi(value);
+    else if (strcmp(argv[i], "--threads") == 0)
+      threads = atoi(value);
+    else {
+      printUsage(argv[0]);
+      return 2;
+    }
+    i++;
+  }
+  if (minHz <= 0 || maxHz < minHz || measureSamples < FILTER_FIR_DECIMATION_FACTOR ||
+      threads < 1 || threads > MAX_THREADS) {
+    printUsage(argv[0]);
+    return 2;
+  }
+
+  buildGrid(gridPoints, minHz, maxHz, linear);
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pthread_t workers[MAX_THREADS];
+  for (uint32_t t = 0; t < threads; t++)
+    pthread_create(&workers[t], NULL, worker, NULL);
+  for (uint32_t t = 0; t < threads; t++)
+    pthread_join(workers[t], NULL);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+  if (outPath) {
+    FILE *out = fopen(outPath, "w");
+    if (!out) {
+      printf("filterSweep: cannot open %s\n", outPath);
+      return 1;
+    }
+    writeCsv(out);
+    fclose(out);
+  } else {
+    writeCsv(stdout);
+  }
+  // Keep stdout clean for the CSV unless it went to a file.
+  FILE *report = outPath ? stdout : stderr;
+  fprintf(report, "%u points, %u threads, %.2f s (%.1f ms per point per thread)\n",
+          pointCount, threads, seconds, seconds * threads * 1000 / pointCount);
+  if (check && !checkPlayers(report))
+    return 1;
+  return 0;
+}
@@ -0,0 +1,806 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Word-length analysis for a fixed-point filter chain: how many bits each
+// stage of filter.c needs, from the ranges and errors it sees on long inputs.
+// The stages are the scaled ADC input, the FIR coefficients and output, the
+// IIR numerator gain, the IIR denominator, the IIR state, and the power (the
+// squares of the IIR outputs and their running sum). The IIR filters are
+// modeled twice:
+// - in direct form, as filter.c runs them: b about 1e-9, a up to 163, and
+//   the last ten outputs as the state;
+// - as five second-order sections each, as filterFloat.c runs them: a fifth
+//   of the gain, a1 within 2 and a2 within 1 per section, and each
+//   section's last two outputs as the state.
+// A stage W bits wide holds round(v * 2^n) in W signed bits, saturating,
+// written Qm.n with m = W - 1 - n integer bits; a stage whose values are all
+// below 1/2 is Q0.(W-1) with a scale factor 2^m, m < 0. Accumulators are
+// taken to be wide enough, and the bits they need are reported.
+//
+// A reference pass in double finds each stage's peak, the mean square output
+// of each IIR filter and, over noise alone, its noise floor. Each stage alone
+// is then quantized at each width from 16 to 48 bits and the chain run again;
+// the SNR it costs is the drop in each filter's ratio of shot to noise power,
+// the worst filter's. The power stage is charged its RMS error against the
+// noise power, which the detector's threshold is built from. Each stage gets
+// the narrowest width within its share of --budget-db, and the chain is run
+// once more with every stage fixed for the total. The power needs the most:
+// the detector compares powers near the noise floor, far below the peak.
+//
+//   fixedPointAudit [--seconds s] [--capture file]... [--budget-db dB]
+//                   [--headroom-bits n] [--min-distance m] [--max-distance m]
+//                   [--seed n] [--header file] [--check]
+//
+// The synthetic input is one 200 ms shot a second, from each player in turn
+// at a random distance, through the channel model; captures are raw 16-bit
+// samples at 100 kHz, as channelGen writes them. --header writes the formats,
+// the quantized coefficients of the recommended structure and the predicted
+// SNR loss as a C header. --check fails unless one structure fits the budget
+// without saturating, in 32-bit words but for the power.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "channel.h"
+#include "filter.h"
+#include "filterCoefficients.h"
+#include "filterDesign.h"
+
+#define SAMPLE_RATE 100000 // Of the coefficient tables and of captures.
+#define DECIMATED_RATE (SAMPLE_RATE / FILTER_FIR_DECIMATION_FACTOR)
+#define ADC_MAX_VALUE 4095.0
+#define ADC_SCALAR 2.0
+#define SHOT_DURATION_S 0.2
+#define SHOT_OFFSET_S 0.1
+#define SHOT_JITTER_S 0.5
+#define SILENT_SECONDS 5 // Of noise alone, for the noise floor.
+#define MIN_SNR 1.0      // Filters with less shot power than noise are not judged.
+#define READ_BLOCK_SAMPLES 4096
+#define MAX_CAPTURES 8
+#define WORD_WIDTH 32 // Past it, a stage takes two words.
+#define IIR_ORDER (IIR_A_COEFF_COUNT / 2)
+#define SECTION_COUNT IIR_ORDER
+#define HEADER_GUARD "FILTERFIXEDCOEFFICIENTS_H_"
+
+static const uint8_t widths[] = {16, 18, 20, 24, 28, 32, 40, 48};
+#define WIDTH_COUNT (sizeof(widths) / sizeof(widths[0]))
+
+typedef enum {
+  STAGE_INPUT,
+  STAGE_FIR_COEFFICIENTS,
+  STAGE_FIR_OUTPUT,
+  STAGE_IIR_GAIN,
+  STAGE_IIR_DENOMINATOR,
+  STAGE_IIR_STATE,
+  STAGE_POWER,
+  STAGE_COUNT
+} stage_t;
+
+typedef enum { DIRECT_FORM, SECTIONS, STRUCTURE_COUNT } structure_t;
+
+static const char *structureNames[STRUCTURE_COUNT] = {"direct form", "second-order sections"};
+static const char *stageNames[STRUCTURE_COUNT][STAGE_COUNT] = {
+    {"input", "FIR coefficients", "FIR output", "IIR b", "IIR a", "IIR outputs", "power"},
+    {"input", "FIR coefficients", "FIR output", "IIR gain", "IIR sections", "IIR states",
+     "power"}};
+// Names in the emitted header.
+static const char *stageMacros[STRUCTURE_COUNT][STAGE_COUNT] = {
+    {"INPUT", "FIR_COEFFICIENT", "FIR_OUTPUT", "IIR_B", "IIR_A", "IIR_OUTPUT", "POWER"},
+    {"INPUT", "FIR_COEFFICIENT", "FIR_OUTPUT", "IIR_GAIN", "IIR_SECTION", "IIR_STATE",
+     "POWER"}};
+// Data can exceed what the inputs showed; coefficients cannot.
+static const bool stageHasHeadroom[STAGE_COUNT] = {false, false, true, false,
+                                                   false, true,  true};
+
+typedef struct {
+  double seconds;
+  const char *captures[MAX_CAPTURES];
+  uint32_t captureCount;
+  double budgetDb;
+  int headroomBits;
+  double minDistanceM, maxDistanceM;
+  uint32_t seed;
+  const char *headerPath;
+  bool check;
+} options_t;
+
+// One stage's format. Width 0 leaves the stage in double.
+typedef struct {
+  uint8_t width;
+  int8_t integerBits; // m of Qm.n; negative for a scale factor 2^m.
+  double scale;       // 2^fraction bits.
+  double max, min;    // Of the stored integer.
+} format_t;
+
+typedef struct {
+  structure_t structure;
+  format_t formats[STAGE_COUNT];
+} config_t;
+
+typedef struct {
+  const config_t *config;
+  double fir[FIR_COEFF_COUNT];
+  double b[FILTER_FREQUENCY_COUNT][IIR_B_COEFF_COUNT];
+  double a[FILTER_FREQUENCY_COUNT][IIR_A_COEFF_COUNT];
+  double gain[FILTER_FREQUENCY_COUNT]; // Per section.
+  double sections[FILTER_FREQUENCY_COUNT][SECTION_COUNT][2];
+  double x[2 * FIR_COEFF_COUNT]; // Stored twice: x + xIndex is newest first.
+  uint32_t xIndex;
+  uint32_t phase; // Inputs since the last FIR output.
+  double y[IIR_B_COEFF_COUNT]; // Newest first.
+  // Direct form: the last outputs, newest first. Sections: the last two
+  // inputs of each section, then of the output.
+  double z[FILTER_FREQUENCY_COUNT][IIR_A_COEFF_COUNT];
+  double stages[FILTER_FREQUENCY_COUNT][SECTION_COUNT + 1][2];
+  double output[FILTER_FREQUENCY_COUNT];
+  double squares[FILTER_FREQUENCY_COUNT][FILTER_INPUT_PULSE_WIDTH];
+  uint32_t squareIndex;
+  double power[FILTER_FREQUENCY_COUNT];
+  uint64_t saturations;
+} chain_t;
+
+// Peaks of a double chain, and the largest sums of absolute products its
+// accumulators form.
+typedef struct {
+  double peaks[STAGE_COUNT];
+  double firBound, iirBound;
+} ranges_t;
+
+// What a chain makes of the inputs.
+typedef struct {
+  double shotSquares[FILTER_FREQUENCY_COUNT];  // Mean square output, inputs.
+  double noiseSquares[FILTER_FREQUENCY_COUNT]; // Mean square output, noise.
+  double noisePower[FILTER_FREQUENCY_COUNT];   // Mean power, noise.
+  double powerError[FILTER_FREQUENCY_COUNT];   // RMS against the reference, noise.
+  uint64_t saturations;
+  uint64_t samples; // Of the inputs, noise excluded.
+} outcome_t;
+
+typedef struct {
+  FILE *file;
+  channel_t channel;
+  channel_config_t config;
+  uint64_t next, total;
+  uint64_t random;
+  bool synthetic, silent;
+  const options_t *options;
+} reader_t;
+
+// The sections of each filter, designed as filterCoefficients.h was.
+static double sectionTable[FILTER_FREQUENCY_COUNT][SECTION_COUNT][2];
+static double sectionGainTable[FILTER_FREQUENCY_COUNT];
+
+static double unitRandom(uint64_t *state) {
+  *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+  return (*state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// The format of width bits for values below peak, plus headroom bits.
+static format_t makeFormat(uint8_t width, double peak, int headroomBits) {
+  format_t format = {width, 0, 1, 0, 0};
+  if (!width)
+    return format;
+  int integerBits = peak > 0 ? (int)floor(log2(peak)) + 1 + headroomBits : 0;
+  if (integerBits > width - 1)
+    integerBits = width - 1;
+  format.integerBits = integerBits;
+  format.scale = ldexp(1, width - 1 - integerBits);
+  format.max = ldexp(1, width - 1) - 1;
+  format.min = -ldexp(1, width - 1);
+  return format;
+}
+
+static int fractionBits(const format_t *format) {
+  return format->width - 1 - format->integerBits;
+}
+
+// v in format, saturated; unchanged in double.
+static double quantize(double v, const format_t *format, uint64_t *saturations) {
+  if (!format->width)
+    return v;
+  double stored = round(v * format->scale);
+  if (stored > format->max || stored < format->min) {
+    (*saturations)++;
+    stored = stored > format->max ? format->max : format->min;
+  }
+  return stored / format->scale;
+}
+
+static void designSections(void) {
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    double gain = filterDesign_iirBandpassSections(
+        IIR_ORDER, round((double)SAMPLE_RATE / filter_frequencyTickTable[f]),
+        FILTERDESIGN_IIR_BANDWIDTH_HZ, DECIMATED_RATE, sectionTable[f]);
+    sectionGainTable[f] = pow(gain, 1.0 / SECTION_COUNT);
+  }
+}
+
+// A chain with its coefficients in the formats of config, or in double.
+static void chain_init(chain_t *chain, const config_t *config) {
+  memset(chain, 0, sizeof(*chain));
+  chain->config = config;
+  const format_t *formats = config->formats;
+  uint64_t ignored = 0;
+  for (uint32_t i = 0; i < FIR_COEFF_COUNT; i++)
+    chain->fir[i] = quantize(fir_b_coeffs[i], &formats[STAGE_FIR_COEFFICIENTS], &ignored);
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    for (uint32_t i = 0; i < IIR_B_COEFF_COUNT; i++)
+      chain->b[f][i] = quantize(iir_b_coeffs[f][i], &formats[STAGE_IIR_GAIN], &ignored);
+    for (uint32_t i = 0; i < IIR_A_COEFF_COUNT; i++)
+      chain->a[f][i] = quantize(iir_a_coeffs[f][i], &formats[STAGE_IIR_DENOMINATOR], &ignored);
+    chain->gain[f] = quantize(sectionGainTable[f], &formats[STAGE_IIR_GAIN], &ignored);
+    for (uint16_t s = 0; s < SECTION_COUNT; s++)
+      for (uint16_t i = 0; i < 2; i++)
+        chain->sections[f][s][i] =
+            quantize(sectionTable[f][s][i], &formats[STAGE_IIR_DENOMINATOR], &ignored);
+  }
+}
+
+// Start again from silence, keeping the coefficients.
+static void chain_clear(chain_t *chain) {
+  memset(chain->x, 0, sizeof(chain->x));
+  memset(chain->y, 0, sizeof(chain->y));
+  memset(chain->z, 0, sizeof(chain->z));
+  memset(chain->stages, 0, sizeof(chain->stages));
+  memset(chain->output, 0, sizeof(chain->output));
+  memset(chain->squares, 0, sizeof(chain->squares));
+  memset(chain->power, 0, sizeof(chain->power));
+  chain->xIndex = chain->phase = chain->squareIndex = 0;
+}
+
+// One output of direct-form filter f, as filter_iirFilter() computes it.
+static double directForm(chain_t *chain, uint16_t f, ranges_t *ranges) {
+  double *z = chain->z[f];
+  double feedforward = 0, feedback = 0;
+  for (uint32_t i = 0; i < IIR_B_COEFF_COUNT; i++)
+    feedforward += chain->b[f][i] * chain->y[i];
+  for (uint32_t i = 0; i < IIR_A_COEFF_COUNT; i++)
+    feedback += chain->a[f][i] * z[i];
+  if (ranges) {
+    double bound = 0;
+    for (uint32_t i = 0; i < IIR_B_COEFF_COUNT; i++)
+      bound += fabs(chain->b[f][i] * chain->y[i]);
+    for (uint32_t i = 0; i < IIR_A_COEFF_COUNT; i++)
+      bound += fabs(chain->a[f][i] * z[i]);
+    ranges->iirBound = fmax(ranges->iirBound, bound);
+    ranges->peaks[STAGE_IIR_STATE] =
+        fmax(ranges->peaks[STAGE_IIR_STATE], fabs(feedforward - feedback));
+  }
+  memmove(z + 1, z, (IIR_A_COEFF_COUNT - 1) * sizeof(z[0]));
+  z[0] = quantize(feedforward - feedback, &chain->config->formats[STAGE_IIR_STATE],
+                  &chain->saturations);
+  return z[0];
+}
+
+// One output of filter f as sections, as filterFloat.c runs them.
+static double sections(chain_t *chain, uint16_t f, ranges_t *ranges) {
+  const format_t *state = &chain->config->formats[STAGE_IIR_STATE];
+  double (*stages)[2] = chain->stages[f];
+  double x = chain->y[0];
+  for (uint16_t s = 0; s < SECTION_COUNT; s++) {
+    double g = chain->gain[f], a1 = chain->sections[f][s][0], a2 = chain->sections[f][s][1];
+    double y = g * x - g * stages[s][1] - a1 * stages[s + 1][0] - a2 * stages[s + 1][1];
+    if (ranges) {
+      double bound = fabs(g * x) + fabs(g * stages[s][1]) + fabs(a1 * stages[s + 1][0]) +
+                     fabs(a2 * stages[s + 1][1]);
+      ranges->iirBound = fmax(ranges->iirBound, bound);
+      ranges->peaks[STAGE_IIR_STATE] = fmax(ranges->peaks[STAGE_IIR_STATE], fabs(y));
+    }
+    stages[s][1] = stages[s][0];
+    stages[s][0] = x;
+    x = quantize(y, state, &chain->saturations);
+  }
+  stages[SECTION_COUNT][1] = stages[SECTION_COUNT][0];
+  stages[SECTION_COUNT][0] = x;
+  return x;
+}
+
+// Push one raw ADC sample; returns true when the FIR produced an output and
+// the IIR filters and powers moved on. With ranges, their peaks and bounds
+// are updated.
+static bool chain_addSample(chain_t *chain, uint16_t raw, ranges_t *ranges) {
+  const format_t *formats = chain->config->formats;
+  double x = quantize(raw / ADC_MAX_VALUE * ADC_SCALAR - 1.0, &formats[STAGE_INPUT],
+                      &chain->saturations);
+  chain->xIndex = chain->xIndex ? chain->xIndex - 1 : FIR_COEFF_COUNT - 1;
+  chain->x[chain->xIndex] = chain->x[chain->xIndex + FIR_COEFF_COUNT] = x;
+  if (++chain->phase < FILTER_FIR_DECIMATION_FACTOR)
+    return false;
+  chain->phase = 0;
+
+  const double *window = chain->x + chain->xIndex;
+  double y = 0;
+  for (uint32_t i = 0; i < FIR_COEFF_COUNT; i++)
+    y += chain->fir[i] * window[i];
+  if (ranges) {
+    double bound = 0;
+    for (uint32_t i = 0; i < FIR_COEFF_COUNT; i++)
+      bound += fabs(chain->fir[i] * window[i]);
+    ranges->firBound = fmax(ranges->firBound, bound);
+    ranges->peaks[STAGE_FIR_OUTPUT] = fmax(ranges->peaks[STAGE_FIR_OUTPUT], fabs(y));
+  }
+  memmove(chain->y + 1, chain->y, sizeof(chain->y) - sizeof(chain->y[0]));
+  chain->y[0] = quantize(y, &formats[STAGE_FIR_OUTPUT], &chain->saturations);
+
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    double z = chain->config->structure == SECTIONS ? sections(chain, f, ranges)
+                                                    : directForm(chain, f, ranges);
+    chain->output[f] = z;
+    // In fixed point the squares are rounded once and the running sum of
+    // them is exact.
+    double square = quantize(z * z, &formats[STAGE_POWER], &chain->saturations);
+    double *oldest = &chain->squares[f][chain->squareIndex];
+    chain->power[f] += square - *oldest;
+    *oldest = square;
+    if (ranges)
+      ranges->peaks[STAGE_POWER] = fmax(ranges->peaks[STAGE_POWER], chain->power[f]);
+    else
+      quantize(chain->power[f], &formats[STAGE_POWER], &chain->saturations);
+  }
+  chain->squareIndex = (chain->squareIndex + 1) % FILTER_INPUT_PULSE_WIDTH;
+  return true;
+}
+
+// Open input number index: the synthetic input first if there is one, then
+// the captures; or with silent, the noise alone. Returns false past the last.
+static bool reader_open(reader_t *reader, const options_t *options, uint32_t index,
+                        bool silent) {
+  memset(reader, 0, sizeof(*reader));
+  reader->options = options;
+  reader->random = options->seed;
+  if (silent && index)
+    return false;
+  if (silent || (options->seconds > 0 && index == 0)) {
+    reader->synthetic = true;
+    reader->silent = silent;
+    channel_initConfig(&reader->config);
+    reader->config.flickerAmplitude = 100;
+    reader->config.sunlight = 400;
+    reader->config.noiseSigma = 10;
+    reader->config.seed = options->seed;
+    channel_init(&reader->channel, &reader->config);
+    reader->total = (uint64_t)((silent ? SILENT_SECONDS : options->seconds) * SAMPLE_RATE);
+    return true;
+  }
+  index -= options->seconds > 0;
+  if (index >= options->captureCount)
+    return false;
+  reader->file = fopen(options->captures[index], "rb");
+  if (!reader->file)
+    printf("fixedPointAudit: cannot read %s, skipped\n", options->captures[index]);
+  return true;
+}
+
+// Read up to count samples; returns how many, 0 at the end.
+static uint32_t reader_read(reader_t *reader, uint16_t samples[], uint32_t count) {
+  if (!reader->synthetic) {
+    uint32_t read = reader->file ? fread(samples, sizeof(samples[0]), count, reader->file) : 0;
+    if (!read && reader->file) {
+      fclose(reader->file);
+      reader->file = NULL;
+    }
+    return read;
+  }
+  if (reader->next >= reader->total)
+    return 0;
+  uint64_t second = reader->next / SAMPLE_RATE;
+  if (reader->next % SAMPLE_RATE == 0 && !reader->silent) {
+    // A new second: the next player shoots from a random distance.
+    const options_t *options = reader->options;
+    channel_config_t shot = reader->config;
+    shot.shooterCount = 0;
+    double distance = options->minDistanceM + unitRandom(&reader->random) *
+                                                  (options->maxDistanceM - options->minDistanceM);
+    double start = second + SHOT_OFFSET_S + unitRandom(&reader->random) * SHOT_JITTER_S;
+    channel_addShooter(&shot, second % FILTER_FREQUENCY_COUNT, distance, start,
+                       SHOT_DURATION_S);
+    channel_setShooters(&reader->channel, shot.shooters, shot.shooterCount);
+  }
+  uint64_t left = (second + 1) * SAMPLE_RATE - reader->next;
+  if (left > reader->total - reader->next)
+    left = reader->total - reader->next;
+  if (count > left)
+    count = left;
+  channel_generate(&reader->channel, samples, count);
+  reader->next += count;
+  return count;
+}
+
+// Run the inputs, then the noise alone, through the chain of config, and
+// with the noise the double direct-form reference beside it. With ranges,
+// the chain (in double) records its peaks and bounds over the inputs.
+static void runChain(const options_t *options, const config_t *config, outcome_t *outcome,
+                     ranges_t *ranges) {
+  static chain_t chain, reference;
+  static const config_t referenceConfig = {DIRECT_FORM};
+  static uint16_t samples[READ_BLOCK_SAMPLES];
+  memset(outcome, 0, sizeof(*outcome));
+  if (ranges)
+    memset(ranges, 0, sizeof(*ranges));
+  chain_init(&chain, config);
+  chain_init(&reference, &referenceConfig);
+  reader_t reader;
+  uint64_t outputs = 0;
+  for (uint32_t input = 0; reader_open(&reader, options, input, false); input++) {
+    chain_clear(&chain);
+    uint32_t count;
+    while ((count = reader_read(&reader, samples, READ_BLOCK_SAMPLES))) {
+      for (uint32_t i = 0; i < count; i++) {
+        if (!chain_addSample(&chain, samples[i], ranges))
+          continue;
+        for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+          outcome->shotSquares[f] += chain.output[f] * chain.output[f];
+        outputs++;
+      }
+      outcome->samples += count;
+    }
+  }
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT && outputs; f++)
+    outcome->shotSquares[f] /= outputs;
+
+  reader_open(&reader, options, 0, true);
+  chain_clear(&chain);
+  chain_clear(&reference);
+  uint32_t count;
+  outputs = 0;
+  while ((count = reader_read(&reader, samples, READ_BLOCK_SAMPLES))) {
+    for (uint32_t i = 0; i < count; i++) {
+      chain_addSample(&reference, samples[i], NULL);
+      if (!chain_addSample(&chain, samples[i], NULL))
+        continue;
+      // Skip the first power window, which starts from silence.
+      if (++outputs <= FILTER_INPUT_PULSE_WIDTH)
+        continue;
+      for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+        double powerError = chain.power[f] - reference.power[f];
+        outcome->noiseSquares[f] += chain.output[f] * chain.output[f];
+        outcome->noisePower[f] += reference.power[f];
+        outcome->powerError[f] += powerError * powerError;
+      }
+    }
+  }
+  outputs -= FILTER_INPUT_PULSE_WIDTH;
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    outcome->noiseSquares[f] /= outputs;
+    outcome->noisePower[f] /= outputs;
+    outcome->powerError[f] = sqrt(outcome->powerError[f] / outputs);
+  }
+  outcome->saturations = chain.saturations;
+}
+
+// The SNR the chain of outcome costs against the reference: the largest
+// drop in a filter's ratio of shot power to noise power, plus the largest
+// RMS power error against the noise power. Infinite if the chain broke.
+static double snrLossDb(const outcome_t *reference, const outcome_t *outcome) {
+  double worst = 0, worstPower = 0;
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    double snr = reference->shotSquares[f] / reference->noiseSquares[f] - 1;
+    double quantizedSnr = outcome->shotSquares[f] / outcome->noiseSquares[f] - 1;
+    if (snr < MIN_SNR)
+      continue;
+    if (!(quantizedSnr > 0) || !isfinite(quantizedSnr))
+      return INFINITY;
+    worst = fmax(worst, 10 * log10(snr / quantizedSnr));
+    if (!isfinite(outcome->powerError[f]))
+      return INFINITY;
+    worstPower =
+        fmax(worstPower, 10 * log10(1 + outcome->powerError[f] / reference->noisePower[f]));
+  }
+  return worst + worstPower;
+}
+
+// structure with every stage in double except stage, at width bits.
+static config_t stageConfig(const ranges_t *ranges, const options_t *options,
+                            structure_t structure, stage_t stage, uint8_t width) {
+  config_t config;
+  memset(&config, 0, sizeof(config));
+  config.structure = structure;
+  config.formats[stage] = makeFormat(width, ranges->peaks[stage],
+                                     stageHasHeadroom[stage] ? options->headroomBits : 0);
+  return config;
+}
+
+// Coefficient peaks come from the tables, and the input's from the ADC.
+static void measureCoefficientPeaks(structure_t structure, ranges_t *ranges) {
+  double *peaks = ranges->peaks;
+  peaks[STAGE_INPUT] = 1.0;
+  for (uint32_t i = 0; i < FIR_COEFF_COUNT; i++)
+    peaks[STAGE_FIR_COEFFICIENTS] = fmax(peaks[STAGE_FIR_COEFFICIENTS], fabs(fir_b_coeffs[i]));
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    if (structure == SECTIONS) {
+      peaks[STAGE_IIR_GAIN] = fmax(peaks[STAGE_IIR_GAIN], sectionGainTable[f]);
+      for (uint16_t s = 0; s < SECTION_COUNT; s++)
+        for (uint16_t i = 0; i < 2; i++)
+          peaks[STAGE_IIR_DENOMINATOR] =
+              fmax(peaks[STAGE_IIR_DENOMINATOR], fabs(sectionTable[f][s][i]));
+      continue;
+    }
+    for (uint32_t i = 0; i < IIR_B_COEFF_COUNT; i++)
+      peaks[STAGE_IIR_GAIN] = fmax(peaks[STAGE_IIR_GAIN], fabs(iir_b_coeffs[f][i]));
+    for (uint32_t i = 0; i < IIR_A_COEFF_COUNT; i++)
+      peaks[STAGE_IIR_DENOMINATOR] = fmax(peaks[STAGE_IIR_DENOMINATOR], fabs(iir_a_coeffs[f][i]));
+  }
+}
+
+static void printFormat(char text[], size_t size, const format_t *format) {
+  if (format->integerBits >= 0)
+    snprintf(text, size, "Q%d.%d", format->integerBits, fractionBits(format));
+  else
+    snprintf(text, size, "Q0.%d * 2^%d", format->width - 1, format->integerBits);
+}
+
+// Bits a signed accumulator needs for sums up to bound with an LSB of
+// 2^-lsbBits.
+static int accumulatorBits(double bound, int lsbBits) {
+  return bound > 0 ? (int)floor(log2(bound) + lsbBits) + 2 : 1;
+}
+
+typedef struct {
+  config_t config;
+  bool fits; // Every stage within its share at some width.
+  double lossDb;
+  uint64_t saturations;
+  int firAccumulatorBits, iirAccumulatorBits;
+  uint32_t totalBits; // Of all the stage widths, to choose between structures.
+} result_t;
+
+// Each stage of structure alone at each width, then all of them at the
+// widths chosen.
+static void analyze(const options_t *options, structure_t structure, const outcome_t *reference,
+                    result_t *result) {
+  config_t doubleConfig = {structure};
+  outcome_t outcome;
+  ranges_t ranges;
+  runChain(options, &doubleConfig, &outcome, &ranges);
+  measureCoefficientPeaks(structure, &ranges);
+
+  memset(result, 0, sizeof(*result));
+  result->config.structure = structure;
+  result->fits = true;
+  double stageBudget = options->budgetDb / STAGE_COUNT;
+  printf("\n%s\n%-17s %9s   SNR loss in dB at", structureNames[structure], "stage", "peak");
+  for (uint32_t w = 0; w < WIDTH_COUNT; w++)
+    printf(" %7u", widths[w]);
+  printf(" bits\n");
+  for (stage_t s = 0; s < STAGE_COUNT; s++) {
+    printf("%-17s %9.3g %18s", stageNames[structure][s], ranges.peaks[s], "");
+    uint8_t width = 0;
+    for (uint32_t w = 0; w < WIDTH_COUNT; w++) {
+      config_t config = stageConfig(&ranges, options, structure, s, widths[w]);
+      runChain(options, &config, &outcome, NULL);
+      double loss = snrLossDb(reference, &outcome);
+      if (isfinite(loss))
+        printf(" %7.2g", fabs(loss) < 5e-5 ? 0.0 : loss);
+      else
+        printf(" %7s", "unstable");
+      if (!width && loss <= stageBudget && !outcome.saturations)
+        width = widths[w];
+    }
+    printf("\n");
+    if (!width || (width > WORD_WIDTH && s != STAGE_POWER)) {
+      result->fits = false;
+      width = width ? width : widths[WIDTH_COUNT - 1];
+    }
+    result->config.formats[s] = stageConfig(&ranges, options, structure, s, width).formats[s];
+    result->totalBits += width;
+  }
+
+  runChain(options, &result->config, &outcome, NULL);
+  result->lossDb = snrLossDb(reference, &outcome);
+  result->saturations = outcome.saturations;
+  const format_t *formats = result->config.formats;
+  result->firAccumulatorBits =
+      accumulatorBits(ranges.firBound, fractionBits(&formats[STAGE_FIR_COEFFICIENTS]) +
+                                           fractionBits(&formats[STAGE_INPUT]));
+  int inputLsbBits = fractionBits(&formats[STAGE_IIR_GAIN]) +
+                     fractionBits(&formats[structure == SECTIONS ? STAGE_IIR_STATE
+                                                                 : STAGE_FIR_OUTPUT]);
+  int feedbackLsbBits =
+      fractionBits(&formats[STAGE_IIR_DENOMINATOR]) + fractionBits(&formats[STAGE_IIR_STATE]);
+  result->iirAccumulatorBits = accumulatorBits(
+      ranges.iirBound, inputLsbBits > feedbackLsbBits ? inputLsbBits : feedbackLsbBits);
+
+  printf("%-17s %5s  %s\n", "recommended", "bits", "format");
+  for (stage_t s = 0; s < STAGE_COUNT; s++) {
+    char text[32];
+    printFormat(text, sizeof(text), &formats[s]);
+    printf("%-17s %5u  %s\n", stageNames[structure][s], formats[s].width, text);
+  }
+  printf("accumulators      FIR %d bits, IIR %d bits\n", result->firAccumulatorBits,
+         result->iirAccumulatorBits);
+  if (isfinite(result->lossDb))
+    printf("all stages fixed: predicted SNR loss %.3g dB, %llu saturations%s\n",
+           result->lossDb, (unsigned long long)result->saturations,
+           result->fits ? "" : "; some stages do not fit");
+  else
+    printf("all stages fixed: unstable%s\n",
+           result->fits ? "" : "; some stages do not fit");
+}
+
+// count values in format as a C table, rowLength to a line. With rows, each
+// line is braced, and with pairs each pair within it too.
+static void writeTable(FILE *out, const char *type, const char *name, const char *dimensions,
+                       const double *values, uint32_t count, uint32_t rowLength, bool rows,
+                       bool pairs, const format_t *format) {
+  fprintf(out, "static const %s %s%s = {", type, name, dimensions);
+  for (uint32_t i = 0; i < count; i++) {
+    bool rowStart = i % rowLength == 0, rowEnd = (i + 1) % rowLength == 0 || i + 1 == count;
+    if (rowStart)
+      fprintf(out, "\n    %s", rows ? "{" : "");
+    else
+      fprintf(out, " ");
+    fprintf(out, "%s%.0f", pairs && i % 2 == 0 ? "{" : "", round(values[i] * format->scale));
+    fprintf(out, "%s%s,", pairs && i % 2 ? "}" : "", rowEnd && rows ? "}" : "");
+  }
+  fprintf(out, "\n};\n\n");
+}
+
+static const char *storageType(const format_t *format) {
+  return format->width <= 16 ? "int16_t" : format->width <= 32 ? "int32_t" : "int64_t";
+}
+
+static bool writeHeader(const options_t *options, const result_t *result) {
+  FILE *out = fopen(options->headerPath, "w");
+  if (!out) {
+    printf("fixedPointAudit: cannot write %s\n", options->headerPath);
+    return false;
+  }
+  structure_t structure = result->config.structure;
+  const format_t *formats = result->config.formats;
+  fprintf(out, "/*\n"
+               "This software is provided for student assignment use in the Department of\n"
+               "Electrical and Computer Engineering, Brigham Young University, Utah, USA.\n"
+               "Users agree to not re-host, or redistribute the software, in source or binary\n"
+               "form, to other persons or other institutions. Users may modify and use the\n"
+               "source code for personal or educational use.\n"
+               "For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/\n"
+               "*/\n\n"
+               "#ifndef " HEADER_GUARD "\n#define " HEADER_GUARD "\n\n#include <stdint.h>\n\n");
+  fprintf(out,
+          "// Fixed-point formats for the filter chain of filter.c, written by\n"
+          "// host/fixedPointAudit from %.0f s of synthetic input and %u captures, with\n"
+          "// the IIR filters as %s. A value v of a stage is stored as\n"
+          "// round(v * 2^FRAC_BITS) in BITS signed bits; INTEGER_BITS below zero is the\n"
+          "// scale factor of a stage whose values are all below 1/2. The accumulators\n"
+          "// need the bits given for their sums at these formats.\n\n",
+          options->seconds, options->captureCount, structureNames[structure]);
+  if (structure == SECTIONS)
+    fprintf(out,
+            "// Each IIR filter is FILTERFIXED_IIR_SECTION_COUNT sections, each one\n"
+            "// y = gain (x - x[-2]) - a1 y[-1] - a2 y[-2], the sections furthest from\n"
+            "// the unit circle first.\n"
+            "#define FILTERFIXED_IIR_SECTION_COUNT %d\n\n",
+            SECTION_COUNT);
+  for (stage_t s = 0; s < STAGE_COUNT; s++) {
+    const char *macro = stageMacros[structure][s];
+    fprintf(out, "#define FILTERFIXED_%s_BITS %u\n", macro, formats[s].width);
+    fprintf(out, "#define FILTERFIXED_%s_INTEGER_BITS %d\n", macro, formats[s].integerBits);
+    fprintf(out, "#define FILTERFIXED_%s_FRAC_BITS %d\n", macro, fractionBits(&formats[s]));
+  }
+  fprintf(out, "#define FILTERFIXED_FIR_ACCUMULATOR_BITS %d\n", result->firAccumulatorBits);
+  fprintf(out, "#define FILTERFIXED_IIR_ACCUMULATOR_BITS %d\n", result->iirAccumulatorBits);
+  fprintf(out, "#define FILTERFIXED_PREDICTED_SNR_LOSS_DB %.4f\n\n", result->lossDb);
+
+  char dimensions[32];
+  snprintf(dimensions, sizeof(dimensions), "[%d]", FIR_COEFF_COUNT);
+  writeTable(out, storageType(&formats[STAGE_FIR_COEFFICIENTS]), "filterFixed_firCoefficients",
+             dimensions, fir_b_coeffs, FIR_COEFF_COUNT, 8, false, false, &formats[STAGE_FIR_COEFFICIENTS]);
+  if (structure == SECTIONS) {
+    snprintf(dimensions, sizeof(dimensions), "[%d]", FILTER_FREQUENCY_COUNT);
+    writeTable(out, storageType(&formats[STAGE_IIR_GAIN]), "filterFixed_iirSectionGains",
+               dimensions, sectionGainTable, FILTER_FREQUENCY_COUNT, FILTER_FREQUENCY_COUNT,
+               false, false, &formats[STAGE_IIR_GAIN]);
+    snprintf(dimensions, sizeof(dimensions), "[%d][%d][2]", FILTER_FREQUENCY_COUNT,
+             SECTION_COUNT);
+    writeTable(out, storageType(&formats[STAGE_IIR_DENOMINATOR]), "filterFixed_iirSections",
+               dimensions, &sectionTable[0][0][0], FILTER_FREQUENCY_COUNT * SECTION_COUNT * 2,
+               SECTION_COUNT * 2, true, true, &formats[STAGE_IIR_DENOMINATOR]);
+  } else {
+    snprintf(dimensions, sizeof(dimensions), "[%d][%d]", FILTER_FREQUENCY_COUNT,
+             IIR_B_COEFF_COUNT);
+    writeTable(out, storageType(&formats[STAGE_IIR_GAIN]), "filterFixed_iirBCoefficients",
+               dimensions, &iir_b_coeffs[0][0], FILTER_FREQUENCY_COUNT * IIR_B_COEFF_COUNT,
+               IIR_B_COEFF_COUNT, true, false, &formats[STAGE_IIR_GAIN]);
+    snprintf(dimensions, sizeof(dimensions), "[%d][%d]", FILTER_FREQUENCY_COUNT,
+             IIR_A_COEFF_COUNT);
+    writeTable(out, storageType(&formats[STAGE_IIR_DENOMINATOR]), "filterFixed_iirACoefficients",
+               dimensions, &iir_a_coeffs[0][0], FILTER_FREQUENCY_COUNT * IIR_A_COEFF_COUNT,
+               IIR_A_COEFF_COUNT, true, false, &formats[STAGE_IIR_DENOMINATOR]);
+  }
+  fprintf(out, "#endif /* " HEADER_GUARD " */\n");
+  bool written = fclose(out) == 0;
+  if (!written)
+    printf("fixedPointAudit: cannot write %s\n", options->headerPath);
+  return written;
+}
+
+static void printUsage(const char *program) {
+  printf("usage: %s [--seconds s] [--capture file]... [--budget-db dB]\n"
+         "          [--headroom-bits n] [--min-distance m] [--max-distance m]\n"
+         "          [--seed n] [--header file] [--check]\n",
+         program);
+}
+
+int main(int argc, char *argv[]) {
+  options_t options = {60, {NULL}, 0, 0.1, 1, 2.0, 40.0, 1, NULL, false};
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--seconds") == 0 && hasValue)
+      options.seconds = atof(argv[++i]);
+    else if (strcmp(argv[i], "--capture") == 0 && hasValue &&
+             options.captureCount < MAX_CAPTURES)
+      options.captures[options.captureCount++] = argv[++i];
+    else if (strcmp(argv[i], "--budget-db") == 0 && hasValue)
+      options.budgetDb = atof(argv[++i]);
+    else if (strcmp(argv[i], "--headroom-bits") == 0 && hasValue)
+      options.headroomBits = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--min-distance") == 0 && hasValue)
+      options.minDistanceM = atof(argv[++i]);
+    else if (strcmp(argv[i], "--max-distance") == 0 && hasValue)
+      options.maxDistanceM = atof(argv[++i]);
+    else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+      options.seed = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--header") == 0 && hasValue)
+      options.headerPath = argv[++i];
+    else if (strcmp(argv[i], "--check") == 0)
+      options.check = true;
+    else {
+      printUsage(argv[0]);
+      return 2;
+    }
+  }
+  if ((options.seconds <= 0 && !options.captureCount) || options.budgetDb <= 0 ||
+      options.headroomBits < 0) {
+    printUsage(argv[0]);
+    return 2;
+  }
+
+  designSections();
+  static const config_t referenceConfig = {DIRECT_FORM};
+  outcome_t reference;
+  runChain(&options, &referenceConfig, &reference, NULL);
+  printf("%.1f s of input (%.0f s synthetic, %u captures) and %d s of noise alone; "
+         "budget %.3g dB, %.3g dB a stage\n",
+         (double)reference.samples / SAMPLE_RATE, options.seconds, options.captureCount,
+         SILENT_SECONDS, options.budgetDb, options.budgetDb / STAGE_COUNT);
+
+  result_t results[STRUCTURE_COUNT];
+  for (structure_t structure = 0; structure < STRUCTURE_COUNT; structure++)
+    analyze(&options, structure, &reference, &results[structure]);
+
+  // The structure that fits, in the fewest bits.
+  const result_t *best = NULL;
+  for (structure_t structure = 0; structure < STRUCTURE_COUNT; structure++) {
+    const result_t *result = &results[structure];
+    bool fits = result->fits && !result->saturations && result->lossDb <= options.budgetDb;
+    if (fits && (!best || result->totalBits < best->totalBits))
+      best = result;
+  }
+  if (best)
+    printf("\nrecommended: %s, predicted SNR loss %.3g dB\n",
+           structureNames[best->config.structure], best->lossDb);
+  else
+    printf("\nneither structure fits the budget\n");
+
+  if (options.headerPath) {
+    const result_t *written = best ? best : &results[SECTIONS];
+    if (!writeHeader(&options, written))
+      return 2;
+    printf("wrote %s (%s)\n", options.headerPath, structureNames[written->config.structure]);
+  }
+  if (!options.check)
+    return 0;
+  if (!best)
+    printf("fixedPointAudit: FAILED\n");
+  return best ? 0 : 1;
+}
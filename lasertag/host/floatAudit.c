@@ -0,0 +1,229 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// The single-precision filter chain (filterFloat.h) against the double one
+// of filter.c, side by side on the same input:
+// - accuracy on two long inputs, uniform random ADC samples and square-wave
+//   shots from every player at three levels over noise: the worst FIR, IIR
+//   and power errors, and how often detector_detectHit() decides otherwise
+//   on the float powers than on the double ones;
+// - speed: time per input sample of each chain with all ten filters run.
+//
+//   floatAudit [--seconds s] [--check]
+//
+// Errors are relative to the largest value of the same kind: FIR and IIR
+// errors to the largest output of that filter over the run, power errors to
+// the strongest channel at that moment, as the detector compares powers
+// with each other. --check fails if an error is above its limit or any
+// decision differs.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "detector.h"
+#include "filter.h"
+#include "filterFloat.h"
+
+#define SAMPLE_RATE (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000)
+#define ADC_MAX_VALUE 4095
+#define ADC_IDLE_VALUE 2048
+#define SHOT_SAMPLES 20000 // 200 ms, as the transmitter sends them.
+#define NOISE_AMPLITUDE 20 // ADC counts.
+#define LEVEL_COUNT 3
+#define MAX_FIR_ERROR 1e-6
+#define MAX_IIR_ERROR 1e-4
+#define MAX_POWER_ERROR 2e-4
+#define TIMING_SAMPLES SAMPLE_RATE // One second of input, filtered over again.
+
+typedef enum { RANDOM_INPUT, SQUARE_INPUT } input_t;
+
+static const char *inputNames[] = {"random", "square"};
+// Square-wave amplitudes in ADC counts, strongest first.
+static const double levels[LEVEL_COUNT] = {2000, 200, 20};
+
+typedef struct {
+  double firError, firPeak;
+  double iirError[FILTER_FREQUENCY_COUNT], iirPeak[FILTER_FREQUENCY_COUNT];
+  double powerError; // Already relative.
+  uint32_t decisions, hits, decisionMismatches, playerMismatches;
+} audit_t;
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static double unitRandom(uint64_t *state) {
+  *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+  return (*state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Sample n of an input, scaled as the detector scales the ADC.
+static double inputSample(input_t input, uint32_t n, uint64_t *random) {
+  double raw;
+  if (input == RANDOM_INPUT) {
+    raw = floor(unitRandom(random) * (ADC_MAX_VALUE + 1));
+  } else {
+    // Shots alternate with silence; each player shoots at every level.
+    uint32_t shot = n / (2 * SHOT_SAMPLES);
+    uint16_t player = shot % FILTER_FREQUENCY_COUNT;
+    double level = levels[shot / FILTER_FREQUENCY_COUNT % LEVEL_COUNT];
+    uint16_t ticks = filter_frequencyTickTable[player];
+    bool on = n % (2 * SHOT_SAMPLES) < SHOT_SAMPLES;
+    double square = n % ticks < ticks / 2 ? 1 : -1;
+    raw = round(ADC_IDLE_VALUE + (on ? level * square : 0) +
+                (unitRandom(random) * 2 - 1) * NOISE_AMPLITUDE);
+  }
+  return raw / ADC_MAX_VALUE * 2 - 1;
+}
+
+// Returns the channel with the highest power.
+static uint16_t strongest(const double powers[]) {
+  uint16_t best = 0;
+  for (uint16_t f = 1; f < FILTER_FREQUENCY_COUNT; f++)
+    if (powers[f] > powers[best])
+      best = f;
+  return best;
+}
+
+// Run both chains over samples of the input and gather their differences.
+static void audit(input_t input, uint32_t samples, audit_t *result) {
+  uint64_t random = input + 1;
+  memset(result, 0, sizeof(*result));
+  filter_reset();
+  filterFloat_init();
+  for (uint32_t n = 0; n < samples; n++) {
+    double x = inputSample(input, n, &random);
+    filter_addNewInput(x);
+    filterFloat_addNewInput(x);
+    if ((n + 1) % FILTER_FIR_DECIMATION_FACTOR)
+      continue;
+    double y = filter_firFilter();
+    double yf = filterFloat_firFilter();
+    result->firError = fmax(result->firError, fabs(yf - y));
+    result->firPeak = fmax(result->firPeak, fabs(y));
+    filterFloat_iirFilters();
+    double powers[FILTER_FREQUENCY_COUNT], floatPowers[FILTER_FREQUENCY_COUNT];
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+      double z = filter_iirFilter(f);
+      double zf = filterFloat_getIirOutput(f);
+      result->iirError[f] = fmax(result->iirError[f], fabs(zf - z));
+      result->iirPeak[f] = fmax(result->iirPeak[f], fabs(z));
+      powers[f] = filter_computePower(f, false, false);
+      floatPowers[f] = filterFloat_getPower(f);
+    }
+    double largest = powers[strongest(powers)];
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT && largest > 0; f++)
+      result->powerError =
+          fmax(result->powerError, fabs(floatPowers[f] - powers[f]) / largest);
+    bool hit = detector_detectHit(powers);
+    bool floatHit = detector_detectHit(floatPowers);
+    result->decisions++;
+    result->hits += hit;
+    result->decisionMismatches += hit != floatHit;
+    result->playerMismatches +=
+        hit && floatHit && strongest(powers) != strongest(floatPowers);
+  }
+}
+
+// Seconds per input sample of the double chain (floatChain false) or the
+// float one, over passes through the inputs.
+static double measureSpeed(bool floatChain, const double inputs[], uint32_t passes) {
+  double sink = 0;
+  filter_reset();
+  filterFloat_init();
+  double begin = now();
+  for (uint32_t pass = 0; pass < passes; pass++) {
+    for (uint32_t n = 0; n < TIMING_SAMPLES; n++) {
+      if (floatChain)
+        filterFloat_addNewInput(inputs[n]);
+      else
+        filter_addNewInput(inputs[n]);
+      if ((n + 1) % FILTER_FIR_DECIMATION_FACTOR)
+        continue;
+      if (floatChain) {
+        filterFloat_firFilter();
+        filterFloat_iirFilters();
+        for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+          sink += filterFloat_getPower(f);
+      } else {
+        filter_firFilter();
+        for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+          filter_iirFilter(f);
+          sink += filter_computePower(f, false, false);
+        }
+      }
+    }
+  }
+  double seconds = (now() - begin) / ((double)passes * TIMING_SAMPLES);
+  if (sink == 0.5) // Keep the loops.
+    printf("\n");
+  return seconds;
+}
+
+int main(int argc, char *argv[]) {
+  double seconds = 60;
+  bool check = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+      seconds = atof(argv[++i]);
+    else if (strcmp(argv[i], "--check") == 0)
+      check = true;
+    else {
+      printf("usage: %s [--seconds s] [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+  uint32_t samples = seconds * SAMPLE_RATE;
+  if (samples < TIMING_SAMPLES)
+    samples = TIMING_SAMPLES;
+
+  filter_init();
+  bool pass = true;
+  printf("input   seconds  FIR error  IIR error  power error  hits      "
+         "decisions differing  players differing\n");
+  for (input_t input = RANDOM_INPUT; input <= SQUARE_INPUT; input++) {
+    audit_t result;
+    audit(input, samples, &result);
+    double firError = result.firError / result.firPeak;
+    double iirError = 0;
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+      iirError = fmax(iirError, result.iirError[f] / result.iirPeak[f]);
+    printf("%-6s  %7.1f  %9.2e  %9.2e  %11.2e  %8u  %19u  %17u\n", inputNames[input],
+           (double)samples / SAMPLE_RATE, firError, iirError, result.powerError,
+           result.hits, result.decisionMismatches, result.playerMismatches);
+    pass = pass && firError <= MAX_FIR_ERROR && iirError <= MAX_IIR_ERROR &&
+           result.powerError <= MAX_POWER_ERROR && !result.decisionMismatches &&
+           !result.playerMismatches;
+  }
+
+  static double inputs[TIMING_SAMPLES];
+  uint64_t random = 1;
+  for (uint32_t n = 0; n < TIMING_SAMPLES; n++)
+    inputs[n] = inputSample(RANDOM_INPUT, n, &random);
+  uint32_t passes = samples / TIMING_SAMPLES;
+  double doubleSeconds = measureSpeed(false, inputs, passes);
+  double floatSeconds = measureSpeed(true, inputs, passes);
+  printf("double chain %.1f ns per sample, %.2f%% of this host's core at %d kHz\n",
+         doubleSeconds * 1e9, doubleSeconds * SAMPLE_RATE * 100,
+         FILTER_SAMPLE_FREQUENCY_IN_KHZ);
+  printf("float chain  %.1f ns per sample, %.2f%% of this host's core, %.2fx as fast\n",
+         floatSeconds * 1e9, floatSeconds * SAMPLE_RATE * 100, doubleSeconds / floatSeconds);
+  if (check && !pass) {
+    printf("floatAudit: FAILED\n");
+    return 1;
+  }
+  return 0;
+}
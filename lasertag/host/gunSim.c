@@ -0,0 +1,720 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Discrete-event simulator of a complete gun. The unmodified game loop (or one
+// of the running modes) runs against a virtual CPU clock:
+// - every call into the expensive parts of the main loop (detector, buffer
+//   pops, FIR, IIR, power, hit decision, TFT drawing) is intercepted with the
+//   linker's --wrap option and charged a configurable number of CPU cycles;
+// - the private timer comes due every 10 us of virtual time (at the default
+//   100 kHz --sample-rate, see sampleRate.h) and isr_function()
+//   preempts the main loop at that point, unless ARM interrupts are masked, in
+//   which case one tick is latched (as the GIC would) and any further ticks
+//   are lost;
+// - trigger presses, buttons, switches and incoming shots come from a script.
+// Nothing depends on the wall clock, so two runs with the same arguments
+// produce exactly the same interleaving, hits and statistics.
+//
+// Script lines are "<time in ms> <command> <args>", '#' starts a comment:
+//   100 trigger down|up          gun trigger (MIO pin 10)
+//   100 buttons <mask>           BTN0..BTN3 (8 presses BTN3)
+//   100 switches <value>         slide switches
+//   100 shot <freq> <ms> <amp>   square wave at user frequency <freq>
+//   100 noise <amp>              uniform noise of +/- <amp> ADC counts
+//   100 loopback <amp>           feed our own transmitter back into the ADC
+//
+// --journal image puts an SD card holding image in the slot, so the game
+// journals to it (journal.h); the card's writes are charged like the rest.
+// --no-channel-mask runs all ten IIR filters even where the game ignores most
+// frequencies, to compare the filter bank CPU with the masked one.
+// --mode spectrum runs the spectrum analyzer (spectrum.h) and --mode scope
+// the oscilloscope (scope.h), which drain the ADC buffer themselves;
+// --max-overruns fails the run if they cannot keep up.
+
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "buffer.h"
+#include "detector.h"
+#include "fft.h"
+#include "filter.h"
+#include "game.h"
+#include "hostSim.h"
+#include "interrupts.h"
+#include "journal.h"
+#include "journalSd.h"
+#include "runningModes.h"
+#include "sampleRate.h"
+#include "scope.h"
+#include "transmitter.h"
+#include "xsdps.h"
+
+#define DEFAULT_CPU_MHZ 650
+#define DEFAULT_SIM_SECONDS 10
+#define DEFAULT_SEED 1
+#define TICKS_PER_MS (sampleRate_getHz() / 1000)
+#define ADC_MAX_VALUE 4095
+#define TRIGGER_MIO_PIN 10 // Same pin as trigger.c.
+
+#define MAX_SCRIPT_EVENTS 4096
+#define MAX_SHOTS 16
+#define MAX_HITS_REPORTED 64
+#define MAX_LINE_LENGTH 256
+
+// Numerical Recipes LCG, so noise is reproducible on every host.
+#define LCG_MULTIPLIER 1664525u
+#define LCG_INCREMENT 1013904223u
+
+// Costs in CPU cycles. The defaults are rough figures for the -O2 board build
+// at 650 MHz and can be overridden with --cost name=cycles.
+enum {
+  COST_ISR,          // One isr_function() including entry and exit.
+  COST_DETECTOR,     // One detector() call plus the main-loop overhead.
+  COST_POP,          // Pop and scale one ADC sample, with the ints toggling.
+  COST_ADVANCE,      // Take up to a decimation of ADC samples, with the ints toggling.
+  COST_FIR,          // One decimating FIR output from xQueue.
+  COST_FIR_ADC,      // One decimating FIR output read in place from the ADC buffer.
+  COST_IIR,          // One IIR output.
+  COST_POWER,        // One running power update.
+  COST_DECISION,     // Copy, sort and compare the power values.
+  COST_DISPLAY_CALL, // Fixed cost of one display_* call.
+  COST_PIXEL,        // Per pixel written to the TFT.
+  COST_JOURNAL,      // One journal_record().
+  COST_SD_WRITE,     // Fixed cost of one polled SD write, card busy included.
+  COST_SD_BLOCK,     // Per 512-byte block written to the SD card.
+  COST_SPECTRUM,     // One spectrum_update() call plus the main-loop overhead.
+  COST_FFT,          // Per point of one FFT power spectrum.
+  COST_SCOPE,        // One scope_update() call plus the main-loop overhead.
+  COST_SCOPE_SAMPLE, // One sample into the scope's envelope and trigger.
+  COST_COUNT
+};
+
+static struct {
+  const char *name;
+  uint32_t cycles;
+} costs[COST_COUNT] = {
+    {"isr", 1500},     {"detector", 400}, {"pop", 150},
+    {"advance", 60},   {"fir", 1500},     {"firadc", 900},
+    {"iir", 400},      {"power", 100},
+    {"decision", 400}, {"display", 2000}, {"pixel", 10},
+    {"journal", 200},  {"sdwrite", 325000}, {"sdblock", 13000},
+    {"spectrum", 400}, {"fft", 40},    {"scope", 400},
+    {"scopesample", 20},
+};
+
+typedef enum { EVENT_TRIGGER, EVENT_BUTTONS, EVENT_SWITCHES, EVENT_SHOT,
+               EVENT_NOISE, EVENT_LOOPBACK } eventType_t;
+
+typedef struct {
+  uint64_t tick;
+  eventType_t type;
+  int32_t args[3];
+} scriptEvent_t;
+
+typedef struct {
+  uint16_t frequency;
+  uint64_t startTick;
+  uint64_t endTick;
+  int32_t amplitude;
+} shot_t;
+
+typedef struct {
+  uint64_t tick;
+  uint16_t frequency;
+  int64_t latencyTicks; // From the start of the matching shot, -1 if none.
+} hitRecord_t;
+
+static scriptEvent_t script[MAX_SCRIPT_EVENTS];
+static uint32_t scriptLength = 0;
+static uint32_t nextEvent = 0;
+
+static shot_t shots[MAX_SHOTS];
+static uint32_t noiseAmplitude = 0;
+static uint32_t loopbackAmplitude = 0;
+static uint32_t lcgState = DEFAULT_SEED;
+
+// Virtual CPU clock.
+static uint64_t cpuHz = DEFAULT_CPU_MHZ * 1000000ull;
+static uint64_t cyclesPerTick;
+static uint64_t cycles = 0;
+static uint64_t nextTickCycle;
+static uint64_t endCycle;
+static jmp_buf endOfRun;
+
+// Statistics.
+static uint64_t mainLoopCycles = 0;
+static uint64_t isrCycles = 0;
+static uint64_t isrRuns = 0;
+static uint64_t lostTicks = 0;
+static uint64_t isrLatencyTotal = 0;
+static uint64_t isrLatencyMax = 0;
+static uint32_t bufferHighWater = 0;
+static uint64_t bufferOverruns = 0;
+static uint64_t pixelsDrawn = 0;
+static const char *journalImage = NULL;
+static uint64_t journalCycles = 0; // Recording and SD writes.
+static uint64_t filterBankCycles = 0; // IIR filters and power.
+static uint64_t fftCycles = 0;
+static uint64_t fftRuns = 0;
+static uint64_t scopeCycles = 0; // Envelope, trigger and drawing.
+static hitRecord_t hits[MAX_HITS_REPORTED];
+static uint32_t hitTotal = 0;
+
+void __real_detector(bool interruptsCurrentlyEnabled);
+buffer_data_t __real_buffer_pop(void);
+void __real_buffer_advance(uint32_t count);
+void __real_buffer_pushover(buffer_data_t value);
+double __real_filter_firFilter(void);
+double __real_filter_firFilterAdc(const uint32_t codes[]);
+double __real_filter_iirFilter(uint16_t filterNumber);
+double __real_filter_computePower(uint16_t filterNumber,
+                                  bool forceComputeFromScratch, bool debugPrint);
+void __real_filter_getCurrentPowerValues(double powerValues[]);
+int __real_interrupts_enableArmInts(void);
+bool __real_journal_record(journal_eventType_t type, uint8_t channel, float power,
+                           uint32_t value);
+s32 __real_XSdPs_WritePolled(XSdPs *InstancePtr, u32 Arg, u32 BlkCnt, const u8 *Buff);
+void __real_spectrum_update(void);
+void __real_fft_powerSpectrum(const float frame[], float power[]);
+bool __real_scope_addSample(uint32_t rawAdcValue);
+void __real_scope_update(void);
+
+// Next value of the noise generator, uniform in [-amplitude, amplitude].
+static int32_t nextNoise(void) {
+  lcgState = lcgState * LCG_MULTIPLIER + LCG_INCREMENT;
+  if (!noiseAmplitude)
+    return 0;
+  return (int32_t)((lcgState >> 8) % (2 * noiseAmplitude + 1)) -
+         (int32_t)noiseAmplitude;
+}
+
+// Square wave of the given user frequency, as the transmitter produces it.
+static bool squareWaveHigh(uint16_t frequency, uint64_t tick) {
+  uint16_t period = sampleRate_ticks(filter_frequencyTickTable[frequency]);
+  return tick % period < period / 2;
+}
+
+// Light on the sensor for the current tick, in ADC counts.
+static uint32_t simulatedAdc(void) {
+  uint64_t tick = hostSim_getTickCount();
+  int32_t value = HOSTSIM_ADC_IDLE_VALUE + nextNoise();
+  for (uint32_t i = 0; i < MAX_SHOTS; i++)
+    if (shots[i].amplitude && tick >= shots[i].startTick &&
+        tick < shots[i].endTick &&
+        squareWaveHigh(shots[i].frequency, tick - shots[i].startTick))
+      value += shots[i].amplitude;
+  if (hostSim_getMioPin(TRANSMITTER_OUTPUT_PIN))
+    value += loopbackAmplitude;
+  if (value < 0)
+    value = 0;
+  if (value > ADC_MAX_VALUE)
+    value = ADC_MAX_VALUE;
+  return (uint32_t)value;
+}
+
+// Apply one script event to the simulated hardware.
+static void applyEvent(const scriptEvent_t *event) {
+  switch (event->type) {
+  case EVENT_TRIGGER:
+    hostSim_setMioPin(TRIGGER_MIO_PIN, event->args[0]);
+    break;
+  case EVENT_BUTTONS:
+    hostSim_setButtons(event->args[0]);
+    break;
+  case EVENT_SWITCHES:
+    hostSim_setSwitches(event->args[0]);
+    break;
+  case EVENT_SHOT:
+    for (uint32_t i = 0; i < MAX_SHOTS; i++) {
+      if (shots[i].endTick <= event->tick) { // Reuse a finished slot.
+        shots[i].frequency = event->args[0];
+        shots[i].startTick = event->tick;
+        shots[i].endTick = event->tick + (uint64_t)event->args[1] * TICKS_PER_MS;
+        shots[i].amplitude = event->args[2];
+        return;
+      }
+    }
+    printf("gunSim: more than %d overlapping shots, shot dropped\n", MAX_SHOTS);
+    break;
+  case EVENT_NOISE:
+    noiseAmplitude = event->args[0];
+    break;
+  case EVENT_LOOPBACK:
+    loopbackAmplitude = event->args[0];
+    break;
+  }
+}
+
+// Runs before every tick: apply script events that are due.
+static void scriptTick(void) {
+  uint64_t tick = hostSim_getTickCount();
+  while (nextEvent < scriptLength && script[nextEvent].tick <= tick)
+    applyEvent(&script[nextEvent++]);
+}
+
+// Run the timer ISR for a tick that came due at dueCycle.
+static void runIsr(uint64_t dueCycle) {
+  uint64_t latency = cycles - dueCycle;
+  isrLatencyTotal += latency;
+  if (latency > isrLatencyMax)
+    isrLatencyMax = latency;
+  uint32_t before = interrupts_isrInvocationCount();
+  hostSim_advanceTicks(1);
+  if (interrupts_isrInvocationCount() != before) {
+    isrRuns++;
+    isrCycles += costs[COST_ISR].cycles;
+    cycles += costs[COST_ISR].cycles;
+  }
+}
+
+// Let the private timer count a tick without taking the interrupt.
+static void skipTick(void) {
+  interrupts_disableArmInts();
+  hostSim_advanceTicks(1);
+  __real_interrupts_enableArmInts();
+}
+
+// Deliver every tick that is due by now. Only one tick can be pending at a
+// time, so if several came due (while interrupts were masked or while an
+// earlier ISR ran) the oldest is serviced late and the rest are lost.
+static void serviceDueTicks(void) {
+  while (nextTickCycle <= cycles) {
+    uint64_t dueCycle = nextTickCycle;
+    nextTickCycle += cyclesPerTick;
+    if (!hostSim_timerIrqEnabled()) {
+      hostSim_advanceTicks(1); // Timer stopped: the tick only counts.
+      continue;
+    }
+    while (nextTickCycle <= cycles) {
+      skipTick();
+      lostTicks++;
+      nextTickCycle += cyclesPerTick;
+    }
+    runIsr(dueCycle);
+  }
+}
+
+// Spend main-loop cycles. Ticks that come due part way through preempt the
+// main loop at that instant unless ARM interrupts are masked.
+static void charge(uint64_t cost) {
+  mainLoopCycles += cost;
+  if (!hostSim_armIntsEnabled()) {
+    cycles += cost;
+    // With the timer interrupt off nothing is latched; ticks only count.
+    while (!hostSim_timerIrqEnabled() && nextTickCycle <= cycles) {
+      nextTickCycle += cyclesPerTick;
+      hostSim_advanceTicks(1);
+    }
+  } else {
+    serviceDueTicks();
+    while (nextTickCycle <= cycles + cost) {
+      cost -= nextTickCycle - cycles;
+      cycles = nextTickCycle;
+      serviceDueTicks();
+    }
+    cycles += cost;
+  }
+  if (cycles >= endCycle)
+    longjmp(endOfRun, 1);
+}
+
+// Charged for every TFT drawing call.
+static void displayCost(uint32_t pixels) {
+  pixelsDrawn += pixels;
+  charge(costs[COST_DISPLAY_CALL].cycles +
+         (uint64_t)pixels * costs[COST_PIXEL].cycles);
+}
+
+// Virtual time for the interval timers.
+static double simulatedSeconds(void) { return (double)cycles / cpuHz; }
+
+// Record hits the detector registered during one call.
+static void recordNewHits(const detector_hitCount_t before[]) {
+  detector_hitCount_t after[FILTER_FREQUENCY_COUNT];
+  detector_getHitCounts(after);
+  uint64_t tick = hostSim_getTickCount();
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    for (uint32_t n = before[f]; n < after[f]; n++, hitTotal++) {
+      if (hitTotal >= MAX_HITS_REPORTED)
+        continue;
+      hitRecord_t *hit = &hits[hitTotal];
+      hit->tick = tick;
+      hit->frequency = f;
+      hit->latencyTicks = -1;
+      for (uint32_t i = 0; i < MAX_SHOTS; i++)
+        if (shots[i].amplitude && shots[i].frequency == f &&
+            shots[i].startTick <= tick &&
+            (hit->latencyTicks < 0 ||
+             (int64_t)(tick - shots[i].startTick) < hit->latencyTicks))
+          hit->latencyTicks = tick - shots[i].startTick;
+    }
+  }
+}
+
+/******************************************************************************
+***** Wrapped firmware functions (see the --wrap options in CMakeLists.txt)
+******************************************************************************/
+
+void __wrap_detector(bool interruptsCurrentlyEnabled) {
+  detector_hitCount_t before[FILTER_FREQUENCY_COUNT];
+  detector_getHitCounts(before);
+  charge(costs[COST_DETECTOR].cycles);
+  __real_detector(interruptsCurrentlyEnabled);
+  recordNewHits(before);
+}
+
+buffer_data_t __wrap_buffer_pop(void) {
+  buffer_data_t value = __real_buffer_pop();
+  charge(costs[COST_POP].cycles);
+  return value;
+}
+
+void __wrap_buffer_advance(uint32_t count) {
+  __real_buffer_advance(count);
+  charge(costs[COST_ADVANCE].cycles);
+}
+
+// Runs inside the ISR; only tracks the ADC buffer.
+void __wrap_buffer_pushover(buffer_data_t value) {
+  if (buffer_elements() == buffer_size())
+    bufferOverruns++;
+  __real_buffer_pushover(value);
+  if (buffer_elements() > bufferHighWater)
+    bufferHighWater = buffer_elements();
+}
+
+double __wrap_filter_firFilter(void) {
+  charge(costs[COST_FIR].cycles);
+  return __real_filter_firFilter();
+}
+
+double __wrap_filter_firFilterAdc(const uint32_t codes[]) {
+  charge(costs[COST_FIR_ADC].cycles);
+  return __real_filter_firFilterAdc(codes);
+}
+
+double __wrap_filter_iirFilter(uint16_t filterNumber) {
+  filterBankCycles += costs[COST_IIR].cycles;
+  charge(costs[COST_IIR].cycles);
+  return __real_filter_iirFilter(filterNumber);
+}
+
+double __wrap_filter_computePower(uint16_t filterNumber,
+                                  bool forceComputeFromScratch,
+                                  bool debugPrint) {
+  filterBankCycles += costs[COST_POWER].cycles;
+  charge(costs[COST_POWER].cycles);
+  return __real_filter_computePower(filterNumber, forceComputeFromScratch,
+                                    debugPrint);
+}
+
+void __wrap_filter_getCurrentPowerValues(double powerValues[]) {
+  charge(costs[COST_DECISION].cycles);
+  __real_filter_getCurrentPowerValues(powerValues);
+}
+
+// A tick latched while interrupts were masked is taken right here.
+int __wrap_interrupts_enableArmInts(void) {
+  int status = __real_interrupts_enableArmInts();
+  serviceDueTicks();
+  return status;
+}
+
+bool __wrap_journal_record(journal_eventType_t type, uint8_t channel, float power,
+                           uint32_t value) {
+  journalCycles += costs[COST_JOURNAL].cycles;
+  charge(costs[COST_JOURNAL].cycles);
+  return __real_journal_record(type, channel, power, value);
+}
+
+// A polled write keeps the main loop busy; the ISR still runs.
+s32 __wrap_XSdPs_WritePolled(XSdPs *InstancePtr, u32 Arg, u32 BlkCnt, const u8 *Buff) {
+  uint64_t cost = costs[COST_SD_WRITE].cycles + (uint64_t)BlkCnt * costs[COST_SD_BLOCK].cycles;
+  journalCycles += cost;
+  charge(cost);
+  return __real_XSdPs_WritePolled(InstancePtr, Arg, BlkCnt, Buff);
+}
+
+void __wrap_spectrum_update(void) {
+  charge(costs[COST_SPECTRUM].cycles);
+  __real_spectrum_update();
+}
+
+void __wrap_fft_powerSpectrum(const float frame[], float power[]) {
+  uint64_t cost = (uint64_t)fft_getPointCount() * costs[COST_FFT].cycles;
+  fftCycles += cost;
+  fftRuns++;
+  charge(cost);
+  __real_fft_powerSpectrum(frame, power);
+}
+
+bool __wrap_scope_addSample(uint32_t rawAdcValue) {
+  scopeCycles += costs[COST_SCOPE_SAMPLE].cycles;
+  charge(costs[COST_SCOPE_SAMPLE].cycles);
+  return __real_scope_addSample(rawAdcValue);
+}
+
+// Drawing a sweep is charged by displayCost() and counted here as well; the
+// calls that find no sweep ready are only the idle main loop.
+void __wrap_scope_update(void) {
+  charge(costs[COST_SCOPE].cycles);
+  uint64_t before = mainLoopCycles;
+  __real_scope_update();
+  scopeCycles += mainLoopCycles - before;
+}
+
+// Delays burn virtual CPU time, with the ISR running as usual.
+void __wrap_utils_msDelay(long ms) { charge(ms * (cpuHz / 1000)); }
+
+/******************************************************************************
+***** Script, options and report
+******************************************************************************/
+
+// Parse one script line. Returns false on a syntax error.
+static bool parseScriptLine(char *line) {
+  char *comment = strchr(line, '#');
+  if (comment)
+    *comment = '\0';
+  double ms;
+  char command[32], arg[32];
+  int32_t a = 0, b = 0, c = 0;
+  int fields = sscanf(line, "%lf %31s %31s %d %d", &ms, command, arg, &b, &c);
+  if (fields <= 0)
+    return true; // Blank line.
+  if (fields < 3 || scriptLength == MAX_SCRIPT_EVENTS)
+    return false;
+  scriptEvent_t *event = &script[scriptLength];
+  event->tick = (uint64_t)(ms * TICKS_PER_MS);
+  if (strcmp(command, "trigger") == 0) {
+    event->type = EVENT_TRIGGER;
+    a = strcmp(arg, "down") == 0;
+  } else {
+    a = strtol(arg, NULL, 0);
+    if (strcmp(command, "buttons") == 0)
+      event->type = EVENT_BUTTONS;
+    else if (strcmp(command, "switches") == 0)
+      event->type = EVENT_SWITCHES;
+    else if (strcmp(command, "noise") == 0)
+      event->type = EVENT_NOISE;
+    else if (strcmp(command, "loopback") == 0)
+      event->type = EVENT_LOOPBACK;
+    else if (strcmp(command, "shot") == 0 && fields == 5 &&
+             a < FILTER_FREQUENCY_COUNT)
+      event->type = EVENT_SHOT;
+    else
+      return false;
+  }
+  event->args[0] = a;
+  event->args[1] = b;
+  event->args[2] = c;
+  scriptLength++;
+  return true;
+}
+
+// Read a script file. Returns false if it cannot be read or parsed.
+static bool loadScript(const char *path) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    printf("gunSim: cannot open %s\n", path);
+    return false;
+  }
+  char line[MAX_LINE_LENGTH];
+  uint32_t lineNumber = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), file)) {
+    lineNumber++;
+    if (!parseScriptLine(line)) {
+      printf("gunSim: %s:%u: cannot parse \"%s\"\n", path, lineNumber, line);
+      ok = false;
+    }
+  }
+  fclose(file);
+  // Insertion sort keeps events with the same time in file order.
+  for (uint32_t i = 1; i < scriptLength; i++)
+    for (uint32_t j = i; j > 0 && script[j - 1].tick > script[j].tick; j--) {
+      scriptEvent_t swap = script[j];
+      script[j] = script[j - 1];
+      script[j - 1] = swap;
+    }
+  return ok;
+}
+
+// Set a cost from "name=cycles". Returns false if the name is unknown.
+static bool setCost(const char *assignment) {
+  const char *equals = strchr(assignment, '=');
+  if (!equals)
+    return false;
+  for (uint32_t i = 0; i < COST_COUNT; i++) {
+    if (strlen(costs[i].name) == (size_t)(equals - assignment) &&
+        strncmp(costs[i].name, assignment, equals - assignment) == 0) {
+      costs[i].cycles = strtoul(equals + 1, NULL, 0);
+      return true;
+    }
+  }
+  return false;
+}
+
+static void printUsage(const char *program) {
+  printf("usage: %s [--mode game|shooter|continuous|spectrum|scope] [--seconds s]\n"
+         "          [--script file] [--seed n] [--cpu-mhz mhz]\n"
+         "          [--cost name=cycles]... [--expect-hits n] [--journal image]\n"
+         "          [--no-channel-mask] [--max-overruns n] [--sample-rate hz]\n"
+         "costs:",
+         program);
+  for (uint32_t i = 0; i < COST_COUNT; i++)
+    printf(" %s=%u", costs[i].name, costs[i].cycles);
+  printf("\n");
+}
+
+static void printReport(double wallSeconds) {
+  double simSeconds = simulatedSeconds();
+  uint64_t ticks = hostSim_getTickCount();
+  printf("\ngunSim report\n");
+  printf("  simulated time      %.3f s (%llu ticks)\n", simSeconds,
+         (unsigned long long)ticks);
+  printf("  wall time           %.3f s (%.1fx real time)\n", wallSeconds,
+         wallSeconds > 0 ? simSeconds / wallSeconds : 0.0);
+  printf("  ISR runs            %llu\n", (unsigned long long)isrRuns);
+  printf("  lost ticks          %llu\n", (unsigned long long)lostTicks);
+  printf("  ISR latency         mean %.2f us, max %.2f us\n",
+         isrRuns ? 1e6 * isrLatencyTotal / isrRuns / cpuHz : 0.0,
+         1e6 * isrLatencyMax / cpuHz);
+  printf("  CPU load            ISR %.1f%%, main loop %.1f%%\n",
+         cycles ? 100.0 * isrCycles / cycles : 0.0,
+         cycles ? 100.0 * mainLoopCycles / cycles : 0.0);
+  printf("  ADC buffer          high water %u of %u, %llu overruns\n",
+         bufferHighWater, buffer_size(), (unsigned long long)bufferOverruns);
+  printf("  detector calls      %u\n", detector_getInvocationCount());
+  uint32_t filterRuns, filterRunsSkipped;
+  detector_getFilterRunCounts(&filterRuns, &filterRunsSkipped);
+  printf("  IIR filter bank     %.1f%% CPU, %u runs, %.0f%% skipped by channel mask\n",
+         cycles ? 100.0 * filterBankCycles / cycles : 0.0, filterRuns,
+         filterRuns + filterRunsSkipped
+             ? 100.0 * filterRunsSkipped / (filterRuns + filterRunsSkipped)
+             : 0.0);
+  printf("  pixels drawn        %llu\n", (unsigned long long)pixelsDrawn);
+  if (fftRuns)
+    printf("  FFT                 %llu spectra, %.1f%% CPU, %.1f us each\n",
+           (unsigned long long)fftRuns, cycles ? 100.0 * fftCycles / cycles : 0.0,
+           1e6 * fftCycles / cpuHz / fftRuns);
+  uint32_t triggered;
+  uint32_t sweeps = scope_getSweepCount(&triggered);
+  if (scopeCycles)
+    printf("  scope               %u sweeps, %u triggered, %.1f%% CPU with drawing\n", sweeps,
+           triggered, 100.0 * scopeCycles / cycles);
+  if (journalImage) {
+    journal_stats_t journal;
+    journal_getStats(&journal);
+    printf("  journal             %u records, %u dropped, %u blocks in %u SD writes\n",
+           journal.records, journal.dropped, hostSim_sdGetSectorsWritten(),
+           hostSim_sdGetWriteCount());
+    printf("  journal CPU         %.3f%% (%.1f us per record and write)\n",
+           cycles ? 100.0 * journalCycles / cycles : 0.0,
+           journal.records + hostSim_sdGetWriteCount()
+               ? 1e6 * journalCycles / cpuHz / (journal.records + hostSim_sdGetWriteCount())
+               : 0.0);
+  }
+  printf("  hits                %u\n", hitTotal);
+  for (uint32_t i = 0; i < hitTotal && i < MAX_HITS_REPORTED; i++) {
+    printf("    %10.3f ms  frequency %u", (double)hits[i].tick / TICKS_PER_MS,
+           hits[i].frequency);
+    if (hits[i].latencyTicks >= 0)
+      printf("  latency %.2f ms", (double)hits[i].latencyTicks / TICKS_PER_MS);
+    printf("\n");
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const char *mode = "game";
+  double seconds = DEFAULT_SIM_SECONDS;
+  long expectedHits = -1;
+  long maxOverruns = -1;
+  const char *scriptPath = NULL;
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--mode") == 0 && hasValue)
+      mode = argv[++i];
+    else if (strcmp(argv[i], "--seconds") == 0 && hasValue)
+      seconds = atof(argv[++i]);
+    else if (strcmp(argv[i], "--script") == 0 && hasValue)
+      scriptPath = argv[++i];
+    else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+      lcgState = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--cpu-mhz") == 0 && hasValue)
+      cpuHz = strtoull(argv[++i], NULL, 0) * 1000000ull;
+    else if (strcmp(argv[i], "--cost") == 0 && hasValue && setCost(argv[i + 1]))
+      i++;
+    else if (strcmp(argv[i], "--expect-hits") == 0 && hasValue)
+      expectedHits = strtol(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--journal") == 0 && hasValue)
+      journalImage = argv[++i];
+    else if (strcmp(argv[i], "--no-channel-mask") == 0)
+      detector_setChannelMasking(false);
+    else if (strcmp(argv[i], "--max-overruns") == 0 && hasValue)
+      maxOverruns = strtol(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--sample-rate") == 0 && hasValue &&
+             sampleRate_set(strtoul(argv[i + 1], NULL, 0)))
+      i++;
+    else {
+      printUsage(argv[0]);
+      return 2;
+    }
+  }
+  void (*runMode)(void) = NULL;
+  if (strcmp(mode, "game") == 0)
+    runMode = game_twoTeamTag;
+  else if (strcmp(mode, "shooter") == 0)
+    runMode = runningModes_shooter;
+  else if (strcmp(mode, "continuous") == 0)
+    runMode = runningModes_continuous;
+  else if (strcmp(mode, "spectrum") == 0)
+    runMode = runningModes_spectrum;
+  else if (strcmp(mode, "scope") == 0)
+    runMode = runningModes_scope;
+  if (!runMode || cpuHz < sampleRate_getHz()) {
+    printUsage(argv[0]);
+    return 2;
+  }
+  if (scriptPath && !loadScript(scriptPath)) // Script times need the rate.
+    return 2;
+
+  cyclesPerTick = cpuHz / sampleRate_getHz();
+  nextTickCycle = cyclesPerTick;
+  endCycle = (uint64_t)(seconds * cpuHz);
+  hostSim_setTickHook(scriptTick);
+  hostSim_setAdcSource(simulatedAdc);
+  hostSim_setDisplayHook(displayCost);
+  hostSim_setTimeSource(simulatedSeconds);
+  // The image is the card's journal region, from its first sector.
+  hostSim_sdSetImage(journalImage, JOURNAL_SD_FIRST_SECTOR);
+  scriptTick(); // Events at time zero are visible to the inits.
+
+  struct timespec wallStart, wallEnd;
+  clock_gettime(CLOCK_MONOTONIC, &wallStart);
+  if (!setjmp(endOfRun))
+    runMode(); // Returns if the script presses BTN3 in a running mode.
+  clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+  printReport((wallEnd.tv_sec - wallStart.tv_sec) +
+              (wallEnd.tv_nsec - wallStart.tv_nsec) / 1e9);
+
+  if (expectedHits >= 0 && hitTotal != (uint32_t)expectedHits) {
+    printf("gunSim: expected %ld hits\n", expectedHits);
+    return 1;
+  }
+  if (maxOverruns >= 0 && bufferOverruns > (uint64_t)maxOverruns) {
+    printf("gunSim: more than %ld ADC buffer overruns\n", maxOverruns);
+    return 1;
+  }
+  return 0;
+}
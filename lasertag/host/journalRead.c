@@ -0,0 +1,293 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Post-game reader for the game event journal (journal.h). Each file is
+// either the journal region of a gun's SD card, e.g.
+//
+//   dd if=/dev/sdX of=gun1.img bs=512 skip=2097152 count=4096
+//
+// (JOURNAL_SD_FIRST_SECTOR, see journalSd.h) or a capture of the Bluetooth
+// link from a gun built with LASERTAG_JOURNAL=UART. Blocks are found by their
+// magic and CRC wherever they start, so stray bytes in a capture are skipped.
+//
+// For every session (one run of a gun) it prints the timeline of events and
+// a summary, then a table of who hit whom across all the files given: hits
+// are journaled by the shooter's frequency, which the shooter's own journal
+// names in its game start record.
+//
+//   journalRead gun1.img gun2.img [--csv] [--check] [--expect-hits n]
+//                                 [--expect-sessions n]
+//
+// --csv prints every record as CSV instead. --check fails on corrupt blocks
+// or blocks missing from a session.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filter.h"
+#include "journal.h"
+
+#define MAX_SESSIONS 256
+#define LABEL_SIZE 64
+#define TICKS_PER_SECOND 100000.0
+
+typedef struct {
+  char label[LABEL_SIZE];
+  uint32_t session;
+  bool started;
+  uint16_t frequency; // From the game start record.
+  uint32_t firstTick, lastTick;
+  uint32_t blocks, missingBlocks, nextSequence;
+  uint32_t records, shots, reloads, livesLost, hitsTaken;
+  bool out, ended;
+  uint32_t hitsBy[FILTER_FREQUENCY_COUNT];
+} session_t;
+
+static session_t sessions[MAX_SESSIONS];
+static uint32_t sessionCount;
+static bool csv;
+
+static const char *eventNames[JOURNAL_EVENT_TYPE_COUNT] = {
+    "?", "game start", "hit", "shot", "reload", "life lost", "out", "game end"};
+
+// Sessions are labelled file#session.
+static session_t *findSession(const char *file, uint32_t session) {
+  char label[LABEL_SIZE];
+  snprintf(label, sizeof(label), "%s#%u", file, session);
+  for (uint32_t i = 0; i < sessionCount; i++)
+    if (strcmp(sessions[i].label, label) == 0)
+      return &sessions[i];
+  if (sessionCount == MAX_SESSIONS)
+    return NULL;
+  session_t *s = &sessions[sessionCount++];
+  memset(s, 0, sizeof(*s));
+  strcpy(s->label, label);
+  s->session = session;
+  return s;
+}
+
+static void printRecord(const session_t *s, const journal_record_t *r) {
+  double seconds = (r->tick - s->firstTick) / TICKS_PER_SECOND;
+  const char *name = r->type < JOURNAL_EVENT_TYPE_COUNT ? eventNames[r->type] : "?";
+  if (csv) {
+    printf("%s,%u,%.5f,%s,%u,%g,%u\n", s->label, r->tick, seconds, name, r->channel,
+           r->power, r->value);
+    return;
+  }
+  printf("  %9.3f s  %-10s", seconds, name);
+  switch (r->type) {
+  case JOURNAL_EVENT_GAME_START:
+    printf(" frequency %u, team %c", r->channel, r->value ? 'B' : 'A');
+    break;
+  case JOURNAL_EVENT_HIT:
+    printf(" by frequency %u, power %.4g, hit %u", r->channel, r->power, r->value);
+    break;
+  case JOURNAL_EVENT_SHOT:
+    printf(" %u bullets left", r->value);
+    break;
+  case JOURNAL_EVENT_RELOAD:
+    printf(" %u bullets", r->value);
+    break;
+  case JOURNAL_EVENT_LIFE_LOST:
+    printf(" %u lives left", r->value);
+    break;
+  case JOURNAL_EVENT_GAME_END:
+    printf(" %u hits taken", r->value);
+    break;
+  }
+  printf("\n");
+}
+
+static void applyRecord(session_t *s, const journal_record_t *r) {
+  if (!s->records++)
+    s->firstTick = r->tick;
+  s->lastTick = r->tick;
+  switch (r->type) {
+  case JOURNAL_EVENT_GAME_START:
+    s->started = true;
+    s->frequency = r->channel;
+    break;
+  case JOURNAL_EVENT_HIT:
+    s->hitsTaken++;
+    if (r->channel < FILTER_FREQUENCY_COUNT)
+      s->hitsBy[r->channel]++;
+    break;
+  case JOURNAL_EVENT_SHOT:
+    s->shots++;
+    break;
+  case JOURNAL_EVENT_RELOAD:
+    s->reloads++;
+    break;
+  case JOURNAL_EVENT_LIFE_LOST:
+    s->livesLost++;
+    break;
+  case JOURNAL_EVENT_OUT:
+    s->livesLost++;
+    s->out = true;
+    break;
+  case JOURNAL_EVENT_GAME_END:
+    s->ended = true;
+    break;
+  }
+  printRecord(s, r);
+}
+
+// Find the blocks in one file and run their records. Returns the number of
+// bytes that were not part of a good block or an erased sector.
+static long readFile(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    printf("journalRead: cannot open %s\n", path);
+    return -1;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  rewind(file);
+  uint8_t *data = malloc(size > 0 ? size : 1);
+  size = fread(data, 1, size, file);
+  fclose(file);
+
+  static const uint8_t erased[JOURNAL_BLOCK_SIZE];
+  const char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+  long skipped = 0;
+  session_t *current = NULL;
+  for (long offset = 0; offset < size;) {
+    journal_blockHeader_t header;
+    if (size - offset >= JOURNAL_BLOCK_SIZE && journal_parseBlock(data + offset, &header)) {
+      session_t *s = findSession(name, header.session);
+      if (!s)
+        break;
+      if (s != current && !csv)
+        printf("%s session %u\n", name, header.session);
+      current = s;
+      if (header.sequence > s->nextSequence)
+        s->missingBlocks += header.sequence - s->nextSequence;
+      s->nextSequence = header.sequence + 1;
+      s->blocks++;
+      for (uint16_t i = 0; i < header.recordCount; i++) {
+        journal_record_t record;
+        journal_readRecord(data + offset, i, &record);
+        applyRecord(s, &record);
+      }
+      offset += JOURNAL_BLOCK_SIZE;
+    } else if (offset % JOURNAL_BLOCK_SIZE == 0 && size - offset >= JOURNAL_BLOCK_SIZE &&
+               memcmp(data + offset, erased, JOURNAL_BLOCK_SIZE) == 0) {
+      offset += JOURNAL_BLOCK_SIZE; // Never written.
+    } else {
+      offset++;
+      skipped++;
+    }
+  }
+  free(data);
+  return skipped;
+}
+
+// The gun that transmits on frequency, if one of the journals says so.
+static const session_t *shooterOn(uint16_t frequency) {
+  for (uint32_t i = 0; i < sessionCount; i++)
+    if (sessions[i].started && sessions[i].frequency == frequency)
+      return &sessions[i];
+  return NULL;
+}
+
+static void printSummary(void) {
+  printf("\nsessions\n");
+  for (uint32_t i = 0; i < sessionCount; i++) {
+    const session_t *s = &sessions[i];
+    printf("  %-24s freq %2u  %7.2f s  %3u blocks%s  shots %3u  reloads %2u  "
+           "hits taken %3u  lives lost %u%s%s\n",
+           s->label, s->frequency, (s->lastTick - s->firstTick) / TICKS_PER_SECOND,
+           s->blocks, s->missingBlocks ? " (some missing)" : "", s->shots, s->reloads,
+           s->hitsTaken, s->livesLost, s->out ? ", out" : "",
+           s->ended ? "" : ", no game end (power lost?)");
+  }
+  printf("\nwho hit whom\n");
+  for (uint32_t i = 0; i < sessionCount; i++) {
+    const session_t *s = &sessions[i];
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+      if (!s->hitsBy[f])
+        continue;
+      const session_t *shooter = shooterOn(f);
+      char name[LABEL_SIZE];
+      if (shooter)
+        snprintf(name, sizeof(name), "%s", shooter->label);
+      else
+        snprintf(name, sizeof(name), "frequency %u", f);
+      printf("  %-24s hit %-24s %3u times\n", name, s->label, s->hitsBy[f]);
+    }
+  }
+}
+
+static void printUsage(const char *program) {
+  printf("usage: %s file... [--csv] [--check] [--expect-hits n] [--expect-sessions n]\n",
+         program);
+}
+
+int main(int argc, char *argv[]) {
+  bool check = false;
+  long expectedHits = -1, expectedSessions = -1;
+  const char *paths[MAX_SESSIONS];
+  uint32_t pathCount = 0;
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--csv") == 0)
+      csv = true;
+    else if (strcmp(argv[i], "--check") == 0)
+      check = true;
+    else if (strcmp(argv[i], "--expect-hits") == 0 && hasValue)
+      expectedHits = strtol(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--expect-sessions") == 0 && hasValue)
+      expectedSessions = strtol(argv[++i], NULL, 0);
+    else if (argv[i][0] != '-' && pathCount < MAX_SESSIONS)
+      paths[pathCount++] = argv[i];
+    else {
+      printUsage(argv[0]);
+      return 2;
+    }
+  }
+  if (!pathCount) {
+    printUsage(argv[0]);
+    return 2;
+  }
+
+  if (csv)
+    printf("session,tick,seconds,event,channel,power,value\n");
+  long skipped = 0;
+  for (uint32_t p = 0; p < pathCount; p++) {
+    long fileSkipped = readFile(paths[p]);
+    if (fileSkipped < 0)
+      return 1;
+    skipped += fileSkipped;
+  }
+  if (!csv) {
+    printSummary();
+    printf("\n%ld bytes outside good blocks\n", skipped);
+  }
+
+  uint32_t hits = 0, missing = 0;
+  for (uint32_t i = 0; i < sessionCount; i++) {
+    hits += sessions[i].hitsTaken;
+    missing += sessions[i].missingBlocks;
+  }
+  bool pass = true;
+  if (check && (skipped || missing)) {
+    printf("journalRead: %ld bytes outside good blocks, %u blocks missing\n", skipped, missing);
+    pass = false;
+  }
+  if (expectedHits >= 0 && hits != (uint32_t)expectedHits) {
+    printf("journalRead: %u hits, expected %ld\n", hits, expectedHits);
+    pass = false;
+  }
+  if (expectedSessions >= 0 && sessionCount != (uint32_t)expectedSessions) {
+    printf("journalRead: %u sessions, expected %ld\n", sessionCount, expectedSessions);
+    pass = false;
+  }
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// The gun at each acquisition rate (sampleRate.h): the same random shots,
+// through the optical channel model generated at that rate, go into the ISR
+// and the real detector, with the filters designed for the rate. For each
+// rate it reports the shots detected, the hits on the wrong frequency, the
+// false hits in as long again with nobody shooting, and the host time the ISR
+// and detector take per simulated second, the CPU load the rate costs.
+//
+//   rateBench [--shots n] [--min-distance m] [--max-distance m] [--seed n]
+//             [--rate hz]... [--check]
+//
+// The channel samples are generated ahead of the timed part. --check fails
+// if any rate detects fewer than 90% of the shots, calls the wrong frequency
+// or has false hits.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "channel.h"
+#include "detector.h"
+#include "filter.h"
+#include "hostSim.h"
+#include "interrupts.h"
+#include "isr.h"
+#include "sampleRate.h"
+
+#define MAX_RATES 8
+#define SHOT_SPACING_S 1.0 // One shot a second, well clear of the lockout.
+#define SHOT_OFFSET_S 0.1
+#define SHOT_JITTER_S 0.3
+#define SHOT_DURATION_S 0.2
+#define DETECTOR_CALLS_PER_SECOND 1000
+#define MAX_TICKS_PER_CALL 200
+#define MIN_DETECTED_FRACTION 0.9
+
+typedef struct {
+  uint32_t shots, seed;
+  double minDistanceM, maxDistanceM;
+  uint32_t rates[MAX_RATES];
+  uint32_t rateCount;
+  bool check;
+} options_t;
+
+typedef struct {
+  uint32_t detected;       // Shots registered on the shooter's frequency.
+  uint32_t wrongFrequency; // Shots registered on another one.
+  uint32_t falseHits;      // Hits with nobody shooting.
+  double seconds;          // Host time in the ISR and detector.
+} result_t;
+
+static uint16_t samples[MAX_TICKS_PER_CALL];
+static uint32_t nextSample;
+
+static uint32_t samplesAdcSource(void) { return samples[nextSample++]; }
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static double unitRandom(uint64_t *state) {
+  *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+  return (*state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Run the shots at hz, or as long with nobody shooting if silent.
+static void runShots(const options_t *options, uint32_t hz, bool silent, result_t *result) {
+  sampleRate_set(hz);
+  channel_config_t config;
+  channel_initConfig(&config);
+  config.sampleRateHz = hz;
+  config.flickerAmplitude = 100;
+  config.sunlight = 400;
+  config.noiseSigma = 10;
+  config.seed = options->seed;
+  channel_t channel;
+  channel_init(&channel, &config);
+  filter_init();
+  filter_reset(); // Clear the power sums of the last run.
+  isr_init();
+  detector_init();
+  interrupts_initAll(false);
+  interrupts_setPrivateTimerLoadValue(sampleRate_getTimerLoadValue());
+  hostSim_setAdcSource(samplesAdcSource);
+  interrupts_enableTimerGlobalInts();
+  interrupts_startArmPrivateTimer();
+  interrupts_enableArmInts();
+
+  uint64_t random = options->seed;
+  uint32_t ticksPerCall = hz / DETECTOR_CALLS_PER_SECOND;
+  uint32_t ticksPerShot = SHOT_SPACING_S * hz;
+  for (uint32_t shot = 0; shot < options->shots; shot++) {
+    uint16_t frequency = unitRandom(&random) * FILTER_FREQUENCY_COUNT;
+    double distance = options->minDistanceM +
+                      unitRandom(&random) * (options->maxDistanceM - options->minDistanceM);
+    double start = shot * SHOT_SPACING_S + SHOT_OFFSET_S + unitRandom(&random) * SHOT_JITTER_S;
+    channel_config_t shooter = config;
+    shooter.shooterCount = 0;
+    if (!silent)
+      channel_addShooter(&shooter, frequency, distance, start, SHOT_DURATION_S);
+    channel_setShooters(&channel, shooter.shooters, shooter.shooterCount);
+
+    detector_clearHit();
+    for (uint32_t tick = 0; tick < ticksPerShot; tick += ticksPerCall) {
+      channel_generate(&channel, samples, ticksPerCall);
+      nextSample = 0;
+      double begin = now();
+      hostSim_advanceTicks(ticksPerCall);
+      detector(true);
+      result->seconds += now() - begin;
+    }
+    if (!detector_hitDetected())
+      continue;
+    if (silent)
+      result->falseHits++;
+    else if (detector_getFrequencyNumberOfLastHit() == frequency)
+      result->detected++;
+    else
+      result->wrongFrequency++;
+  }
+  interrupts_disableArmInts();
+  hostSim_setAdcSource(NULL);
+}
+
+static void printUsage(const char *program) {
+  printf("usage: %s [--shots n] [--min-distance m] [--max-distance m] [--seed n]\n"
+         "          [--rate hz]... [--check]\n",
+         program);
+}
+
+int main(int argc, char *argv[]) {
+  options_t options = {200, 1, 5.0, 30.0, {0}, 0, false};
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--shots") == 0 && hasValue)
+      options.shots = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--min-distance") == 0 && hasValue)
+      options.minDistanceM = strtod(argv[++i], NULL);
+    else if (strcmp(argv[i], "--max-distance") == 0 && hasValue)
+      options.maxDistanceM = strtod(argv[++i], NULL);
+    else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+      options.seed = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--rate") == 0 && hasValue && options.rateCount < MAX_RATES)
+      options.rates[options.rateCount++] = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--check") == 0)
+      options.check = true;
+    else {
+      printUsage(argv[0]);
+      return 2;
+    }
+  }
+  if (!options.rateCount) {
+    static const uint32_t defaultRates[] = {50000, 80000, 100000, 125000};
+    options.rateCount = sizeof(defaultRates) / sizeof(defaultRates[0]);
+    memcpy(options.rates, defaultRates, sizeof(defaultRates));
+  }
+  for (uint32_t r = 0; r < options.rateCount; r++) {
+    if (!sampleRate_set(options.rates[r])) {
+      printf("rateBench: this build cannot run at %u Hz\n", options.rates[r]);
+      return 2;
+    }
+  }
+  if (!options.shots) {
+    printUsage(argv[0]);
+    return 2;
+  }
+
+  printf("%u shots, %.0f-%.0f m, and %.0f s with nobody shooting, at each rate\n",
+         options.shots, options.minDistanceM, options.maxDistanceM,
+         options.shots * SHOT_SPACING_S);
+  printf("%9s %10s %9s %11s %10s %14s\n", "rate Hz", "decimation", "detected",
+         "wrong freq", "false hits", "host ms per s");
+  bool pass = true;
+  double referenceLoad = 0;
+  for (uint32_t r = 0; r < options.rateCount; r++) {
+    uint32_t hz = options.rates[r];
+    result_t shots = {0}, silent = {0};
+    runShots(&options, hz, false, &shots);
+    runShots(&options, hz, true, &silent);
+    double seconds = 2 * options.shots * SHOT_SPACING_S;
+    double load = (shots.seconds + silent.seconds) / seconds * 1000;
+    if (hz == SAMPLE_RATE_REFERENCE_HZ)
+      referenceLoad = load;
+    printf("%9u %10u %8.1f%% %11u %10u %14.2f\n", hz, sampleRate_getDecimation(),
+           100.0 * shots.detected / options.shots, shots.wrongFrequency, silent.falseHits,
+           load);
+    pass = pass && shots.detected >= MIN_DETECTED_FRACTION * options.shots &&
+           !shots.wrongFrequency && !silent.falseHits;
+  }
+  if (referenceLoad > 0)
+    printf("host ms per simulated second is the ISR and detector; %.2f at %d Hz\n",
+           referenceLoad, SAMPLE_RATE_REFERENCE_HZ);
+  sampleRate_set(SAMPLE_RATE_REFERENCE_HZ);
+
+  if (!options.check)
+    return 0;
+  if (!pass)
+    printf("rateBench: FAILED\n");
+  return pass ? 0 : 1;
+}
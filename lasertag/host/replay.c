@@ -0,0 +1,555 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Offline detection over long captures, split across all cores.
+//
+// The capture is cut into chunks that are filtered independently, each on a
+// worker thread with its own filter instance. A chunk starts from clean
+// filters and first runs a pre-roll: the samples just before it, so its FIR
+// and IIR filters hold the recent history by the time it reaches its own first
+// sample. Only then does it record the decimated samples where
+// detector_detectHit() is true. The lockout depends on the previous hit, so it
+// is applied afterwards, in capture order, while the chunks are merged; a shot
+// that straddles a seam is counted once.
+//
+// The IIR filters never forget their history bit for bit: two runs that differ
+// only in rounding long ago keep differing in the last bits. A chunk's filters
+// are therefore defined by its pre-roll, not by everything before it, and the
+// sequential pass (--sequential) does exactly the same resets at the same
+// places. The parallel result is thus identical to the sequential one for any
+// number of threads. --verify checks that, and also reports how the hits
+// compare with one continuous pass that never resets, which is what the gun
+// itself does.
+//
+// The input is a raw capture of 16-bit ADC samples at 100 kHz (as written by
+// channelGen) or a synthetic capture of random shots generated on the fly.
+//
+// A capture that continues an earlier one can start from the filter state
+// that one ended with (--state-out, then --state-in; see filter_saveState()),
+// so its first chunk needs no pre-roll and no settling. Samples after the
+// last decimated sample of the earlier capture (under 0.1 ms) are in the
+// state, but the decimation starts over with the new capture. --verify also
+// stops the continuous pass half way, snapshots it, restores the snapshot
+// into clean filters and carries on: the hits must be those of the pass that
+// never stopped.
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "channel.h"
+#include "detector.h"
+#include "filter.h"
+#include "instance.h"
+#include "lockoutTimer.h"
+#include "shotCode.h"
+
+#define SAMPLE_RATE (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000)
+#define DEFAULT_CHUNK_SECONDS 30
+#define DEFAULT_PREROLL_SECONDS 2 // IIR transients are down by 1e-30 by then.
+#define READ_BLOCK_SAMPLES 4096
+#define MAX_THREADS 256
+#define ADC_MAX_VALUE 4095.0
+#define ADC_SCALAR 2.0
+#define DEFAULT_PLAYER_HIT 2
+
+// Synthetic captures are scripted a section at a time.
+#define SYNTHETIC_SECTION_SECONDS 10
+#define SYNTHETIC_SHOTS_PER_SECTION 6
+#define SYNTHETIC_SHOT_SECONDS 0.2
+#define SYNTHETIC_MIN_DISTANCE_M 3.0
+#define SYNTHETIC_MAX_DISTANCE_M 30.0
+
+// A decimated sample where the detector would have reported a hit, had the
+// gun not been locked out.
+typedef struct {
+  uint64_t sample; // Index of the ADC sample that completed the decision.
+  uint16_t frequencyNumber;
+} candidate_t;
+
+typedef struct {
+  uint64_t start, end; // Samples owned by this chunk: [start, end).
+  candidate_t *candidates;
+  uint32_t candidateCount, candidateCapacity;
+  bool done;
+} chunk_t;
+
+typedef struct {
+  candidate_t *hits;
+  uint32_t count, capacity;
+  uint64_t lockoutEnd; // First sample after the current lockout.
+} hitList_t;
+
+static struct {
+  const uint16_t *capture; // Mapped capture, or NULL for synthetic input.
+  uint64_t sampleCount;
+  channel_config_t synthetic;
+  uint64_t preroll;
+  bool ignored[FILTER_FREQUENCY_COUNT];
+  uint8_t *initialState; // --state-in, or NULL to start from silence.
+  uint32_t initialStateSize;
+  uint8_t *finalState; // The filters after the last sample, for --state-out.
+  uint32_t finalStateSize;
+} replay;
+
+static chunk_t *chunks;
+static uint32_t chunkCount;
+static uint32_t nextChunk;
+static pthread_mutex_t chunkLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t chunkDone = PTHREAD_COND_INITIALIZER;
+
+// splitmix64, used to script each synthetic section from its index alone.
+static uint64_t mix64(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+static double unitRandom(uint64_t *state) {
+  *state = mix64(*state);
+  return (*state >> 11) * 0x1.0p-53;
+}
+
+// Script the shots of one synthetic section. Shots end before the section
+// does, so a sample only ever depends on its own section.
+static uint16_t scriptSection(uint64_t section, channel_shooter_t shooters[]) {
+  uint64_t random = replay.synthetic.seed ^ (section * 0xD1B54A32D192ED03ull);
+  double slot = (double)SYNTHETIC_SECTION_SECONDS / SYNTHETIC_SHOTS_PER_SECTION;
+  for (uint16_t s = 0; s < SYNTHETIC_SHOTS_PER_SECTION; s++) {
+    shooters[s].frequencyNumber = unitRandom(&random) * FILTER_FREQUENCY_COUNT;
+    shooters[s].distanceM =
+        SYNTHETIC_MIN_DISTANCE_M +
+        unitRandom(&random) * (SYNTHETIC_MAX_DISTANCE_M - SYNTHETIC_MIN_DISTANCE_M);
+    shooters[s].startS = section * SYNTHETIC_SECTION_SECONDS + s * slot +
+                         unitRandom(&random) * (slot - 2 * SYNTHETIC_SHOT_SECONDS);
+    shooters[s].durationS = SYNTHETIC_SHOT_SECONDS;
+    shooters[s].code = SHOTCODE_NONE;
+  }
+  return SYNTHETIC_SHOTS_PER_SECTION;
+}
+
+// Read count samples starting at first. Synthetic input is generated with a
+// channel per thread.
+static void readSamples(uint64_t first, uint16_t samples[], uint32_t count) {
+  static INSTANCE_LOCAL channel_t *channel;
+  static INSTANCE_LOCAL uint64_t channelSection = UINT64_MAX;
+  if (replay.capture) {
+    memcpy(samples, replay.capture + first, count * sizeof(samples[0]));
+    return;
+  }
+  if (!channel) {
+    channel = malloc(sizeof(*channel));
+    channel_init(channel, &replay.synthetic);
+  }
+  uint64_t sectionSamples = (uint64_t)SYNTHETIC_SECTION_SECONDS * SAMPLE_RATE;
+  while (count) {
+    uint64_t section = first / sectionSamples;
+    uint64_t left = (section + 1) * sectionSamples - first;
+    uint32_t n = left < count ? left : count;
+    if (section != channelSection) {
+      channel_shooter_t shooters[SYNTHETIC_SHOTS_PER_SECTION];
+      channel_setShooters(channel, shooters, scriptSection(section, shooters));
+      channelSection = section;
+    }
+    channel_seek(channel, first);
+    channel_generate(channel, samples, n);
+    first += n;
+    samples += n;
+    count -= n;
+  }
+}
+
+static void addCandidate(chunk_t *chunk, uint64_t sample, uint16_t frequency) {
+  if (chunk->candidateCount == chunk->candidateCapacity) {
+    chunk->candidateCapacity = chunk->candidateCapacity ? 2 * chunk->candidateCapacity : 64;
+    chunk->candidates = realloc(chunk->candidates,
+                                chunk->candidateCapacity * sizeof(candidate_t));
+  }
+  chunk->candidates[chunk->candidateCount++] = (candidate_t){sample, frequency};
+}
+
+// Run samples [from, to) through the filters of the calling thread, the same
+// way detector() does. from must be a multiple of the decimation factor. With
+// restart, the power is computed from scratch on the first decimated sample.
+// Candidates are recorded into chunk unless it is NULL (pre-roll).
+static void filterRange(uint64_t from, uint64_t to, bool restart, chunk_t *chunk) {
+  uint16_t samples[READ_BLOCK_SAMPLES];
+  while (from < to) {
+    uint32_t count = to - from < READ_BLOCK_SAMPLES ? to - from : READ_BLOCK_SAMPLES;
+    readSamples(from, samples, count);
+    for (uint32_t i = 0; i < count; i++) {
+      filter_addNewInput(((double)samples[i] / ADC_MAX_VALUE) * ADC_SCALAR - 1.0);
+      uint64_t sample = from + i;
+      if ((sample + 1) % FILTER_FIR_DECIMATION_FACTOR)
+        continue;
+      filter_firFilter();
+      for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+        filter_iirFilter(f);
+        filter_computePower(f, restart, false);
+      }
+      restart = false;
+      double powerValues[FILTER_FREQUENCY_COUNT];
+      filter_getCurrentPowerValues(powerValues);
+      if (!chunk || !detector_detectHit(powerValues))
+        continue;
+      uint16_t player = DEFAULT_PLAYER_HIT;
+      for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+        if (powerValues[f] > powerValues[player])
+          player = f;
+      if (!replay.ignored[player])
+        addCandidate(chunk, sample, player);
+    }
+    from += count;
+  }
+}
+
+// Reset the filters of the calling thread, to the --state-in state if there
+// is one. Returns true if they start from silence.
+static bool startFilters(void) {
+  filter_reset();
+  return !replay.initialState ||
+         !filter_restoreState(replay.initialState, replay.initialStateSize);
+}
+
+// Filter one chunk on the calling thread: reset, pre-roll, then record. The
+// first chunk starts from the --state-in state instead of a pre-roll, and
+// the last one leaves its state for --state-out.
+static void runChunk(chunk_t *chunk) {
+  uint64_t prerollStart = chunk->start > replay.preroll ? chunk->start - replay.preroll : 0;
+  bool silent = true;
+  if (chunk->start)
+    filter_reset();
+  else
+    silent = startFilters();
+  filterRange(prerollStart, chunk->start, true, NULL);
+  filterRange(chunk->start, chunk->end, prerollStart == chunk->start && silent, chunk);
+  if (chunk->end == replay.sampleCount && replay.finalState)
+    replay.finalStateSize = filter_saveState(replay.finalState, FILTER_STATE_MAX_SIZE);
+}
+
+static void *worker(void *arg) {
+  (void)arg;
+  filter_init();
+  for (;;) {
+    pthread_mutex_lock(&chunkLock);
+    uint32_t index = nextChunk++;
+    pthread_mutex_unlock(&chunkLock);
+    if (index >= chunkCount)
+      return NULL;
+    runChunk(&chunks[index]);
+    pthread_mutex_lock(&chunkLock);
+    chunks[index].done = true;
+    pthread_cond_broadcast(&chunkDone);
+    pthread_mutex_unlock(&chunkLock);
+  }
+}
+
+// Apply the lockout to the candidates of the next chunk in capture order.
+static void mergeChunk(hitList_t *list, const chunk_t *chunk) {
+  for (uint32_t i = 0; i < chunk->candidateCount; i++) {
+    const candidate_t *candidate = &chunk->candidates[i];
+    if (candidate->sample < list->lockoutEnd)
+      continue;
+    if (list->count == list->capacity) {
+      list->capacity = list->capacity ? 2 * list->capacity : 64;
+      list->hits = realloc(list->hits, list->capacity * sizeof(candidate_t));
+    }
+    list->hits[list->count++] = *candidate;
+    list->lockoutEnd = candidate->sample + LOCKOUT_TIMER_EXPIRE_VALUE;
+  }
+}
+
+static void initChunks(uint64_t chunkSamples) {
+  chunkCount = (replay.sampleCount + chunkSamples - 1) / chunkSamples;
+  chunks = calloc(chunkCount, sizeof(chunk_t));
+  for (uint32_t c = 0; c < chunkCount; c++) {
+    chunks[c].start = c * chunkSamples;
+    chunks[c].end = chunks[c].start + chunkSamples < replay.sampleCount
+                        ? chunks[c].start + chunkSamples
+                        : replay.sampleCount;
+  }
+}
+
+// Detect over the whole capture. With no threads every chunk is filtered in
+// turn on this thread; otherwise the workers filter them and this thread
+// merges them in order as they finish.
+static void detectChunks(uint32_t threads, uint64_t chunkSamples, hitList_t *list) {
+  memset(list, 0, sizeof(*list));
+  initChunks(chunkSamples);
+  nextChunk = 0;
+  pthread_t workers[MAX_THREADS];
+  for (uint32_t t = 0; t < threads; t++)
+    pthread_create(&workers[t], NULL, worker, NULL);
+  for (uint32_t c = 0; c < chunkCount; c++) {
+    chunk_t *chunk = &chunks[c];
+    if (threads) {
+      pthread_mutex_lock(&chunkLock);
+      while (!chunk->done)
+        pthread_cond_wait(&chunkDone, &chunkLock);
+      pthread_mutex_unlock(&chunkLock);
+    } else {
+      runChunk(chunk);
+    }
+    mergeChunk(list, chunk);
+    free(chunk->candidates);
+  }
+  for (uint32_t t = 0; t < threads; t++)
+    pthread_join(workers[t], NULL);
+  free(chunks);
+}
+
+// Detect over the whole capture in one pass that never resets the filters.
+static void detectContinuous(hitList_t *list) {
+  chunk_t whole = {.start = 0, .end = replay.sampleCount};
+  memset(list, 0, sizeof(*list));
+  filterRange(whole.start, whole.end, startFilters(), &whole);
+  mergeChunk(list, &whole);
+  free(whole.candidates);
+}
+
+// The continuous pass again, but stopped half way: the filters are saved,
+// reset and restored before it carries on. Returns false if this build
+// cannot save its filters.
+static bool detectResumed(hitList_t *list) {
+  uint64_t middle = replay.sampleCount / 2 / FILTER_FIR_DECIMATION_FACTOR *
+                    FILTER_FIR_DECIMATION_FACTOR;
+  chunk_t halves[2] = {{.start = 0, .end = middle},
+                       {.start = middle, .end = replay.sampleCount}};
+  memset(list, 0, sizeof(*list));
+  filterRange(halves[0].start, halves[0].end, startFilters(), &halves[0]);
+  uint8_t *state = malloc(FILTER_STATE_MAX_SIZE);
+  uint32_t size = filter_saveState(state, FILTER_STATE_MAX_SIZE);
+  filter_reset();
+  bool restored = filter_restoreState(state, size);
+  free(state);
+  if (restored)
+    filterRange(halves[1].start, halves[1].end, false, &halves[1]);
+  for (uint16_t h = 0; h < 2; h++) {
+    mergeChunk(list, &halves[h]);
+    free(halves[h].candidates);
+  }
+  return restored;
+}
+
+// Read a whole file into memory. Returns NULL if it cannot be read.
+static uint8_t *readFile(const char *path, uint32_t *size) {
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return NULL;
+  uint8_t *data = malloc(FILTER_STATE_MAX_SIZE);
+  *size = fread(data, 1, FILTER_STATE_MAX_SIZE, file);
+  fclose(file);
+  return data;
+}
+
+static bool writeFile(const char *path, const uint8_t *data, uint32_t size) {
+  FILE *file = fopen(path, "wb");
+  bool written = file && fwrite(data, 1, size, file) == size;
+  if (file)
+    fclose(file);
+  return written;
+}
+
+static bool mapCapture(const char *path) {
+  int fd = open(path, O_RDONLY);
+  struct stat info;
+  if (fd < 0 || fstat(fd, &info) < 0) {
+    printf("replay: cannot open %s\n", path);
+    return false;
+  }
+  replay.sampleCount = info.st_size / sizeof(uint16_t);
+  if (replay.sampleCount) {
+    replay.capture = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (replay.capture == MAP_FAILED) {
+      printf("replay: cannot map %s\n", path);
+      return false;
+    }
+    madvise((void *)replay.capture, info.st_size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+  return true;
+}
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void printHits(const hitList_t *list) {
+  for (uint32_t i = 0; i < list->count; i++)
+    printf("hit at %12.5f s (sample %llu) by player %u\n",
+           (double)list->hits[i].sample / SAMPLE_RATE,
+           (unsigned long long)list->hits[i].sample, list->hits[i].frequencyNumber);
+}
+
+static bool sameHit(const candidate_t *a, const candidate_t *b) {
+  return a->sample == b->sample && a->frequencyNumber == b->frequencyNumber;
+}
+
+// Returns how many hits of a have no identical hit in b.
+static uint32_t countMissing(const hitList_t *a, const hitList_t *b) {
+  uint32_t missing = 0, j = 0;
+  for (uint32_t i = 0; i < a->count; i++) {
+    while (j < b->count && b->hits[j].sample < a->hits[i].sample)
+      j++;
+    if (j == b->count || !sameHit(&a->hits[i], &b->hits[j]))
+      missing++;
+  }
+  return missing;
+}
+
+static void printUsage(const char *program) {
+  printf("usage: %s (capture.raw | --synthetic seconds) [--threads n]\n"
+         "          [--chunk-seconds s] [--preroll-seconds s] [--ignore f]...\n"
+         "          [--seed n] [--state-in file] [--state-out file]\n"
+         "          [--sequential] [--verify] [--quiet]\n",
+         program);
+}
+
+int main(int argc, char *argv[]) {
+  const char *capturePath = NULL;
+  const char *stateInPath = NULL, *stateOutPath = NULL;
+  double syntheticSeconds = 0;
+  double chunkSeconds = DEFAULT_CHUNK_SECONDS;
+  double prerollSeconds = DEFAULT_PREROLL_SECONDS;
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t threads = cores > 0 ? cores : 1;
+  bool sequential = false, verify = false, quiet = false;
+  channel_initConfig(&replay.synthetic);
+  replay.synthetic.flickerAmplitude = 100;
+  replay.synthetic.sunlight = 300;
+  for (int i = 1; i < argc; i++) {
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (strcmp(argv[i], "--sequential") == 0) {
+      sequential = true;
+      continue;
+    } else if (strcmp(argv[i], "--verify") == 0) {
+      verify = true;
+      continue;
+    } else if (strcmp(argv[i], "--quiet") == 0) {
+      quiet = true;
+      continue;
+    } else if (argv[i][0] != '-' && !capturePath) {
+      capturePath = argv[i];
+      continue;
+    }
+    if (!value) {
+      printUsage(argv[0]);
+      return 2;
+    }
+    if (strcmp(argv[i], "--synthetic") == 0)
+      syntheticSeconds = atof(value);
+    else if (strcmp(argv[i], "--threads") == 0)
+      threads = atoi(value);
+    else if (strcmp(argv[i], "--chunk-seconds") == 0)
+      chunkSeconds = atof(value);
+    else if (strcmp(argv[i], "--preroll-seconds") == 0)
+      prerollSeconds = atof(value);
+    else if (strcmp(argv[i], "--seed") == 0)
+      replay.synthetic.seed = strtoull(value, NULL, 0);
+    else if (strcmp(argv[i], "--state-in") == 0)
+      stateInPath = value;
+    else if (strcmp(argv[i], "--state-out") == 0)
+      stateOutPath = value;
+    else if (strcmp(argv[i], "--ignore") == 0 && atoi(value) >= 0 &&
+             atoi(value) < FILTER_FREQUENCY_COUNT)
+      replay.ignored[atoi(value)] = true;
+    else {
+      printUsage(argv[0]);
+      return 2;
+    }
+    i++;
+  }
+  if (!capturePath == !(syntheticSeconds > 0) || threads < 1 || threads > MAX_THREADS) {
+    printUsage(argv[0]);
+    return 2;
+  }
+  if (capturePath && !mapCapture(capturePath))
+    return 1;
+  if (!capturePath)
+    replay.sampleCount = (uint64_t)(syntheticSeconds * SAMPLE_RATE);
+
+  // Chunks and pre-rolls keep the decimation phase of the whole capture.
+  uint64_t chunkSamples = (uint64_t)(chunkSeconds * SAMPLE_RATE) /
+                          FILTER_FIR_DECIMATION_FACTOR * FILTER_FIR_DECIMATION_FACTOR;
+  if (chunkSamples < FILTER_FIR_DECIMATION_FACTOR)
+    chunkSamples = FILTER_FIR_DECIMATION_FACTOR;
+  replay.preroll = (uint64_t)(prerollSeconds * SAMPLE_RATE) /
+                   FILTER_FIR_DECIMATION_FACTOR * FILTER_FIR_DECIMATION_FACTOR;
+  filter_init();
+  if (stateInPath) {
+    replay.initialState = readFile(stateInPath, &replay.initialStateSize);
+    if (!replay.initialState ||
+        !filter_restoreState(replay.initialState, replay.initialStateSize)) {
+      printf("replay: %s is not a filter state of this build\n", stateInPath);
+      return 1;
+    }
+  }
+  if (stateOutPath)
+    replay.finalState = malloc(FILTER_STATE_MAX_SIZE);
+
+  double seconds = (double)replay.sampleCount / SAMPLE_RATE;
+  hitList_t sequentialHits, parallelHits;
+  double sequentialTime = 0, parallelTime = 0;
+  if (sequential || verify) {
+    double start = now();
+    detectChunks(0, chunkSamples, &sequentialHits);
+    sequentialTime = now() - start;
+    printf("sequential: %.1f s of samples in %.2f s (%.0fx real time), %u hits\n",
+           seconds, sequentialTime, seconds / sequentialTime, sequentialHits.count);
+  }
+  if (!sequential) {
+    double start = now();
+    detectChunks(threads, chunkSamples, &parallelHits);
+    parallelTime = now() - start;
+    printf("parallel: %.1f s of samples in %.2f s (%.0fx real time), %u hits, "
+           "%u threads, %u chunks of %.0f s, %.0f s pre-roll\n",
+           seconds, parallelTime, seconds / parallelTime, parallelHits.count, threads,
+           chunkCount, (double)chunkSamples / SAMPLE_RATE,
+           (double)replay.preroll / SAMPLE_RATE);
+  }
+  if (!quiet)
+    printHits(sequential ? &sequentialHits : &parallelHits);
+  if (stateOutPath && !writeFile(stateOutPath, replay.finalState, replay.finalStateSize)) {
+    printf("replay: cannot write the filter state to %s\n", stateOutPath);
+    return 1;
+  }
+  if (!verify)
+    return 0;
+
+  bool same = sequentialHits.count == parallelHits.count &&
+              countMissing(&sequentialHits, &parallelHits) == 0;
+  printf("verify: parallel and sequential hits %s, speedup %.2fx\n",
+         same ? "identical" : "DIFFER", sequentialTime / parallelTime);
+  hitList_t continuousHits;
+  detectContinuous(&continuousHits);
+  printf("verify: continuous pass has %u hits, %u not in the chunked result, "
+         "%u chunked hits not in it\n",
+         continuousHits.count, countMissing(&continuousHits, &parallelHits),
+         countMissing(&parallelHits, &continuousHits));
+  hitList_t resumedHits;
+  if (detectResumed(&resumedHits)) {
+    bool resumedSame = resumedHits.count == continuousHits.count &&
+                       countMissing(&resumedHits, &continuousHits) == 0;
+    printf("verify: continuous pass resumed from a snapshot half way: hits %s\n",
+           resumedSame ? "identical" : "DIFFER");
+    same = same && resumedSame;
+  } else {
+    printf("verify: this build cannot snapshot its filters\n");
+  }
+  return same ? 0 : 1;
+}
@@ -0,0 +1,214 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Coded shots (shotCode.h) through the optical channel model: many players
+// share the ten frequencies, each with its own ID, and shoot one gun in turn
+// from random distances through flicker, sunlight and noise. The gun runs the
+// real detector with coded shots on, fed by the ISR; every shot must be
+// registered with the shooter's ID. The same shots are run again with coded
+// shots off for the plain detection rate.
+//
+// It also measures what decoding costs: detector() time per decimated sample
+// with coded shots on and off, and the slicer alone (shotCode_addSample() for
+// every channel and shotCode_endSample()) per decimated sample.
+//
+//   shotCodeBench [--shots n] [--players n] [--min-distance m]
+//                 [--max-distance m] [--seed n] [--check]
+//
+// Last, the same time passes with nobody shooting, for false hits. --check
+// fails unless at least 95% as many shots are decoded as the plain detector
+// finds, no shot is given a wrong ID and there are no false hits.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "channel.h"
+#include "detector.h"
+#include "filter.h"
+#include "hostSim.h"
+#include "interrupts.h"
+#include "isr.h"
+#include "shotCode.h"
+
+#define SAMPLE_RATE 100000
+#define SHOT_SPACING_S 1.0 // One shot a second, well clear of the lockout.
+#define SHOT_OFFSET_S 0.1
+#define SHOT_JITTER_S 0.3
+#define TICKS_PER_DETECTOR_CALL 100
+#define SLICER_SAMPLES 10000000
+#define MIN_DECODED_FRACTION 0.95
+
+typedef struct {
+  uint32_t shots, players, seed;
+  double minDistanceM, maxDistanceM;
+  bool check;
+} options_t;
+
+typedef struct {
+  uint32_t registered; // Hits the detector registered.
+  uint32_t correct;    // ...with the shooter's ID.
+  uint32_t wrong;      // ...with someone else's.
+  double detectorSeconds;
+  uint64_t decimatedSamples;
+} result_t;
+
+static channel_t channel;
+
+static uint32_t channelAdcSource(void) {
+  uint16_t sample;
+  channel_generate(&channel, &sample, 1);
+  return sample;
+}
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static double unitRandom(uint64_t *state) {
+  *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+  return (*state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Player p shoots on frequency p % 10 with ID p. With silent, nobody shoots
+// and every hit is a false one.
+static void runShots(const options_t *options, bool coded, bool silent, result_t *result) {
+  memset(result, 0, sizeof(*result));
+  channel_config_t config;
+  channel_initConfig(&config);
+  config.flickerAmplitude = 100;
+  config.sunlight = 400;
+  config.noiseSigma = 10;
+  config.seed = options->seed;
+  channel_init(&channel, &config);
+  filter_init();
+  isr_init();
+  detector_init();
+  detector_setCodedShots(coded);
+  interrupts_initAll(false);
+  hostSim_setAdcSource(channelAdcSource);
+  interrupts_enableTimerGlobalInts();
+  interrupts_startArmPrivateTimer();
+  interrupts_enableArmInts();
+
+  uint64_t random = options->seed;
+  uint32_t ticksPerShot = SHOT_SPACING_S * SAMPLE_RATE;
+  for (uint32_t shot = 0; shot < options->shots; shot++) {
+    uint32_t player = unitRandom(&random) * options->players;
+    double distance = options->minDistanceM +
+                      unitRandom(&random) * (options->maxDistanceM - options->minDistanceM);
+    double start = shot * SHOT_SPACING_S + SHOT_OFFSET_S + unitRandom(&random) * SHOT_JITTER_S;
+    channel_config_t shooter = config;
+    shooter.shooterCount = 0;
+    if (!silent)
+      channel_addCodedShooter(&shooter, player % FILTER_FREQUENCY_COUNT, distance, start,
+                              player % SHOTCODE_ID_COUNT);
+    channel_setShooters(&channel, shooter.shooters, shooter.shooterCount);
+
+    detector_clearHit();
+    for (uint32_t tick = 0; tick < ticksPerShot; tick += TICKS_PER_DETECTOR_CALL) {
+      hostSim_advanceTicks(TICKS_PER_DETECTOR_CALL);
+      double begin = now();
+      detector(true);
+      result->detectorSeconds += now() - begin;
+    }
+    if (!detector_hitDetected())
+      continue;
+    result->registered++;
+    if (coded && detector_getFrequencyNumberOfLastHit() == player % FILTER_FREQUENCY_COUNT &&
+        detector_getCodeOfLastHit() == (int16_t)(player % SHOTCODE_ID_COUNT))
+      result->correct++;
+    else if (coded)
+      result->wrong++;
+  }
+  interrupts_disableArmInts();
+  hostSim_setAdcSource(NULL);
+  result->decimatedSamples =
+      (uint64_t)options->shots * ticksPerShot / FILTER_FIR_DECIMATION_FACTOR;
+}
+
+// The slicer alone, on every channel, per decimated sample.
+static double slicerNanoseconds(void) {
+  shotCode_init();
+  double y = 0.001, sink = 0;
+  double begin = now();
+  for (uint32_t n = 0; n < SLICER_SAMPLES; n++) {
+    for (uint16_t c = 0; c < FILTER_FREQUENCY_COUNT; c++)
+      shotCode_addSample(c, y * c);
+    sink += shotCode_endSample();
+    y = -y;
+  }
+  double seconds = now() - begin;
+  if (sink < 0) // Keep the loop.
+    printf("\n");
+  return seconds / SLICER_SAMPLES * 1e9;
+}
+
+static void printUsage(const char *program) {
+  printf("usage: %s [--shots n] [--players n] [--min-distance m] [--max-distance m] "
+         "[--seed n] [--check]\n",
+         program);
+}
+
+int main(int argc, char *argv[]) {
+  options_t options = {200, 40, 1, 5.0, 30.0, false};
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--shots") == 0 && hasValue)
+      options.shots = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--players") == 0 && hasValue)
+      options.players = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--min-distance") == 0 && hasValue)
+      options.minDistanceM = strtod(argv[++i], NULL);
+    else if (strcmp(argv[i], "--max-distance") == 0 && hasValue)
+      options.maxDistanceM = strtod(argv[++i], NULL);
+    else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+      options.seed = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--check") == 0)
+      options.check = true;
+    else {
+      printUsage(argv[0]);
+      return 2;
+    }
+  }
+  if (!options.shots || !options.players || options.players > SHOTCODE_ID_COUNT) {
+    printf("shotCodeBench: need at least one shot and 1 to %d players\n", SHOTCODE_ID_COUNT);
+    return 2;
+  }
+
+  result_t plain, coded, silent;
+  runShots(&options, false, false, &plain);
+  runShots(&options, true, false, &coded);
+  runShots(&options, true, true, &silent);
+  printf("%u shots by %u players on %d frequencies, %.0f-%.0f m\n", options.shots,
+         options.players, FILTER_FREQUENCY_COUNT, options.minDistanceM, options.maxDistanceM);
+  printf("plain bursts: %u detected\n", plain.registered);
+  printf("coded shots:  %u registered, %u with the right ID, %u with a wrong one\n",
+         coded.registered, coded.correct, coded.wrong);
+  printf("no shots:     %u false hits with coded shots on in %.0f s\n", silent.registered,
+         options.shots * SHOT_SPACING_S);
+
+  double plainNs = plain.detectorSeconds / plain.decimatedSamples * 1e9;
+  double codedNs = coded.detectorSeconds / coded.decimatedSamples * 1e9;
+  printf("detector per decimated sample: %.1f ns plain, %.1f ns coded (%+.1f%%)\n", plainNs,
+         codedNs, (codedNs / plainNs - 1) * 100);
+  printf("slicer alone, %d channels: %.2f ns per decimated sample\n", FILTER_FREQUENCY_COUNT,
+         slicerNanoseconds());
+
+  if (!options.check)
+    return 0;
+  bool pass = coded.wrong == 0 && silent.registered == 0 &&
+              coded.correct >= MIN_DECODED_FRACTION * plain.registered;
+  if (!pass)
+    printf("shotCodeBench: FAILED\n");
+  return pass ? 0 : 1;
+}
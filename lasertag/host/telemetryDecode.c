@@ -0,0 +1,515 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Decoder for the gun's binary telemetry (see telemetry.h). It reads the
+// stream from a serial device, such as the USB serial adapter on the
+// Bluetooth link's far end:
+//
+//   telemetryDecode --device /dev/ttyUSB0 --baud 9600
+//
+// or, with --simulate, from a pseudo-terminal that stands in for the serial
+// line. A simulated gun on its own thread then writes into the master side
+// while the decoder reads the slave side exactly as it would a device. The gun
+// detects shots from the channel model and sends hits and snapshots at the
+// configured rate. With --check the run fails unless every frame decodes, the
+// sequence gaps match the frames the gun dropped and every hit arrives.
+//
+// --record saves the raw stream to a file, for baseStation --replay.
+//
+// Either way the decoder prints each message (unless --quiet) and ends with
+// bytes per second, frame counts and the host CPU time per message spent
+// encoding (simulated gun only) and decoding.
+
+#define _GNU_SOURCE // posix_openpt(), cfmakeraw()
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "channel.h"
+#include "detector.h"
+#include "filter.h"
+#include "hostSim.h"
+#include "interrupts.h"
+#include "isr.h"
+#include "lockoutTimer.h"
+#include "telemetry.h"
+
+#define TICKS_PER_SECOND HOSTSIM_DEFAULT_TICKS_PER_SECOND
+#define TICKS_PER_MS (TICKS_PER_SECOND / 1000)
+#define MS_PER_SECOND 1000
+#define DEFAULT_BAUD_RATE 9600
+#define READ_BUFFER_SIZE 4096
+#define IDLE_TIMEOUT_MS 200 // The stream has ended once the gun is done and this passes.
+#define NANOSECONDS_PER_SECOND 1e9
+#define ENCODE_BENCHMARK_MESSAGES 100000
+
+// Shots as in ampSim: after the start-up lockout, further apart than the
+// lockout, cycling through the frequencies.
+#define FIRST_SHOT_S 0.6
+#define SHOT_INTERVAL_S 0.6
+#define SHOT_DURATION_S 0.2
+#define SHOT_DISTANCE_M 5.0
+#define SHOT_FREQUENCY_STEP 3
+
+typedef struct {
+  uint32_t bytes;
+  uint32_t frames;
+  uint32_t byType[TELEMETRY_MESSAGE_TYPE_COUNT];
+  uint32_t errors[TELEMETRY_DECODE_BAD_VERSION + 1];
+  uint32_t oversized;       // Ran past the longest frame without a delimiter.
+  uint32_t unknownType;
+  uint32_t sequenceGaps;    // Frames missing between consecutive sequence numbers.
+  uint16_t lastSequence;
+  uint32_t hitsByFrequency[FILTER_FREQUENCY_COUNT];
+  double decodeSeconds;
+} decoder_t;
+
+// The simulated gun's results.
+static uint32_t gunSeconds;
+static uint32_t bytesPerSecond = TELEMETRY_DEFAULT_BYTES_PER_SECOND;
+static int masterFd = -1;
+static volatile int gunDone;
+static telemetry_stats_t gunStats;
+static uint32_t gunMessages;
+static detector_hitCount_t gunHits[FILTER_FREQUENCY_COUNT];
+
+static const char *typeNames[TELEMETRY_MESSAGE_TYPE_COUNT] = {
+    "?", "HELLO", "HIT", "POWER", "BUFFER", "PROFILE"};
+
+static FILE *recordFile; // Raw stream copy for baseStation --replay.
+
+static INSTANCE_LOCAL channel_t channel;
+static INSTANCE_LOCAL uint16_t samples[TICKS_PER_MS];
+static INSTANCE_LOCAL uint32_t sampleIndex;
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / NANOSECONDS_PER_SECOND;
+}
+
+/*****************************************************************************
+***** Simulated gun
+*****************************************************************************/
+
+static uint32_t nextSample(void) { return samples[sampleIndex++]; }
+
+// The pseudo-terminal as the gun's UART: takes what fits, never waits.
+static uint16_t ptyWrite(uint8_t *data, uint16_t size) {
+  ssize_t written = write(masterFd, data, size);
+  return written > 0 ? written : 0;
+}
+
+static void *gun(void *arg) {
+  (void)arg;
+  channel_config_t config;
+  channel_initConfig(&config);
+  uint16_t frequency = 1;
+  for (double start = FIRST_SHOT_S; start + SHOT_DURATION_S < gunSeconds;
+       start += SHOT_INTERVAL_S) {
+    if (!channel_addShooter(&config, frequency, SHOT_DISTANCE_M, start, SHOT_DURATION_S))
+      break;
+    frequency = (frequency + SHOT_FREQUENCY_STEP) % FILTER_FREQUENCY_COUNT;
+  }
+  channel_init(&channel, &config);
+  hostSim_setAdcSource(nextSample);
+  interrupts_initAll(true);
+  isr_init();
+  filter_init();
+  detector_init();
+  interrupts_enableTimerGlobalInts();
+  interrupts_startArmPrivateTimer();
+  interrupts_enableArmInts();
+  lockoutTimer_start();
+  telemetry_init(ptyWrite, bytesPerSecond);
+
+  uint32_t tick = 0;
+  for (uint32_t ms = 0; ms < gunSeconds * MS_PER_SECOND; ms++) {
+    channel_generate(&channel, samples, TICKS_PER_MS);
+    sampleIndex = 0;
+    hostSim_advanceTicks(TICKS_PER_MS);
+    detector(true);
+    tick = interrupts_isrInvocationCount();
+    if (detector_hitDetected()) {
+      uint16_t hitFrequency = detector_getFrequencyNumberOfLastHit();
+      detector_getHitCounts(gunHits);
+      telemetry_sendHit(tick, hitFrequency, gunHits[hitFrequency]);
+      detector_clearHit();
+    }
+    telemetry_sendSnapshots(tick);
+    telemetry_poll(tick);
+  }
+  interrupts_disableArmInts();
+  detector_getHitCounts(gunHits);
+
+  // Let the queue drain at the configured rate, waiting whenever the
+  // pseudo-terminal is full.
+  telemetry_getStats(&gunStats);
+  while (gunStats.bytesSent < gunStats.bytesQueued) {
+    uint32_t sent = gunStats.bytesSent;
+    tick += TICKS_PER_MS;
+    telemetry_poll(tick);
+    telemetry_getStats(&gunStats);
+    if (gunStats.bytesSent == sent)
+      usleep(100);
+  }
+  gunMessages = gunStats.framesQueued + gunStats.framesDropped;
+  __atomic_store_n(&gunDone, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+// Takes everything, for timing the encoder alone.
+static uint16_t sinkWrite(uint8_t *data, uint16_t size) {
+  (void)data;
+  return size;
+}
+
+// Host time to frame, queue and hand over one message of each kind.
+static void measureEncodeCost(void) {
+  double powerValues[FILTER_FREQUENCY_COUNT] = {0};
+  telemetry_init(sinkWrite, TELEMETRY_BURST_BYTES);
+  uint32_t tick = 0;
+  for (telemetry_messageType_t type = TELEMETRY_MESSAGE_HIT; type <= TELEMETRY_MESSAGE_PROFILE;
+       type++) {
+    double start = now();
+    for (uint32_t i = 0; i < ENCODE_BENCHMARK_MESSAGES; i++) {
+      tick += TICKS_PER_SECOND; // A full burst of credit every time.
+      if (type == TELEMETRY_MESSAGE_HIT)
+        telemetry_sendHit(tick, i % FILTER_FREQUENCY_COUNT, i);
+      else if (type == TELEMETRY_MESSAGE_POWER)
+        telemetry_sendPower(tick, powerValues);
+      else if (type == TELEMETRY_MESSAGE_BUFFER)
+        telemetry_sendBuffer(tick, i, i);
+      else
+        telemetry_sendProfile(tick, i, i);
+      telemetry_poll(tick);
+    }
+    printf("encode and send %-7s %5.0f ns/message\n", typeNames[type],
+           (now() - start) * NANOSECONDS_PER_SECOND / ENCODE_BENCHMARK_MESSAGES);
+  }
+}
+
+/*****************************************************************************
+***** Decoder
+*****************************************************************************/
+
+static void printMessage(const telemetry_frame_t *frame) {
+  const uint8_t *p = frame->payload;
+  printf("%-7s seq %5u tick %10u", typeNames[frame->type], frame->sequence,
+         telemetry_readU32(p, 0));
+  switch (frame->type) {
+  case TELEMETRY_MESSAGE_HELLO:
+    printf(" ticks/s %u frequencies %u", telemetry_readU32(p, 4), p[8]);
+    break;
+  case TELEMETRY_MESSAGE_HIT:
+    printf(" frequency %u count %u", p[4], telemetry_readU32(p, 5));
+    break;
+  case TELEMETRY_MESSAGE_POWER:
+    for (uint16_t i = 0; i < (frame->payloadSize - sizeof(uint32_t)) / sizeof(float); i++)
+      printf(" %.3g", telemetry_readF32(p, sizeof(uint32_t) + i * sizeof(float)));
+    break;
+  case TELEMETRY_MESSAGE_BUFFER:
+    printf(" elements %u of %u", telemetry_readU32(p, 4), telemetry_readU32(p, 8));
+    break;
+  case TELEMETRY_MESSAGE_PROFILE:
+    printf(" isr %u detector %u dropped %u sent %u", telemetry_readU32(p, 4),
+           telemetry_readU32(p, 8), telemetry_readU32(p, 12), telemetry_readU32(p, 16));
+    break;
+  }
+  printf("\n");
+}
+
+// Smallest payload of each type; shorter frames are not trusted.
+static bool payloadFits(const telemetry_frame_t *frame) {
+  static const uint16_t minimum[TELEMETRY_MESSAGE_TYPE_COUNT] = {
+      0, TELEMETRY_HELLO_PAYLOAD, TELEMETRY_HIT_PAYLOAD, sizeof(uint32_t),
+      TELEMETRY_BUFFER_PAYLOAD, TELEMETRY_PROFILE_PAYLOAD};
+  return frame->type > 0 && frame->type < TELEMETRY_MESSAGE_TYPE_COUNT &&
+         frame->payloadSize >= minimum[frame->type];
+}
+
+// Handle one frame, as read up to its delimiter.
+static void decodeFrame(decoder_t *decoder, const uint8_t *data, uint32_t size,
+                        bool quiet) {
+  static bool haveSequence;
+  telemetry_frame_t frame;
+  double start = now();
+  telemetry_decodeStatus_t status = telemetry_decodeFrame(data, size, &frame);
+  decoder->decodeSeconds += now() - start;
+  if (status != TELEMETRY_DECODE_OK) {
+    decoder->errors[status]++;
+    return;
+  }
+  if (!payloadFits(&frame)) {
+    decoder->unknownType++;
+    return;
+  }
+  if (frame.type == TELEMETRY_MESSAGE_HELLO)
+    haveSequence = false; // A new stream.
+  if (haveSequence)
+    decoder->sequenceGaps += (uint16_t)(frame.sequence - decoder->lastSequence - 1);
+  haveSequence = true;
+  decoder->lastSequence = frame.sequence;
+  decoder->frames++;
+  decoder->byType[frame.type]++;
+  if (frame.type == TELEMETRY_MESSAGE_HIT && frame.payload[4] < FILTER_FREQUENCY_COUNT)
+    decoder->hitsByFrequency[frame.payload[4]]++;
+  if (!quiet)
+    printMessage(&frame);
+}
+
+// Read fd until it reports end of file or, if done is given, until *done is
+// set and nothing has arrived for IDLE_TIMEOUT_MS. seconds limits the time.
+static void decodeStream(int fd, decoder_t *decoder, volatile int *done, double seconds,
+                         bool quiet) {
+  uint8_t buffer[READ_BUFFER_SIZE];
+  uint8_t frame[TELEMETRY_MAX_ENCODED_FRAME];
+  uint32_t frameSize = 0;
+  bool overflowed = false;
+  double start = now();
+  for (;;) {
+    if (seconds > 0 && now() - start > seconds)
+      return;
+    struct pollfd waitFor = {.fd = fd, .events = POLLIN};
+    int ready = poll(&waitFor, 1, IDLE_TIMEOUT_MS);
+    if (ready < 0 && errno != EINTR)
+      return;
+    if (ready <= 0) {
+      if (done && __atomic_load_n(done, __ATOMIC_ACQUIRE))
+        return;
+      continue;
+    }
+    ssize_t count = read(fd, buffer, sizeof(buffer));
+    if (count <= 0)
+      return;
+    decoder->bytes += count;
+    if (recordFile)
+      fwrite(buffer, 1, count, recordFile);
+    for (ssize_t i = 0; i < count; i++) {
+      if (buffer[i] == 0) { // End of a frame.
+        if (overflowed)
+          decoder->oversized++;
+        else if (frameSize)
+          decodeFrame(decoder, frame, frameSize, quiet);
+        frameSize = 0;
+        overflowed = false;
+      } else if (frameSize < sizeof(frame)) {
+        frame[frameSize++] = buffer[i];
+      } else {
+        overflowed = true; // Skip to the next delimiter.
+      }
+    }
+  }
+}
+
+static void printSummary(const decoder_t *decoder, double streamSeconds) {
+  uint32_t errors = decoder->oversized + decoder->unknownType;
+  for (int i = TELEMETRY_DECODE_BAD_COBS; i <= TELEMETRY_DECODE_BAD_VERSION; i++)
+    errors += decoder->errors[i];
+  printf("%u bytes, %u frames over %.1f s: %.0f bytes/s, %.1f bytes/frame\n", decoder->bytes,
+         decoder->frames, streamSeconds, decoder->bytes / streamSeconds,
+         decoder->frames ? (double)decoder->bytes / decoder->frames : 0);
+  printf("frames by type:");
+  for (int t = TELEMETRY_MESSAGE_HELLO; t < TELEMETRY_MESSAGE_TYPE_COUNT; t++)
+    printf(" %s %u", typeNames[t], decoder->byType[t]);
+  printf("\nbad frames %u (COBS %u, short %u, CRC %u, version %u, oversized %u, type %u), "
+         "sequence gaps %u\n",
+         errors, decoder->errors[TELEMETRY_DECODE_BAD_COBS],
+         decoder->errors[TELEMETRY_DECODE_TOO_SHORT], decoder->errors[TELEMETRY_DECODE_BAD_CRC],
+         decoder->errors[TELEMETRY_DECODE_BAD_VERSION], decoder->oversized,
+         decoder->unknownType, decoder->sequenceGaps);
+  printf("decode %.0f ns/frame\n",
+         decoder->frames ? decoder->decodeSeconds * NANOSECONDS_PER_SECOND / decoder->frames : 0);
+}
+
+/*****************************************************************************
+***** Serial devices
+*****************************************************************************/
+
+static speed_t baudConstant(uint32_t baudRate) {
+  switch (baudRate) {
+  case 9600:
+    return B9600;
+  case 19200:
+    return B19200;
+  case 38400:
+    return B38400;
+  case 57600:
+    return B57600;
+  case 115200:
+    return B115200;
+  case 230400:
+    return B230400;
+  case 460800:
+    return B460800;
+  case 921600:
+    return B921600;
+  default:
+    return B0;
+  }
+}
+
+// Raw mode: no echo, no line editing, no translation of the binary stream.
+static bool makeRaw(int fd, uint32_t baudRate) {
+  struct termios settings;
+  if (tcgetattr(fd, &settings) != 0)
+    return false;
+  cfmakeraw(&settings);
+  if (baudRate) {
+    cfsetispeed(&settings, baudConstant(baudRate));
+    cfsetospeed(&settings, baudConstant(baudRate));
+  }
+  return tcsetattr(fd, TCSANOW, &settings) == 0;
+}
+
+// Open a pseudo-terminal pair. The gun writes the master; returns the slave.
+static int openPty(void) {
+  masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (masterFd < 0 || grantpt(masterFd) != 0 || unlockpt(masterFd) != 0)
+    return -1;
+  int slave = open(ptsname(masterFd), O_RDONLY | O_NOCTTY);
+  if (slave < 0 || !makeRaw(slave, 0))
+    return -1;
+  fcntl(masterFd, F_SETFL, fcntl(masterFd, F_GETFL) | O_NONBLOCK);
+  return slave;
+}
+
+/*****************************************************************************
+***** Main
+*****************************************************************************/
+
+// The simulated gun's stream must arrive whole.
+static bool checkSimulation(const decoder_t *decoder) {
+  bool pass = true;
+  uint32_t badFrames = decoder->oversized + decoder->unknownType;
+  for (int i = TELEMETRY_DECODE_BAD_COBS; i <= TELEMETRY_DECODE_BAD_VERSION; i++)
+    badFrames += decoder->errors[i];
+  if (badFrames) {
+    printf("FAIL: %u frames did not decode\n", badFrames);
+    pass = false;
+  }
+  // Frames dropped after the last one received leave no gap.
+  uint32_t missing = decoder->sequenceGaps + (uint16_t)(gunMessages - 1 - decoder->lastSequence);
+  if (decoder->frames != gunStats.framesQueued || missing != gunStats.framesDropped) {
+    printf("FAIL: received %u frames with %u missing, gun queued %u and dropped %u\n",
+           decoder->frames, missing, gunStats.framesQueued, gunStats.framesDropped);
+    pass = false;
+  }
+  uint32_t gunHitTotal = 0;
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    gunHitTotal += gunHits[f];
+    if (decoder->hitsByFrequency[f] != gunHits[f]) {
+      printf("FAIL: frequency %u: %u hits reported, gun detected %u\n", f,
+             decoder->hitsByFrequency[f], gunHits[f]);
+      pass = false;
+    }
+  }
+  if (!gunHitTotal) {
+    printf("FAIL: the gun detected no hits\n");
+    pass = false;
+  }
+  return pass;
+}
+
+static void printUsage(const char *program) {
+  printf("usage: %s --device path [--baud n] [--seconds s] [--record file] [--quiet]\n"
+         "       %s --simulate seconds [--rate bytes/s] [--record file] [--quiet] [--check]\n",
+         program, program);
+}
+
+int main(int argc, char *argv[]) {
+  const char *device = NULL, *recordPath = NULL;
+  uint32_t baudRate = DEFAULT_BAUD_RATE;
+  double seconds = 0;
+  bool quiet = false, check = false;
+  for (int i = 1; i < argc; i++) {
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (strcmp(argv[i], "--quiet") == 0) {
+      quiet = true;
+      continue;
+    } else if (strcmp(argv[i], "--check") == 0) {
+      check = true;
+      continue;
+    }
+    if (!value) {
+      printUsage(argv[0]);
+      return 2;
+    }
+    if (strcmp(argv[i], "--device") == 0)
+      device = value;
+    else if (strcmp(argv[i], "--baud") == 0)
+      baudRate = atoi(value);
+    else if (strcmp(argv[i], "--seconds") == 0)
+      seconds = atof(value);
+    else if (strcmp(argv[i], "--simulate") == 0)
+      gunSeconds = atoi(value);
+    else if (strcmp(argv[i], "--rate") == 0)
+      bytesPerSecond = atoi(value);
+    else if (strcmp(argv[i], "--record") == 0)
+      recordPath = value;
+    else {
+      printUsage(argv[0]);
+      return 2;
+    }
+    i++;
+  }
+  if (!device == !gunSeconds || !bytesPerSecond || baudConstant(baudRate) == B0) {
+    printUsage(argv[0]);
+    return 2;
+  }
+
+  if (recordPath && !(recordFile = fopen(recordPath, "wb"))) {
+    printf("telemetryDecode: cannot open %s\n", recordPath);
+    return 1;
+  }
+  decoder_t decoder;
+  memset(&decoder, 0, sizeof(decoder));
+  if (device) {
+    int fd = open(device, O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+      printf("telemetryDecode: cannot open %s: %s\n", device, strerror(errno));
+      return 1;
+    }
+    if (isatty(fd) && !makeRaw(fd, baudRate)) {
+      printf("telemetryDecode: cannot configure %s\n", device);
+      return 1;
+    }
+    double start = now();
+    decodeStream(fd, &decoder, NULL, seconds, quiet);
+    printSummary(&decoder, now() - start);
+    return 0;
+  }
+
+  int slave = openPty();
+  if (slave < 0) {
+    printf("telemetryDecode: cannot open a pseudo-terminal: %s\n", strerror(errno));
+    return 1;
+  }
+  hostSim_setConsoleEnabled(false);
+  pthread_t gunThread;
+  pthread_create(&gunThread, NULL, gun, NULL);
+  decodeStream(slave, &decoder, &gunDone, 0, quiet);
+  pthread_join(gunThread, NULL);
+
+  printf("simulated gun: %u s at %u bytes/s budget, %u messages, %u dropped\n", gunSeconds,
+         bytesPerSecond, gunMessages, gunStats.framesDropped);
+  printSummary(&decoder, gunSeconds);
+  measureEncodeCost();
+  if (check && !checkSimulation(&decoder))
+    return 1;
+  return 0;
+}
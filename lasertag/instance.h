@@ -0,0 +1,25 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef INSTANCE_H_
+#define INSTANCE_H_
+
+// Marks module state that belongs to one gun. The board runs a single gun and
+// this expands to nothing. Host simulators run one gun per thread, so there
+// the state is thread-local and every thread sees its own filters, detector,
+// timers and simulated hardware.
+#ifdef ZYBO_BOARD
+#define INSTANCE_LOCAL
+#elif defined(__cplusplus)
+#define INSTANCE_LOCAL thread_local
+#else
+#define INSTANCE_LOCAL _Thread_local
+#endif
+
+#endif /* INSTANCE_H_ */
@@ -0,0 +1,68 @@
+#include "invincibilityTimer.h"
+#include "gameEngine.h"
+#include "instance.h"
+#include "sampleRate.h"
+
+// The invincibilityTimer runs for a given number of seconds after a player
+// loses a life. Hits are ignored meanwhile; when it expires it tells the game
+// engine with GAME_EVENT_INVINCIBILITY_OVER.
+
+static INSTANCE_LOCAL volatile uint32_t ticks;
+static INSTANCE_LOCAL volatile uint32_t expireValue;
+
+// States for the controller state machine.
+enum invincibilityTimer_st_t {
+  waiting_st,   // Wait here until started
+  invincible_st // Count down the invincible period
+};
+static INSTANCE_LOCAL volatile enum invincibilityTimer_st_t currentState;
+
+// Perform any necessary inits for the invincibility timer.
+void invincibilityTimer_init() {
+  ticks = 0;
+  expireValue = 0;
+  currentState = waiting_st;
+}
+
+// Standard tick function.
+void invincibilityTimer_tick() {
+  // State updates
+  switch (currentState) {
+  case waiting_st:
+    break;
+  case invincible_st:
+    if (ticks >= expireValue) {
+      ticks = 0;
+      currentState = waiting_st;
+      gameEngine_postEvent(GAME_EVENT_INVINCIBILITY_OVER, 0);
+    }
+    break;
+  default:
+    // error
+    break;
+  }
+
+  // State actions
+  switch (currentState) {
+  case waiting_st:
+    break;
+  case invincible_st:
+    ticks++;
+    break;
+  default:
+    // error
+    break;
+  }
+}
+
+// Calling this starts the timer.
+void invincibilityTimer_start(uint32_t seconds) {
+  ticks = 0;
+  expireValue = seconds * sampleRate_getHz();
+  currentState = invincible_st;
+}
+
+// Returns true if the timer is running.
+bool invincibilityTimer_running() {
+  return currentState == invincible_st;
+}
@@ -1,12 +1,25 @@
 #include "isr.h"
+#include "autoReloadTimer.h"
 #include "buffer.h"
+#include "gameEngine.h"
 #include "hitLedTimer.h"
 #include "include/interrupts.h"
+#include "invincibilityTimer.h"
 #include "lockoutTimer.h"
+#include "sampleRate.h"
 #include "transmitter.h"
 #include "trigger.h"
 #include "sound/sound.h"
 
+#if defined(LASERTAG_TELEMETRY) || defined(LASERTAG_JOURNAL_UART)
+#include "bluetooth/bluetooth.h"
+
+// Without its interrupt the Bluetooth UART is polled every 5 ms.
+#define BLUETOOTH_POLL_TICKS 500 // At 100 kHz.
+static uint32_t bluetoothPollTicks;
+static uint32_t bluetoothPollPeriod = BLUETOOTH_POLL_TICKS; // At the sample rate.
+#endif
+
 // The interrupt service routine (ISR) is implemented here.
 // Add function calls for state machine tick functions and
 // other interrupt related modules.
@@ -19,16 +32,35 @@ void isr_init() {
   transmitter_init();
   buffer_init();
   sound_init();
+  invincibilityTimer_init();
+  autoReloadTimer_init();
   hitLedTimer_enable();
+#if defined(LASERTAG_TELEMETRY) || defined(LASERTAG_JOURNAL_UART)
+  bluetoothPollPeriod = sampleRate_ticks(BLUETOOTH_POLL_TICKS);
+#endif
 }
 
-// This function is invoked by the timer interrupt at 100 kHz.
+// This function is invoked by the timer interrupt at the sample rate
+// (sampleRate.h), 100 kHz unless set otherwise.
 void isr_function() {
   trigger_tick();
   hitLedTimer_tick();
-  lockoutTimer_tick();
   transmitter_tick();
   sound_tick();
+  invincibilityTimer_tick();
+  autoReloadTimer_tick();
+  gameEngine_tick(); // After trigger_tick(), so it sees this tick's press.
+#ifndef LASERTAG_AMP
+  lockoutTimer_tick();
   // Grab data from the ADC and store it in the ADC buffer
   buffer_pushover(interrupts_getAdcData());
+#endif
+  // In the AMP build CPU1 samples the ADC and runs the lockout timer (see
+  // detectorCore.c).
+#if defined(LASERTAG_TELEMETRY) || defined(LASERTAG_JOURNAL_UART)
+  if (!bluetooth_isInterruptDriven() && ++bluetoothPollTicks >= bluetoothPollPeriod) {
+    bluetoothPollTicks = 0;
+    bluetooth_poll();
+  }
+#endif
 }
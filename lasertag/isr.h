@@ -17,7 +17,8 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 // Perform initialization for interrupt and timing related modules.
 void isr_init();
 
-// This function is invoked by the timer interrupt at 100 kHz.
+// This function is invoked by the timer interrupt at the sample rate
+// (sampleRate.h), 100 kHz unless set otherwise.
 void isr_function();
 
 #endif /* ISR_H_ */
@@ -0,0 +1,162 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <string.h>
+
+#include "instance.h"
+#include "interrupts.h"
+#include "journal.h"
+#include "sampleRate.h"
+#include "telemetry.h" // For telemetry_crc16().
+
+#define CRC_OFFSET 14
+#define DMA_ALIGNMENT 32 // Cache line: the SD controller reads the ring by DMA.
+
+// Blocks are counted free-running: sealed ones are [flushed, sealed) and the
+// open block, still taking records, is the one after them. Used from the main
+// loop only.
+static INSTANCE_LOCAL uint8_t ring[JOURNAL_RING_BLOCKS][JOURNAL_BLOCK_SIZE]
+    __attribute__((aligned(DMA_ALIGNMENT)));
+static INSTANCE_LOCAL uint32_t sealedBlocks, flushedBlocks;
+static INSTANCE_LOCAL uint32_t flushedOffset; // Bytes of the next block already taken.
+static INSTANCE_LOCAL uint32_t batchEnd;      // Sealed count when the batch began.
+static INSTANCE_LOCAL uint16_t openRecords;
+static INSTANCE_LOCAL bool pending;         // Records not yet written.
+static INSTANCE_LOCAL uint32_t pendingSince; // Tick of the oldest of them.
+static INSTANCE_LOCAL journal_writer_t writer;
+static INSTANCE_LOCAL uint32_t session;
+static INSTANCE_LOCAL journal_stats_t stats;
+// JOURNAL_MAX_DELAY_TICKS and JOURNAL_IDLE_BACKLOG at the sample rate.
+static INSTANCE_LOCAL uint32_t maxDelayTicks = JOURNAL_MAX_DELAY_TICKS;
+static INSTANCE_LOCAL uint32_t idleBacklog = JOURNAL_IDLE_BACKLOG;
+
+static uint8_t *blockAt(uint32_t block) { return ring[block % JOURNAL_RING_BLOCKS]; }
+
+// Close the open block with its header and CRC. Returns false if the ring has
+// no room to open the next one.
+static bool sealOpenBlock(void) {
+  if (sealedBlocks + 1 - flushedBlocks >= JOURNAL_RING_BLOCKS)
+    return false;
+  uint8_t *block = blockAt(sealedBlocks);
+  memset(block + JOURNAL_BLOCK_HEADER_SIZE + openRecords * JOURNAL_RECORD_SIZE, 0,
+         (JOURNAL_RECORDS_PER_BLOCK - openRecords) * JOURNAL_RECORD_SIZE);
+  journal_blockHeader_t header = {JOURNAL_MAGIC, session, sealedBlocks, openRecords, 0};
+  memcpy(block, &header, sizeof(header));
+  uint16_t crc = telemetry_crc16(block, JOURNAL_BLOCK_SIZE);
+  memcpy(block + CRC_OFFSET, &crc, sizeof(crc));
+  sealedBlocks++;
+  openRecords = 0;
+  stats.blocksSealed++;
+  return true;
+}
+
+// Start a journal through writer.
+void journal_start(journal_writer_t newWriter, uint32_t newSession) {
+  sealedBlocks = flushedBlocks = flushedOffset = batchEnd = 0;
+  openRecords = 0;
+  pending = false;
+  session = newSession;
+  maxDelayTicks = sampleRate_ticks(JOURNAL_MAX_DELAY_TICKS);
+  idleBacklog = sampleRate_ticks(JOURNAL_IDLE_BACKLOG);
+  memset(&stats, 0, sizeof(stats));
+  writer = newWriter;
+}
+
+// Append one record stamped with the current tick.
+bool journal_record(journal_eventType_t type, uint8_t channel, float power, uint32_t value) {
+  if (!writer)
+    return false;
+  if (openRecords == JOURNAL_RECORDS_PER_BLOCK && !sealOpenBlock()) {
+    stats.dropped++;
+    return false;
+  }
+  journal_record_t record = {interrupts_isrInvocationCount(), type, channel, 0, power, value};
+  memcpy(blockAt(sealedBlocks) + JOURNAL_BLOCK_HEADER_SIZE + openRecords * JOURNAL_RECORD_SIZE,
+         &record, sizeof(record));
+  openRecords++;
+  stats.records++;
+  if (!pending) {
+    pending = true;
+    pendingSince = record.tick;
+  }
+  return true;
+}
+
+// Hand sealed blocks to the writer, contiguous runs of the ring at a time,
+// until it stops taking them.
+static void writeSealedBlocks(void) {
+  while (flushedBlocks != sealedBlocks) {
+    uint32_t first = flushedBlocks % JOURNAL_RING_BLOCKS;
+    uint32_t blocks = sealedBlocks - flushedBlocks;
+    if (blocks > JOURNAL_RING_BLOCKS - first)
+      blocks = JOURNAL_RING_BLOCKS - first;
+    uint32_t size = blocks * JOURNAL_BLOCK_SIZE - flushedOffset;
+    uint32_t taken = writer(ring[first] + flushedOffset, size);
+    stats.writeCalls++;
+    stats.bytesWritten += taken;
+    flushedOffset += taken;
+    flushedBlocks += flushedOffset / JOURNAL_BLOCK_SIZE;
+    flushedOffset %= JOURNAL_BLOCK_SIZE;
+    if (taken < size)
+      return;
+  }
+  // All sealed blocks are out: what waits now starts with the open block.
+  if (!openRecords)
+    pending = false;
+  else
+    memcpy(&pendingSince, blockAt(sealedBlocks) + JOURNAL_BLOCK_HEADER_SIZE,
+           sizeof(pendingSince));
+}
+
+// Write a batch when one is ready, or when records have waited too long. A
+// batch a slow writer only took part of carries on at the next call.
+void journal_poll(uint32_t tick, uint32_t adcBacklog) {
+  if (!writer || !pending || adcBacklog >= idleBacklog)
+    return;
+  if ((int32_t)(batchEnd - flushedBlocks) <= 0) { // No batch under way.
+    if (tick - pendingSince >= maxDelayTicks) {
+      if (openRecords)
+        sealOpenBlock();
+    } else if (sealedBlocks - flushedBlocks < JOURNAL_BATCH_BLOCKS) {
+      return;
+    }
+    batchEnd = sealedBlocks;
+  }
+  writeSealedBlocks();
+}
+
+// Seal the open block and hand everything to the writer now.
+bool journal_flush(void) {
+  if (!writer)
+    return true;
+  if (openRecords)
+    sealOpenBlock();
+  writeSealedBlocks();
+  return flushedBlocks == sealedBlocks && !openRecords;
+}
+
+// Copy of the counters.
+void journal_getStats(journal_stats_t *statsOut) { *statsOut = stats; }
+
+// Check one block read back.
+bool journal_parseBlock(const uint8_t *block, journal_blockHeader_t *header) {
+  memcpy(header, block, sizeof(*header));
+  if (header->magic != JOURNAL_MAGIC || header->recordCount > JOURNAL_RECORDS_PER_BLOCK)
+    return false;
+  uint8_t copy[JOURNAL_BLOCK_SIZE];
+  memcpy(copy, block, JOURNAL_BLOCK_SIZE);
+  memset(copy + CRC_OFFSET, 0, sizeof(header->crc));
+  return telemetry_crc16(copy, JOURNAL_BLOCK_SIZE) == header->crc;
+}
+
+// Record index of a checked block.
+void journal_readRecord(const uint8_t *block, uint16_t index, journal_record_t *record) {
+  memcpy(record, block + JOURNAL_BLOCK_HEADER_SIZE + index * JOURNAL_RECORD_SIZE,
+         sizeof(*record));
+}
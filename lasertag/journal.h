@@ -0,0 +1,118 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Append-only journal of game events (hits with their power, shots, reloads,
+// lives lost), kept for after the game.
+//
+// Records are fixed-size and go into 512-byte blocks in a RAM ring. A full
+// block is sealed with a header and CRC; sealed blocks leave the ring in
+// batches of JOURNAL_BATCH_BLOCKS through a writer (the SD card, see
+// journalSd.h, or a UART), and only from journal_poll() when the main loop
+// says it is idle. Recording is a copy into the open block, so it costs the
+// game loop next to nothing and detector() nothing at all. If the writer
+// falls behind and the ring fills, new records are dropped and counted; what
+// is already written is never overwritten.
+//
+// Block layout, little-endian like both the Zynq and the hosts that read it:
+//
+//   magic (4) | session (4) | sequence (4) | record count (2) | CRC (2)
+//   JOURNAL_RECORDS_PER_BLOCK records of 16 bytes, unused ones zero
+//
+// The session identifies one run of the gun; the sequence counts blocks
+// within it. The CRC is CRC-16/CCITT-FALSE over the whole block with the CRC
+// field zero.
+
+#define JOURNAL_BLOCK_SIZE 512
+#define JOURNAL_BLOCK_HEADER_SIZE 16
+#define JOURNAL_RECORD_SIZE 16
+#define JOURNAL_RECORDS_PER_BLOCK \
+  ((JOURNAL_BLOCK_SIZE - JOURNAL_BLOCK_HEADER_SIZE) / JOURNAL_RECORD_SIZE)
+#define JOURNAL_MAGIC 0x314A544C // "LTJ1" in the stream.
+#define JOURNAL_RING_BLOCKS 32   // 16 KB of RAM.
+#define JOURNAL_BATCH_BLOCKS 8   // Written together: 4 KB.
+// Even short of a batch, records are written once the oldest is this old
+// (30 s), so a gun switched off mid-game loses little.
+#define JOURNAL_MAX_DELAY_TICKS 3000000
+// The main loop is idle when fewer ADC samples than this (10 ms) are waiting.
+#define JOURNAL_IDLE_BACKLOG 1000
+
+typedef enum {
+  JOURNAL_EVENT_GAME_START = 1, // channel: our frequency, value: team (0 A, 1 B).
+  JOURNAL_EVENT_HIT,            // channel: shooter's frequency, power, value: hit count.
+  JOURNAL_EVENT_SHOT,           // channel: our frequency, value: bullets left.
+  JOURNAL_EVENT_RELOAD,         // value: bullets.
+  JOURNAL_EVENT_LIFE_LOST,      // value: lives left.
+  JOURNAL_EVENT_OUT,            // No lives left.
+  JOURNAL_EVENT_GAME_END,       // value: hits taken.
+  JOURNAL_EVENT_TYPE_COUNT
+} journal_eventType_t;
+
+typedef struct {
+  uint32_t tick; // Timer ISR ticks since power-on.
+  uint8_t type;  // journal_eventType_t.
+  uint8_t channel;
+  uint16_t reserved;
+  float power;
+  uint32_t value;
+} journal_record_t;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t session;
+  uint32_t sequence;
+  uint16_t recordCount;
+  uint16_t crc;
+} journal_blockHeader_t;
+
+// Takes up to size bytes and returns how many it took, without waiting long.
+// A block device takes whole blocks or nothing; a UART takes what fits.
+typedef uint32_t (*journal_writer_t)(const uint8_t *data, uint32_t size);
+
+typedef struct {
+  uint32_t records;
+  uint32_t dropped;      // Found the ring full.
+  uint32_t blocksSealed;
+  uint32_t bytesWritten; // Taken by the writer.
+  uint32_t writeCalls;
+} journal_stats_t;
+
+// Start a journal through writer. Nothing is recorded before this.
+void journal_start(journal_writer_t writer, uint32_t session);
+
+// Append one record stamped with the current tick. Returns false if it was
+// dropped or the journal is not started.
+bool journal_record(journal_eventType_t type, uint8_t channel, float power, uint32_t value);
+
+// From the main loop: write a batch if one is ready, or if records have
+// waited JOURNAL_MAX_DELAY_TICKS, unless adcBacklog says the detector has
+// work waiting.
+void journal_poll(uint32_t tick, uint32_t adcBacklog);
+
+// Seal the open block and hand everything to the writer now. Returns true
+// once nothing is left; call again while it returns false to drain a slow
+// writer.
+bool journal_flush(void);
+
+// Copy of the counters.
+void journal_getStats(journal_stats_t *stats);
+
+// Check one block read back. Returns true, with its header, if it is a
+// journal block with a good CRC.
+bool journal_parseBlock(const uint8_t *block, journal_blockHeader_t *header);
+
+// Record index of a block checked with journal_parseBlock().
+void journal_readRecord(const uint8_t *block, uint16_t index, journal_record_t *record);
+
+#endif /* JOURNAL_H_ */
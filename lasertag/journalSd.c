@@ -0,0 +1,96 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdio.h>
+
+#include "instance.h"
+#include "journal.h"
+#include "journalSd.h"
+#include "xparameters.h"
+#include "xsdps.h"
+
+#define SD_DEVICE_ID XPAR_XSDPS_0_DEVICE_ID
+#define DMA_ALIGNMENT 32
+
+static INSTANCE_LOCAL XSdPs sd;
+static INSTANCE_LOCAL uint32_t nextSector;
+static INSTANCE_LOCAL uint32_t session;
+static INSTANCE_LOCAL uint32_t firstSector;
+static INSTANCE_LOCAL uint8_t scanBuffer[JOURNAL_SD_SCAN_SECTORS * JOURNAL_BLOCK_SIZE]
+    __attribute__((aligned(DMA_ALIGNMENT)));
+
+// Standard-capacity cards address bytes, high-capacity ones sectors.
+static uint32_t cardAddress(uint32_t sector) {
+  return sd.HCS ? sector : sector * JOURNAL_BLOCK_SIZE;
+}
+
+// Find the first sector after the journal already on the card: the first
+// that is not a good block continuing the session before it or starting the
+// next one. Sets the session to start.
+static bool findEnd(void) {
+  uint32_t end = JOURNAL_SD_FIRST_SECTOR + JOURNAL_SD_SECTORS;
+  uint32_t lastSession = 0, expectedSequence = 0;
+  bool any = false;
+  for (uint32_t sector = JOURNAL_SD_FIRST_SECTOR; sector < end;
+       sector += JOURNAL_SD_SCAN_SECTORS) {
+    uint32_t count = end - sector < JOURNAL_SD_SCAN_SECTORS ? end - sector
+                                                           : JOURNAL_SD_SCAN_SECTORS;
+    if (XSdPs_ReadPolled(&sd, cardAddress(sector), count, scanBuffer) != XST_SUCCESS)
+      return false;
+    for (uint32_t i = 0; i < count; i++) {
+      journal_blockHeader_t header;
+      bool good = journal_parseBlock(scanBuffer + i * JOURNAL_BLOCK_SIZE, &header);
+      bool follows = good && (header.sequence == 0
+                                  ? !any || header.session == lastSession + 1
+                                  : any && header.session == lastSession &&
+                                        header.sequence == expectedSequence);
+      if (!follows) {
+        nextSector = sector + i;
+        session = any ? lastSession + 1 : 0;
+        return true;
+      }
+      any = true;
+      lastSession = header.session;
+      expectedSequence = header.sequence + 1;
+    }
+  }
+  nextSector = end; // Full.
+  session = lastSession + 1;
+  return true;
+}
+
+// Bring up the card and start a session after the journal on it.
+bool journalSd_start(void) {
+  XSdPs_Config *config = XSdPs_LookupConfig(SD_DEVICE_ID);
+  if (!config || XSdPs_CfgInitialize(&sd, config, config->BaseAddress) != XST_SUCCESS ||
+      XSdPs_CardInitialize(&sd) != XST_SUCCESS || !findEnd()) {
+    printf("journal: no SD card\n");
+    return false;
+  }
+  firstSector = nextSector;
+  printf("journal: session %lu at sector %lu\n", (unsigned long)session,
+         (unsigned long)firstSector);
+  journal_start(journalSd_write, session);
+  return true;
+}
+
+// Write whole blocks at the end of the journal.
+uint32_t journalSd_write(const uint8_t *data, uint32_t size) {
+  uint32_t blocks = size / JOURNAL_BLOCK_SIZE;
+  uint32_t end = JOURNAL_SD_FIRST_SECTOR + JOURNAL_SD_SECTORS;
+  if (blocks > end - nextSector)
+    blocks = end - nextSector;
+  if (!blocks || XSdPs_WritePolled(&sd, cardAddress(nextSector), blocks, data) != XST_SUCCESS)
+    return 0;
+  nextSector += blocks;
+  return blocks * JOURNAL_BLOCK_SIZE;
+}
+
+uint32_t journalSd_getSession(void) { return session; }
+uint32_t journalSd_getFirstSector(void) { return firstSector; }
@@ -0,0 +1,38 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef JOURNALSD_H_
+#define JOURNALSD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The game journal (journal.h) on the SD card, as raw blocks in a region of
+// JOURNAL_SD_SECTORS sectors from JOURNAL_SD_FIRST_SECTOR. There is no file
+// system: the region must lie outside the card's FAT partition, e.g. in a
+// second partition made for it. Each run appends after the last good block
+// already there, as a new session, so a card holds many games; when the region
+// is full the journal stops taking blocks.
+
+#define JOURNAL_SD_FIRST_SECTOR 2097152 // 1 GiB in: past a 1 GiB boot partition.
+#define JOURNAL_SD_SECTORS 262144       // 128 MiB.
+#define JOURNAL_SD_SCAN_SECTORS 64      // Read at a time looking for the end.
+
+// Bring up the card, find the end of the journal and start a journal session
+// after it. Returns false, leaving the journal off, if there is no usable card.
+bool journalSd_start(void);
+
+// journal_writer_t for the card: writes whole blocks. Returns the bytes taken.
+uint32_t journalSd_write(const uint8_t *data, uint32_t size);
+
+// Returns the session started by journalSd_start() and the sector it starts at.
+uint32_t journalSd_getSession(void);
+uint32_t journalSd_getFirstSector(void);
+
+#endif /* JOURNALSD_H_ */
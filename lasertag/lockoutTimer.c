@@ -1,4 +1,6 @@
 #include "lockoutTimer.h"
+#include "instance.h"
+#include "sampleRate.h"
 #include <stdio.h>
 #include "include/mio.h"
 #include "drivers/intervalTimer.h"
@@ -8,20 +10,22 @@
 // It is used to lock-out the detector once a hit has been detected.
 // This ensures that only one hit is detected per 1/2-second interval.
 
-volatile static uint64_t ticks = 0;
-volatile static bool shouldStart;
+static INSTANCE_LOCAL volatile uint64_t ticks = 0;
+static INSTANCE_LOCAL volatile bool shouldStart;
+static INSTANCE_LOCAL uint32_t expireValue = LOCKOUT_TIMER_EXPIRE_VALUE; // At the sample rate.
 
 // States for the controller state machine.
 enum lockoutTimer_st_t {
 	waiting_st,       // Wait here until hit detected
 	locked_st         // locked out for 1/2 second
 };
-volatile static enum lockoutTimer_st_t currentState;
+static INSTANCE_LOCAL volatile enum lockoutTimer_st_t currentState;
 
 // Perform any necessary inits for the lockout timer.
 void lockoutTimer_init() {
     ticks = 0;
     shouldStart = false;
+    expireValue = sampleRate_ticks(LOCKOUT_TIMER_EXPIRE_VALUE);
     currentState = waiting_st;
 }
 
@@ -33,7 +37,7 @@ void lockoutTimer_tick() {
             break;
         case locked_st:
             // After waiting half a second, move back to the waiting state
-            if (ticks >= LOCKOUT_TIMER_EXPIRE_VALUE) {
+            if (ticks >= expireValue) {
                 ticks = 0;
                 shouldStart = false;
                 currentState = waiting_st;
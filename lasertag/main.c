@@ -22,6 +22,9 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include <assert.h>
 #include <stdio.h>
 
+#ifdef LASERTAG_AMP
+#include "amp.h"
+#endif
 #include "bufferTest.h"
 #include "buttons.h"
 #include "detector.h"
@@ -34,8 +37,10 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include "isr.h"
 #include "leds.h"
 #include "lockoutTimer.h"
+#include "memoryStats.h"
 #include "mio.h"
 #include "runningModes.h"
+#include "sampleRate.h"
 #include "sound.h"
 #include "switches.h"
 #include "transmitter.h"
@@ -43,6 +48,7 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include "queueTest.h"
 
 int main() {
+  memoryStats_init(); // Paint the stacks before anything else runs.
   mio_init(false);  // true enables debug prints
   leds_init(false); // true enables debug prints
   buttons_init();
@@ -50,6 +56,14 @@ int main() {
   display_init();
   display_fillScreen(DISPLAY_BLACK);
   display_println("System is Alive");
+  memoryStats_print("boot");
+  sampleRate_set(LASERTAG_SAMPLE_RATE_HZ); // Before any *_init().
+
+#ifdef LASERTAG_AMP
+  // The detector runs on CPU1 (see amp.h); start it before anything uses it.
+  amp_init();
+  amp_startDetectorCore();
+#endif
 
 #ifdef RUNNING_MODE_TESTS
   // interrupts not needed for these tests
@@ -68,6 +82,7 @@ int main() {
   isr_init();
 
   interrupts_initAll(false);          // main interrupt init function.
+  interrupts_setPrivateTimerLoadValue(sampleRate_getTimerLoadValue());
   interrupts_enableTimerGlobalInts(); // enable global interrupts.
   interrupts_startArmPrivateTimer();  // start the main timer.
   interrupts_enableArmInts(); // now the ARM processor can see interrupts.
@@ -81,11 +96,18 @@ int main() {
 
 #ifdef RUNNING_MODE_M3_T3
   // The program comes up in continuous mode by default.
-  // Hold BTN2 while the program starts to come up in shooter mode.
+  // Hold BTN2 while the program starts to come up in shooter mode,
+  // BTN1 for the spectrum analyzer or BTN0 for the oscilloscope.
   // Interrupts are enabled in runningModes.
   if (buttons_read() & BUTTONS_BTN2_MASK) {
     printf("Starting shooter mode\n");
     runningModes_shooter(); // Run shooter mode if BTN2 is depressed.
+  } else if (buttons_read() & BUTTONS_BTN1_MASK) {
+    printf("Starting spectrum mode\n");
+    runningModes_spectrum(); // Run the spectrum analyzer if BTN1 is depressed.
+  } else if (buttons_read() & BUTTONS_BTN0_MASK) {
+    printf("Starting scope mode\n");
+    runningModes_scope(); // Run the oscilloscope if BTN0 is depressed.
   } else {
     printf("Starting continuous mode\n");
     runningModes_continuous(); // Otherwise, go to continuous mode.
@@ -98,5 +120,6 @@ int main() {
 #endif
 
   display_println("System is Ending");
+  memoryStats_print("exit");
   return 0;
 }
@@ -0,0 +1,173 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "amp.h"
+#include "filter.h"
+#include "hitLedTimer.h"
+#include "instance.h"
+#include "remoteDetector.h"
+
+static INSTANCE_LOCAL detector_hitCount_t hitCounts[FILTER_FREQUENCY_COUNT];
+static INSTANCE_LOCAL bool hitDetectedFlag;
+static INSTANCE_LOCAL uint16_t frequencyNumberOfLastHit;
+static INSTANCE_LOCAL uint32_t tickOfLastHit;
+
+// Send a command to CPU1. Commands are rare and CPU1 drains them on every
+// pass, so a full ring means CPU1 has stopped; the command is dropped and
+// counted in the ring.
+static void sendCommand(amp_messageType_t type, uint16_t argument, uint32_t value) {
+  amp_push(&amp_getShared()->toDetector, type, argument, value);
+}
+
+void remoteDetector_init(void) {
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+    hitCounts[i] = 0;
+  hitDetectedFlag = false;
+  frequencyNumberOfLastHit = 0;
+  tickOfLastHit = 0;
+  sendCommand(AMP_MESSAGE_RESET, 0, 0);
+}
+
+void remoteDetector_setIgnoredFrequencies(bool freqArray[]) {
+  uint32_t mask = 0;
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+    if (freqArray[i])
+      mask |= 1 << i;
+  sendCommand(AMP_MESSAGE_SET_IGNORED, 0, mask);
+}
+
+void remoteDetector_ignoreAllHits(bool flagValue) {
+  sendCommand(AMP_MESSAGE_IGNORE_ALL_HITS, flagValue, 0);
+}
+
+void remoteDetector_setFudgeFactorIndex(uint32_t factorIdx) {
+  sendCommand(AMP_MESSAGE_SET_FUDGE_FACTOR, factorIdx, 0);
+}
+
+// Collect the hits CPU1 has reported since the last call.
+void remoteDetector_poll(void) {
+  amp_message_t message;
+  while (amp_pop(&amp_getShared()->toGame, &message)) {
+    if (message.type != AMP_MESSAGE_HIT || message.argument >= FILTER_FREQUENCY_COUNT)
+      continue;
+    hitCounts[message.argument]++;
+    hitDetectedFlag = true;
+    frequencyNumberOfLastHit = message.argument;
+    tickOfLastHit = message.value;
+    hitLedTimer_start();
+  }
+}
+
+bool remoteDetector_hitDetected(void) { return hitDetectedFlag; }
+
+uint16_t remoteDetector_getFrequencyNumberOfLastHit(void) {
+  return frequencyNumberOfLastHit;
+}
+
+void remoteDetector_clearHit(void) { hitDetectedFlag = false; }
+
+void remoteDetector_getHitCounts(detector_hitCount_t hitArray[]) {
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+    hitArray[i] = hitCounts[i];
+}
+
+// Returns the ADC tick (on CPU1) at which the last hit was detected.
+uint32_t remoteDetector_getTickOfLastHit(void) { return tickOfLastHit; }
+
+// Returns how many detector() calls CPU1 has made, as last reported.
+uint32_t remoteDetector_getInvocationCount(void) {
+  amp_stats_t stats;
+  amp_readStats(&stats);
+  return stats.detectorInvocations;
+}
+
+// Copy the filter powers CPU1 last published.
+void remoteDetector_getPowerValues(double powerValues[]) {
+  amp_stats_t stats;
+  amp_readStats(&stats);
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+    powerValues[i] = stats.powerValues[i];
+}
+
+// Returns how many commands could not be sent because the ring was full.
+uint32_t remoteDetector_getRejectedCommandCount(void) {
+  return amp_getShared()->toDetector.rejected;
+}
+
+#ifdef LASERTAG_AMP
+// The detector.h interface for the CPU0 image.
+
+void detector_init(void) { remoteDetector_init(); }
+
+void detector_setIgnoredFrequencies(bool freqArray[]) {
+  remoteDetector_setIgnoredFrequencies(freqArray);
+}
+
+// CPU1 does the filtering; here we only pick up its hits.
+void detector(bool interruptsCurrentlyEnabled) {
+  (void)interruptsCurrentlyEnabled;
+  remoteDetector_poll();
+}
+
+bool detector_hitDetected(void) { return remoteDetector_hitDetected(); }
+
+uint16_t detector_getFrequencyNumberOfLastHit(void) {
+  return remoteDetector_getFrequencyNumberOfLastHit();
+}
+
+void detector_clearHit(void) { remoteDetector_clearHit(); }
+
+void detector_ignoreAllHits(bool flagValue) { remoteDetector_ignoreAllHits(flagValue); }
+
+void detector_getHitCounts(detector_hitCount_t hitArray[]) {
+  remoteDetector_getHitCounts(hitArray);
+}
+
+void detector_setFudgeFactorIndex(uint32_t factorIdx) {
+  remoteDetector_setFudgeFactorIndex(factorIdx);
+}
+
+uint32_t detector_getInvocationCount(void) {
+  return remoteDetector_getInvocationCount();
+}
+
+// The filters are on CPU1, which starts them cold.
+uint32_t detector_saveState(uint8_t blob[], uint32_t size) {
+  (void)blob;
+  (void)size;
+  return 0;
+}
+
+bool detector_restoreState(const uint8_t blob[], uint32_t size) {
+  (void)blob;
+  (void)size;
+  return false;
+}
+
+// CPU1 picks its filters from the ignored frequencies it is sent.
+void detector_getFilterRunCounts(uint32_t *runs, uint32_t *skipped) {
+  amp_stats_t stats;
+  amp_readStats(&stats);
+  *runs = stats.filterRuns;
+  *skipped = stats.filterRunsSkipped;
+}
+
+// The power readers of filter.h for the CPU0 image, for the histogram,
+// telemetry and the journal.
+
+void filter_getCurrentPowerValues(double powerValues[]) {
+  remoteDetector_getPowerValues(powerValues);
+}
+
+double filter_getCurrentPowerValue(uint16_t filterNumber) {
+  double powerValues[FILTER_FREQUENCY_COUNT];
+  remoteDetector_getPowerValues(powerValues);
+  return powerValues[filterNumber];
+}
+#endif
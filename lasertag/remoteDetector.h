@@ -0,0 +1,56 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef REMOTEDETECTOR_H_
+#define REMOTEDETECTOR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "detector.h"
+
+// CPU0 side of the AMP build (see amp.h): the detector as seen from the core
+// that runs the game. Settings are sent to CPU1 and hits come back from it;
+// each arriving hit also starts the hit-LED timer, which ticks on CPU0.
+//
+// The CPU0 image is built with LASERTAG_AMP and links remoteDetector.c in
+// place of detector.c and filter.c, so the detector_* functions in
+// detector.h forward to these, the filter power readers of filter.h return
+// CPU1's powers, and game.c, runningModes.c, histogram.c and telemetry.c work
+// unchanged. The host simulator
+// calls these directly, since it also links the real detector for CPU1.
+
+void remoteDetector_init(void);
+void remoteDetector_setIgnoredFrequencies(bool freqArray[]);
+void remoteDetector_ignoreAllHits(bool flagValue);
+void remoteDetector_setFudgeFactorIndex(uint32_t factorIdx);
+
+// Collect the hits CPU1 has reported since the last call. Takes the place of
+// detector() in the main loop.
+void remoteDetector_poll(void);
+
+bool remoteDetector_hitDetected(void);
+uint16_t remoteDetector_getFrequencyNumberOfLastHit(void);
+void remoteDetector_clearHit(void);
+void remoteDetector_getHitCounts(detector_hitCount_t hitArray[]);
+
+// Returns the ADC tick (on CPU1) at which the last hit was detected.
+uint32_t remoteDetector_getTickOfLastHit(void);
+
+// Returns how many detector() calls CPU1 has made, as last reported.
+uint32_t remoteDetector_getInvocationCount(void);
+
+// Copy the filter powers CPU1 last published: at most AMP_STATS_INTERVAL_TICKS
+// old, and those of the last hit until the next report.
+void remoteDetector_getPowerValues(double powerValues[]);
+
+// Returns how many commands could not be sent because the ring was full.
+uint32_t remoteDetector_getRejectedCommandCount(void);
+
+#endif /* REMOTEDETECTOR_H_ */
@@ -0,0 +1,66 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "sampleRate.h"
+#include "instance.h"
+
+static INSTANCE_LOCAL uint32_t rateHz = SAMPLE_RATE_REFERENCE_HZ;
+
+// Sets the rate for the modules initialized from now on. Returns false,
+// changing nothing, outside SAMPLE_RATE_MIN_HZ..SAMPLE_RATE_MAX_HZ or if the
+// build cannot filter at hz.
+bool sampleRate_set(uint32_t hz) {
+  if (hz < SAMPLE_RATE_MIN_HZ || hz > SAMPLE_RATE_MAX_HZ)
+    return false;
+#if defined(LASERTAG_FLOAT_PIPELINE) || defined(LASERTAG_FILTER_TEMPLATES)
+  if (hz != SAMPLE_RATE_REFERENCE_HZ)
+    return false;
+#endif
+  rateHz = hz;
+  return true;
+}
+
+// Returns the rate, SAMPLE_RATE_REFERENCE_HZ until sampleRate_set().
+uint32_t sampleRate_getHz(void) { return rateHz; }
+
+// Returns how many inputs the FIR filter takes per output at the rate.
+uint16_t sampleRate_getDecimation(void) { return rateHz / SAMPLE_RATE_DECIMATED_HZ; }
+
+// Returns the rate of the FIR outputs and IIR filters, hz / decimation.
+double sampleRate_getDecimatedHz(void) {
+  return (double)rateHz / sampleRate_getDecimation();
+}
+
+// Converts referenceTicks at 100 kHz into as long a time at the rate,
+// rounded to the nearest tick.
+uint32_t sampleRate_ticks(uint32_t referenceTicks) {
+  return sampleRate_ticksAt(rateHz, referenceTicks);
+}
+
+// The same for any rate hz.
+uint32_t sampleRate_ticksAt(uint32_t hz, uint32_t referenceTicks) {
+  if (hz == SAMPLE_RATE_REFERENCE_HZ)
+    return referenceTicks;
+  return ((uint64_t)referenceTicks * hz + SAMPLE_RATE_REFERENCE_HZ / 2) /
+         SAMPLE_RATE_REFERENCE_HZ;
+}
+
+// Converts a count of decimated samples at 10 kHz into as long a time at the
+// decimated rate, rounded.
+uint32_t sampleRate_decimatedSamples(uint32_t referenceSamples) {
+  uint32_t decimatedHz = rateHz / sampleRate_getDecimation(); // 10416 at 125 kHz.
+  return ((uint64_t)referenceSamples * decimatedHz + SAMPLE_RATE_DECIMATED_HZ / 2) /
+         SAMPLE_RATE_DECIMATED_HZ;
+}
+
+// Returns the private timer load value that interrupts at the rate. Rates
+// that do not divide the timer clock get the nearest period.
+uint32_t sampleRate_getTimerLoadValue(void) {
+  return (SAMPLE_RATE_TIMER_CLOCK_HZ + rateHz / 2) / rateHz - 1;
+}
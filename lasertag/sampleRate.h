@@ -0,0 +1,68 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SAMPLERATE_H_
+#define SAMPLERATE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The acquisition rate: how often the timer ISR runs, and with it the ADC
+// sample, the transmitter and every timer. Tick constants throughout the
+// code are written for the 100 kHz reference rate; modules convert them with
+// sampleRate_ticks() when they are initialized, so a rate takes effect at
+// the next *_init(). The FIR decimation is hz / 10 kHz, which keeps the IIR
+// filters near 10 kHz (10.4 kHz at 125 kHz), and filter_init() designs the
+// filters for the rate.
+//
+// A lower rate costs less ISR and detector time per second, a higher one
+// averages more samples per decimated output. The float and template filter
+// builds have their coefficients built in and only run at the reference rate.
+
+#define SAMPLE_RATE_REFERENCE_HZ 100000 // The rate tick constants are written for.
+#define SAMPLE_RATE_MIN_HZ 50000
+#define SAMPLE_RATE_MAX_HZ 125000
+#define SAMPLE_RATE_DECIMATED_HZ 10000 // Per FIR output, before rounding.
+#define SAMPLE_RATE_TIMER_CLOCK_HZ 325000000 // Private timer: half the CPU clock.
+
+// The rate main() sets on the board, from CMake.
+#ifndef LASERTAG_SAMPLE_RATE_HZ
+#define LASERTAG_SAMPLE_RATE_HZ SAMPLE_RATE_REFERENCE_HZ
+#endif
+
+// Sets the rate for the modules initialized from now on. Returns false,
+// changing nothing, outside SAMPLE_RATE_MIN_HZ..SAMPLE_RATE_MAX_HZ or if the
+// build cannot filter at hz.
+bool sampleRate_set(uint32_t hz);
+
+// Returns the rate, SAMPLE_RATE_REFERENCE_HZ until sampleRate_set().
+uint32_t sampleRate_getHz(void);
+
+// Returns how many inputs the FIR filter takes per output at the rate.
+uint16_t sampleRate_getDecimation(void);
+
+// Returns the rate of the FIR outputs and IIR filters, hz / decimation.
+double sampleRate_getDecimatedHz(void);
+
+// Converts referenceTicks at 100 kHz into as long a time at the rate,
+// rounded to the nearest tick.
+uint32_t sampleRate_ticks(uint32_t referenceTicks);
+
+// The same for any rate hz.
+uint32_t sampleRate_ticksAt(uint32_t hz, uint32_t referenceTicks);
+
+// Converts a count of decimated samples at 10 kHz into as long a time at the
+// decimated rate, rounded.
+uint32_t sampleRate_decimatedSamples(uint32_t referenceSamples);
+
+// Returns the private timer load value that interrupts at the rate. Rates
+// that do not divide the timer clock get the nearest period.
+uint32_t sampleRate_getTimerLoadValue(void);
+
+#endif /* SAMPLERATE_H_ */
@@ -0,0 +1,196 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <string.h>
+
+#include "filter.h"
+#include "instance.h"
+#include "sampleRate.h"
+#include "shotCode.h"
+
+#define HISTORY_MASK (SHOTCODE_HISTORY_CHIPS - 1)
+#define SYMBOL_TICKS (SHOTCODE_TICKS_PER_CHIP * SHOTCODE_SYMBOL_CHIPS)
+#define ID_MASK (SHOTCODE_ID_COUNT - 1)
+#define CHECK_BITS (SHOTCODE_BITS - SHOTCODE_ID_BITS)
+#define CHECK_MASK ((1 << CHECK_BITS) - 1)
+
+// The power detector fires somewhere in the frame, early for a strong shot
+// and late for a weak one, up to a little after the frame as the IIR output
+// rings down, so the start is searched for over a frame and two symbols
+// before it, and a little after for the IIR delay. The window also holds a
+// lookback of eight symbols before the earliest start, which should be dark,
+// and the decode waits a few chips past its end for the tail of the IIR
+// response.
+#define SEARCH_BACK_CHIPS (SHOTCODE_FRAME_CHIPS + 2 * SHOTCODE_SYMBOL_CHIPS)
+#define SEARCH_LATE_CHIPS 2
+#define CANDIDATES (SEARCH_BACK_CHIPS + SEARCH_LATE_CHIPS + 1)
+#define LOOKBACK_CHIPS (SHOTCODE_BITS * SHOTCODE_SYMBOL_CHIPS)
+#define WINDOW_CHIPS (LOOKBACK_CHIPS + CANDIDATES + SHOTCODE_FRAME_CHIPS)
+#define DECODE_MARGIN_CHIPS 2
+#if WINDOW_CHIPS + DECODE_MARGIN_CHIPS > SHOTCODE_HISTORY_CHIPS
+#error "The chip history must hold a whole decode window."
+#endif
+
+// The IIR filters ring down faster than they ring up, so a one after a zero
+// only reaches about two thirds of the preamble level while a zero after a
+// one falls to a tenth of it. Bits are sliced between the two, and must be
+// clearly on one side.
+#define SLICE_LEVEL 0.375f
+#define MIN_BIT_MARGIN 0.1f
+
+static INSTANCE_LOCAL float history[FILTER_FREQUENCY_COUNT][SHOTCODE_HISTORY_CHIPS];
+static INSTANCE_LOCAL float chipEnergy[FILTER_FREQUENCY_COUNT];
+static INSTANCE_LOCAL uint16_t chipSamples;
+static INSTANCE_LOCAL uint16_t samplesPerChip = SHOTCODE_CHIP_SAMPLES; // At the decimated rate.
+static INSTANCE_LOCAL uint32_t chips; // Completed chips, free-running.
+static INSTANCE_LOCAL bool pending[FILTER_FREQUENCY_COUNT];
+static INSTANCE_LOCAL uint32_t searchFirst[FILTER_FREQUENCY_COUNT];
+static INSTANCE_LOCAL int16_t result[FILTER_FREQUENCY_COUNT];
+
+// Two parity bits over the alternate bits of id, inverted.
+static uint8_t checkBits(uint8_t id) {
+  return ~(id ^ (id >> 2) ^ (id >> 4)) & CHECK_MASK;
+}
+
+// The 8-bit frame, most significant bit first, that carries id.
+uint8_t shotCode_encode(uint8_t id) {
+  id &= ID_MASK;
+  return (id << CHECK_BITS) | checkBits(id);
+}
+
+// Returns the ID in frame, or SHOTCODE_UNKNOWN if its check bits are wrong.
+int16_t shotCode_checkFrame(uint8_t frame) {
+  uint8_t id = frame >> CHECK_BITS;
+  return checkBits(id) == (frame & CHECK_MASK) ? id : SHOTCODE_UNKNOWN;
+}
+
+// Returns true if the carrier is on tick transmitter ticks, at the sample
+// rate, into the burst that carries frame.
+bool shotCode_carrierOn(uint8_t frame, uint32_t tick) {
+  uint32_t symbol = tick / sampleRate_ticks(SYMBOL_TICKS);
+  if (symbol < SHOTCODE_PREAMBLE_SYMBOLS)
+    return true;
+  if (symbol >= SHOTCODE_FRAME_SYMBOLS)
+    return false;
+  return frame & (0x80 >> (symbol - SHOTCODE_PREAMBLE_SYMBOLS));
+}
+
+// Forget all chip history and pending decodes.
+void shotCode_init(void) {
+  memset(history, 0, sizeof(history));
+  memset(chipEnergy, 0, sizeof(chipEnergy));
+  memset(pending, 0, sizeof(pending));
+  chipSamples = 0;
+  samplesPerChip = sampleRate_decimatedSamples(SHOTCODE_CHIP_SAMPLES);
+  chips = 0;
+  for (uint16_t c = 0; c < FILTER_FREQUENCY_COUNT; c++)
+    result[c] = SHOTCODE_NONE;
+}
+
+// Add the newest IIR output of channel.
+void shotCode_addSample(uint16_t channel, double y) {
+  chipEnergy[channel] += (float)(y * y);
+}
+
+// Energy of symbol k of the frame starting at chip s of the window.
+static float symbolEnergy(const float prefix[], int32_t s, int32_t k) {
+  int32_t first = s + k * SHOTCODE_SYMBOL_CHIPS;
+  return prefix[first + SHOTCODE_SYMBOL_CHIPS] - prefix[first];
+}
+
+// Find the frame start with dark before it, a bright preamble and bits that
+// are closest to either dark or the preamble level, and slice the bits there.
+static int16_t decode(uint16_t channel) {
+  // prefix[i] is the energy of the first i chips of the window.
+  float prefix[WINDOW_CHIPS + 1];
+  prefix[0] = 0;
+  for (uint32_t i = 0; i < WINDOW_CHIPS; i++)
+    prefix[i + 1] = prefix[i] + history[channel][(searchFirst[channel] + i) & HISTORY_MASK];
+
+  float bestScore = 0;
+  int32_t best = -1;
+  for (int32_t s = LOOKBACK_CHIPS; s < LOOKBACK_CHIPS + CANDIDATES; s++) {
+    // The frame starts at a rising edge: a dark symbol, then the preamble. It
+    // is dark for a while before, too, which is what tells the real start from
+    // a later pair of ones followed by the dark after the frame. Each bit costs half its distance from the nearer of dark and the
+    // preamble level, taken from the second preamble symbol since the first
+    // is still ringing up. That settles the start to within a chip.
+    float level = symbolEnergy(prefix, s, SHOTCODE_PREAMBLE_SYMBOLS - 1);
+    float score = symbolEnergy(prefix, s, 0) + level - symbolEnergy(prefix, s, -1) -
+                  (prefix[s] - prefix[s - LOOKBACK_CHIPS]);
+    for (int32_t k = SHOTCODE_PREAMBLE_SYMBOLS; k < SHOTCODE_FRAME_SYMBOLS; k++) {
+      float energy = symbolEnergy(prefix, s, k);
+      float fromLevel = energy > level ? energy - level : level - energy;
+      score -= (energy < fromLevel ? energy : fromLevel) / 2;
+    }
+    if (best < 0 || score > bestScore) {
+      bestScore = score;
+      best = s;
+    }
+  }
+
+  float level = symbolEnergy(prefix, best, SHOTCODE_PREAMBLE_SYMBOLS - 1);
+  if (symbolEnergy(prefix, best, -1) > level * SLICE_LEVEL)
+    return SHOTCODE_UNKNOWN;
+  // Another channel brighter over the frame means this one only caught the
+  // skirt of that shot.
+  float frameEnergy = prefix[best + SHOTCODE_FRAME_CHIPS] - prefix[best];
+  for (uint16_t c = 0; c < FILTER_FREQUENCY_COUNT; c++) {
+    if (c == channel)
+      continue;
+    float energy = 0;
+    for (uint32_t i = 0; i < SHOTCODE_FRAME_CHIPS; i++)
+      energy += history[c][(searchFirst[channel] + best + i) & HISTORY_MASK];
+    if (energy > frameEnergy)
+      return SHOTCODE_UNKNOWN;
+  }
+  uint8_t frame = 0;
+  for (int32_t k = SHOTCODE_PREAMBLE_SYMBOLS; k < SHOTCODE_FRAME_SYMBOLS; k++) {
+    float margin = symbolEnergy(prefix, best, k) - level * SLICE_LEVEL;
+    if ((margin < 0 ? -margin : margin) < level * MIN_BIT_MARGIN)
+      return SHOTCODE_UNKNOWN;
+    frame = (frame << 1) | (margin > 0);
+  }
+  return shotCode_checkFrame(frame);
+}
+
+// Call once per decimated sample after adding the channels.
+bool shotCode_endSample(void) {
+  if (++chipSamples < samplesPerChip)
+    return false;
+  chipSamples = 0;
+  uint32_t slot = chips & HISTORY_MASK;
+  for (uint16_t c = 0; c < FILTER_FREQUENCY_COUNT; c++) {
+    history[c][slot] = chipEnergy[c];
+    chipEnergy[c] = 0;
+  }
+  chips++;
+  for (uint16_t c = 0; c < FILTER_FREQUENCY_COUNT; c++) {
+    if (pending[c] && chips - searchFirst[c] >= WINDOW_CHIPS + DECODE_MARGIN_CHIPS) {
+      pending[c] = false;
+      result[c] = decode(c);
+    }
+  }
+  return true;
+}
+
+// Decode the shot on channel once the frame must be complete.
+void shotCode_expectFrame(uint16_t channel) {
+  if (pending[channel] || result[channel] != SHOTCODE_NONE)
+    return;
+  pending[channel] = true;
+  searchFirst[channel] = chips - SEARCH_BACK_CHIPS - LOOKBACK_CHIPS;
+}
+
+// Returns SHOTCODE_NONE until a pending decode of channel is done.
+int16_t shotCode_takeResult(uint16_t channel) {
+  int16_t id = result[channel];
+  result[channel] = SHOTCODE_NONE;
+  return id;
+}
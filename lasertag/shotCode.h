@@ -0,0 +1,88 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SHOTCODE_H_
+#define SHOTCODE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Coded shots: a shooter ID carried on the 200 ms burst by switching the
+// carrier on and off, so players sharing a frequency can still be told apart.
+//
+// The burst is ten symbols of 20 ms, each carrier on (1) or off (0):
+//
+//   preamble: 1 1 | 8 data bits, most significant first
+//
+// The 8 bits are a 6-bit ID (team in the top bit, player below) and a 2-bit
+// check. The check bits are inverted so that a plain burst, all ones, never
+// reads as a valid code. 20 ms is about as short as a symbol can be: the IIR
+// filters take 10-15 ms to ring up and down, and 10 ms symbols smear into a
+// flat level.
+//
+// The receiver side works on the IIR outputs the detector already computes.
+// Per decimated sample and decoded channel it adds y * y into the current
+// chip, a quarter of a symbol; at the end of each chip it stores the chip
+// energies in a ring. When the power detector has found a shot on a channel,
+// shotCode_expectFrame() asks for a decode once the whole frame must have
+// arrived: the frame start is then searched for over the chip history, using
+// prefix sums, as the rising edge that gives the cleanest ones and zeros, and
+// each bit is sliced against half the preamble level, so no threshold depends
+// on range. The cost per sample is a multiply-add per channel, and the search
+// runs once a shot.
+
+#define SHOTCODE_TICKS_PER_CHIP 500 // Transmitter ticks at 100 kHz: 5 ms.
+#define SHOTCODE_CHIP_SAMPLES 50    // The same in decimated samples at 10 kHz.
+#define SHOTCODE_SYMBOL_CHIPS 4     // 20 ms.
+#define SHOTCODE_PREAMBLE_SYMBOLS 2
+#define SHOTCODE_BITS 8
+#define SHOTCODE_FRAME_SYMBOLS (SHOTCODE_PREAMBLE_SYMBOLS + SHOTCODE_BITS)
+#define SHOTCODE_FRAME_CHIPS (SHOTCODE_FRAME_SYMBOLS * SHOTCODE_SYMBOL_CHIPS)
+#define SHOTCODE_HISTORY_CHIPS 128 // Per channel, a power of two: 640 ms.
+
+#define SHOTCODE_ID_BITS 6
+#define SHOTCODE_ID_COUNT (1 << SHOTCODE_ID_BITS)
+#define SHOTCODE_PLAYER_BITS 5
+#define SHOTCODE_ID(team, player) (((team) << SHOTCODE_PLAYER_BITS) | (player))
+#define SHOTCODE_TEAM(id) ((id) >> SHOTCODE_PLAYER_BITS)
+#define SHOTCODE_PLAYER(id) ((id) & ((1 << SHOTCODE_PLAYER_BITS) - 1))
+
+#define SHOTCODE_NONE -1    // Plain burst, or no result yet.
+#define SHOTCODE_UNKNOWN -2 // A shot whose code did not check out.
+
+// The 8-bit frame, most significant bit first, that carries id.
+uint8_t shotCode_encode(uint8_t id);
+
+// Returns the ID in frame, or SHOTCODE_UNKNOWN if its check bits are wrong.
+int16_t shotCode_checkFrame(uint8_t frame);
+
+// Returns true if the carrier is on tick transmitter ticks, at the sample
+// rate, into the burst that carries frame.
+bool shotCode_carrierOn(uint8_t frame, uint32_t tick);
+
+// Forget all chip history and pending decodes.
+void shotCode_init(void);
+
+// Add the newest IIR output of channel. Channels that are never added read as
+// silent.
+void shotCode_addSample(uint16_t channel, double y);
+
+// Call once per decimated sample after adding the channels. Returns true when
+// a chip was completed, which is when shotCode_takeResult() may have news.
+bool shotCode_endSample(void);
+
+// The power detector saw a shot on channel: decode it once the frame must be
+// complete. Does nothing if a decode for channel is already pending.
+void shotCode_expectFrame(uint16_t channel);
+
+// Returns SHOTCODE_NONE until a pending decode of channel is done, then once
+// the ID found or SHOTCODE_UNKNOWN.
+int16_t shotCode_takeResult(uint16_t channel);
+
+#endif /* SHOTCODE_H_ */
@@ -0,0 +1,24 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "shotSlot.h"
+#include "sampleRate.h"
+
+// Ticks, at the sample rate (sampleRate.h), in a frame of slotCount slots.
+uint32_t shotSlot_frameTicks(uint16_t slotCount) {
+  return (uint32_t)slotCount * sampleRate_ticks(SHOTSLOT_TICKS);
+}
+
+// Returns the slot that a hit detected phase ticks into the frame was sent in.
+int16_t shotSlot_ofDetection(uint32_t phase, uint16_t slotCount) {
+  if (!slotCount)
+    return SHOTSLOT_NONE;
+  return (phase + sampleRate_ticks(SHOTSLOT_GUARD_TICKS)) % shotSlot_frameTicks(slotCount) /
+         sampleRate_ticks(SHOTSLOT_TICKS);
+}
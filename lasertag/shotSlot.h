@@ -0,0 +1,45 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SHOTSLOT_H_
+#define SHOTSLOT_H_
+
+#include <stdint.h>
+
+// Time-division shots: players sharing a frequency take turns. Time is cut
+// into a frame of slotCount slots from a shared epoch, and each shooter only
+// starts a burst at the start of its own slot (transmitter_setSlot()). The
+// receiver bins each hit by the slot it arrived in (detector_setSlots()), so
+// (frequency, slot) names the shooter even in dense fire.
+//
+// The epoch is whatever moment every gun agrees on, e.g. a beacon from the
+// base station or a sync burst: each gun calls transmitter_syncSlots() and
+// detector_syncSlots() when it sees it. Guns may disagree by up to
+// SHOTSLOT_GUARD_TICKS.
+//
+// A slot is as long as the hit lockout: a 200 ms burst, then the 200 ms the
+// power window takes to forget it and the IIR filters to ring down, so no
+// energy is left over for the next slot, and a guard for clock error. The
+// price is latency: a shot waits up to a frame for its slot.
+
+#define SHOTSLOT_TICKS 50000      // 500 ms at 100 kHz.
+#define SHOTSLOT_GUARD_TICKS 4000 // 40 ms.
+#define SHOTSLOT_MAX_COUNT 16
+#define SHOTSLOT_NONE -1
+
+// Ticks, at the sample rate (sampleRate.h), in a frame of slotCount slots.
+uint32_t shotSlot_frameTicks(uint16_t slotCount);
+
+// Returns the slot that a hit detected phase ticks into the frame was sent in.
+// The power detector fires from a few ms into a burst to a little after its
+// end, so detections are binned from SHOTSLOT_GUARD_TICKS before the slot
+// starts to as much before the next one.
+int16_t shotSlot_ofDetection(uint32_t phase, uint16_t slotCount);
+
+#endif /* SHOTSLOT_H_ */
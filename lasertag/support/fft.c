@@ -0,0 +1,216 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <math.h>
+
+#include "fft.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define MAX_COMPLEX_COUNT (FFT_MAX_POINT_COUNT / 2)
+// The real split reaches W_N^k up to k = N/2, the radix-4 passes up to 3N/4.
+#define TWIDDLE_COUNT (3 * FFT_MAX_POINT_COUNT / 4)
+// A radix-4 pass of span s takes 6 s twiddles, and the spans add up to less
+// than N/6.
+#define PASS_TWIDDLE_COUNT FFT_MAX_POINT_COUNT
+#define LANES 4 // Butterflies per NEON register.
+#define TWO_PI 6.283185307179586
+
+static uint16_t pointCount;
+static uint16_t complexCount;
+static uint16_t complexStages; // log2(complexCount) radix-2 stages.
+// W_N^k = exp(-2 pi i k / N); the complex FFT's W_{N/2}^k is W_N^{2k}.
+static float twiddleRe[TWIDDLE_COUNT];
+static float twiddleIm[TWIDDLE_COUNT];
+// The twiddles of each radix-4 pass in the order its butterflies use them:
+// for a pass of span s, W_{4s}^{2j}, W_{4s}^j and W_{4s}^{3j} for j = 0 to
+// s - 1, each as s real parts then s imaginary parts, and the next pass
+// after them. Neighbouring butterflies then load neighbouring twiddles.
+static float passTwiddles[PASS_TWIDDLE_COUNT];
+static uint16_t bitReversed[MAX_COMPLEX_COUNT];
+// Hann window, scaled so a tone of amplitude A at a bin center reads A^2.
+static float window[FFT_MAX_POINT_COUNT];
+static float workRe[MAX_COMPLEX_COUNT];
+static float workIm[MAX_COMPLEX_COUNT];
+
+// Build the tables for pointCount-point frames. Returns false unless
+// pointCount is a power of two from FFT_MIN_POINT_COUNT to
+// FFT_MAX_POINT_COUNT.
+bool fft_init(uint16_t count) {
+  if (count < FFT_MIN_POINT_COUNT || count > FFT_MAX_POINT_COUNT || (count & (count - 1)))
+    return false;
+  pointCount = count;
+  complexCount = count / 2;
+  for (uint32_t k = 0; k < 3 * (uint32_t)count / 4; k++) {
+    twiddleRe[k] = (float)cos(TWO_PI * k / count);
+    twiddleIm[k] = (float)-sin(TWO_PI * k / count);
+  }
+  complexStages = 0;
+  while ((1u << complexStages) < complexCount)
+    complexStages++;
+  float *w = passTwiddles;
+  for (uint16_t span = complexStages & 1 ? 2 : 1; span < complexCount; span *= 4) {
+    uint32_t stride = count / (4 * span); // W_{4 span}^j = W_N^{j stride}.
+    for (uint16_t j = 0; j < span; j++) {
+      uint32_t k[3] = {2 * j * stride, j * stride, 3 * j * stride};
+      for (uint16_t t = 0; t < 3; t++) {
+        w[2 * t * span + j] = twiddleRe[k[t]];
+        w[(2 * t + 1) * span + j] = twiddleIm[k[t]];
+      }
+    }
+    w += 6 * span;
+  }
+  for (uint16_t i = 0; i < complexCount; i++) {
+    uint16_t reversed = 0;
+    for (uint16_t b = 0; b < complexStages; b++)
+      reversed |= ((i >> b) & 1) << (complexStages - 1 - b);
+    bitReversed[i] = reversed;
+  }
+  double windowSum = 0;
+  for (uint16_t n = 0; n < count; n++)
+    windowSum += 0.5 - 0.5 * cos(TWO_PI * n / count);
+  for (uint16_t n = 0; n < count; n++)
+    window[n] = (float)((1 - cos(TWO_PI * n / count)) / windowSum);
+  return true;
+}
+
+// Returns the frame length set by fft_init().
+uint16_t fft_getPointCount(void) { return pointCount; }
+
+// One radix-4 pass: two radix-2 stages at once, butterflies of span and
+// 2 * span, with three twiddle multiplies per four points instead of four.
+// w[] holds the pass's twiddles as passTwiddles lays them out.
+static void radix4Pass(float re[], float im[], uint16_t span, const float w[]) {
+  const float *w1r = w, *w1i = w + span, *w2r = w + 2 * span, *w2i = w + 3 * span;
+  const float *w3r = w + 4 * span, *w3i = w + 5 * span;
+#if defined(__ARM_NEON)
+  // Four neighbouring butterflies per register, once span allows it.
+  if (span >= LANES) {
+    for (uint16_t g = 0; g < complexCount; g += 4 * span) {
+      for (uint16_t j = 0; j < span; j += LANES) {
+        uint16_t a = g + j, b = a + span, c = b + span, d = c + span;
+        float32x4_t xr = vld1q_f32(&re[b]), xi = vld1q_f32(&im[b]);
+        float32x4_t wr = vld1q_f32(&w1r[j]), wi = vld1q_f32(&w1i[j]);
+        float32x4_t br = vmlsq_f32(vmulq_f32(xr, wr), xi, wi);
+        float32x4_t bi = vmlaq_f32(vmulq_f32(xr, wi), xi, wr);
+        xr = vld1q_f32(&re[c]), xi = vld1q_f32(&im[c]);
+        wr = vld1q_f32(&w2r[j]), wi = vld1q_f32(&w2i[j]);
+        float32x4_t cr = vmlsq_f32(vmulq_f32(xr, wr), xi, wi);
+        float32x4_t ci = vmlaq_f32(vmulq_f32(xr, wi), xi, wr);
+        xr = vld1q_f32(&re[d]), xi = vld1q_f32(&im[d]);
+        wr = vld1q_f32(&w3r[j]), wi = vld1q_f32(&w3i[j]);
+        float32x4_t dr = vmlsq_f32(vmulq_f32(xr, wr), xi, wi);
+        float32x4_t di = vmlaq_f32(vmulq_f32(xr, wi), xi, wr);
+        float32x4_t ar = vld1q_f32(&re[a]), ai = vld1q_f32(&im[a]);
+        float32x4_t s0r = vaddq_f32(ar, br), s0i = vaddq_f32(ai, bi);
+        float32x4_t s1r = vsubq_f32(ar, br), s1i = vsubq_f32(ai, bi);
+        float32x4_t s2r = vaddq_f32(cr, dr), s2i = vaddq_f32(ci, di);
+        float32x4_t s3r = vsubq_f32(cr, dr), s3i = vsubq_f32(ci, di);
+        vst1q_f32(&re[a], vaddq_f32(s0r, s2r));
+        vst1q_f32(&im[a], vaddq_f32(s0i, s2i));
+        vst1q_f32(&re[c], vsubq_f32(s0r, s2r));
+        vst1q_f32(&im[c], vsubq_f32(s0i, s2i));
+        vst1q_f32(&re[b], vaddq_f32(s1r, s3i));
+        vst1q_f32(&im[b], vsubq_f32(s1i, s3r));
+        vst1q_f32(&re[d], vsubq_f32(s1r, s3i));
+        vst1q_f32(&im[d], vaddq_f32(s1i, s3r));
+      }
+    }
+    return;
+  }
+#endif
+  for (uint16_t g = 0; g < complexCount; g += 4 * span) {
+    for (uint16_t j = 0; j < span; j++) {
+      uint16_t a = g + j, b = a + span, c = b + span, d = c + span;
+      float br = re[b] * w1r[j] - im[b] * w1i[j], bi = re[b] * w1i[j] + im[b] * w1r[j];
+      float cr = re[c] * w2r[j] - im[c] * w2i[j], ci = re[c] * w2i[j] + im[c] * w2r[j];
+      float dr = re[d] * w3r[j] - im[d] * w3i[j], di = re[d] * w3i[j] + im[d] * w3r[j];
+      float s0r = re[a] + br, s0i = im[a] + bi;
+      float s1r = re[a] - br, s1i = im[a] - bi;
+      float s2r = cr + dr, s2i = ci + di;
+      float s3r = cr - dr, s3i = ci - di;
+      re[a] = s0r + s2r;
+      im[a] = s0i + s2i;
+      re[c] = s0r - s2r;
+      im[c] = s0i - s2i;
+      // -i * s3 finishes the odd half.
+      re[b] = s1r + s3i;
+      im[b] = s1i - s3r;
+      re[d] = s1r - s3i;
+      im[d] = s1i + s3r;
+    }
+  }
+}
+
+// In-place forward FFT of the pointCount / 2 complex values in re[] and im[].
+void fft_transform(float re[], float im[]) {
+  uint16_t m = complexCount;
+  for (uint16_t i = 0; i < m; i++) {
+    uint16_t j = bitReversed[i];
+    if (j > i) {
+      float swap = re[i];
+      re[i] = re[j];
+      re[j] = swap;
+      swap = im[i];
+      im[i] = im[j];
+      im[j] = swap;
+    }
+  }
+
+  // With an odd number of radix-2 stages the first is done alone; its only
+  // twiddle is 1.
+  uint16_t span = 1;
+  if (complexStages & 1) {
+    for (uint16_t i = 0; i < m; i += 2) {
+      float r = re[i + 1], q = im[i + 1];
+      re[i + 1] = re[i] - r;
+      im[i + 1] = im[i] - q;
+      re[i] += r;
+      im[i] += q;
+    }
+    span = 2;
+  }
+
+  const float *w = passTwiddles;
+  for (; span < m; span *= 4) {
+    radix4Pass(re, im, span, w);
+    w += 6 * span;
+  }
+}
+
+// Power of bins 0 to pointCount / 2 - 1 of frame[], which holds pointCount
+// samples. The frame mean is removed and a Hann window applied first, so bin
+// k is the power at k * sampleRate / pointCount.
+void fft_powerSpectrum(const float frame[], float power[]) {
+  float mean = 0;
+  for (uint16_t n = 0; n < pointCount; n++)
+    mean += frame[n];
+  mean /= pointCount;
+  // Even samples go in the real part, odd ones in the imaginary part.
+  for (uint16_t n = 0; n < complexCount; n++) {
+    workRe[n] = (frame[2 * n] - mean) * window[2 * n];
+    workIm[n] = (frame[2 * n + 1] - mean) * window[2 * n + 1];
+  }
+  fft_transform(workRe, workIm);
+
+  // Split Z into the spectra of the even and odd samples, E and O, and
+  // combine them: X[k] = E[k] + W_N^k O[k].
+  for (uint16_t k = 0; k < complexCount; k++) {
+    uint16_t mirror = k ? complexCount - k : 0;
+    float ar = workRe[k], ai = workIm[k];
+    float cr = workRe[mirror], ci = workIm[mirror];
+    float evenRe = (ar + cr) / 2, evenIm = (ai - ci) / 2;
+    float oddRe = (ai + ci) / 2, oddIm = (cr - ar) / 2;
+    float xr = evenRe + twiddleRe[k] * oddRe - twiddleIm[k] * oddIm;
+    float xi = evenIm + twiddleRe[k] * oddIm + twiddleIm[k] * oddRe;
+    power[k] = xr * xr + xi * xi;
+  }
+}
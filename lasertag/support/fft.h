@@ -0,0 +1,44 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef FFT_H_
+#define FFT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Power spectrum of real ADC frames for the spectrum analyzer (spectrum.h).
+// An N-point real frame is packed into an N/2-point complex FFT, which runs
+// in radix-4 passes (plus one radix-2 pass when log2(N/2) is odd) over
+// precomputed twiddles, and is split into the N/2 bins of the real
+// spectrum. All arithmetic is single precision. On the board the radix-4
+// passes do four butterflies at a time in NEON once their span reaches four;
+// without NEON (the host) plain C does the same operations in the same
+// order.
+
+#define FFT_MIN_POINT_COUNT 256
+#define FFT_MAX_POINT_COUNT 1024
+
+// Build the tables for pointCount-point frames. Returns false unless
+// pointCount is a power of two from FFT_MIN_POINT_COUNT to
+// FFT_MAX_POINT_COUNT.
+bool fft_init(uint16_t pointCount);
+
+// Returns the frame length set by fft_init().
+uint16_t fft_getPointCount(void);
+
+// In-place forward FFT of the pointCount / 2 complex values in re[] and im[].
+void fft_transform(float re[], float im[]);
+
+// Power of bins 0 to pointCount / 2 - 1 of frame[], which holds pointCount
+// samples. The frame mean is removed and a Hann window applied first, so bin
+// k is the power at k * sampleRate / pointCount.
+void fft_powerSpectrum(const float frame[], float power[]);
+
+#endif /* FFT_H_ */
@@ -0,0 +1,160 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "memoryStats.h"
+
+// Symbols provided by lscript.ld. Only their addresses are meaningful.
+extern char _vector_table[];
+extern char __rodata_start[], __rodata_end[];
+extern char __data_start[], __data_end[];
+extern char __bss_start[], __bss_end[];
+extern char _heap_start[], _heap_end[];
+extern char _stack_end[], _stack[];
+extern char _irq_stack_end[], __irq_stack[];
+
+#define STACK_PAINT_VALUE 0xDEADBEEF
+// Leave this many bytes below the caller's frame unpainted.
+#define STACK_PAINT_MARGIN 256
+#define BYTES_PER_KB 1024
+
+// Every allocation is prefixed with a header holding its size so free() knows
+// how much to subtract. 8 bytes keeps the returned pointer 8-byte aligned.
+#define ALLOC_HEADER_SIZE 8
+
+static uint32_t heapBytesInUse = 0;
+static uint32_t heapHighWater = 0;
+static uint32_t allocationCount = 0;
+
+void *__real_malloc(size_t size);
+void __real_free(void *ptr);
+void *__real_realloc(void *ptr, size_t size);
+
+// Keep the in-use and high-water counts up to date.
+static void trackAllocation(size_t size) {
+  heapBytesInUse += size;
+  if (heapBytesInUse > heapHighWater)
+    heapHighWater = heapBytesInUse;
+}
+
+// Replaces malloc() when linked with -Wl,--wrap=malloc.
+void *__wrap_malloc(size_t size) {
+  uint8_t *block = __real_malloc(size + ALLOC_HEADER_SIZE);
+  if (block == NULL)
+    return NULL;
+  *(size_t *)block = size;
+  allocationCount++;
+  trackAllocation(size);
+  return block + ALLOC_HEADER_SIZE;
+}
+
+// Replaces free() when linked with -Wl,--wrap=free.
+void __wrap_free(void *ptr) {
+  if (ptr == NULL)
+    return;
+  uint8_t *block = (uint8_t *)ptr - ALLOC_HEADER_SIZE;
+  heapBytesInUse -= *(size_t *)block;
+  allocationCount--;
+  __real_free(block);
+}
+
+// Replaces calloc() when linked with -Wl,--wrap=calloc.
+void *__wrap_calloc(size_t count, size_t size) {
+  void *ptr = __wrap_malloc(count * size);
+  if (ptr != NULL)
+    memset(ptr, 0, count * size);
+  return ptr;
+}
+
+// Replaces realloc() when linked with -Wl,--wrap=realloc.
+void *__wrap_realloc(void *ptr, size_t size) {
+  if (ptr == NULL)
+    return __wrap_malloc(size);
+  uint8_t *block = (uint8_t *)ptr - ALLOC_HEADER_SIZE;
+  size_t oldSize = *(size_t *)block;
+  block = __real_realloc(block, size + ALLOC_HEADER_SIZE);
+  if (block == NULL)
+    return NULL;
+  *(size_t *)block = size;
+  heapBytesInUse -= oldSize;
+  trackAllocation(size);
+  return block + ALLOC_HEADER_SIZE;
+}
+
+// Fill [start, end) with the paint value.
+static void paintStack(uint32_t *start, uint32_t *end) {
+  for (uint32_t *p = start; p < end; p++)
+    *p = STACK_PAINT_VALUE;
+}
+
+// Stacks grow down, so the first overwritten word above the low end marks the
+// deepest point reached. Returns the number of bytes used.
+static uint32_t stackHighWater(uint32_t *low, uint32_t *high) {
+  uint32_t *p = low;
+  while (p < high && *p == STACK_PAINT_VALUE)
+    p++;
+  return (uint32_t)((char *)high - (char *)p);
+}
+
+// Paints the main and IRQ stacks. Call this first thing in main(), before
+// interrupts are enabled, so that the IRQ stack is not in use.
+void memoryStats_init(void) {
+  char *frame = __builtin_frame_address(0);
+  paintStack((uint32_t *)_stack_end, (uint32_t *)(frame - STACK_PAINT_MARGIN));
+  paintStack((uint32_t *)_irq_stack_end, (uint32_t *)__irq_stack);
+}
+
+// Returns the number of heap bytes currently allocated through malloc().
+uint32_t memoryStats_getHeapBytesInUse(void) { return heapBytesInUse; }
+
+// Returns the largest number of heap bytes that were allocated at one time.
+uint32_t memoryStats_getHeapHighWater(void) { return heapHighWater; }
+
+// Returns the deepest main-stack usage in bytes since memoryStats_init().
+uint32_t memoryStats_getMainStackHighWater(void) {
+  return stackHighWater((uint32_t *)_stack_end, (uint32_t *)_stack);
+}
+
+// Returns the deepest IRQ-stack usage in bytes since memoryStats_init().
+uint32_t memoryStats_getIrqStackHighWater(void) {
+  return stackHighWater((uint32_t *)_irq_stack_end, (uint32_t *)__irq_stack);
+}
+
+// Print one "name: used / reserved" line, in KB.
+static void printUsage(const char *name, uint32_t used, uint32_t reserved) {
+  printf("  %-12s %8.1f KB / %8.1f KB (%.1f%%)\n", name,
+         (double)used / BYTES_PER_KB, (double)reserved / BYTES_PER_KB,
+         reserved ? 100.0 * used / reserved : 0.0);
+}
+
+// Prints the section sizes, heap usage and stack high-water marks to the
+// console. The label is printed in the heading, e.g. "boot" or "exit".
+void memoryStats_print(const char *label) {
+  uint32_t heapReserved = _heap_end - _heap_start;
+  // sbrk(0) includes allocator overhead and fragmentation, and allocations
+  // made inside newlib that do not go through the wrapped malloc().
+  uint32_t heapBreak = (char *)sbrk(0) - _heap_start;
+
+  printf("Memory usage (%s):\n", label);
+  printf("  %-12s %8.1f KB\n", ".text", (double)(__rodata_start - _vector_table) / BYTES_PER_KB);
+  printf("  %-12s %8.1f KB\n", ".rodata", (double)(__rodata_end - __rodata_start) / BYTES_PER_KB);
+  printf("  %-12s %8.1f KB\n", ".data", (double)(__data_end - __data_start) / BYTES_PER_KB);
+  printf("  %-12s %8.1f KB\n", ".bss", (double)(__bss_end - __bss_start) / BYTES_PER_KB);
+  printUsage("heap", heapBytesInUse, heapReserved);
+  printUsage("heap peak", heapHighWater, heapReserved);
+  printUsage("heap break", heapBreak, heapReserved);
+  printf("  %-12s %8lu live allocations\n", "", (unsigned long)allocationCount);
+  printUsage("main stack", memoryStats_getMainStackHighWater(), _stack - _stack_end);
+  printUsage("irq stack", memoryStats_getIrqStackHighWater(), __irq_stack - _irq_stack_end);
+}
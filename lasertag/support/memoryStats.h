@@ -0,0 +1,43 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef MEMORYSTATS_H_
+#define MEMORYSTATS_H_
+
+#include <stdint.h>
+
+// Memory accounting for the firmware.
+// 1. Static section sizes come from the symbols defined in lscript.ld.
+// 2. Heap usage is tracked by wrapping malloc()/free() at link time (see the
+// --wrap options in lasertag/CMakeLists.txt).
+// 3. Stack high-water marks are found by painting the unused part of the main
+// and IRQ stacks with a known pattern and later scanning for the deepest word
+// that was overwritten.
+
+// Paints the main and IRQ stacks. Call this first thing in main(), before
+// interrupts are enabled, so that the IRQ stack is not in use.
+void memoryStats_init(void);
+
+// Returns the number of heap bytes currently allocated through malloc().
+uint32_t memoryStats_getHeapBytesInUse(void);
+
+// Returns the largest number of heap bytes that were allocated at one time.
+uint32_t memoryStats_getHeapHighWater(void);
+
+// Returns the deepest main-stack usage in bytes since memoryStats_init().
+uint32_t memoryStats_getMainStackHighWater(void);
+
+// Returns the deepest IRQ-stack usage in bytes since memoryStats_init().
+uint32_t memoryStats_getIrqStackHighWater(void);
+
+// Prints the section sizes, heap usage and stack high-water marks to the
+// console. The label is printed in the heading, e.g. "boot" or "exit".
+void memoryStats_print(const char *label);
+
+#endif /* MEMORYSTATS_H_ */
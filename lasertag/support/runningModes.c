@@ -13,6 +13,9 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef LASERTAG_AMP
+#include "amp.h"
+#endif
 #include "buffer.h"
 #include "buttons.h"
 #include "detector.h"
@@ -25,6 +28,9 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include "isr.h"
 #include "lockoutTimer.h"
 #include "runningModes.h"
+#include "sampleRate.h"
+#include "scope.h"
+#include "spectrum.h"
 #include "switches.h"
 #include "transmitter.h"
 #include "trigger.h"
@@ -131,6 +137,21 @@ void runningModes_printRunTimeStatistics(void) {
   display_print(sprintfBuffer);
   display_print("%)\n\n");
 
+#ifdef LASERTAG_AMP
+  // The detector runs on CPU1; print that core's load and what is left of it.
+  amp_stats_t cpu1Stats;
+  amp_readStats(&cpu1Stats);
+  double cpu1Load =
+      cpu1Stats.runTime ? (double)cpu1Stats.busyTime / cpu1Stats.runTime * 100 : 0;
+  display_print("CPU1 detector load: ");
+  sprintf(sprintfBuffer, "%.2f%% (headroom %.2f%%)", cpu1Load, 100 - cpu1Load);
+  display_print(sprintfBuffer);
+  display_print("\n\n");
+  display_print("CPU1 ADC buffer high water: ");
+  display_printDecimalInt(cpu1Stats.bufferHighWater);
+  display_print("\n\n");
+#endif
+
   // Print out total interrupt count.
   uint32_t interruptCount = interrupts_isrInvocationCount();
   display_print("Total interrupts: ");
@@ -148,6 +169,18 @@ void runningModes_printRunTimeStatistics(void) {
   display_print(sprintfBuffer);
   display_print("\n\n");
 
+  // Print out how much of the filter bank the channel mask saved.
+  uint32_t filterRuns, filterRunsSkipped;
+  detector_getFilterRunCounts(&filterRuns, &filterRunsSkipped);
+  display_print("IIR filter runs: ");
+  display_printDecimalInt(filterRuns);
+  if (filterRuns + filterRunsSkipped) {
+    sprintf(sprintfBuffer, " (%.0f%% skipped by channel mask)",
+            100.0 * filterRunsSkipped / (filterRuns + filterRunsSkipped));
+    display_print(sprintfBuffer);
+  }
+  display_print("\n\n");
+
   // If the detector invocation rate is too low, inform the user.
   if (detectorInvocationCount / runningSeconds <
       SUGGESTED_DETECTOR_INVOCATIONS_PER_SECOND) {
@@ -172,7 +205,9 @@ void runningModes_printRunTimeStatistics(void) {
 void runningModes_initAll(void) {
   // Assume mio, leds, buttons, switches, & display initialized previously
   histogram_init(HISTOGRAM_BAR_COUNT);
+#ifndef LASERTAG_AMP // CPU1 initializes the filters it runs.
   filter_init();
+#endif
   detector_init();
   // isr_init() should include calls to: transmitter, trigger,
   // hitLedTimer, lockoutTimer, sound, and buffer init
@@ -181,6 +216,7 @@ void runningModes_initAll(void) {
   // Init all interrupts (but does not enable the interrupts at the devices).
   // Call last
   interrupts_initAll(false); // A true argument enables error messages
+  interrupts_setPrivateTimerLoadValue(sampleRate_getTimerLoadValue());
 }
 
 // Returns the current switch-setting
@@ -314,6 +350,118 @@ void runningModes_shooter(void) {
   printf("Shooter mode terminated after detecting %d hits.\n", hitCount);
 }
 
+// Frame rate and CPU load of the spectrum or scope mode on the TFT.
+static void printAnalyzerStatistics(const char *frameName, uint32_t frameCount) {
+  char sprintfBuffer[MAX_BUFFER_SIZE]; // Generic message buffer.
+  display_setTextSize(RUNNING_MODE_NORMAL_TEXT_SIZE);
+  display_setTextColor(RUNNING_MODE_NORMAL_TEXT_COLOR);
+  display_setCursor(RUNNING_MODE_SCREEN_X_ORIGIN, RUNNING_MODE_SCREEN_Y_ORIGIN);
+  display_fillScreen(DISPLAY_BLACK);
+
+  double runningSeconds = intervalTimer_getTotalDurationInSeconds(TOTAL_RUNTIME_TIMER);
+  double isrRunningSeconds = intervalTimer_getTotalDurationInSeconds(ISR_CUMULATIVE_TIMER);
+  double mainLoopRunningSeconds =
+      intervalTimer_getTotalDurationInSeconds(MAIN_CUMULATIVE_TIMER);
+  sprintf(sprintfBuffer, "Measured run time in seconds: %.2f\n\n", runningSeconds);
+  display_print(sprintfBuffer);
+  sprintf(sprintfBuffer, "%s: %u (%.1f per second)\n\n", frameName, frameCount,
+          frameCount / runningSeconds);
+  display_print(sprintfBuffer);
+  sprintf(sprintfBuffer, "Time in timer ISR: %.2f%%\n\n", isrRunningSeconds / runningSeconds * 100);
+  display_print(sprintfBuffer);
+  sprintf(sprintfBuffer, "Time draining ADC, analyzing and drawing: %.2f%%\n\n",
+          mainLoopRunningSeconds / runningSeconds * 100);
+  display_print(sprintfBuffer);
+  uint32_t remainingElementCount = buffer_elements();
+  display_print("Unprocessed elements in ADC buffer: ");
+  display_printDecimalInt(remainingElementCount);
+  display_print("\n\n");
+  if (remainingElementCount >= SUGGESTED_REMAINING_ELEMENT_COUNT) {
+    display_setTextColor(RUNNING_MODE_WARNING_TEXT_COLOR);
+    display_setTextSize(RUNNING_MODE_WARNING_TEXT_SIZE);
+    display_print("ADC buffer should contain\nless than ");
+    display_printDecimalInt(SUGGESTED_REMAINING_ELEMENT_COUNT);
+    display_print(" elements.\n\n");
+  }
+}
+
+// Main loop of the spectrum and scope modes, until BTN3 is pressed: drain
+// everything the ISR has sampled so far into addSample(), as the detector
+// would, then let update() draw whatever is complete. onButton0() runs each
+// time BTN0 is pressed.
+static void runAnalyzer(bool (*addSample)(uint32_t), void (*update)(void),
+                        void (*onButton0)(void)) {
+  bool button0WasPressed = false;
+  interrupts_enableTimerGlobalInts(); // Allow timer interrupts.
+  interrupts_startArmPrivateTimer();  // Start the private ARM timer running.
+  intervalTimer_reset(ISR_CUMULATIVE_TIMER);
+  intervalTimer_reset(TOTAL_RUNTIME_TIMER);
+  intervalTimer_reset(MAIN_CUMULATIVE_TIMER);
+  intervalTimer_start(TOTAL_RUNTIME_TIMER);
+  interrupts_enableArmInts(); // ARM will now see interrupts after this.
+
+  while (!(buttons_read() & BUTTONS_BTN3_MASK)) { // Run until you detect BTN3 pressed.
+    bool button0Pressed = buttons_read() & BUTTONS_BTN0_MASK;
+    if (button0Pressed && !button0WasPressed)
+      onButton0();
+    button0WasPressed = button0Pressed;
+
+    intervalTimer_start(MAIN_CUMULATIVE_TIMER);
+    uint32_t elementCount = buffer_elements();
+    for (uint32_t i = 0; i < elementCount; i++) {
+      interrupts_disableArmInts();
+      uint32_t rawAdcValue = buffer_pop();
+      interrupts_enableArmInts();
+      addSample(rawAdcValue);
+    }
+    update();
+    intervalTimer_stop(MAIN_CUMULATIVE_TIMER);
+  }
+  interrupts_disableArmInts();
+}
+
+// BTN0 in the spectrum mode.
+static void toggleSpectrumView(void) {
+  spectrum_setView(spectrum_getView() == SPECTRUM_VIEW_BARS ? SPECTRUM_VIEW_WATERFALL
+                                                             : SPECTRUM_VIEW_BARS);
+}
+
+// This mode runs until BTN3 is pressed.
+// When BTN3 is pressed, it exits and prints the frame rate and CPU load.
+// Shows a live spectrum of the ADC input in place of running the detector.
+// Press BTN0 to switch between the bar and the waterfall view.
+void runningModes_spectrum(void) {
+#ifdef LASERTAG_AMP
+  // CPU1 owns the ADC in the AMP build, so there are no samples to show here.
+  printf("Spectrum mode needs the single-core build.\n");
+#else
+  runningModes_initAll();
+  spectrum_init(SPECTRUM_DEFAULT_POINT_COUNT, SPECTRUM_DEFAULT_SPAN_HZ);
+  runAnalyzer(spectrum_addSample, spectrum_update, toggleSpectrumView);
+  printAnalyzerStatistics("Spectrum frames", spectrum_getFrameCount());
+  printf("Spectrum mode terminated after %u frames.\n", spectrum_getFrameCount());
+#endif
+}
+
+// This mode runs until BTN3 is pressed.
+// When BTN3 is pressed, it exits and prints the sweep rate and CPU load.
+// Shows the raw ADC waveform as an oscilloscope in place of running the
+// detector. Press BTN0 to step through the timebases.
+void runningModes_scope(void) {
+#ifdef LASERTAG_AMP
+  // CPU1 owns the ADC in the AMP build, so there are no samples to show here.
+  printf("Scope mode needs the single-core build.\n");
+#else
+  runningModes_initAll();
+  scope_init(SCOPE_DEFAULT_SAMPLES_PER_COLUMN);
+  runAnalyzer(scope_addSample, scope_update, scope_nextTimebase);
+  uint32_t triggered;
+  uint32_t sweepCount = scope_getSweepCount(&triggered);
+  printAnalyzerStatistics("Scope sweeps", sweepCount);
+  printf("Scope mode terminated after %u sweeps, %u triggered.\n", sweepCount, triggered);
+#endif
+}
+
 // This mode simply dumps raw ADC values to the console.
 // It can be used to determine if bipolar mode is working for the ADC.
 // Will loop forever. Stop the program with an external reset or Ctl-C.
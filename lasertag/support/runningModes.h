@@ -41,6 +41,18 @@ void runningModes_continuous(void);
 // Transmit frequency is selected via the slide-switches.
 void runningModes_shooter(void);
 
+// This mode runs until BTN3 is pressed.
+// When BTN3 is pressed, it exits and prints the frame rate and CPU load.
+// Shows a live spectrum of the ADC input in place of running the detector.
+// Press BTN0 to switch between the bar and the waterfall view.
+void runningModes_spectrum(void);
+
+// This mode runs until BTN3 is pressed.
+// When BTN3 is pressed, it exits and prints the sweep rate and CPU load.
+// Shows the raw ADC waveform as an oscilloscope in place of running the
+// detector. Press BTN0 to step through the timebases.
+void runningModes_scope(void);
+
 // This mode simply dumps raw ADC values to the console.
 // It can be used to determine if bipolar mode is working for the ADC.
 // Will loop forever. Stop the program with an external reset or Ctl-C.
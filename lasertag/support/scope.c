@@ -0,0 +1,219 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "display.h"
+#include "filter.h"
+#include "sampleRate.h"
+#include "scope.h"
+
+#define ADC_MAX_VALUE 4095
+#define HEADER_HEIGHT (DISPLAY_CHAR_HEIGHT + 2)
+#define PLOT_TOP HEADER_HEIGHT
+#define PLOT_HEIGHT (DISPLAY_HEIGHT - HEADER_HEIGHT)
+#define TRACE_COLOR DISPLAY_GREEN
+#define TEXT_COLOR DISPLAY_WHITE
+#define MIN_HYSTERESIS 4 // ADC counts.
+#define HYSTERESIS_DIVISOR 8 // Of the last sweep's range.
+#define MAX_LABEL_LENGTH 54  // Characters across the screen, and the null.
+
+typedef enum { ARMED, SWEEPING, DONE } state_t;
+
+static const uint16_t timebases[] = {1, 2, 5, 10, 20, 50, 100, 200, 500};
+
+static uint16_t samplesPerColumn;
+static state_t state;
+static uint16_t triggerLevel;
+static uint16_t hysteresis;
+static bool armedBelow;     // Seen a sample below the hysteresis band.
+static uint32_t waited;     // Samples since the trigger was armed.
+static bool sweepTriggered; // The sweep being taken started on the trigger.
+static uint16_t column;
+static uint16_t columnSamples;
+static uint16_t sweepMin, sweepMax;
+static uint16_t columnMin[DISPLAY_WIDTH];
+static uint16_t columnMax[DISPLAY_WIDTH];
+// Rows drawn in each column, top to bottom; empty when top > bottom.
+static int16_t drawnTop[DISPLAY_WIDTH];
+static int16_t drawnBottom[DISPLAY_WIDTH];
+static uint32_t sweepCount;
+static uint32_t triggeredCount;
+static char header[MAX_LABEL_LENGTH];
+
+// Screen row of an ADC value; full scale fills the plot.
+static int16_t rowOf(uint16_t value) {
+  return PLOT_TOP + (int32_t)(ADC_MAX_VALUE - value) * (PLOT_HEIGHT - 1) / ADC_MAX_VALUE;
+}
+
+// Rewrite the title line if its text changed.
+static void drawHeader(bool triggered) {
+  char label[MAX_LABEL_LENGTH];
+  double screenMs = 1000.0 * samplesPerColumn * DISPLAY_WIDTH / sampleRate_getHz();
+  snprintf(label, sizeof(label), "Scope %.1f ms across, %s", screenMs,
+           triggered ? "triggered" : "auto     ");
+  if (strcmp(label, header) == 0)
+    return;
+  strcpy(header, label);
+  display_setTextSize(1);
+  display_setTextColorBg(TEXT_COLOR, DISPLAY_BLACK);
+  display_setCursor(0, 0);
+  display_print(header);
+}
+
+// Clear the screen and arm the trigger for a fresh sweep.
+static void restart(void) {
+  display_fillScreen(DISPLAY_BLACK);
+  header[0] = '\0';
+  drawHeader(false);
+  for (uint16_t x = 0; x < DISPLAY_WIDTH; x++) {
+    drawnTop[x] = 1;
+    drawnBottom[x] = 0;
+  }
+  state = ARMED;
+  armedBelow = false;
+  waited = 0;
+}
+
+// Start over with samplesPerColumn samples in each pixel column and clear
+// the screen. Returns false if samplesPerColumn is 0 or above
+// SCOPE_MAX_SAMPLES_PER_COLUMN.
+bool scope_init(uint16_t count) {
+  if (!count || count > SCOPE_MAX_SAMPLES_PER_COLUMN)
+    return false;
+  samplesPerColumn = count;
+  triggerLevel = (ADC_MAX_VALUE + 1) / 2;
+  hysteresis = MIN_HYSTERESIS;
+  sweepCount = 0;
+  triggeredCount = 0;
+  memset(columnMin, 0, sizeof(columnMin));
+  memset(columnMax, 0, sizeof(columnMax));
+  restart();
+  return true;
+}
+
+// Step to the next longer timebase in 1-2-5 steps, wrapping around to the
+// shortest, and clear the screen.
+void scope_nextTimebase(void) {
+  uint16_t i = 0;
+  while (i < sizeof(timebases) / sizeof(timebases[0]) && timebases[i] <= samplesPerColumn)
+    i++;
+  samplesPerColumn = i < sizeof(timebases) / sizeof(timebases[0]) ? timebases[i] : timebases[0];
+  restart();
+}
+
+// Returns the samples in each pixel column.
+uint16_t scope_getSamplesPerColumn(void) { return samplesPerColumn; }
+
+// Begin a sweep with this sample.
+static void startSweep(bool triggered) {
+  state = SWEEPING;
+  sweepTriggered = triggered;
+  column = 0;
+  columnSamples = 0;
+  sweepMin = ADC_MAX_VALUE;
+  sweepMax = 0;
+}
+
+// Take the next raw ADC sample. Returns true once a sweep is waiting for
+// scope_update(); until then further samples are dropped.
+bool scope_addSample(uint32_t rawAdcValue) {
+  uint16_t value = rawAdcValue > ADC_MAX_VALUE ? ADC_MAX_VALUE : rawAdcValue;
+  if (state == DONE)
+    return true;
+  if (state == ARMED) {
+    if (value + hysteresis < triggerLevel)
+      armedBelow = true;
+    if (armedBelow && value >= triggerLevel)
+      startSweep(true);
+    else if (++waited >= (uint32_t)samplesPerColumn * DISPLAY_WIDTH)
+      startSweep(false);
+    else
+      return false;
+  }
+  if (!columnSamples || value < columnMin[column])
+    columnMin[column] = value;
+  if (!columnSamples || value > columnMax[column])
+    columnMax[column] = value;
+  if (++columnSamples < samplesPerColumn)
+    return false;
+  if (columnMin[column] < sweepMin)
+    sweepMin = columnMin[column];
+  if (columnMax[column] > sweepMax)
+    sweepMax = columnMax[column];
+  columnSamples = 0;
+  if (++column < DISPLAY_WIDTH)
+    return false;
+  state = DONE;
+  return true;
+}
+
+// Fill rows from to to of column x, if there are any.
+static void fillRows(int16_t x, int16_t from, int16_t to, uint16_t color) {
+  if (from <= to)
+    display_drawFastVLine(x, from, to - from + 1, color);
+}
+
+// Move the trace in column x from the rows drawn to top..bottom.
+static void redrawColumn(int16_t x, int16_t top, int16_t bottom) {
+  int16_t oldTop = drawnTop[x], oldBottom = drawnBottom[x];
+  if (top == oldTop && bottom == oldBottom)
+    return;
+  if (oldTop > oldBottom) {
+    fillRows(x, top, bottom, TRACE_COLOR);
+  } else {
+    // Erase what is no longer covered, then draw what is newly covered.
+    fillRows(x, oldTop, oldBottom < top ? oldBottom : top - 1, DISPLAY_BLACK);
+    fillRows(x, oldTop > bottom ? oldTop : bottom + 1, oldBottom, DISPLAY_BLACK);
+    fillRows(x, top, bottom < oldTop ? bottom : oldTop - 1, TRACE_COLOR);
+    fillRows(x, top > oldBottom ? top : oldBottom + 1, bottom, TRACE_COLOR);
+  }
+  drawnTop[x] = top;
+  drawnBottom[x] = bottom;
+}
+
+// If a sweep is waiting, draw it and arm the trigger for the next one.
+void scope_update(void) {
+  if (state != DONE)
+    return;
+  drawHeader(sweepTriggered);
+  for (uint16_t x = 0; x < DISPLAY_WIDTH; x++) {
+    // Join each column to the last one so steep edges stay continuous.
+    uint16_t low = columnMin[x], high = columnMax[x];
+    if (x && columnMax[x - 1] < low)
+      low = columnMax[x - 1];
+    if (x && columnMin[x - 1] > high)
+      high = columnMin[x - 1];
+    redrawColumn(x, rowOf(high), rowOf(low));
+  }
+  triggerLevel = (sweepMin + sweepMax + 1) / 2;
+  hysteresis = (sweepMax - sweepMin) / HYSTERESIS_DIVISOR;
+  if (hysteresis < MIN_HYSTERESIS)
+    hysteresis = MIN_HYSTERESIS;
+  sweepCount++;
+  triggeredCount += sweepTriggered;
+  state = ARMED;
+  armedBelow = false;
+  waited = 0;
+}
+
+// Returns the number of sweeps drawn since scope_init(), and in *triggered
+// how many of them started on the trigger rather than by timing out.
+uint32_t scope_getSweepCount(uint32_t *triggered) {
+  if (triggered)
+    *triggered = triggeredCount;
+  return sweepCount;
+}
+
+// Lowest and highest sample in column x of the last sweep.
+void scope_getColumn(uint16_t x, uint16_t *min, uint16_t *max) {
+  *min = columnMin[x];
+  *max = columnMax[x];
+}
@@ -0,0 +1,58 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SCOPE_H_
+#define SCOPE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Live oscilloscope of the raw ADC stream on the TFT (runningModes_scope()).
+// Every ADC sample goes through scope_addSample(), which reduces each run of
+// samplesPerColumn samples to the min and max of one pixel column as they
+// arrive, so a sweep of any length costs a compare or two per sample and
+// nothing is stored but the envelope.
+//
+// A sweep starts on a rising crossing of the trigger level, which sits half
+// way between the lowest and highest sample of the last sweep, with
+// hysteresis against noise. With no crossing for a whole sweep it starts
+// anyway, so a flat input still shows. Only the columns whose envelope
+// changed since the last sweep are redrawn, and only the pixels that
+// changed in them.
+
+#define SCOPE_DEFAULT_SAMPLES_PER_COLUMN 2 // 6.4 ms across the screen.
+#define SCOPE_MAX_SAMPLES_PER_COLUMN 500   // 1.6 s across the screen.
+
+// Start over with samplesPerColumn samples in each pixel column and clear
+// the screen. Returns false if samplesPerColumn is 0 or above
+// SCOPE_MAX_SAMPLES_PER_COLUMN.
+bool scope_init(uint16_t samplesPerColumn);
+
+// Step to the next longer timebase in 1-2-5 steps, wrapping around to the
+// shortest, and clear the screen.
+void scope_nextTimebase(void);
+
+// Returns the samples in each pixel column.
+uint16_t scope_getSamplesPerColumn(void);
+
+// Take the next raw ADC sample. Returns true once a sweep is waiting for
+// scope_update(); until then further samples are dropped.
+bool scope_addSample(uint32_t rawAdcValue);
+
+// If a sweep is waiting, draw it and arm the trigger for the next one.
+void scope_update(void);
+
+// Returns the number of sweeps drawn since scope_init(), and in *triggered
+// how many of them started on the trigger rather than by timing out.
+uint32_t scope_getSweepCount(uint32_t *triggered);
+
+// Lowest and highest sample in column x of the last sweep.
+void scope_getColumn(uint16_t x, uint16_t *min, uint16_t *max);
+
+#endif /* SCOPE_H_ */
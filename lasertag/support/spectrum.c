@@ -0,0 +1,206 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "display.h"
+#include "fft.h"
+#include "filter.h"
+#include "sampleRate.h"
+#include "spectrum.h"
+
+#define HEADER_HEIGHT (DISPLAY_CHAR_HEIGHT + 2)
+#define FOOTER_HEIGHT (DISPLAY_CHAR_HEIGHT + 4)
+#define PLOT_TOP HEADER_HEIGHT
+#define PLOT_HEIGHT (DISPLAY_HEIGHT - HEADER_HEIGHT - FOOTER_HEIGHT)
+#define PLOT_BOTTOM (PLOT_TOP + PLOT_HEIGHT) // One below the lowest plot row.
+#define BAR_COLOR DISPLAY_GREEN
+#define MARKER_COLOR DISPLAY_YELLOW
+#define TEXT_COLOR DISPLAY_WHITE
+#define WATERFALL_LEVEL_COUNT 8
+#define MAX_LABEL_LENGTH 64
+
+static const uint16_t waterfallColors[WATERFALL_LEVEL_COUNT] = {
+    DISPLAY_BLACK, DISPLAY_BLUE, DISPLAY_CYAN,    DISPLAY_GREEN,
+    DISPLAY_YELLOW, DISPLAY_RED, DISPLAY_MAGENTA, DISPLAY_WHITE};
+
+static uint16_t pointCount;
+static uint32_t spanHz;
+static spectrum_view_t view;
+static float frame[FFT_MAX_POINT_COUNT];
+static float power[FFT_MAX_POINT_COUNT / 2];
+static uint16_t captured;          // Samples in frame[] so far.
+static uint32_t samplesSinceFrame; // Since the current frame started.
+static bool frameReady;
+static uint32_t frameCount;
+// heightThreshold[h] is the power a column needs to be h + 1 pixels high;
+// comparing with it avoids a log per column.
+static float heightThreshold[PLOT_HEIGHT];
+// Columns (bar view) and rows (waterfall, from the bottom) cover bins
+// firstBin[i] up to but not including firstBin[i + 1], or at least bin
+// firstBin[i].
+static uint16_t columnFirstBin[DISPLAY_WIDTH + 1];
+static uint16_t rowFirstBin[PLOT_HEIGHT + 1];
+static uint16_t columnHeight[DISPLAY_WIDTH]; // As drawn in the bar view.
+static uint16_t waterfallColumn;
+
+// Spread the bins of the shown span over count lines.
+static void mapBins(uint16_t lines[], uint16_t count) {
+  uint32_t shownBins = (uint32_t)spanHz * pointCount / sampleRate_getHz();
+  for (uint16_t i = 0; i <= count; i++)
+    lines[i] = (uint32_t)i * shownBins / count;
+}
+
+// Pixel height for a power, by binary search of heightThreshold[].
+static uint16_t heightOf(float p) {
+  uint16_t low = 0, high = PLOT_HEIGHT;
+  while (low < high) {
+    uint16_t middle = (low + high) / 2;
+    if (p >= heightThreshold[middle])
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+// Highest power over the bins of line i. Where there are more lines than
+// bins, neighbouring lines show the same bin.
+static float peakPower(const uint16_t lines[], uint16_t i) {
+  float peak = power[lines[i]];
+  for (uint16_t k = lines[i] + 1; k < lines[i + 1]; k++)
+    if (power[k] > peak)
+      peak = power[k];
+  return peak;
+}
+
+// Title line and, in the bar view, a marker under each user frequency.
+static void drawFrame(void) {
+  char label[MAX_LABEL_LENGTH];
+  display_fillScreen(DISPLAY_BLACK);
+  display_setTextSize(1);
+  display_setTextColor(TEXT_COLOR);
+  display_setCursor(0, 0);
+  snprintf(label, sizeof(label), "%s 0-%.1f kHz, %u points, %d..%d dB",
+           view == SPECTRUM_VIEW_BARS ? "Spectrum" : "Waterfall", spanHz / 1000.0, pointCount,
+           SPECTRUM_DB_FLOOR, SPECTRUM_DB_CEILING);
+  display_print(label);
+  memset(columnHeight, 0, sizeof(columnHeight));
+  waterfallColumn = 0;
+  if (view != SPECTRUM_VIEW_BARS)
+    return;
+  display_setTextColor(MARKER_COLOR);
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    uint32_t hz = SAMPLE_RATE_REFERENCE_HZ / filter_frequencyTickTable[f];
+    if (hz >= spanHz)
+      continue;
+    int16_t x = (int32_t)hz * DISPLAY_WIDTH / spanHz;
+    display_drawFastVLine(x, PLOT_BOTTOM, 2, MARKER_COLOR);
+    display_setCursor(x - DISPLAY_CHAR_WIDTH / 2, PLOT_BOTTOM + 3);
+    display_printDecimalInt(f);
+  }
+}
+
+// Start over with pointCount-point frames (a power of two from 256 to 1024)
+// showing 0 to spanHz, and clear the screen for the bar view. Returns false
+// if the FFT cannot run that many points or the span is above the Nyquist
+// frequency.
+bool spectrum_init(uint16_t points, uint32_t span) {
+  if (!span || span > sampleRate_getHz() / 2 || !fft_init(points))
+    return false;
+  pointCount = points;
+  spanHz = span;
+  captured = 0;
+  samplesSinceFrame = 0;
+  frameReady = false;
+  frameCount = 0;
+  float dbPerPixel = (float)(SPECTRUM_DB_CEILING - SPECTRUM_DB_FLOOR) / PLOT_HEIGHT;
+  for (uint16_t h = 0; h < PLOT_HEIGHT; h++)
+    heightThreshold[h] = powf(10, (SPECTRUM_DB_FLOOR + (h + 1) * dbPerPixel) / 10);
+  mapBins(columnFirstBin, DISPLAY_WIDTH);
+  mapBins(rowFirstBin, PLOT_HEIGHT);
+  spectrum_setView(SPECTRUM_VIEW_BARS);
+  return true;
+}
+
+// Switch between the bar and the waterfall view; clears the screen.
+void spectrum_setView(spectrum_view_t newView) {
+  view = newView;
+  drawFrame();
+}
+
+// Returns the current view.
+spectrum_view_t spectrum_getView(void) { return view; }
+
+// Take the next raw ADC sample. Returns true once a frame is waiting for
+// spectrum_update(); until then further samples are only counted.
+bool spectrum_addSample(uint32_t rawAdcValue) {
+  if (!frameReady && samplesSinceFrame >= SPECTRUM_FRAME_INTERVAL_SAMPLES) {
+    samplesSinceFrame = 0;
+    captured = 0;
+  }
+  samplesSinceFrame++;
+  if (captured < pointCount) {
+    frame[captured++] = rawAdcValue;
+    frameReady = captured == pointCount;
+  }
+  return frameReady;
+}
+
+// Redraw only the part of each column whose height changed.
+static void drawBars(void) {
+  for (uint16_t x = 0; x < DISPLAY_WIDTH; x++) {
+    uint16_t height = heightOf(peakPower(columnFirstBin, x));
+    uint16_t old = columnHeight[x];
+    if (height > old)
+      display_drawFastVLine(x, PLOT_BOTTOM - height, height - old, BAR_COLOR);
+    else if (height < old)
+      display_drawFastVLine(x, PLOT_BOTTOM - old, old - height, DISPLAY_BLACK);
+    columnHeight[x] = height;
+  }
+}
+
+// Draw the next waterfall column, one line per run of equal color.
+static void drawWaterfallColumn(void) {
+  uint16_t runStart = 0;
+  uint16_t runColor = 0;
+  for (uint16_t row = 0; row <= PLOT_HEIGHT; row++) {
+    uint16_t color = 0;
+    if (row < PLOT_HEIGHT) {
+      uint16_t level = heightOf(peakPower(rowFirstBin, row)) *
+                       WATERFALL_LEVEL_COUNT / (PLOT_HEIGHT + 1);
+      color = waterfallColors[level];
+      if (row && color == runColor)
+        continue;
+    }
+    if (row)
+      display_drawFastVLine(waterfallColumn, PLOT_BOTTOM - row, row - runStart, runColor);
+    runStart = row;
+    runColor = color;
+  }
+  waterfallColumn = (waterfallColumn + 1) % DISPLAY_WIDTH;
+}
+
+// If a frame is waiting, compute its spectrum and draw it.
+void spectrum_update(void) {
+  if (!frameReady)
+    return;
+  fft_powerSpectrum(frame, power);
+  if (view == SPECTRUM_VIEW_BARS)
+    drawBars();
+  else
+    drawWaterfallColumn();
+  frameReady = false;
+  frameCount++;
+}
+
+// Returns the number of frames drawn since spectrum_init().
+uint32_t spectrum_getFrameCount(void) { return frameCount; }
@@ -0,0 +1,58 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SPECTRUM_H_
+#define SPECTRUM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Live spectrum of the raw ADC stream on the TFT (runningModes_spectrum()).
+// Every ADC sample goes through spectrum_addSample(), which keeps one frame
+// of pointCount samples out of every SPECTRUM_FRAME_INTERVAL_SAMPLES, so the
+// main loop can drain the ADC buffer at the full 100 kHz and still spend
+// only a few ms per frame on the FFT (fft.h) and the display.
+//
+// Nothing is redrawn from scratch per frame. The bar view redraws only the
+// part of each column whose height changed; the waterfall view draws a
+// single new column per frame, left to right, wrapping around.
+
+#define SPECTRUM_FRAME_INTERVAL_SAMPLES 5000 // 20 frames per second.
+#define SPECTRUM_DEFAULT_POINT_COUNT 1024
+// The user frequencies are all below 5 kHz and the FIR passes nothing above
+// it; the default span shows the first harmonics of the square waves too.
+#define SPECTRUM_DEFAULT_SPAN_HZ 12500
+#define SPECTRUM_DB_FLOOR -10 // Power in dB of ADC counts squared.
+#define SPECTRUM_DB_CEILING 70
+
+typedef enum { SPECTRUM_VIEW_BARS, SPECTRUM_VIEW_WATERFALL } spectrum_view_t;
+
+// Start over with pointCount-point frames (a power of two from 256 to 1024)
+// showing 0 to spanHz, and clear the screen for the bar view. Returns false
+// if the FFT cannot run that many points or the span is above the Nyquist
+// frequency.
+bool spectrum_init(uint16_t pointCount, uint32_t spanHz);
+
+// Switch between the bar and the waterfall view; clears the screen.
+void spectrum_setView(spectrum_view_t view);
+
+// Returns the current view.
+spectrum_view_t spectrum_getView(void);
+
+// Take the next raw ADC sample. Returns true once a frame is waiting for
+// spectrum_update(); until then further samples are only counted.
+bool spectrum_addSample(uint32_t rawAdcValue);
+
+// If a frame is waiting, compute its spectrum and draw it.
+void spectrum_update(void);
+
+// Returns the number of frames drawn since spectrum_init().
+uint32_t spectrum_getFrameCount(void);
+
+#endif /* SPECTRUM_H_ */
@@ -0,0 +1,309 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <string.h>
+
+#include "buffer.h"
+#include "detector.h"
+#include "filter.h"
+#include "instance.h"
+#include "interrupts.h"
+#include "sampleRate.h"
+#include "telemetry.h"
+
+#define TELEMETRY_QUEUE_MASK (TELEMETRY_QUEUE_SIZE - 1)
+#define TELEMETRY_POWER_PAYLOAD (sizeof(uint32_t) + FILTER_FREQUENCY_COUNT * sizeof(float))
+#define CRC16_INITIAL_VALUE 0xFFFF
+#define CRC16_POLYNOMIAL 0x1021 // crc16Nibble[] holds its multiples.
+#define COBS_MAX_RUN 0xFF // A code byte of 0xFF means 254 bytes and no zero.
+
+// Both ends of the queue are used from the main loop only.
+static INSTANCE_LOCAL uint8_t queue[TELEMETRY_QUEUE_SIZE];
+static INSTANCE_LOCAL uint32_t queueIn, queueOut; // Free-running byte indices.
+static INSTANCE_LOCAL telemetry_writer_t writer;
+static INSTANCE_LOCAL uint32_t bytesPerSecond;
+// The timer ISR rate, the unit of tick arguments, and the snapshot interval
+// in its ticks.
+static INSTANCE_LOCAL uint32_t ticksPerSecond = TELEMETRY_TICKS_PER_SECOND;
+static INSTANCE_LOCAL uint32_t snapshotIntervalTicks = TELEMETRY_SNAPSHOT_INTERVAL_TICKS;
+// Bytes the rate allows, scaled by ticksPerSecond so refills stay exact in
+// integer arithmetic.
+static INSTANCE_LOCAL uint64_t credit;
+static INSTANCE_LOCAL uint32_t lastPollTick;
+static INSTANCE_LOCAL uint32_t lastSnapshotTick;
+static INSTANCE_LOCAL uint16_t sequence;
+static INSTANCE_LOCAL telemetry_stats_t stats;
+
+/*****************************************************************************
+***** Encoding
+*****************************************************************************/
+
+// Table for four bits at a time: small enough for every build.
+static const uint16_t crc16Nibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF};
+
+// CRC-16/CCITT-FALSE.
+uint16_t telemetry_crc16(const uint8_t *data, uint32_t size) {
+  uint16_t crc = CRC16_INITIAL_VALUE;
+  for (uint32_t i = 0; i < size; i++) {
+    crc = (crc << 4) ^ crc16Nibble[(crc >> 12) ^ (data[i] >> 4)];
+    crc = (crc << 4) ^ crc16Nibble[(crc >> 12) ^ (data[i] & 0xF)];
+  }
+  return crc;
+}
+
+// COBS-encode size bytes into out, which needs size + size / 254 + 1 bytes.
+// Returns the encoded length. No delimiter is added.
+uint32_t telemetry_cobsEncode(const uint8_t *data, uint32_t size, uint8_t *out) {
+  uint32_t codeIndex = 0, length = 1;
+  uint8_t code = 1;
+  for (uint32_t i = 0; i < size; i++) {
+    if (data[i]) {
+      out[length++] = data[i];
+      code++;
+    }
+    if (!data[i] || code == COBS_MAX_RUN) {
+      out[codeIndex] = code;
+      codeIndex = length++;
+      code = 1;
+    }
+  }
+  out[codeIndex] = code;
+  return length;
+}
+
+// Decode COBS data (without its delimiter) into out, which needs size bytes.
+// Returns the decoded length, or -1 if the data is not valid COBS.
+int32_t telemetry_cobsDecode(const uint8_t *data, uint32_t size, uint8_t *out) {
+  uint32_t length = 0;
+  for (uint32_t i = 0; i < size;) {
+    uint8_t code = data[i++];
+    if (code == 0 || i + code - 1 > size)
+      return -1;
+    for (uint8_t j = 1; j < code; j++) {
+      if (data[i] == 0)
+        return -1;
+      out[length++] = data[i++];
+    }
+    if (code != COBS_MAX_RUN && i < size)
+      out[length++] = 0;
+  }
+  return length;
+}
+
+static void putU32(uint8_t *payload, uint16_t offset, uint32_t value) {
+  for (uint16_t i = 0; i < sizeof(uint32_t); i++)
+    payload[offset + i] = value >> (8 * i);
+}
+
+static void putF32(uint8_t *payload, uint16_t offset, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  putU32(payload, offset, bits);
+}
+
+// Frame, encode and queue one message. Drops it if the queue cannot take all
+// of it. Snapshots must also leave TELEMETRY_EVENT_RESERVE_BYTES free, so when
+// the link falls behind they are shed before any hit is.
+static bool queueMessage(telemetry_messageType_t type, const uint8_t *payload,
+                         uint16_t payloadSize) {
+  uint8_t frame[TELEMETRY_MAX_FRAME];
+  frame[0] = TELEMETRY_VERSION;
+  frame[1] = type;
+  frame[2] = sequence;
+  frame[3] = sequence >> 8;
+  sequence++;
+  memcpy(frame + TELEMETRY_HEADER_BYTES, payload, payloadSize);
+  uint16_t size = TELEMETRY_HEADER_BYTES + payloadSize;
+  uint16_t crc = telemetry_crc16(frame, size);
+  frame[size++] = crc;
+  frame[size++] = crc >> 8;
+
+  uint8_t encoded[TELEMETRY_MAX_ENCODED_FRAME];
+  uint32_t length = telemetry_cobsEncode(frame, size, encoded);
+  encoded[length++] = 0;
+  bool snapshot = type == TELEMETRY_MESSAGE_POWER || type == TELEMETRY_MESSAGE_BUFFER ||
+                  type == TELEMETRY_MESSAGE_PROFILE;
+  uint32_t needed = snapshot ? length + TELEMETRY_EVENT_RESERVE_BYTES : length;
+  if (TELEMETRY_QUEUE_SIZE - (queueIn - queueOut) < needed) {
+    stats.framesDropped++;
+    stats.droppedByType[type]++;
+    return false;
+  }
+  uint32_t start = queueIn & TELEMETRY_QUEUE_MASK;
+  uint32_t first = TELEMETRY_QUEUE_SIZE - start < length ? TELEMETRY_QUEUE_SIZE - start : length;
+  memcpy(queue + start, encoded, first);
+  memcpy(queue, encoded + first, length - first);
+  queueIn += length;
+  stats.framesQueued++;
+  stats.bytesQueued += length;
+  return true;
+}
+
+/*****************************************************************************
+***** Messages
+*****************************************************************************/
+
+// Start a new stream through writer at bytesPerSecond and queue a HELLO.
+void telemetry_init(telemetry_writer_t newWriter, uint32_t newBytesPerSecond) {
+  writer = newWriter;
+  bytesPerSecond = newBytesPerSecond;
+  ticksPerSecond = sampleRate_getHz();
+  snapshotIntervalTicks = sampleRate_ticks(TELEMETRY_SNAPSHOT_INTERVAL_TICKS);
+  queueIn = queueOut = 0;
+  credit = 0;
+  lastPollTick = lastSnapshotTick = interrupts_isrInvocationCount();
+  sequence = 0;
+  memset(&stats, 0, sizeof(stats));
+  uint8_t payload[TELEMETRY_HELLO_PAYLOAD];
+  putU32(payload, 0, lastPollTick);
+  putU32(payload, 4, ticksPerSecond);
+  payload[8] = FILTER_FREQUENCY_COUNT;
+  queueMessage(TELEMETRY_MESSAGE_HELLO, payload, sizeof(payload));
+}
+
+bool telemetry_sendHit(uint32_t tick, uint16_t frequency, uint32_t hitCount) {
+  uint8_t payload[TELEMETRY_HIT_PAYLOAD];
+  putU32(payload, 0, tick);
+  payload[4] = frequency;
+  putU32(payload, 5, hitCount);
+  return queueMessage(TELEMETRY_MESSAGE_HIT, payload, sizeof(payload));
+}
+
+bool telemetry_sendPower(uint32_t tick, const double powerValues[]) {
+  uint8_t payload[TELEMETRY_POWER_PAYLOAD];
+  putU32(payload, 0, tick);
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+    putF32(payload, sizeof(uint32_t) + i * sizeof(float), powerValues[i]);
+  return queueMessage(TELEMETRY_MESSAGE_POWER, payload, sizeof(payload));
+}
+
+bool telemetry_sendBuffer(uint32_t tick, uint32_t elements, uint32_t size) {
+  uint8_t payload[TELEMETRY_BUFFER_PAYLOAD];
+  putU32(payload, 0, tick);
+  putU32(payload, 4, elements);
+  putU32(payload, 8, size);
+  return queueMessage(TELEMETRY_MESSAGE_BUFFER, payload, sizeof(payload));
+}
+
+bool telemetry_sendProfile(uint32_t tick, uint32_t isrInvocations,
+                           uint32_t detectorInvocations) {
+  uint8_t payload[TELEMETRY_PROFILE_PAYLOAD];
+  putU32(payload, 0, tick);
+  putU32(payload, 4, isrInvocations);
+  putU32(payload, 8, detectorInvocations);
+  putU32(payload, 12, stats.framesDropped);
+  putU32(payload, 16, stats.bytesSent);
+  return queueMessage(TELEMETRY_MESSAGE_PROFILE, payload, sizeof(payload));
+}
+
+// Queue power, buffer and profile snapshots if
+// TELEMETRY_SNAPSHOT_INTERVAL_TICKS have passed since the last ones.
+void telemetry_sendSnapshots(uint32_t tick) {
+  if (tick - lastSnapshotTick < snapshotIntervalTicks)
+    return;
+  lastSnapshotTick = tick;
+  double powerValues[FILTER_FREQUENCY_COUNT];
+  filter_getCurrentPowerValues(powerValues);
+  telemetry_sendPower(tick, powerValues);
+  telemetry_sendBuffer(tick, buffer_elements(), buffer_size());
+  telemetry_sendProfile(tick, interrupts_isrInvocationCount(), detector_getInvocationCount());
+}
+
+// Hand queued bytes to the writer, as many as the rate allows.
+void telemetry_poll(uint32_t tick) {
+  credit += (uint64_t)(tick - lastPollTick) * bytesPerSecond;
+  lastPollTick = tick;
+  const uint64_t maxCredit = (uint64_t)TELEMETRY_BURST_BYTES * ticksPerSecond;
+  if (credit > maxCredit)
+    credit = maxCredit;
+  uint32_t allowed = credit / ticksPerSecond;
+  for (int part = 0; part < 2 && allowed && queueIn != queueOut; part++) {
+    uint32_t start = queueOut & TELEMETRY_QUEUE_MASK;
+    uint32_t length = queueIn - queueOut;
+    if (length > TELEMETRY_QUEUE_SIZE - start)
+      length = TELEMETRY_QUEUE_SIZE - start; // Up to the wrap.
+    if (length > allowed)
+      length = allowed;
+    uint16_t taken = writer(queue + start, length);
+    queueOut += taken;
+    allowed -= taken;
+    stats.bytesSent += taken;
+    credit -= (uint64_t)taken * ticksPerSecond;
+    if (taken < length)
+      break; // The writer is full.
+  }
+}
+
+// Copy of the counters.
+void telemetry_getStats(telemetry_stats_t *statsOut) { *statsOut = stats; }
+
+/*****************************************************************************
+***** Decoding
+*****************************************************************************/
+
+// Decode one frame in place, as read up to (not including) its zero delimiter.
+// COBS never writes ahead of where it reads, so the decoded frame overwrites
+// the start of data and the view points into it.
+telemetry_decodeStatus_t telemetry_parseFrame(uint8_t *data, uint32_t size,
+                                              telemetry_frameView_t *view) {
+  if (size > TELEMETRY_MAX_ENCODED_FRAME)
+    return TELEMETRY_DECODE_BAD_COBS;
+  int32_t length = telemetry_cobsDecode(data, size, data);
+  if (length < 0)
+    return TELEMETRY_DECODE_BAD_COBS;
+  if (length < TELEMETRY_HEADER_BYTES + TELEMETRY_CRC_BYTES ||
+      length > TELEMETRY_MAX_FRAME)
+    return TELEMETRY_DECODE_TOO_SHORT;
+  uint16_t crc = data[length - 2] | data[length - 1] << 8;
+  if (telemetry_crc16(data, length - TELEMETRY_CRC_BYTES) != crc)
+    return TELEMETRY_DECODE_BAD_CRC;
+  if (data[0] != TELEMETRY_VERSION)
+    return TELEMETRY_DECODE_BAD_VERSION;
+  view->version = data[0];
+  view->type = data[1];
+  view->sequence = data[2] | data[3] << 8;
+  view->payloadSize = length - TELEMETRY_HEADER_BYTES - TELEMETRY_CRC_BYTES;
+  view->payload = data + TELEMETRY_HEADER_BYTES;
+  return TELEMETRY_DECODE_OK;
+}
+
+// Decode one frame, as read up to (not including) its zero delimiter, into a
+// copy.
+telemetry_decodeStatus_t telemetry_decodeFrame(const uint8_t *data, uint32_t size,
+                                               telemetry_frame_t *frame) {
+  uint8_t copy[TELEMETRY_MAX_ENCODED_FRAME];
+  if (size > sizeof(copy))
+    return TELEMETRY_DECODE_BAD_COBS;
+  memcpy(copy, data, size);
+  telemetry_frameView_t view;
+  telemetry_decodeStatus_t status = telemetry_parseFrame(copy, size, &view);
+  if (status != TELEMETRY_DECODE_OK)
+    return status;
+  frame->version = view.version;
+  frame->type = view.type;
+  frame->sequence = view.sequence;
+  frame->payloadSize = view.payloadSize;
+  memcpy(frame->payload, view.payload, view.payloadSize);
+  return TELEMETRY_DECODE_OK;
+}
+
+// Little-endian payload fields.
+uint32_t telemetry_readU32(const uint8_t *payload, uint16_t offset) {
+  return payload[offset] | payload[offset + 1] << 8 | payload[offset + 2] << 16 |
+         (uint32_t)payload[offset + 3] << 24;
+}
+
+float telemetry_readF32(const uint8_t *payload, uint16_t offset) {
+  uint32_t bits = telemetry_readU32(payload, offset);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
@@ -0,0 +1,156 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Binary telemetry from the gun: hits, power snapshots, ADC buffer levels and
+// profiling counters, sent as small frames over a byte stream (the Bluetooth
+// UART on the board, a serial device or pseudo-terminal on the host).
+//
+// Frame, before framing:
+//
+//   version (1) | type (1) | sequence (2) | payload (0..TELEMETRY_MAX_PAYLOAD) | CRC (2)
+//
+// Multi-byte fields are little-endian. The CRC is CRC-16/CCITT-FALSE over
+// everything before it. The frame is COBS-encoded, so it contains no zero
+// bytes, and followed by a single zero, so a reader that joins mid-stream or
+// loses bytes resynchronizes at the next zero. The sequence number counts
+// every frame queued, so gaps show frames dropped on the gun.
+//
+// Messages are encoded into a queue when they are produced and leave it from
+// telemetry_poll() no faster than the configured byte rate. Nothing here ever
+// waits: a message that does not fit in the queue is dropped and counted, and
+// the writer takes only what its own buffer has room for. Part of the queue is
+// kept for hits, so a slow link loses snapshots first.
+
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_HEADER_BYTES 4
+#define TELEMETRY_CRC_BYTES 2
+#define TELEMETRY_MAX_PAYLOAD 48
+#define TELEMETRY_MAX_FRAME (TELEMETRY_HEADER_BYTES + TELEMETRY_MAX_PAYLOAD + TELEMETRY_CRC_BYTES)
+// COBS adds one byte per 254 plus one; the delimiter adds one more.
+#define TELEMETRY_MAX_ENCODED_FRAME (TELEMETRY_MAX_FRAME + TELEMETRY_MAX_FRAME / 254 + 2)
+#define TELEMETRY_QUEUE_SIZE 1024 // Bytes; a power of two.
+#define TELEMETRY_TICKS_PER_SECOND 100000 // Timer ISR rate at 100 kHz; HELLO has the rate.
+#define TELEMETRY_DEFAULT_BYTES_PER_SECOND 800 // Leaves headroom at 9600 baud.
+#define TELEMETRY_BURST_BYTES 128 // Most bytes sent at once after a quiet spell.
+#define TELEMETRY_SNAPSHOT_INTERVAL_TICKS 25000 // 250 ms.
+#define TELEMETRY_EVENT_RESERVE_BYTES 128 // Queue space only hits may use.
+
+typedef enum {
+  TELEMETRY_MESSAGE_HELLO = 1, // First frame after telemetry_init().
+  TELEMETRY_MESSAGE_HIT,
+  TELEMETRY_MESSAGE_POWER,
+  TELEMETRY_MESSAGE_BUFFER,
+  TELEMETRY_MESSAGE_PROFILE,
+  TELEMETRY_MESSAGE_TYPE_COUNT
+} telemetry_messageType_t;
+
+// Payloads. Every message starts with the timer tick it was produced at.
+// HELLO:   tick u32, ticks per second u32, frequency count u8.
+// HIT:     tick u32, frequency u8, hits on that frequency so far u32.
+// POWER:   tick u32, one f32 power value per frequency.
+// BUFFER:  tick u32, ADC buffer elements u32, ADC buffer size u32.
+// PROFILE: tick u32, ISR invocations u32, detector invocations u32,
+//          telemetry frames dropped u32, telemetry bytes sent u32.
+#define TELEMETRY_HELLO_PAYLOAD 9
+#define TELEMETRY_HIT_PAYLOAD 9
+#define TELEMETRY_BUFFER_PAYLOAD 12
+#define TELEMETRY_PROFILE_PAYLOAD 20
+
+// Takes up to size bytes of the stream and returns how many it took. Must not
+// block; bluetooth_transmitQueueWrite() fits.
+typedef uint16_t (*telemetry_writer_t)(uint8_t *data, uint16_t size);
+
+typedef struct {
+  uint32_t framesQueued;
+  uint32_t framesDropped; // Found the queue full.
+  uint32_t bytesQueued;
+  uint32_t bytesSent;     // Taken by the writer.
+  uint32_t droppedByType[TELEMETRY_MESSAGE_TYPE_COUNT];
+} telemetry_stats_t;
+
+// A decoded frame.
+typedef struct {
+  uint8_t version;
+  uint8_t type;
+  uint16_t sequence;
+  uint16_t payloadSize;
+  uint8_t payload[TELEMETRY_MAX_PAYLOAD];
+} telemetry_frame_t;
+
+// A frame decoded in place by telemetry_parseFrame().
+typedef struct {
+  uint8_t version;
+  uint8_t type;
+  uint16_t sequence;
+  uint16_t payloadSize;
+  const uint8_t *payload; // Inside the buffer that was parsed.
+} telemetry_frameView_t;
+
+typedef enum {
+  TELEMETRY_DECODE_OK,
+  TELEMETRY_DECODE_BAD_COBS,
+  TELEMETRY_DECODE_TOO_SHORT,
+  TELEMETRY_DECODE_BAD_CRC,
+  TELEMETRY_DECODE_BAD_VERSION,
+} telemetry_decodeStatus_t;
+
+// Start a new stream through writer at bytesPerSecond and queue a HELLO.
+void telemetry_init(telemetry_writer_t writer, uint32_t bytesPerSecond);
+
+// Queue one message. Returns false if it was dropped.
+bool telemetry_sendHit(uint32_t tick, uint16_t frequency, uint32_t hitCount);
+bool telemetry_sendPower(uint32_t tick, const double powerValues[]);
+bool telemetry_sendBuffer(uint32_t tick, uint32_t elements, uint32_t size);
+bool telemetry_sendProfile(uint32_t tick, uint32_t isrInvocations,
+                           uint32_t detectorInvocations);
+
+// Queue power, buffer and profile snapshots if
+// TELEMETRY_SNAPSHOT_INTERVAL_TICKS have passed since the last ones. Reads the
+// filter, buffer and detector directly; call it from the main loop.
+void telemetry_sendSnapshots(uint32_t tick);
+
+// Hand queued bytes to the writer, as many as the rate allows.
+void telemetry_poll(uint32_t tick);
+
+// Copy of the counters.
+void telemetry_getStats(telemetry_stats_t *stats);
+
+// CRC-16/CCITT-FALSE.
+uint16_t telemetry_crc16(const uint8_t *data, uint32_t size);
+
+// COBS-encode size bytes into out, which needs size + size / 254 + 1 bytes.
+// Returns the encoded length. No delimiter is added.
+uint32_t telemetry_cobsEncode(const uint8_t *data, uint32_t size, uint8_t *out);
+
+// Decode COBS data (without its delimiter) into out, which needs size bytes.
+// Returns the decoded length, or -1 if the data is not valid COBS.
+int32_t telemetry_cobsDecode(const uint8_t *data, uint32_t size, uint8_t *out);
+
+// Decode one frame in place, as read up to (not including) its zero delimiter.
+// The decoded frame overwrites data and the view points into it, so nothing is
+// copied.
+telemetry_decodeStatus_t telemetry_parseFrame(uint8_t *data, uint32_t size,
+                                              telemetry_frameView_t *view);
+
+// Decode one frame, as read up to (not including) its zero delimiter, into a
+// copy. data is left as it was.
+telemetry_decodeStatus_t telemetry_decodeFrame(const uint8_t *data, uint32_t size,
+                                               telemetry_frame_t *frame);
+
+// Little-endian payload fields.
+uint32_t telemetry_readU32(const uint8_t *payload, uint16_t offset);
+float telemetry_readF32(const uint8_t *payload, uint16_t offset);
+
+#endif /* TELEMETRY_H_ */
@@ -1,7 +1,11 @@
 #include "transmitter.h"
+#include "instance.h"
 #include "buttons.h"
 #include "filter.h"
 #include "mio.h"
+#include "sampleRate.h"
+#include "shotCode.h"
+#include "shotSlot.h"
 #include "switches.h"
 #include "utils.h"
 #include <stdbool.h>
@@ -22,22 +26,44 @@
 // frequency as set by transmitter_setFrequencyNumber(). The step counts for the
 // frequencies are provided in filter.h
 
-static enum transmitter_st_t {
+static INSTANCE_LOCAL enum transmitter_st_t {
   init_st,
   wait_st,
   sig_high_st,
   sig_low_st,
 } currentState = init_st;
 
-static uint16_t signalTimer = 0;
-static bool continuousModeOn = false;
-volatile static bool running = false;
-
-static uint32_t pulseWidth = TRANSMITTER_PULSE_WIDTH;
-static bool debugOn = false;
-
-static uint8_t currentFrequency = 0;
-static uint16_t period = 0;
+static INSTANCE_LOCAL uint16_t signalTimer = 0;
+static INSTANCE_LOCAL bool continuousModeOn = false;
+static INSTANCE_LOCAL volatile bool running = false;
+
+static INSTANCE_LOCAL uint32_t pulseWidth = TRANSMITTER_PULSE_WIDTH; // At 100 kHz.
+static INSTANCE_LOCAL uint32_t burstTicks = TRANSMITTER_PULSE_WIDTH; // At the sample rate.
+static INSTANCE_LOCAL bool debugOn = false;
+
+static INSTANCE_LOCAL uint8_t currentFrequency = 0;
+static INSTANCE_LOCAL uint16_t period = 0;
+
+static INSTANCE_LOCAL int16_t codeSetting = SHOTCODE_NONE;
+static INSTANCE_LOCAL int16_t burstCode = SHOTCODE_NONE; // Latched per burst.
+static INSTANCE_LOCAL uint8_t burstFrame = 0;
+
+// Time-division shots (shotSlot.h): with slotCount set, a burst only starts at
+// the start of slot slotNumber. slotPhase counts ticks since the frame began;
+// slotStart and frameTicks are in ticks at the sample rate.
+static INSTANCE_LOCAL uint16_t slotNumber = 0;
+static INSTANCE_LOCAL uint16_t slotCount = 0;
+static INSTANCE_LOCAL uint32_t slotPhase = 0;
+static INSTANCE_LOCAL uint32_t slotStart = 0;
+static INSTANCE_LOCAL uint32_t frameTicks = 0;
+
+// The level for the high half of a carrier period: high, unless a coded burst
+// has the carrier off at this point.
+static uint8_t highValue() {
+  if (burstCode == SHOTCODE_NONE || shotCode_carrierOn(burstFrame, signalTimer))
+    return TRANSMITTER_HIGH_VALUE;
+  return TRANSMITTER_LOW_VALUE;
+}
 
 void transmitter_setDebug(bool on) {
   debugOn = on;
@@ -58,12 +84,18 @@ void transmitter_init() {
   signalTimer = 0;
   running = false;
 
-  period = filter_frequencyTickTable[currentFrequency];
+  period = sampleRate_ticks(filter_frequencyTickTable[currentFrequency]);
+  transmitter_setSlot(slotNumber, slotCount); // For the sample rate.
 
   mio_init(debugOn);
   mio_setPinAsOutput(TRANSMITTER_OUTPUT_PIN);
 }
 
+// Returns true if a burst may start on this tick.
+static bool inOwnSlot() {
+  return !slotCount || slotPhase == slotStart;
+}
+
 // Standard tick function.
 void transmitter_tick() {
   // Transition logic
@@ -72,14 +104,19 @@ void transmitter_tick() {
     currentState = wait_st;
     break;
   case wait_st:
-    // if the run next flag is true, then move on to sending our signal
-    if (running) {
+    // if the run next flag is true, then move on to sending our signal, in our
+    // own slot if shots are time-divided
+    if (running && inOwnSlot()) {
       if (!continuousModeOn)
         running = false; // only run once, unluss continuous mode is on
-      mio_writePin(TRANSMITTER_OUTPUT_PIN, TRANSMITTER_HIGH_VALUE);
-      period = filter_frequencyTickTable[currentFrequency]; // get the most
-                                                            // recent tick count
+      // get the most recent tick count
+      period = sampleRate_ticks(filter_frequencyTickTable[currentFrequency]);
+      burstTicks = sampleRate_ticks(pulseWidth);
+      burstCode = codeSetting;
+      if (burstCode != SHOTCODE_NONE)
+        burstFrame = shotCode_encode(burstCode);
       signalTimer = 0;
+      mio_writePin(TRANSMITTER_OUTPUT_PIN, highValue());
       currentState = sig_high_st;
     }
     break;
@@ -95,7 +132,7 @@ void transmitter_tick() {
     // If the timer has sent a full transmit pulse, go back to the wait state.
     // If continuous mode is on, then the wait state will handle resetting the
     // period with only a small delay.
-    if (signalTimer > pulseWidth) {
+    if (signalTimer > burstTicks) {
       currentState = wait_st;
       // For the second half of the period, stay in the low state. Otherwise
       // move to high.
@@ -105,7 +142,7 @@ void transmitter_tick() {
                                // won't end up in an infinite loop if the timer
                                // somehow skips over the change condition
       currentState = sig_high_st;
-      mio_writePin(TRANSMITTER_OUTPUT_PIN, TRANSMITTER_HIGH_VALUE);
+      mio_writePin(TRANSMITTER_OUTPUT_PIN, highValue());
     }
     break;
   }
@@ -123,6 +160,8 @@ void transmitter_tick() {
     signalTimer++;
     break;
   }
+  if (slotCount && ++slotPhase == frameTicks)
+    slotPhase = 0;
 }
 
 // Activate the transmitter.
@@ -143,6 +182,24 @@ void transmitter_setFrequencyNumber(uint16_t frequencyNumber) {
 // Returns the current frequency setting.
 uint16_t transmitter_getFrequencyNumber() { return currentFrequency; }
 
+// Sets the shooter ID (shotCode.h) sent on each burst, or SHOTCODE_NONE for
+// plain bursts. Like the frequency, it changes between bursts only.
+void transmitter_setCode(int16_t id) { codeSetting = id; }
+
+// Time-division shots (shotSlot.h): bursts only start at the start of slot in
+// a frame of count slots. A count of 0 sends bursts as soon as they are run.
+void transmitter_setSlot(uint16_t slot, uint16_t count) {
+  slotNumber = slot;
+  slotCount = count;
+  slotStart = (uint32_t)slot * sampleRate_ticks(SHOTSLOT_TICKS);
+  frameTicks = shotSlot_frameTicks(count);
+  if (slotPhase >= frameTicks)
+    slotPhase = 0;
+}
+
+// The shared epoch is now: slot 0 starts on the next tick.
+void transmitter_syncSlots() { slotPhase = 0; }
+
 // Runs the transmitter continuously.
 // if continuousModeFlag == true, transmitter runs continuously, otherwise, it
 // transmits one burst and stops. To set continuous mode, you must invoke
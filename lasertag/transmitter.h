@@ -40,6 +40,19 @@ void transmitter_setFrequencyNumber(uint16_t frequencyNumber);
 // Returns the current frequency setting.
 uint16_t transmitter_getFrequencyNumber();
 
+// Sets the shooter ID (shotCode.h) sent on each burst, or SHOTCODE_NONE for
+// plain bursts. Like the frequency, it changes between bursts only.
+void transmitter_setCode(int16_t id);
+
+// Time-division shots (shotSlot.h): bursts only start at the start of slot in
+// a frame of count slots, so a shot run in between waits for it. A count of 0,
+// the default, sends bursts as soon as they are run.
+void transmitter_setSlot(uint16_t slot, uint16_t count);
+
+// The shared epoch is now: slot 0 starts on the next tick. Call it when the
+// beacon or sync burst arrives, like detector_syncSlots().
+void transmitter_syncSlots();
+
 // Runs the transmitter continuously.
 // if continuousModeFlag == true, transmitter runs continuously, otherwise, it
 // transmits one burst and stops. To set continuous mode, you must invoke
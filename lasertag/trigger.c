@@ -1,4 +1,6 @@
 #include "trigger.h"
+#include "instance.h"
+#include "sampleRate.h"
 #include "drivers/buttons.h"
 #include "include/mio.h"
 #include "transmitter.h"
@@ -25,21 +27,22 @@
 
 #define TRIGGER_GUN_TRIGGER_MIO_PIN 10
 #define GUN_TRIGGER_PRESSED 1
-#define MAX_TICKS 5000
+#define MAX_TICKS 5000 // 50 ms at 100 kHz.
 #define BOUNCE_DELAY 5
 
-volatile static bool ignoreGunInput;
-volatile static bool isEnabled;
-volatile static trigger_shotsRemaining_t shotsRemaining;
-volatile static uint64_t ticks = 0;
-volatile static bool triggerPressedFlag = false;
+static INSTANCE_LOCAL volatile bool ignoreGunInput;
+static INSTANCE_LOCAL volatile bool isEnabled;
+static INSTANCE_LOCAL volatile trigger_shotsRemaining_t shotsRemaining;
+static INSTANCE_LOCAL volatile uint64_t ticks = 0;
+static INSTANCE_LOCAL volatile bool triggerPressedFlag = false;
+static INSTANCE_LOCAL uint32_t maxTicks = MAX_TICKS; // At the sample rate.
 
 // States for the controller state machine.
 enum trigger_st_t {
   released_st, // Wait here until the button has been pressed continuously for 50ms
   pressed_st   // Wait here until the button has been released continuously for 50ms
 };
-volatile static enum trigger_st_t currentState;
+static INSTANCE_LOCAL volatile enum trigger_st_t currentState;
 
 // Trigger can be activated by either btn0 or the external gun that is attached to TRIGGER_GUN_TRIGGER_MIO_PIN
 // Gun input is ignored if the gun-input is high when the init() function is invoked.
@@ -59,6 +62,7 @@ void trigger_init() {
   triggerPressedFlag = false;
   currentState = released_st;
   ticks = 0;
+  maxTicks = sampleRate_ticks(MAX_TICKS);
 
   mio_setPinAsInput(TRIGGER_GUN_TRIGGER_MIO_PIN);
   // If the trigger is pressed when trigger_init() is called, assume that the gun is not connected and ignore it.
@@ -75,7 +79,7 @@ void trigger_tick() {
   // State updates
   switch (currentState) {
   case released_st:
-    if (ticks >= MAX_TICKS) {
+    if (ticks >= maxTicks) {
       DPCHAR('D');
       DPCHAR('\n');
       ticks = 0;
@@ -85,7 +89,7 @@ void trigger_tick() {
     }
     break;
   case pressed_st:
-    if (ticks >= MAX_TICKS) {
+    if (ticks >= maxTicks) {
       DPCHAR('U');
       DPCHAR('\n');
       ticks = 0;
@@ -128,8 +132,13 @@ void trigger_enable() {
 }
 
 // Disable the trigger state machine so that trigger presses are ignored.
+// It stops as released, so a press it was in the middle of does not stay
+// reported while it is off.
 void trigger_disable() {
   isEnabled = false;
+  triggerPressedFlag = false;
+  currentState = released_st;
+  ticks = 0;
 }
 
 // Returns the number of remaining shots.
@@ -142,7 +151,8 @@ void trigger_setRemainingShotCount(trigger_shotsRemaining_t count) {
   shotsRemaining = count;
 }
 
-void trigger_isPressed() {
+// Returns true while a debounced trigger press is in progress.
+bool trigger_isPressed() {
   return triggerPressedFlag;
 }
 
@@ -10,6 +10,7 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #ifndef TRIGGER_H_
 #define TRIGGER_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 // The trigger state machine debounces both the press and release of gun
@@ -33,6 +34,8 @@ void trigger_tick();
 void trigger_enable();
 
 // Disable the trigger state machine so that trigger presses are ignored.
+// trigger_isPressed() then returns false until the trigger is enabled and
+// pressed again.
 void trigger_disable();
 
 // Returns the number of remaining shots.
@@ -41,6 +44,9 @@ trigger_shotsRemaining_t trigger_getRemainingShotCount();
 // Sets the number of remaining shots.
 void trigger_setRemainingShotCount(trigger_shotsRemaining_t count);
 
+// Returns true while a debounced trigger press is in progress.
+bool trigger_isPressed();
+
 // Runs the test continuously until BTN3 is pressed.
 // The test just prints out a 'D' when the trigger or BTN0
 // is pressed, and a 'U' when the trigger or BTN0 is released.
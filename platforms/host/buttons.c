@@ -0,0 +1,18 @@
+// Simulated push buttons for the host build.
+
+#include "buttons.h"
+#include "hostSim.h"
+
+static INSTANCE_LOCAL int32_t buttonValues = 0;
+
+// Nothing to initialize in the simulation.
+int32_t buttons_init() { return BUTTONS_INIT_STATUS_OK; }
+
+// Returns the value set with hostSim_setButtons().
+int32_t buttons_read() { return buttonValues; }
+
+// There is nothing to look at on the host.
+void buttons_runTest() {}
+
+// Set the value returned by buttons_read().
+void hostSim_setButtons(int32_t value) { buttonValues = value; }
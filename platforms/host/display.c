@@ -0,0 +1,147 @@
+// Headless TFT for the host build. Nothing is drawn; each drawing call only
+// reports how many pixels it would have touched so simulators can charge the
+// cost of display updates to the main loop (see hostSim_setDisplayHook()).
+
+#include <string.h>
+
+#include "display.h"
+#include "hostSim.h"
+
+static INSTANCE_LOCAL hostSim_displayHook_t displayHook = NULL;
+static INSTANCE_LOCAL int16_t cursorX = 0;
+static INSTANCE_LOCAL int16_t cursorY = 0;
+static INSTANCE_LOCAL uint8_t textSize = 1;
+static INSTANCE_LOCAL uint8_t rotation = DISPLAY_LANDSCAPE_MODE_ORIGIN_UPPER_LEFT;
+
+// Install a function that is told the pixel count of every drawing call.
+void hostSim_setDisplayHook(hostSim_displayHook_t hook) { displayHook = hook; }
+
+// Report pixels touched by a drawing call.
+static void touch(int32_t pixels) {
+  if (displayHook && pixels > 0)
+    displayHook((uint32_t)pixels);
+}
+
+// Text is drawn as one character cell per char.
+static size_t touchText(size_t chars) {
+  touch((int32_t)(chars * DISPLAY_CHAR_WIDTH * DISPLAY_CHAR_HEIGHT * textSize *
+                  textSize));
+  cursorX += chars * DISPLAY_CHAR_WIDTH * textSize;
+  return chars;
+}
+
+static int16_t absDiff(int16_t a, int16_t b) { return a > b ? a - b : b - a; }
+
+void display_init() {
+  cursorX = cursorY = 0;
+  textSize = 1;
+}
+
+void display_drawPixel(int16_t x0, int16_t y0, uint16_t color) { touch(1); }
+void display_drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                      uint16_t color) {
+  int16_t dx = absDiff(x0, x1), dy = absDiff(y0, y1);
+  touch((dx > dy ? dx : dy) + 1);
+}
+void display_drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  touch(h);
+}
+void display_drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  touch(w);
+}
+void display_drawRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                      uint16_t color) {
+  touch(2 * (w + h));
+}
+void display_fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                      uint16_t color) {
+  touch((int32_t)w * h);
+}
+void display_fillScreen(uint16_t color) {
+  touch((int32_t)DISPLAY_WIDTH * DISPLAY_HEIGHT);
+}
+void display_invertDisplay(bool i) {}
+void display_drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+  touch(6 * r);
+}
+void display_fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+  touch(3 * r * r);
+}
+void display_drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                          int16_t x2, int16_t y2, uint16_t color) {
+  display_drawLine(x0, y0, x1, y1, color);
+  display_drawLine(x1, y1, x2, y2, color);
+  display_drawLine(x2, y2, x0, y0, color);
+}
+void display_fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                          int16_t x2, int16_t y2, uint16_t color) {
+  int32_t area = ((int32_t)(x1 - x0) * (y2 - y0) - (int32_t)(x2 - x0) * (y1 - y0)) / 2;
+  touch(area < 0 ? -area : area);
+}
+void display_drawRoundRect(int16_t x0, int16_t y0, int16_t w, int16_t h,
+                           int16_t radius, uint16_t color) {
+  touch(2 * (w + h));
+}
+void display_fillRoundRect(int16_t x0, int16_t y0, int16_t w, int16_t h,
+                           int16_t radius, uint16_t color) {
+  touch((int32_t)w * h);
+}
+void display_drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w,
+                        int16_t h, uint16_t color) {
+  touch((int32_t)w * h);
+}
+void display_drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color,
+                      uint16_t bg, uint8_t size) {
+  touch(DISPLAY_CHAR_WIDTH * DISPLAY_CHAR_HEIGHT * size * size);
+}
+void display_setCursor(int16_t x, int16_t y) {
+  cursorX = x;
+  cursorY = y;
+}
+void display_setTextColor(uint16_t c) {}
+void display_setTextColorBg(uint16_t c, uint16_t bg) {}
+void display_setTextSize(uint8_t s) { textSize = s; }
+void display_setTextWrap(bool w) {}
+void display_setRotation(uint8_t r) { rotation = r; }
+int16_t display_height() {
+  return rotation % 2 ? DISPLAY_HEIGHT : DISPLAY_WIDTH;
+}
+int16_t display_width() {
+  return rotation % 2 ? DISPLAY_WIDTH : DISPLAY_HEIGHT;
+}
+uint16_t display_color565(uint8_t r, uint8_t g, uint8_t b) {
+  return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+size_t display_println(const char str[]) { return touchText(strlen(str)); }
+size_t display_printlnChar(char c) { return touchText(1); }
+size_t display_printlnDecimalInt(int num) { return display_printDecimalInt(num); }
+size_t display_print(const char str[]) { return touchText(strlen(str)); }
+size_t display_printChar(char c) { return touchText(1); }
+size_t display_printDecimalInt(int num) {
+  size_t digits = num < 0 ? 2 : 1;
+  for (int n = num / 10; n; n /= 10)
+    digits++;
+  return touchText(digits);
+}
+
+unsigned long display_testLines(uint16_t color) { return 0; }
+unsigned long display_testFastLines(uint16_t color1, uint16_t color2) { return 0; }
+unsigned long display_testRects(uint16_t color) { return 0; }
+unsigned long display_testFilledRects(uint16_t color1, uint16_t color2) { return 0; }
+unsigned long display_testFilledCircles(uint8_t radius, uint16_t color) { return 0; }
+unsigned long display_testCircles(uint8_t radius, uint16_t color) { return 0; }
+unsigned long display_testTriangles() { return 0; }
+unsigned long display_testFilledTriangles() { return 0; }
+unsigned long display_testRoundRects() { return 0; }
+unsigned long display_testFilledRoundRects() { return 0; }
+unsigned long display_testFillScreen() { return 0; }
+unsigned long display_testText() { return 0; }
+unsigned long display_test() { return 0; }
+
+bool display_isTouched(void) { return false; }
+void display_getTouchedPoint(int16_t *x, int16_t *y, uint8_t *z) {
+  *x = *y = 0;
+  *z = 0;
+}
+void display_clearOldTouchData() {}
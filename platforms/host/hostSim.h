@@ -0,0 +1,142 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef HOSTSIM_H_
+#define HOSTSIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "instance.h"
+
+// Controls for the simulated hardware layer used by the host build.
+// The interrupts_*, mio_*, buttons_*, switches_*, leds_*, intervalTimer_*
+// and utils_* functions in this directory stand in for libzybo.a so the
+// lasertag core can run natively. Time does not advance on its own: the
+// private timer only "fires" when hostSim_advanceTicks() or utils_msDelay()
+// is called, which makes every host run deterministic.
+
+// Number of ADC samples/ISR invocations per simulated second with the default
+// private-timer load value.
+#define HOSTSIM_DEFAULT_TICKS_PER_SECOND 100000
+
+// Mid-scale ADC reading, i.e. no light on the sensor.
+#define HOSTSIM_ADC_IDLE_VALUE 2048
+
+// Supplies the next ADC sample. Called once per simulated timer tick.
+typedef uint32_t (*hostSim_adcSource_t)(void);
+
+// Called once per simulated timer tick, before isr_function().
+typedef void (*hostSim_tickHook_t)(void);
+
+// Told how many pixels each display_* drawing call touches.
+typedef void (*hostSim_displayHook_t)(uint32_t pixels);
+
+// Returns the current time in seconds for the interval timers.
+typedef double (*hostSim_timeSource_t)(void);
+
+// Advance the simulated clock by tickCount private-timer periods. The ISR is
+// invoked once per tick if the timer is running and both the timer and ARM
+// interrupts are enabled.
+void hostSim_advanceTicks(uint32_t tickCount);
+
+// Number of private-timer periods that have elapsed since start-up.
+uint64_t hostSim_getTickCount(void);
+
+// True if the private timer is running and its interrupt is enabled, i.e. a
+// tick raises an IRQ (which is only taken while ARM interrupts are enabled).
+bool hostSim_timerIrqEnabled(void);
+
+// True between interrupts_enableArmInts() and interrupts_disableArmInts().
+bool hostSim_armIntsEnabled(void);
+
+// Set a constant ADC reading. Ignored while an ADC source is installed.
+void hostSim_setAdcValue(uint32_t value);
+
+// Install a function that produces each ADC sample. NULL removes it.
+void hostSim_setAdcSource(hostSim_adcSource_t source);
+
+// Install a function that runs on every tick before the ISR. NULL removes it.
+void hostSim_setTickHook(hostSim_tickHook_t hook);
+
+// Set the value returned by buttons_read().
+void hostSim_setButtons(int32_t value);
+
+// Set the value returned by switches_read().
+void hostSim_setSwitches(int32_t value);
+
+// Drive an MIO input pin, e.g. the gun trigger.
+void hostSim_setMioPin(uint8_t pin, uint8_t value);
+
+// Read back an MIO pin, e.g. the transmitter output.
+uint8_t hostSim_getMioPin(uint8_t pin);
+
+// Returns the last value written with leds_write().
+int32_t hostSim_getLeds(void);
+
+// Install a function that is told the pixel count of every drawing call.
+void hostSim_setDisplayHook(hostSim_displayHook_t hook);
+
+// Make the interval timers read a simulated clock instead of CLOCK_MONOTONIC,
+// so timing decisions in the firmware are deterministic. NULL restores the
+// wall clock.
+void hostSim_setTimeSource(hostSim_timeSource_t source);
+
+// Turn the firmware's character output (DPCHAR(), xil_printf()) on or off.
+// Simulators with many guns use this to keep the console readable.
+void hostSim_setConsoleEnabled(bool enabled);
+
+// Simulated Bluetooth UART (uartLite.c): an XUartLite with 16-byte receive and
+// transmit FIFOs, moving one byte per character time (10 bits) as simulated
+// ticks pass. The "peer" is the phone at the other end of the radio link.
+#define HOSTSIM_UART_DEFAULT_BAUD_RATE 9600
+#define HOSTSIM_UART_FIFO_SIZE 16
+
+// Called like the GIC would when the UART interrupt is raised.
+typedef void (*hostSim_uartIsr_t)(void *callBackRef);
+
+// Set the line rate. The real UART Lite's rate is fixed when the hardware is
+// built; the simulation lets it be anything.
+void hostSim_uartSetBaudRate(uint32_t baudRate);
+
+// Connect the handler for the UART interrupt. NULL disconnects it, which
+// leaves the UART to be polled.
+void hostSim_uartConnectIsr(hostSim_uartIsr_t isr, void *callBackRef);
+
+// Queue bytes for the peer to send. Returns how many fitted.
+uint32_t hostSim_uartPeerSend(const uint8_t *data, uint32_t size);
+
+// Returns how many queued peer bytes have not gone over the line yet.
+uint32_t hostSim_uartPeerPending(void);
+
+// Take up to maxSize of the bytes the peer has received.
+uint32_t hostSim_uartPeerReceive(uint8_t *data, uint32_t maxSize);
+
+// Returns how many received bytes were lost because the receive FIFO was full.
+uint32_t hostSim_uartGetOverrunCount(void);
+
+// Returns how many times the UART interrupt handler was called.
+uint32_t hostSim_uartGetInterruptCount(void);
+
+// Moves the line on by one tick. Called by hostSim_advanceTicks().
+void hostSim_uartTick(void);
+
+// Simulated SD card (sdPs.c): the parts of the xsdps driver that journalSd.c
+// uses, reading and writing an image file. The image holds the card from
+// firstSector on, like a dd of that region, so sectors before it read as
+// zero and cannot be written. Without an image there is no card.
+void hostSim_sdSetImage(const char *path, uint32_t firstSector);
+
+// Returns how many write commands the card has taken, and how many sectors.
+uint32_t hostSim_sdGetWriteCount(void);
+uint32_t hostSim_sdGetSectorsWritten(void);
+
+#endif /* HOSTSIM_H_ */
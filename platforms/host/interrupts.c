@@ -0,0 +1,159 @@
+// Simulated interrupt layer for the host build. The private timer is a
+// counter that hostSim_advanceTicks() steps; each step calls isr_function()
+// exactly as timerIsr() does on the board.
+
+#include <stdio.h>
+
+#include "hostSim.h"
+#include "interrupts.h"
+#include "intervalTimer.h"
+#include "leds.h"
+
+// Same bus clock and load value as the board so tick rates stay identical.
+#define HOST_BUS_CLOCK 325000000
+#define PRIVATE_TIMER_LOAD_VALUE_DEFAULT 3249 // Provides a 10 us period.
+#define HEARTBEAT_TOGGLES_PER_SECOND 8
+
+INSTANCE_LOCAL volatile int interrupts_isrFlagGlobal = 0;
+
+static INSTANCE_LOCAL bool armIntsEnabled = false;
+static INSTANCE_LOCAL bool timerGlobalIntsEnabled = false;
+static INSTANCE_LOCAL bool timerRunning = false;
+
+static INSTANCE_LOCAL u32 privateTimerLoadValue = PRIVATE_TIMER_LOAD_VALUE_DEFAULT;
+static INSTANCE_LOCAL u32 privateTimerPrescaler = 0;
+static INSTANCE_LOCAL u32 isrInvocationCount = 0;
+static INSTANCE_LOCAL uint64_t tickCount = 0;
+static INSTANCE_LOCAL u32 heartBeatTimer = 0;
+static INSTANCE_LOCAL int heartBeatLedValue = 0;
+
+static INSTANCE_LOCAL uint32_t adcValue = HOSTSIM_ADC_IDLE_VALUE;
+static INSTANCE_LOCAL hostSim_adcSource_t adcSource = NULL;
+static INSTANCE_LOCAL hostSim_tickHook_t tickHook = NULL;
+
+// Toggle LD4 at the same rate as the board.
+static void updateHeartBeatLed() {
+  if (!heartBeatTimer) {
+    heartBeatTimer =
+        interrupts_getPrivateTimerTicksPerSecond() / HEARTBEAT_TOGGLES_PER_SECOND;
+    heartBeatLedValue = !heartBeatLedValue;
+    leds_writeLd4(heartBeatLedValue);
+  } else {
+    heartBeatTimer--;
+  }
+}
+
+// Body of the board's timerIsr().
+static void timerIsr() {
+  intervalTimer_start(INTERRUPT_CUMULATIVE_ISR_INTERVAL_TIMER_NUMBER);
+  updateHeartBeatLed();
+  isr_function(); // This function is defined in isr.c
+  isrInvocationCount++;
+  interrupts_isrFlagGlobal = 1;
+  intervalTimer_stop(INTERRUPT_CUMULATIVE_ISR_INTERVAL_TIMER_NUMBER);
+}
+
+// Advance the simulated clock by tickCount private-timer periods. The ISR is
+// invoked once per tick if the timer is running and both the timer and ARM
+// interrupts are enabled.
+void hostSim_advanceTicks(uint32_t ticks) {
+  for (uint32_t i = 0; i < ticks; i++) {
+    tickCount++;
+    hostSim_uartTick();
+    if (tickHook)
+      tickHook();
+    if (hostSim_timerIrqEnabled() && armIntsEnabled)
+      timerIsr();
+  }
+}
+
+// True if the private timer is running and its interrupt is enabled.
+bool hostSim_timerIrqEnabled(void) {
+  return timerRunning && timerGlobalIntsEnabled;
+}
+
+// True between interrupts_enableArmInts() and interrupts_disableArmInts().
+bool hostSim_armIntsEnabled(void) { return armIntsEnabled; }
+
+// Number of private-timer periods that have elapsed since start-up.
+uint64_t hostSim_getTickCount(void) { return tickCount; }
+
+// Set a constant ADC reading. Ignored while an ADC source is installed.
+void hostSim_setAdcValue(uint32_t value) { adcValue = value; }
+
+// Install a function that produces each ADC sample. NULL removes it.
+void hostSim_setAdcSource(hostSim_adcSource_t source) { adcSource = source; }
+
+// Install a function that runs on every tick before the ISR. NULL removes it.
+void hostSim_setTickHook(hostSim_tickHook_t hook) { tickHook = hook; }
+
+int interrupts_initAll(bool printFailedStatusFlag) {
+  (void)printFailedStatusFlag; // Nothing can fail in the simulation.
+  return 0;
+}
+
+int interrupts_enableArmInts() {
+  armIntsEnabled = true;
+  return 0;
+}
+
+int interrupts_disableArmInts() {
+  armIntsEnabled = false;
+  return 0;
+}
+
+int interrupts_enableTimerGlobalInts() {
+  timerGlobalIntsEnabled = true;
+  return 0;
+}
+
+int interrupts_disableTimerGlobalInts() {
+  timerGlobalIntsEnabled = false;
+  return 0;
+}
+
+int interrupts_startArmPrivateTimer() {
+  timerRunning = true;
+  return 0;
+}
+
+int interrupts_stopArmPrivateTimer() {
+  timerRunning = false;
+  return 0;
+}
+
+// The simulated counter counts ticks, not bus cycles.
+u32 interrupts_getPrivateTimerCounterValue(void) { return (u32)tickCount; }
+
+void interrupts_setPrivateTimerLoadValue(u32 loadValue) {
+  privateTimerLoadValue = loadValue;
+}
+
+void interrupts_setPrivateTimerPrescalerValue(u32 prescalerValue) {
+  privateTimerPrescaler = prescalerValue;
+}
+
+// Keep track of total number of times the timer ISR is invoked.
+u32 interrupts_isrInvocationCount() { return isrInvocationCount; }
+
+// Returns the number of private timer ticks that occur in 1 second.
+u32 interrupts_getPrivateTimerTicksPerSecond() {
+  return HOST_BUS_CLOCK /
+         ((privateTimerPrescaler + 1) * (privateTimerLoadValue + 1));
+}
+
+// The simulated ADC is always in unipolar mode.
+bool interrupts_getAdcInputMode() { return INTERRUPTS_ADC_UNIPOLAR_MODE; }
+
+// Returns the next simulated ADC conversion.
+uint32_t interrupts_getAdcData() {
+  return adcSource ? adcSource() : adcValue;
+}
+
+// One conversion per tick.
+u32 interrupts_getTotalEocCount() { return (u32)tickCount; }
+
+uint32_t interrupts_initBluetoothInterrupts() { return 0; }
+void interrupts_enableBluetoothInterrupts() {}
+void interrupts_disableBluetoothInterrupts() {}
+void interrupts_ackBluetoothInterrupts() {}
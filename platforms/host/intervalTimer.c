@@ -0,0 +1,93 @@
+// Interval timers for the host build. By default they measure real
+// (wall-clock) time with CLOCK_MONOTONIC so run-time statistics and benchmarks
+// report how long the host actually spent, just as the hardware timers do on
+// the board. Simulators can substitute a simulated clock.
+
+#include <stdbool.h>
+#include <time.h>
+
+#include "hostSim.h"
+#include "intervalTimer.h"
+
+#define INTERVAL_TIMER_COUNT 3
+#define NANOSECONDS_PER_SECOND 1000000000.0
+
+typedef struct {
+  bool running;
+  double startTime;
+  double accumulatedSeconds;
+} intervalTimer_t;
+
+static INSTANCE_LOCAL intervalTimer_t timers[INTERVAL_TIMER_COUNT];
+static INSTANCE_LOCAL hostSim_timeSource_t timeSource = NULL;
+
+// Current time in seconds from the selected clock.
+static double now() {
+  if (timeSource)
+    return timeSource();
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / NANOSECONDS_PER_SECOND;
+}
+
+// Make the interval timers read a simulated clock. NULL restores the wall
+// clock.
+void hostSim_setTimeSource(hostSim_timeSource_t source) { timeSource = source; }
+
+intervalTimer_status_t intervalTimer_init(uint32_t timerNumber) {
+  if (timerNumber >= INTERVAL_TIMER_COUNT)
+    return INTERVAL_TIMER_STATUS_FAIL;
+  intervalTimer_reset(timerNumber);
+  return INTERVAL_TIMER_STATUS_OK;
+}
+
+intervalTimer_status_t intervalTimer_initAll() {
+  for (uint32_t i = 0; i < INTERVAL_TIMER_COUNT; i++)
+    intervalTimer_init(i);
+  return INTERVAL_TIMER_STATUS_OK;
+}
+
+void intervalTimer_start(uint32_t timerNumber) {
+  if (timerNumber >= INTERVAL_TIMER_COUNT || timers[timerNumber].running)
+    return;
+  timers[timerNumber].startTime = now();
+  timers[timerNumber].running = true;
+}
+
+void intervalTimer_stop(uint32_t timerNumber) {
+  if (timerNumber >= INTERVAL_TIMER_COUNT || !timers[timerNumber].running)
+    return;
+  timers[timerNumber].accumulatedSeconds += now() - timers[timerNumber].startTime;
+  timers[timerNumber].running = false;
+}
+
+void intervalTimer_reset(uint32_t timerNumber) {
+  if (timerNumber >= INTERVAL_TIMER_COUNT)
+    return;
+  timers[timerNumber].accumulatedSeconds = 0.0;
+  timers[timerNumber].startTime = now();
+}
+
+void intervalTimer_resetAll() {
+  for (uint32_t i = 0; i < INTERVAL_TIMER_COUNT; i++)
+    intervalTimer_reset(i);
+}
+
+// Includes the time since start() if the timer is still running.
+double intervalTimer_getTotalDurationInSeconds(uint32_t timerNumber) {
+  if (timerNumber >= INTERVAL_TIMER_COUNT)
+    return 0.0;
+  double seconds = timers[timerNumber].accumulatedSeconds;
+  if (timers[timerNumber].running)
+    seconds += now() - timers[timerNumber].startTime;
+  return seconds;
+}
+
+intervalTimer_status_t intervalTimer_test(uint32_t timerNumber) {
+  return timerNumber < INTERVAL_TIMER_COUNT ? INTERVAL_TIMER_STATUS_OK
+                                            : INTERVAL_TIMER_STATUS_FAIL;
+}
+
+intervalTimer_status_t intervalTimer_testAll() {
+  return INTERVAL_TIMER_STATUS_OK;
+}
@@ -0,0 +1,28 @@
+// Simulated LEDs for the host build.
+
+#include "hostSim.h"
+#include "leds.h"
+
+#define LEDS_MASK 0xF
+
+static INSTANCE_LOCAL int32_t ledValues = 0;
+static INSTANCE_LOCAL int32_t ld4Value = 0;
+
+// Nothing to initialize in the simulation.
+int32_t leds_init(bool printFailedStatusFlag) {
+  (void)printFailedStatusFlag;
+  ledValues = 0;
+  return 1;
+}
+
+// This write the lower 4 bits of ledValue to the LEDs.
+void leds_write(int32_t ledValue) { ledValues = ledValue & LEDS_MASK; }
+
+// These control the LED LD4 attached to MIO 7 on the ZYBO board.
+void leds_writeLd4(int32_t ledValue) { ld4Value = ledValue; }
+
+// There is nothing to look at on the host.
+int32_t leds_runTest() { return 1; }
+
+// Returns the last value written with leds_write().
+int32_t hostSim_getLeds(void) { return ledValues; }
@@ -0,0 +1,65 @@
+// Simulated MIO pins for the host build. Pins are plain bytes that the
+// firmware writes and the simulation reads back (or vice versa).
+
+#include <stdio.h>
+
+#include "hostSim.h"
+#include "mio.h"
+
+#define MIO_PIN_COUNT 54
+
+static INSTANCE_LOCAL u8 pinValues[MIO_PIN_COUNT];
+static INSTANCE_LOCAL u8 pinDirections[MIO_PIN_COUNT];
+
+// Needs to be called before trying to read or write MIO pins.
+int32_t mio_init(bool printFailedStatusFlag) {
+  (void)printFailedStatusFlag;
+  return 0;
+}
+
+// Reads an MIO pin.
+u8 mio_readPin(u8 mioPinNumber) {
+  return mioPinNumber < MIO_PIN_COUNT ? pinValues[mioPinNumber] : 0;
+}
+
+// Writes an MIO pin. Writes to input pins are ignored, as on the board.
+void mio_writePin(u8 mioPinNumber, u8 value) {
+  if (mioPinNumber < MIO_PIN_COUNT &&
+      pinDirections[mioPinNumber] == MIO_OUTPUT_PIN_CONFIGURATION)
+    pinValues[mioPinNumber] = value ? 1 : 0;
+}
+
+// Writes 16 bits to bank 0.
+void mio_WriteBank0(u32 value) {
+  for (u8 pin = 0; pin < 16; pin++)
+    mio_writePin(pin, (value >> pin) & 1);
+}
+
+// Reads 16 bits from bank 0.
+uint16_t mio_readBank0() {
+  uint16_t value = 0;
+  for (u8 pin = 0; pin < 16; pin++)
+    value |= (uint16_t)pinValues[pin] << pin;
+  return value;
+}
+
+// Set MIO pin as input from ZYNQ perspective.
+void mio_setPinAsInput(u8 mioPinNo) {
+  if (mioPinNo < MIO_PIN_COUNT)
+    pinDirections[mioPinNo] = MIO_INPUT_PIN_CONFIGURATION;
+}
+
+// Set MIO pin as output and enabled it, from ZYNQ perspective.
+void mio_setPinAsOutput(u8 mioPinNo) {
+  if (mioPinNo < MIO_PIN_COUNT)
+    pinDirections[mioPinNo] = MIO_OUTPUT_PIN_CONFIGURATION;
+}
+
+// Drive an MIO input pin, e.g. the gun trigger.
+void hostSim_setMioPin(uint8_t pin, uint8_t value) {
+  if (pin < MIO_PIN_COUNT)
+    pinValues[pin] = value ? 1 : 0;
+}
+
+// Read back an MIO pin, e.g. the transmitter output.
+uint8_t hostSim_getMioPin(uint8_t pin) { return mio_readPin(pin); }
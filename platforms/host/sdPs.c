@@ -0,0 +1,87 @@
+// Simulated SD card for the host build: the parts of the xsdps driver that
+// journalSd.c uses, on top of an image file. The card is high-capacity, so it
+// is addressed in sectors. Reads past the end of the image return zeros, as an
+// erased card would.
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hostSim.h"
+#include "xsdps.h"
+
+#define SECTOR_SIZE 512
+#define IMAGE_PATH_SIZE 256
+
+static INSTANCE_LOCAL XSdPs_Config config;
+static INSTANCE_LOCAL char imagePath[IMAGE_PATH_SIZE];
+static INSTANCE_LOCAL uint32_t imageFirstSector;
+static INSTANCE_LOCAL int imageFd = -1;
+static INSTANCE_LOCAL uint32_t writeCount;
+static INSTANCE_LOCAL uint32_t sectorsWritten;
+
+/*****************************************************************************
+***** Driver functions used by journalSd.c
+*****************************************************************************/
+
+XSdPs_Config *XSdPs_LookupConfig(u16 DeviceId) {
+  config.DeviceId = DeviceId;
+  return &config;
+}
+
+s32 XSdPs_CfgInitialize(XSdPs *InstancePtr, XSdPs_Config *ConfigPtr, u32 EffectiveAddr) {
+  memset(InstancePtr, 0, sizeof(*InstancePtr));
+  InstancePtr->Config = *ConfigPtr;
+  InstancePtr->Config.BaseAddress = EffectiveAddr;
+  InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+  return XST_SUCCESS;
+}
+
+// Fails when no image is set, as with no card in the slot.
+s32 XSdPs_CardInitialize(XSdPs *InstancePtr) {
+  if (imageFd >= 0)
+    close(imageFd);
+  imageFd = imagePath[0] ? open(imagePath, O_RDWR | O_CREAT, 0644) : -1;
+  if (imageFd < 0)
+    return XST_FAILURE;
+  InstancePtr->HCS = 1;
+  writeCount = sectorsWritten = 0;
+  return XST_SUCCESS;
+}
+
+s32 XSdPs_ReadPolled(XSdPs *InstancePtr, u32 Arg, u32 BlkCnt, u8 *Buff) {
+  (void)InstancePtr;
+  memset(Buff, 0, BlkCnt * SECTOR_SIZE);
+  for (u32 i = 0; i < BlkCnt; i++)
+    if (Arg + i >= imageFirstSector &&
+        pread(imageFd, Buff + i * SECTOR_SIZE, SECTOR_SIZE,
+              (off_t)(Arg + i - imageFirstSector) * SECTOR_SIZE) < 0)
+      return XST_FAILURE;
+  return XST_SUCCESS;
+}
+
+s32 XSdPs_WritePolled(XSdPs *InstancePtr, u32 Arg, u32 BlkCnt, const u8 *Buff) {
+  (void)InstancePtr;
+  size_t size = (size_t)BlkCnt * SECTOR_SIZE;
+  if (Arg < imageFirstSector ||
+      pwrite(imageFd, Buff, size, (off_t)(Arg - imageFirstSector) * SECTOR_SIZE) !=
+          (ssize_t)size)
+    return XST_FAILURE;
+  writeCount++;
+  sectorsWritten += BlkCnt;
+  return XST_SUCCESS;
+}
+
+/*****************************************************************************
+***** Controls
+*****************************************************************************/
+
+// Use the image file at path for the card from firstSector on.
+void hostSim_sdSetImage(const char *path, uint32_t firstSector) {
+  strncpy(imagePath, path ? path : "", sizeof(imagePath) - 1);
+  imageFirstSector = firstSector;
+}
+
+uint32_t hostSim_sdGetWriteCount(void) { return writeCount; }
+
+uint32_t hostSim_sdGetSectorsWritten(void) { return sectorsWritten; }
@@ -0,0 +1,60 @@
+// Silent sound driver for the host build. The state machine keeps the same
+// timing as the board (48 kHz samples clocked from the timer tick) so
+// sound_isBusy() behaves the same, but no audio is produced.
+
+#include "instance.h"
+#include "interrupts.h"
+#include "sound.h"
+
+#define SOUND_SAMPLE_RATE 48000
+#define SOUND_DEFAULT_LENGTH_IN_SAMPLES SOUND_SAMPLE_RATE // One second.
+
+static INSTANCE_LOCAL bool playing = false;
+static INSTANCE_LOCAL sound_sounds_t currentSound = sound_gameStart_e;
+static INSTANCE_LOCAL uint32_t samplesRemaining = 0;
+static INSTANCE_LOCAL uint32_t tickAccumulator = 0;
+
+sound_status_t sound_init() {
+  playing = false;
+  samplesRemaining = 0;
+  tickAccumulator = 0;
+  return SOUND_STATUS_OK;
+}
+
+// Count off one sample every ticks-per-second / SOUND_SAMPLE_RATE ticks.
+void sound_tick() {
+  if (!playing)
+    return;
+  uint32_t ticksPerSecond = interrupts_getPrivateTimerTicksPerSecond();
+  tickAccumulator += SOUND_SAMPLE_RATE;
+  if (tickAccumulator >= ticksPerSecond) {
+    tickAccumulator -= ticksPerSecond;
+    if (samplesRemaining && --samplesRemaining == 0)
+      playing = false;
+  }
+}
+
+void sound_playSound(sound_sounds_t sound) {
+  sound_setSound(sound);
+  sound_startSound();
+}
+
+bool sound_isBusy() { return playing; }
+
+bool sound_isSoundComplete() { return !playing; }
+
+void sound_setSound(sound_sounds_t sound) { currentSound = sound; }
+
+void sound_setVolume(sound_volume_t volume) { (void)volume; }
+
+void sound_startSound() {
+  samplesRemaining = SOUND_DEFAULT_LENGTH_IN_SAMPLES;
+  playing = true;
+}
+
+void sound_stopSound() {
+  playing = false;
+  samplesRemaining = 0;
+}
+
+void sound_runTest() {}
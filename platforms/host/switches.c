@@ -0,0 +1,18 @@
+// Simulated slide switches for the host build.
+
+#include "hostSim.h"
+#include "switches.h"
+
+static INSTANCE_LOCAL int32_t switchValues = 0;
+
+// Nothing to initialize in the simulation.
+int32_t switches_init() { return SWITCHES_INIT_STATUS_OK; }
+
+// Returns the value set with hostSim_setSwitches().
+int32_t switches_read() { return switchValues; }
+
+// There is nothing to look at on the host.
+void switches_runTest() {}
+
+// Set the value returned by switches_read().
+void hostSim_setSwitches(int32_t value) { switchValues = value; }
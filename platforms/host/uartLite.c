@@ -0,0 +1,175 @@
+// Simulated AXI UART Lite for the host build: the parts of the xuartlite
+// driver that bluetooth.c uses, on top of a model of the line. Each direction
+// has the real part's 16-byte FIFO and moves one byte per character time
+// (start, 8 data and stop bits) as hostSim_advanceTicks() runs. A byte that
+// arrives with the receive FIFO full is lost, as on the board.
+//
+// Like the hardware, the interrupt is raised when the receive FIFO becomes
+// non-empty and when the transmit FIFO becomes empty, if it is enabled in the
+// UART at that moment. As with the GIC, a raised interrupt stays pending while
+// ARM interrupts are masked and is taken once they are enabled.
+
+#include <string.h>
+
+#include "hostSim.h"
+#include "xuartlite.h"
+
+#define BITS_PER_CHARACTER 10
+#define PEER_BUFFER_SIZE (1 << 16) // A power of two.
+#define PEER_BUFFER_MASK (PEER_BUFFER_SIZE - 1)
+
+typedef struct {
+  uint8_t data[HOSTSIM_UART_FIFO_SIZE];
+  uint32_t in, out; // Free-running; count is in - out.
+} fifo_t;
+
+typedef struct {
+  uint8_t data[PEER_BUFFER_SIZE];
+  uint32_t in, out;
+} peerBuffer_t;
+
+static INSTANCE_LOCAL bool initialized;
+static INSTANCE_LOCAL bool interruptEnabled;
+static INSTANCE_LOCAL bool interruptPending;
+static INSTANCE_LOCAL uint32_t baudRate = HOSTSIM_UART_DEFAULT_BAUD_RATE;
+static INSTANCE_LOCAL double characterPhase; // Characters due, fractional.
+static INSTANCE_LOCAL fifo_t receiveFifo, transmitFifo;
+static INSTANCE_LOCAL peerBuffer_t peerOutgoing, peerIncoming;
+static INSTANCE_LOCAL uint32_t overruns;
+static INSTANCE_LOCAL uint32_t interruptCount;
+static INSTANCE_LOCAL hostSim_uartIsr_t connectedIsr;
+static INSTANCE_LOCAL void *connectedCallBackRef;
+
+/*****************************************************************************
+***** Driver functions used by bluetooth.c
+*****************************************************************************/
+
+// Start with empty FIFOs, a quiet line and the interrupt disabled.
+int XUartLite_CfgInitialize(XUartLite *InstancePtr, XUartLite_Config *Config,
+                            UINTPTR EffectiveAddr) {
+  (void)Config;
+  memset(InstancePtr, 0, sizeof(*InstancePtr));
+  InstancePtr->RegBaseAddress = EffectiveAddr;
+  InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+  receiveFifo.in = receiveFifo.out = 0;
+  transmitFifo.in = transmitFifo.out = 0;
+  peerOutgoing.in = peerOutgoing.out = 0;
+  peerIncoming.in = peerIncoming.out = 0;
+  characterPhase = 0;
+  overruns = 0;
+  interruptCount = 0;
+  interruptEnabled = false;
+  interruptPending = false;
+  initialized = true;
+  return XST_SUCCESS;
+}
+
+// Fill the transmit FIFO from the buffer. Returns how many bytes fitted.
+unsigned int XUartLite_Send(XUartLite *InstancePtr, u8 *DataBufferPtr,
+                            unsigned int NumBytes) {
+  unsigned int sent = 0;
+  while (sent < NumBytes && transmitFifo.in - transmitFifo.out < HOSTSIM_UART_FIFO_SIZE)
+    transmitFifo.data[transmitFifo.in++ % HOSTSIM_UART_FIFO_SIZE] = DataBufferPtr[sent++];
+  InstancePtr->Stats.CharactersTransmitted += sent;
+  return sent;
+}
+
+// Empty the receive FIFO into the buffer. Returns how many bytes were read.
+unsigned int XUartLite_Recv(XUartLite *InstancePtr, u8 *DataBufferPtr,
+                            unsigned int NumBytes) {
+  unsigned int received = 0;
+  while (received < NumBytes && receiveFifo.in != receiveFifo.out)
+    DataBufferPtr[received++] = receiveFifo.data[receiveFifo.out++ % HOSTSIM_UART_FIFO_SIZE];
+  InstancePtr->Stats.CharactersReceived += received;
+  return received;
+}
+
+// True while the transmit FIFO still holds bytes.
+int XUartLite_IsSending(XUartLite *InstancePtr) {
+  (void)InstancePtr;
+  return transmitFifo.in != transmitFifo.out;
+}
+
+void XUartLite_ResetFifos(XUartLite *InstancePtr) {
+  (void)InstancePtr;
+  receiveFifo.in = receiveFifo.out = 0;
+  transmitFifo.in = transmitFifo.out = 0;
+}
+
+void XUartLite_EnableInterrupt(XUartLite *InstancePtr) {
+  (void)InstancePtr;
+  interruptEnabled = true;
+}
+
+void XUartLite_DisableInterrupt(XUartLite *InstancePtr) {
+  (void)InstancePtr;
+  interruptEnabled = false;
+}
+
+/*****************************************************************************
+***** The line and the peer
+*****************************************************************************/
+
+// Set the line rate.
+void hostSim_uartSetBaudRate(uint32_t rate) { baudRate = rate; }
+
+// Connect the handler for the UART interrupt.
+void hostSim_uartConnectIsr(hostSim_uartIsr_t isr, void *callBackRef) {
+  connectedIsr = isr;
+  connectedCallBackRef = callBackRef;
+}
+
+// Queue bytes for the peer to send.
+uint32_t hostSim_uartPeerSend(const uint8_t *data, uint32_t size) {
+  uint32_t sent = 0;
+  while (sent < size && peerOutgoing.in - peerOutgoing.out < PEER_BUFFER_SIZE)
+    peerOutgoing.data[peerOutgoing.in++ & PEER_BUFFER_MASK] = data[sent++];
+  return sent;
+}
+
+// Returns how many queued peer bytes have not gone over the line yet.
+uint32_t hostSim_uartPeerPending(void) { return peerOutgoing.in - peerOutgoing.out; }
+
+// Take up to maxSize of the bytes the peer has received.
+uint32_t hostSim_uartPeerReceive(uint8_t *data, uint32_t maxSize) {
+  uint32_t received = 0;
+  while (received < maxSize && peerIncoming.in != peerIncoming.out)
+    data[received++] = peerIncoming.data[peerIncoming.out++ & PEER_BUFFER_MASK];
+  return received;
+}
+
+uint32_t hostSim_uartGetOverrunCount(void) { return overruns; }
+
+uint32_t hostSim_uartGetInterruptCount(void) { return interruptCount; }
+
+// One tick of line time: every character that is due moves in each direction.
+void hostSim_uartTick(void) {
+  if (!initialized)
+    return;
+  characterPhase += (double)baudRate / BITS_PER_CHARACTER / HOSTSIM_DEFAULT_TICKS_PER_SECOND;
+  bool raise = false;
+  while (characterPhase >= 1) {
+    characterPhase -= 1;
+    if (peerOutgoing.in != peerOutgoing.out) {
+      uint8_t byte = peerOutgoing.data[peerOutgoing.out++ & PEER_BUFFER_MASK];
+      if (receiveFifo.in - receiveFifo.out == HOSTSIM_UART_FIFO_SIZE) {
+        overruns++;
+      } else {
+        raise |= receiveFifo.in == receiveFifo.out;
+        receiveFifo.data[receiveFifo.in++ % HOSTSIM_UART_FIFO_SIZE] = byte;
+      }
+    }
+    if (transmitFifo.in != transmitFifo.out) {
+      uint8_t byte = transmitFifo.data[transmitFifo.out++ % HOSTSIM_UART_FIFO_SIZE];
+      if (peerIncoming.in - peerIncoming.out < PEER_BUFFER_SIZE)
+        peerIncoming.data[peerIncoming.in++ & PEER_BUFFER_MASK] = byte;
+      raise |= transmitFifo.in == transmitFifo.out;
+    }
+  }
+  interruptPending |= raise && interruptEnabled;
+  if (interruptPending && connectedIsr && hostSim_armIntsEnabled()) {
+    interruptPending = false;
+    interruptCount++;
+    connectedIsr(connectedCallBackRef);
+  }
+}
@@ -0,0 +1,30 @@
+// utils_* and the BSP console hook for the host build.
+
+#include <stdio.h>
+
+#include "hostSim.h"
+#include "interrupts.h"
+#include "utils.h"
+
+#define MS_PER_SECOND 1000
+
+static INSTANCE_LOCAL bool consoleEnabled = true;
+
+// Delays advance simulated time rather than sleeping, so the ISR keeps running
+// and busy-wait loops in the firmware make progress.
+void utils_msDelay(long ms) {
+  hostSim_advanceTicks(ms * interrupts_getPrivateTimerTicksPerSecond() /
+                       MS_PER_SECOND);
+}
+
+// Nothing to wait on in the simulation; let one tick elapse.
+void utils_sleep() { hostSim_advanceTicks(1); }
+
+// Used by DPCHAR() and xil_printf() in the firmware.
+void outbyte(char c) {
+  if (consoleEnabled)
+    putchar(c);
+}
+
+// Turn the firmware's character output on or off for this gun.
+void hostSim_setConsoleEnabled(bool enabled) { consoleEnabled = enabled; }